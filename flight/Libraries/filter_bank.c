@@ -0,0 +1,228 @@
+/**
+ ******************************************************************************
+ * @addtogroup OpenPilotSystem OpenPilot System
+ * @{
+ * @addtogroup OpenPilotLibraries OpenPilot System Libraries
+ * @{
+ * @file       filter_bank.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Low-pass and notch filters for the gyros and accels. Each
+ *             filter is one or more second order sections, designed with
+ *             the bilinear transform, which run as a cascade on each axis.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "filter_bank.h"
+#include <math.h>
+#include <string.h>
+
+#define F_PI 3.14159265358979323846f
+
+// Private functions
+static int32_t add_stage(struct filter_bank *bank, float b0, float b1, float b2,
+		float a0, float a1, float a2);
+
+/**
+ * Set up a bank without any filters, which passes the samples through
+ * @param[out] bank The filter bank
+ */
+void filter_bank_init(struct filter_bank *bank)
+{
+	memset(bank, 0, sizeof(*bank));
+}
+
+/**
+ * Clear the history of the filters, e.g. after a gap in the samples
+ * @param[in] bank The filter bank
+ */
+void filter_bank_reset(struct filter_bank *bank)
+{
+	memset(bank->state, 0, sizeof(bank->state));
+}
+
+/**
+ * Add a Butterworth low-pass filter to the bank
+ * @param[in] bank The filter bank
+ * @param[in] sample_rate The rate the filter is applied at in Hz
+ * @param[in] cutoff The -3 dB frequency in Hz
+ * @param[in] order The order of the filter, rounded up to an even number
+ * @return 0 if the filter was added, -1 if the bank is full or the
+ * frequency is not below the Nyquist frequency
+ */
+int32_t filter_bank_add_lowpass(struct filter_bank *bank, float sample_rate, float cutoff, uint8_t order)
+{
+	uint8_t sections = (order + 1) / 2;
+
+	if (sections == 0 || bank->num_stages + sections > FILTER_BANK_MAX_STAGES)
+		return -1;
+	if (cutoff <= 0 || cutoff >= sample_rate / 2)
+		return -1;
+
+	float w0 = 2 * F_PI * cutoff / sample_rate;
+	float cos_w0 = cosf(w0);
+	float sin_w0 = sinf(w0);
+
+	for (uint8_t k = 0; k < sections; k++) {
+		// Pairs of Butterworth poles have a quality factor of
+		// 1 / (2 cos(angle from the negative real axis))
+		float q = 1.0f / (2 * cosf((2 * k + 1) * F_PI / (4 * sections)));
+		float alpha = sin_w0 / (2 * q);
+
+		add_stage(bank, (1 - cos_w0) / 2, 1 - cos_w0, (1 - cos_w0) / 2,
+				1 + alpha, -2 * cos_w0, 1 - alpha);
+	}
+
+	return 0;
+}
+
+/**
+ * Add a notch filter to the bank
+ * @param[in] bank The filter bank
+ * @param[in] sample_rate The rate the filter is applied at in Hz
+ * @param[in] center The frequency that is removed in Hz
+ * @param[in] bandwidth The width of the notch at -3 dB in Hz
+ * @return 0 if the filter was added, -1 if the bank is full or the
+ * frequencies are invalid
+ */
+int32_t filter_bank_add_notch(struct filter_bank *bank, float sample_rate, float center, float bandwidth)
+{
+	if (bank->num_stages >= FILTER_BANK_MAX_STAGES)
+		return -1;
+	if (center <= 0 || center >= sample_rate / 2 || bandwidth <= 0)
+		return -1;
+
+	float w0 = 2 * F_PI * center / sample_rate;
+	float cos_w0 = cosf(w0);
+	float alpha = sinf(w0) * bandwidth / (2 * center);
+
+	return add_stage(bank, 1, -2 * cos_w0, 1, 1 + alpha, -2 * cos_w0, 1 - alpha);
+}
+
+/**
+ * Set up a bank with the low-pass and notch filter of one sensor
+ * @param[out] bank The filter bank
+ * @param[in] sample_rate The rate the filters are applied at in Hz
+ * @param[in] cutoff The low-pass cutoff in Hz, 0 to disable it
+ * @param[in] order The order of the low-pass filter
+ * @param[in] center The frequency removed by the notch in Hz, 0 to disable it
+ * @param[in] bandwidth The width of the notch in Hz
+ * @return 0 if the enabled filters were added, -1 if one of them is invalid
+ */
+int32_t filter_bank_configure(struct filter_bank *bank, float sample_rate, float cutoff, uint8_t order,
+		float center, float bandwidth)
+{
+	int32_t ret = 0;
+
+	filter_bank_init(bank);
+	if (cutoff > 0 && filter_bank_add_lowpass(bank, sample_rate, cutoff, order) != 0)
+		ret = -1;
+	if (center > 0 && filter_bank_add_notch(bank, sample_rate, center, bandwidth) != 0)
+		ret = -1;
+
+	return ret;
+}
+
+/**
+ * Append a second order section and restart the filters
+ */
+static int32_t add_stage(struct filter_bank *bank, float b0, float b1, float b2,
+		float a0, float a1, float a2)
+{
+	if (bank->num_stages >= FILTER_BANK_MAX_STAGES)
+		return -1;
+
+	// Normalized, and with the a coefficients negated as CMSIS expects
+	float *c = &bank->coeffs[bank->num_stages * FILTER_BANK_STAGE_COEFFS];
+	c[0] = b0 / a0;
+	c[1] = b1 / a0;
+	c[2] = b2 / a0;
+	c[3] = -a1 / a0;
+	c[4] = -a2 / a0;
+	bank->num_stages++;
+
+#if defined(FILTER_BANK_CMSIS)
+	for (uint8_t axis = 0; axis < FILTER_BANK_AXES; axis++)
+		arm_biquad_cascade_df2T_init_f32(&bank->cmsis[axis], bank->num_stages,
+				bank->coeffs, bank->state[axis]);
+#endif
+
+	filter_bank_reset(bank);
+
+	return 0;
+}
+
+#if defined(FILTER_BANK_CMSIS)
+
+/**
+ * Filter one sample of each axis in place
+ * @param[in] bank The filter bank
+ * @param[in,out] sample The sample of each axis
+ */
+void filter_bank_apply(struct filter_bank *bank, float sample[FILTER_BANK_AXES])
+{
+	if (bank->num_stages == 0)
+		return;
+
+	for (uint8_t axis = 0; axis < FILTER_BANK_AXES; axis++)
+		arm_biquad_cascade_df2T_f32(&bank->cmsis[axis], &sample[axis], &sample[axis], 1);
+}
+
+#else /* FILTER_BANK_CMSIS */
+
+/**
+ * Filter one sample of each axis in place
+ * @param[in] bank The filter bank
+ * @param[in,out] sample The sample of each axis
+ */
+void filter_bank_apply(struct filter_bank *bank, float sample[FILTER_BANK_AXES])
+{
+	const float *c = bank->coeffs;
+
+	// The axes are independent, running them side by side through each
+	// stage keeps the coefficients in registers
+	for (uint8_t stage = 0; stage < bank->num_stages; stage++, c += FILTER_BANK_STAGE_COEFFS) {
+		for (uint8_t axis = 0; axis < FILTER_BANK_AXES; axis++) {
+			float *d = &bank->state[axis][2 * stage];
+			float x = sample[axis];
+			float y = c[0] * x + d[0];
+
+			d[0] = c[1] * x + c[3] * y + d[1];
+			d[1] = c[2] * x + c[4] * y;
+			sample[axis] = y;
+		}
+	}
+}
+
+#endif /* FILTER_BANK_CMSIS */
+
+/**
+ * filter_bank_apply() in the form of a PIOS_SENSORS_ReceiveFiltered() filter
+ * @param[in] bank The filter bank
+ * @param[in,out] sample The sample of each axis
+ */
+void filter_bank_apply_cb(void *bank, float sample[FILTER_BANK_AXES])
+{
+	filter_bank_apply((struct filter_bank *) bank, sample);
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,83 @@
+/**
+ ******************************************************************************
+ * @addtogroup OpenPilotSystem OpenPilot System
+ * @{
+ * @addtogroup OpenPilotLibraries OpenPilot System Libraries
+ * @{
+ * @file       filter_bank.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Low-pass and notch filters for the gyros and accels
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef FILTER_BANK_H_
+#define FILTER_BANK_H_
+
+#include <stdint.h>
+
+/**
+ * The CMSIS DSP library is used on the Cortex-M4F targets, everything else
+ * (CopterControl, the simulator and the unit tests) uses the portable C
+ * version of the same direct form II transposed biquads.
+ */
+#if defined(ARM_MATH_CM4) && !defined(FILTER_BANK_PORTABLE)
+#define FILTER_BANK_CMSIS
+#endif
+
+#if defined(FILTER_BANK_CMSIS)
+#include "arm_math.h"
+#endif
+
+#define FILTER_BANK_AXES 3
+#define FILTER_BANK_MAX_STAGES 4
+
+//! Floats per stage, b0, b1, b2, a1 and a2 with the a coefficients negated
+#define FILTER_BANK_STAGE_COEFFS 5
+
+/**
+ * A cascade of second order sections that runs on each axis of a sensor.
+ * The coefficients are shared by the axes and computed when the filters are
+ * added, applying the filter only runs the recursion. The CMSIS instances
+ * point into the structure so it must not be copied once set up.
+ */
+struct filter_bank {
+	uint8_t num_stages;
+	float coeffs[FILTER_BANK_MAX_STAGES * FILTER_BANK_STAGE_COEFFS];
+	float state[FILTER_BANK_AXES][FILTER_BANK_MAX_STAGES * 2];
+#if defined(FILTER_BANK_CMSIS)
+	arm_biquad_cascade_df2T_instance_f32 cmsis[FILTER_BANK_AXES];
+#endif
+};
+
+void filter_bank_init(struct filter_bank *bank);
+void filter_bank_reset(struct filter_bank *bank);
+int32_t filter_bank_add_lowpass(struct filter_bank *bank, float sample_rate, float cutoff, uint8_t order);
+int32_t filter_bank_add_notch(struct filter_bank *bank, float sample_rate, float center, float bandwidth);
+int32_t filter_bank_configure(struct filter_bank *bank, float sample_rate, float cutoff, uint8_t order,
+		float center, float bandwidth);
+void filter_bank_apply(struct filter_bank *bank, float sample[FILTER_BANK_AXES]);
+void filter_bank_apply_cb(void *bank, float sample[FILTER_BANK_AXES]);
+
+#endif /* FILTER_BANK_H_ */
+
+/**
+ * @}
+ * @}
+ */
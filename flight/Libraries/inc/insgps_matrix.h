@@ -0,0 +1,87 @@
+/**
+ ******************************************************************************
+ * @addtogroup AHRS
+ * @{
+ * @addtogroup INSGPS
+ * @{
+ * @brief INSGPS is a joint attitude and position estimation EKF
+ *
+ * @file       insgps_matrix.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Matrix kernels shared by the INSGPS filters.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef INSGPS_MATRIX_H_
+#define INSGPS_MATRIX_H_
+
+#include <stdint.h>
+
+/**
+ * The CMSIS DSP library is used on the Cortex-M4F targets, everything else
+ * (the simulator and the unit tests) uses the portable C kernels, which use
+ * SSE when the host has it.
+ */
+#if defined(ARM_MATH_CM4) && !defined(INSGPS_MATRIX_PORTABLE)
+#define INSGPS_MATRIX_CMSIS
+#endif
+
+//! Largest block of F that is multiplied at once
+#define INSGPS_MAX_BLOCK_ROWS 8
+#define INSGPS_MAX_BLOCK_COLS 8
+
+//! Floats of scratch space needed by the kernels for n states
+#define INSGPS_PREDICTION_WORK_SIZE(n) ((n) * (n) + INSGPS_MAX_BLOCK_ROWS * ((n) + INSGPS_MAX_BLOCK_COLS))
+#define INSGPS_UPDATE_WORK_SIZE(n) (2 * (n))
+
+/**
+ * A dense block of a sparse matrix. All elements of the matrix outside of
+ * its blocks are zero. F, G and H of the INSGPS filters are described as a
+ * list of blocks so that the kernels only multiply the non-zero parts.
+ */
+struct insgps_block {
+	uint8_t row;
+	uint8_t col;
+	uint8_t rows;
+	uint8_t cols;
+};
+
+// Backend, all matrices are dense and row major
+void insgps_mat_mult(const float *A, const float *B, float *C, uint16_t m, uint16_t k, uint16_t n);
+void insgps_mat_trans(const float *A, float *At, uint16_t m, uint16_t n);
+float insgps_vec_dot(const float *a, const float *b, uint16_t n);
+void insgps_vec_axpy(float a, const float *x, float *y, uint16_t n);
+
+// Kalman filter steps on block sparse system matrices
+void insgps_covariance_prediction(float *P, uint16_t n,
+		const float *F, const struct insgps_block *Fblocks, uint8_t numFblocks,
+		const float *G, const struct insgps_block *Gblocks, uint8_t numGblocks, uint16_t nw,
+		const float *Q, float dT, float *work);
+void insgps_serial_update(float *P, float *X, uint16_t n,
+		const float *H, const struct insgps_block *Hblocks, uint8_t numHblocks, uint16_t nv,
+		const float *R, const float *Z, const float *Y, float *K,
+		uint16_t SensorsUsed, float *work);
+
+#endif /* INSGPS_MATRIX_H_ */
+
+/**
+ * @}
+ * @}
+ */
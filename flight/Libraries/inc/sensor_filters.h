@@ -0,0 +1,43 @@
+/**
+ ******************************************************************************
+ * @addtogroup OpenPilotSystem OpenPilot System
+ * @{
+ * @addtogroup OpenPilotLibraries OpenPilot System Libraries
+ * @{
+ * @file       sensor_filters.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Set up the gyro and accel filters from SensorFilterSettings
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef SENSOR_FILTERS_H_
+#define SENSOR_FILTERS_H_
+
+#include "filter_bank.h"
+
+int32_t sensor_filters_configure(struct filter_bank *gyro_filter, struct filter_bank *accel_filter,
+		float default_rate);
+
+#endif /* SENSOR_FILTERS_H_ */
+
+/**
+ * @}
+ * @}
+ */
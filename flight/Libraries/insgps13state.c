@@ -30,6 +30,7 @@
  */
 
 #include "insgps.h"
+#include "insgps_matrix.h"
 #include <math.h>
 #include <stdint.h>
 
@@ -55,8 +56,10 @@ void RungeKutta(float X[NUMX], float U[NUMU], float dT);
 void StateEq(float X[NUMX], float U[NUMU], float Xdot[NUMX]);
 void LinearizeFG(float X[NUMX], float U[NUMU], float F[NUMX][NUMX],
 		 float G[NUMX][NUMW]);
-void MeasurementEq(float X[NUMX], float Be[3], float Y[NUMV]);
-void LinearizeH(float X[NUMX], float Be[3], float H[NUMV][NUMX]);
+void MeasurementEq(float X[NUMX], float Be[3], float Y[NUMV],
+		   uint16_t SensorsUsed);
+void LinearizeH(float X[NUMX], float Be[3], float H[NUMV][NUMX],
+		uint16_t SensorsUsed);
 
 // Private variables
 float F[NUMX][NUMX], G[NUMX][NUMW], H[NUMV][NUMX];	// linearized system matrices
@@ -65,6 +68,31 @@ float Be[3];			// local magnetic unit vector in NED frame
 float P[NUMX][NUMX], X[NUMX];	// covariance matrix and state vector
 float Q[NUMW], R[NUMV];		// input noise and measurement noise variances
 float K[NUMX][NUMV];		// feedback gain matrix
+
+// Non-zero blocks of F, G and H as set by LinearizeFG and LinearizeH. The
+// blocks of H are also the measurement groups of the serial update, a new
+// sensor needs its rows in Z, R and MeasurementEq and one block here.
+static const struct insgps_block Hblocks[] = {
+	{ 0, 0, 1, 1 }, { 1, 1, 1, 1 }, { 2, 2, 1, 1 },	// dP/dP=I
+	{ 3, 3, 1, 1 }, { 4, 4, 1, 1 }, { 5, 5, 1, 1 },	// dV/dV=I
+	{ 6, 6, 3, 4 },		// dBb/dq
+	{ 9, 2, 1, 1 },		// dAlt/dPz
+};
+#if defined(COVARIANCE_PREDICTION_GENERAL)
+static const struct insgps_block Fblocks[] = {
+	{ 0, 3, 1, 1 }, { 1, 4, 1, 1 }, { 2, 5, 1, 1 },	// Pdot = V
+	{ 3, 6, 3, 4 },		// dVdot/dq
+	{ 6, 6, 4, 7 },		// dqdot/dq, dqdot/dwbias
+};
+static const struct insgps_block Gblocks[] = {
+	{ 3, 3, 3, 3 },		// dVdot/dna
+	{ 6, 0, 4, 3 },		// dqdot/dnw
+	{ 10, 6, 3, 3 },	// dwbias = random walk noise
+};
+static float work[INSGPS_PREDICTION_WORK_SIZE(NUMX)];	// scratch space of the matrix kernels
+#else
+static float work[INSGPS_UPDATE_WORK_SIZE(NUMX)];
+#endif
 static struct NavStruct Nav;
 
 //  *************  Exposed Functions ****************
@@ -334,19 +362,22 @@ void INSCorrection(float mag_data[3], float Pos[3], float Vel[3],
 	Z[5] = Vel[2];
 
 	// magnetometer data in any units (use unit vector) and in body frame
-	Bmag =
-	    sqrtf(mag_data[0] * mag_data[0] + mag_data[1] * mag_data[1] +
-		 mag_data[2] * mag_data[2]);
-	Z[6] = mag_data[0] / Bmag;
-	Z[7] = mag_data[1] / Bmag;
-	Z[8] = mag_data[2] / Bmag;
+	if (SensorsUsed & MAG_SENSORS) {
+		Bmag =
+		    sqrtf(mag_data[0] * mag_data[0] + mag_data[1] * mag_data[1] +
+			 mag_data[2] * mag_data[2]);
+		Z[6] = mag_data[0] / Bmag;
+		Z[7] = mag_data[1] / Bmag;
+		Z[8] = mag_data[2] / Bmag;
+	}
 
 	// barometric altimeter in meters and in local NED frame
 	Z[9] = BaroAlt;
 
-	// EKF correction step
-	LinearizeH(X, Be, H);
-	MeasurementEq(X, Be, Y);
+	// EKF correction step, only the measurements that are used are
+	// linearized and updated
+	LinearizeH(X, Be, H, SensorsUsed);
+	MeasurementEq(X, Be, Y, SensorsUsed);
 	SerialUpdate(H, R, Z, Y, P, X, SensorsUsed);
 	qmag = sqrtf(X[6] * X[6] + X[7] * X[7] + X[8] * X[8] + X[9] * X[9]);
 	X[6] /= qmag;
@@ -377,8 +408,9 @@ void INSCorrection(float mag_data[3], float Pos[3], float Vel[3],
 //  Q is the discrete time covariance of process noise
 //  Q is vector of the diagonal for a square matrix with
 //    dimensions equal to the number of disturbance noise variables
-//  The General Method is very inefficient,not taking advantage of the sparse F and G
-//  The first Method is very specific to this implementation
+//  The General Method multiplies the non-zero blocks of F and G with the
+//    matrix kernels, and works for any Fblocks and Gblocks
+//  The first Method is very specific to this implementation, and faster
 //  ************************************************
 
 #ifdef COVARIANCE_PREDICTION_GENERAL
@@ -386,28 +418,10 @@ void INSCorrection(float mag_data[3], float Pos[3], float Vel[3],
 void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
 			  float Q[NUMW], float dT, float P[NUMX][NUMX])
 {
-	float Dummy[NUMX][NUMX], dTsq;
-	uint8_t i, j, k;
-
-	//  Pnew = (I+F*T)*P*(I+F*T)' + T^2*G*Q*G' = T^2[(P/T + F*P)*(I/T + F') + G*Q*G')]
-
-	dTsq = dT * dT;
-
-	for (i = 0; i < NUMX; i++)	// Calculate Dummy = (P/T +F*P)
-		for (j = 0; j < NUMX; j++) {
-			Dummy[i][j] = P[i][j] / dT;
-			for (k = 0; k < NUMX; k++)
-				Dummy[i][j] += F[i][k] * P[k][j];
-		}
-	for (i = 0; i < NUMX; i++)	// Calculate Pnew = Dummy/T + Dummy*F' + G*Qw*G'
-		for (j = i; j < NUMX; j++) {	// Use symmetry, ie only find upper triangular
-			P[i][j] = Dummy[i][j] / dT;
-			for (k = 0; k < NUMX; k++)
-				P[i][j] += Dummy[i][k] * F[j][k];	// P = Dummy/T + Dummy*F'
-			for (k = 0; k < NUMW; k++)
-				P[i][j] += Q[k] * G[i][k] * G[j][k];	// P = Dummy/T + Dummy*F' + G*Q*G'
-			P[j][i] = P[i][j] = P[i][j] * dTsq;	// Pnew = T^2*P and fill in lower triangular;
-		}
+	insgps_covariance_prediction(&P[0][0], NUMX,
+		&F[0][0], Fblocks, sizeof(Fblocks) / sizeof(Fblocks[0]),
+		&G[0][0], Gblocks, sizeof(Gblocks) / sizeof(Gblocks[0]), NUMW,
+		Q, dT, work);
 }
 
 #else
@@ -1352,7 +1366,7 @@ void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
 //  Does the update step of the Kalman filter for the covariance and estimate
 //  Outputs are Xnew & Pnew, and are written over P and X
 //  Z is actual measurement, Y is predicted measurement
-//  Xnew = X + K*(Z-Y), Pnew=(I-K*H)*P,
+//  Xnew = X + K*(Z-Y), Pnew=(I-K*H)*P*(I-K*H)' + K*R*K',
 //    where K=P*H'*inv[H*P*H'+R]
 //  NOTE the algorithm assumes R (measurement covariance matrix) is diagonal
 //    i.e. the measurment noises are uncorrelated.
@@ -1362,43 +1376,18 @@ void CovariancePrediction(float F[NUMX][NUMX], float G[NUMX][NUMW],
 //            - or see Simon, "Optimal State Estimation," 1st Ed, p.150
 //  The SensorsUsed variable is a bitwise mask indicating which sensors
 //     should be used in the update.
+//  Each block of H is a group of measurements that is skipped when it is
+//     not used, and only its non-zero states are multiplied, see
+//     insgps_serial_update
 //  ************************************************
 
 void SerialUpdate(float H[NUMV][NUMX], float R[NUMV], float Z[NUMV],
 		  float Y[NUMV], float P[NUMX][NUMX], float X[NUMX],
 		  uint16_t SensorsUsed)
 {
-	float HP[NUMX], HPHR, Error;
-	uint8_t i, j, k, m;
-
-	for (m = 0; m < NUMV; m++) {
-
-		if (SensorsUsed & (0x01 << m)) {	// use this sensor for update
-
-			for (j = 0; j < NUMX; j++) {	// Find Hp = H*P
-				HP[j] = 0;
-				for (k = 0; k < NUMX; k++)
-					HP[j] += H[m][k] * P[k][j];
-			}
-			HPHR = R[m];	// Find  HPHR = H*P*H' + R
-			for (k = 0; k < NUMX; k++)
-				HPHR += HP[k] * H[m][k];
-
-			for (k = 0; k < NUMX; k++)
-				K[k][m] = HP[k] / HPHR;	// find K = HP/HPHR
-
-			for (i = 0; i < NUMX; i++) {	// Find P(m)= P(m-1) + K*HP
-				for (j = i; j < NUMX; j++)
-					P[i][j] = P[j][i] =
-					    P[i][j] - K[i][m] * HP[j];
-			}
-
-			Error = Z[m] - Y[m];
-			for (i = 0; i < NUMX; i++)	// Find X(m)= X(m-1) + K*Error
-				X[i] = X[i] + K[i][m] * Error;
-
-		}
-	}
+	insgps_serial_update(&P[0][0], X, NUMX,
+		&H[0][0], Hblocks, sizeof(Hblocks) / sizeof(Hblocks[0]), NUMV,
+		R, Z, Y, &K[0][0], SensorsUsed, work);
 }
 
 //  *************  RungeKutta **********************
@@ -1602,7 +1591,8 @@ void LinearizeFG(float X[NUMX], float U[NUMU], float F[NUMX][NUMX],
 	// G[13][9]=G[14][10]=G[15][11]=1;  // NO BIAS STATES ON ACCELS
 }
 
-void MeasurementEq(float X[NUMX], float Be[3], float Y[NUMV])
+void MeasurementEq(float X[NUMX], float Be[3], float Y[NUMV],
+		   uint16_t SensorsUsed)
 {
 	float q0, q1, q2, q3;
 
@@ -1620,24 +1610,27 @@ void MeasurementEq(float X[NUMX], float Be[3], float Y[NUMV])
 	Y[5] = X[5];
 
 	// Bb=Rbe*Be
-	Y[6] =
-	    (q0 * q0 + q1 * q1 - q2 * q2 - q3 * q3) * Be[0] +
-	    2.0f * (q1 * q2 + q0 * q3) * Be[1] + 2.0f * (q1 * q3 -
-						   q0 * q2) * Be[2];
-	Y[7] =
-	    2.0f * (q1 * q2 - q0 * q3) * Be[0] + (q0 * q0 - q1 * q1 +
-					       q2 * q2 - q3 * q3) * Be[1] +
-	    2.0f * (q2 * q3 + q0 * q1) * Be[2];
-	Y[8] =
-	    2.0f * (q1 * q3 + q0 * q2) * Be[0] + 2.0f * (q2 * q3 -
-						   q0 * q1) * Be[1] +
-	    (q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3) * Be[2];
+	if (SensorsUsed & MAG_SENSORS) {
+		Y[6] =
+		    (q0 * q0 + q1 * q1 - q2 * q2 - q3 * q3) * Be[0] +
+		    2.0f * (q1 * q2 + q0 * q3) * Be[1] + 2.0f * (q1 * q3 -
+							   q0 * q2) * Be[2];
+		Y[7] =
+		    2.0f * (q1 * q2 - q0 * q3) * Be[0] + (q0 * q0 - q1 * q1 +
+						       q2 * q2 - q3 * q3) * Be[1] +
+		    2.0f * (q2 * q3 + q0 * q1) * Be[2];
+		Y[8] =
+		    2.0f * (q1 * q3 + q0 * q2) * Be[0] + 2.0f * (q2 * q3 -
+							   q0 * q1) * Be[1] +
+		    (q0 * q0 - q1 * q1 - q2 * q2 + q3 * q3) * Be[2];
+	}
 
 	// Alt = -Pz
 	Y[9] = -1.0f * X[2];
 }
 
-void LinearizeH(float X[NUMX], float Be[3], float H[NUMV][NUMX])
+void LinearizeH(float X[NUMX], float Be[3], float H[NUMV][NUMX],
+		uint16_t SensorsUsed)
 {
 	float q0, q1, q2, q3;
 
@@ -1651,19 +1644,21 @@ void LinearizeH(float X[NUMX], float Be[3], float H[NUMV][NUMX])
 	// dV/dV=I;
 	H[3][3] = H[4][4] = H[5][5] = 1.0f;
 
-	// dBb/dq
-	H[6][6] = 2.0f * (q0 * Be[0] + q3 * Be[1] - q2 * Be[2]);
-	H[6][7] = 2.0f * (q1 * Be[0] + q2 * Be[1] + q3 * Be[2]);
-	H[6][8] = 2.0f * (-q2 * Be[0] + q1 * Be[1] - q0 * Be[2]);
-	H[6][9] = 2.0f * (-q3 * Be[0] + q0 * Be[1] + q1 * Be[2]);
-	H[7][6] = 2.0f * (-q3 * Be[0] + q0 * Be[1] + q1 * Be[2]);
-	H[7][7] = 2.0f * (q2 * Be[0] - q1 * Be[1] + q0 * Be[2]);
-	H[7][8] = 2.0f * (q1 * Be[0] + q2 * Be[1] + q3 * Be[2]);
-	H[7][9] = 2.0f * (-q0 * Be[0] - q3 * Be[1] + q2 * Be[2]);
-	H[8][6] = 2.0f * (q2 * Be[0] - q1 * Be[1] + q0 * Be[2]);
-	H[8][7] = 2.0f * (q3 * Be[0] - q0 * Be[1] - q1 * Be[2]);
-	H[8][8] = 2.0f * (q0 * Be[0] + q3 * Be[1] - q2 * Be[2]);
-	H[8][9] = 2.0f * (q1 * Be[0] + q2 * Be[1] + q3 * Be[2]);
+	// dBb/dq, only needed when the magnetometer is used
+	if (SensorsUsed & MAG_SENSORS) {
+		H[6][6] = 2.0f * (q0 * Be[0] + q3 * Be[1] - q2 * Be[2]);
+		H[6][7] = 2.0f * (q1 * Be[0] + q2 * Be[1] + q3 * Be[2]);
+		H[6][8] = 2.0f * (-q2 * Be[0] + q1 * Be[1] - q0 * Be[2]);
+		H[6][9] = 2.0f * (-q3 * Be[0] + q0 * Be[1] + q1 * Be[2]);
+		H[7][6] = 2.0f * (-q3 * Be[0] + q0 * Be[1] + q1 * Be[2]);
+		H[7][7] = 2.0f * (q2 * Be[0] - q1 * Be[1] + q0 * Be[2]);
+		H[7][8] = 2.0f * (q1 * Be[0] + q2 * Be[1] + q3 * Be[2]);
+		H[7][9] = 2.0f * (-q0 * Be[0] - q3 * Be[1] + q2 * Be[2]);
+		H[8][6] = 2.0f * (q2 * Be[0] - q1 * Be[1] + q0 * Be[2]);
+		H[8][7] = 2.0f * (q3 * Be[0] - q0 * Be[1] - q1 * Be[2]);
+		H[8][8] = 2.0f * (q0 * Be[0] + q3 * Be[1] - q2 * Be[2]);
+		H[8][9] = 2.0f * (q1 * Be[0] + q2 * Be[1] + q3 * Be[2]);
+	}
 
 	// dAlt/dPz = -1
 	H[9][2] = -1.0f;
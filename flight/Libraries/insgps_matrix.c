@@ -0,0 +1,316 @@
+/**
+ ******************************************************************************
+ * @addtogroup AHRS
+ * @{
+ * @addtogroup INSGPS
+ * @{
+ * @brief INSGPS is a joint attitude and position estimation EKF
+ *
+ * @file       insgps_matrix.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Matrix kernels shared by the INSGPS filters. The covariance
+ *             prediction and the serial update only multiply the non-zero
+ *             blocks of the linearized system matrices, using the CMSIS DSP
+ *             library on the Cortex-M4F or portable C elsewhere.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "insgps_matrix.h"
+#include <string.h>
+
+#if defined(INSGPS_MATRIX_CMSIS)
+#include "arm_math.h"
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#elif defined(__ARM_NEON__)
+#include <arm_neon.h>
+#endif
+
+// Private functions
+static void apply_transition(float *D, const float *P, uint16_t n,
+		const float *F, const struct insgps_block *Fblocks, uint8_t numFblocks,
+		float dT, float *FP, float *Fb);
+
+//  *************  Backend **************************
+//  Dense row major kernels, C = A*B with A m x k and B k x n
+//  ************************************************
+
+#if defined(INSGPS_MATRIX_CMSIS)
+
+void insgps_mat_mult(const float *A, const float *B, float *C, uint16_t m, uint16_t k, uint16_t n)
+{
+	const arm_matrix_instance_f32 a = { m, k, (float32_t *) A };
+	const arm_matrix_instance_f32 b = { k, n, (float32_t *) B };
+	arm_matrix_instance_f32 c = { m, n, C };
+
+	arm_mat_mult_f32(&a, &b, &c);
+}
+
+void insgps_mat_trans(const float *A, float *At, uint16_t m, uint16_t n)
+{
+	const arm_matrix_instance_f32 a = { m, n, (float32_t *) A };
+	arm_matrix_instance_f32 at = { n, m, At };
+
+	arm_mat_trans_f32(&a, &at);
+}
+
+float insgps_vec_dot(const float *a, const float *b, uint16_t n)
+{
+	float32_t result;
+
+	arm_dot_prod_f32((float32_t *) a, (float32_t *) b, n, &result);
+	return result;
+}
+
+void insgps_vec_axpy(float a, const float *x, float *y, uint16_t n)
+{
+	// No CMSIS equivalent, the compiler emits fused multiply-adds for this
+	for (uint16_t i = 0; i < n; i++)
+		y[i] += a * x[i];
+}
+
+#else /* INSGPS_MATRIX_CMSIS */
+
+void insgps_mat_mult(const float *A, const float *B, float *C, uint16_t m, uint16_t k, uint16_t n)
+{
+	for (uint16_t i = 0; i < m; i++) {
+		const float *a = &A[i * k];
+		uint16_t j = 0;
+
+		// Each output element is accumulated in a register, the blocks are small
+#if defined(__SSE__)
+		for (; j + 4 <= n; j += 4) {
+			__m128 sum = _mm_setzero_ps();
+			for (uint16_t p = 0; p < k; p++)
+				sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(a[p]), _mm_loadu_ps(&B[p * n + j])));
+			_mm_storeu_ps(&C[i * n + j], sum);
+		}
+#elif defined(__ARM_NEON__)
+		for (; j + 4 <= n; j += 4) {
+			float32x4_t sum = vdupq_n_f32(0);
+			for (uint16_t p = 0; p < k; p++)
+				sum = vmlaq_n_f32(sum, vld1q_f32(&B[p * n + j]), a[p]);
+			vst1q_f32(&C[i * n + j], sum);
+		}
+#endif
+		for (; j < n; j++) {
+			float sum = 0;
+			for (uint16_t p = 0; p < k; p++)
+				sum += a[p] * B[p * n + j];
+			C[i * n + j] = sum;
+		}
+	}
+}
+
+void insgps_mat_trans(const float *A, float *At, uint16_t m, uint16_t n)
+{
+	for (uint16_t i = 0; i < m; i++)
+		for (uint16_t j = 0; j < n; j++)
+			At[j * m + i] = A[i * n + j];
+}
+
+float insgps_vec_dot(const float *a, const float *b, uint16_t n)
+{
+	uint16_t i = 0;
+	float result = 0;
+
+#if defined(__SSE__)
+	float lanes[4];
+	__m128 sum = _mm_setzero_ps();
+	for (; i + 4 <= n; i += 4)
+		sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(&a[i]), _mm_loadu_ps(&b[i])));
+	_mm_storeu_ps(lanes, sum);
+	result = (lanes[0] + lanes[1]) + (lanes[2] + lanes[3]);
+#elif defined(__ARM_NEON__)
+	float32x4_t sum = vdupq_n_f32(0);
+	for (; i + 4 <= n; i += 4)
+		sum = vmlaq_f32(sum, vld1q_f32(&a[i]), vld1q_f32(&b[i]));
+	result = (vgetq_lane_f32(sum, 0) + vgetq_lane_f32(sum, 1)) +
+		(vgetq_lane_f32(sum, 2) + vgetq_lane_f32(sum, 3));
+#endif
+
+	for (; i < n; i++)
+		result += a[i] * b[i];
+
+	return result;
+}
+
+void insgps_vec_axpy(float a, const float *x, float *y, uint16_t n)
+{
+	uint16_t i = 0;
+
+#if defined(__SSE__)
+	const __m128 va = _mm_set1_ps(a);
+	for (; i + 4 <= n; i += 4)
+		_mm_storeu_ps(&y[i], _mm_add_ps(_mm_loadu_ps(&y[i]), _mm_mul_ps(va, _mm_loadu_ps(&x[i]))));
+#elif defined(__ARM_NEON__)
+	for (; i + 4 <= n; i += 4)
+		vst1q_f32(&y[i], vmlaq_n_f32(vld1q_f32(&y[i]), vld1q_f32(&x[i]), a));
+#endif
+
+	for (; i < n; i++)
+		y[i] += a * x[i];
+}
+
+#endif /* INSGPS_MATRIX_CMSIS */
+
+//  *************  Covariance prediction ************
+//  Pnew = (I+F*T)*P*(I+F*T)' + T^2*G*Q*G'
+//  Since P is symmetric this is computed as A*(A*P)' with A = I+F*T, so
+//  both products only multiply the blocks of F with rows of P. G*Q*G' is
+//  only summed over the noise inputs two blocks of G have in common.
+//  work holds INSGPS_PREDICTION_WORK_SIZE(n) floats.
+//  ************************************************
+
+void insgps_covariance_prediction(float *P, uint16_t n,
+		const float *F, const struct insgps_block *Fblocks, uint8_t numFblocks,
+		const float *G, const struct insgps_block *Gblocks, uint8_t numGblocks, uint16_t nw,
+		const float *Q, float dT, float *work)
+{
+	float *D = work;
+	float *FP = &D[n * n];
+	float *Fb = &FP[INSGPS_MAX_BLOCK_ROWS * n];
+	float Tsq = dT * dT;
+
+	apply_transition(D, P, n, F, Fblocks, numFblocks, dT, FP, Fb);	// D = A*P
+	insgps_mat_trans(D, P, n, n);					// P = P*A'
+	apply_transition(D, P, n, F, Fblocks, numFblocks, dT, FP, Fb);	// D = A*P*A'
+
+	for (uint8_t a = 0; a < numGblocks; a++) {
+		for (uint8_t b = 0; b < numGblocks; b++) {
+			const struct insgps_block *ga = &Gblocks[a];
+			const struct insgps_block *gb = &Gblocks[b];
+			uint16_t first = ga->col > gb->col ? ga->col : gb->col;
+			uint16_t last = ga->col + ga->cols < gb->col + gb->cols ?
+				ga->col + ga->cols : gb->col + gb->cols;
+			if (first >= last)
+				continue;
+
+			for (uint16_t i = ga->row; i < ga->row + ga->rows; i++) {
+				for (uint16_t j = gb->row; j < gb->row + gb->rows; j++) {
+					if (j < i)	// Use symmetry, ie only find upper triangular
+						continue;
+					float GQG = 0;
+					for (uint16_t k = first; k < last; k++)
+						GQG += Q[k] * G[i * nw + k] * G[j * nw + k];
+					D[i * n + j] += Tsq * GQG;
+				}
+			}
+		}
+	}
+
+	for (uint16_t i = 0; i < n; i++)	// Fill in the lower triangular
+		for (uint16_t j = i; j < n; j++)
+			P[i * n + j] = P[j * n + i] = D[i * n + j];
+}
+
+/**
+ * Compute D = (I+F*T)*P one block of F at a time. The rows of P a block
+ * multiplies with are contiguous, so only the block itself is copied.
+ */
+static void apply_transition(float *D, const float *P, uint16_t n,
+		const float *F, const struct insgps_block *Fblocks, uint8_t numFblocks,
+		float dT, float *FP, float *Fb)
+{
+	memcpy(D, P, n * n * sizeof(float));
+
+	for (uint8_t b = 0; b < numFblocks; b++) {
+		const struct insgps_block *block = &Fblocks[b];
+
+		for (uint16_t r = 0; r < block->rows; r++)
+			memcpy(&Fb[r * block->cols], &F[(block->row + r) * n + block->col],
+				block->cols * sizeof(float));
+
+		// The rows of the block are contiguous in D as well
+		insgps_mat_mult(Fb, &P[block->col * n], FP, block->rows, block->cols, n);
+		insgps_vec_axpy(dT, FP, &D[block->row * n], block->rows * n);
+	}
+}
+
+//  *************  Serial update ********************
+//  Xnew = X + K*(Z-Y), Pnew=(I-K*H)*P*(I-K*H)' + K*R*K', where
+//  K=P*H'*inv[H*P*H'+R], processing one measurement at a time with R
+//  diagonal. Every block of H is a group of measurements, like the axes of
+//  the magnetometer, and every row of H is in exactly one block. Groups
+//  SensorsUsed does not select are skipped and only the states a block
+//  covers are multiplied, so the cost follows what was measured.
+//  Only the upper triangle of P is read and updated, the lower triangle is
+//  filled in at the end. K is n x nv and work holds
+//  INSGPS_UPDATE_WORK_SIZE(n) floats.
+//  ************************************************
+
+void insgps_serial_update(float *P, float *X, uint16_t n,
+		const float *H, const struct insgps_block *Hblocks, uint8_t numHblocks, uint16_t nv,
+		const float *R, const float *Z, const float *Y, float *K,
+		uint16_t SensorsUsed, float *work)
+{
+	float *HP = work;
+	float *Km = &work[n];
+
+	for (uint8_t b = 0; b < numHblocks; b++) {
+		const struct insgps_block *block = &Hblocks[b];
+
+		for (uint16_t m = block->row; m < block->row + block->rows; m++) {
+			if (!(SensorsUsed & (0x01 << m)))
+				continue;
+
+			const float *h = &H[m * n + block->col];
+
+			memset(HP, 0, n * sizeof(float));	// Find HP = H*P
+			for (uint16_t c = 0; c < block->cols; c++) {
+				uint16_t k = block->col + c;
+				for (uint16_t j = 0; j < k; j++)	// column k above the diagonal
+					HP[j] += h[c] * P[j * n + k];
+				insgps_vec_axpy(h[c], &P[k * n + k], &HP[k], n - k);
+			}
+
+			// Find HPHR = H*P*H' + R
+			float HPHR = R[m] + insgps_vec_dot(&HP[block->col], h, block->cols);
+
+			float scale = 1.0f / HPHR;
+			for (uint16_t k = 0; k < n; k++) {	// find K = HP/HPHR
+				Km[k] = HP[k] * scale;
+				K[k * nv + m] = Km[k];
+			}
+
+			// Find P(m) in Joseph form, which for this K is
+			// P(m-1) - K*HP - HP'*K' + HPHR*K*K'. The last two terms only
+			// differ by the rounding of K and keep it from adding up. Both
+			// are applied in one pass over each row.
+			for (uint16_t i = 0; i < n; i++) {
+				float a = -Km[i];
+				float b = HPHR * Km[i] - HP[i];
+				for (uint16_t j = i; j < n; j++)
+					P[i * n + j] += a * HP[j] + b * Km[j];
+			}
+
+			insgps_vec_axpy(Z[m] - Y[m], Km, X, n);	// Find X(m)= X(m-1) + K*Error
+		}
+	}
+
+	for (uint16_t i = 0; i < n; i++)	// Fill in the lower triangular
+		for (uint16_t j = i + 1; j < n; j++)
+			P[j * n + i] = P[i * n + j];
+}
+
+/**
+ * @}
+ * @}
+ */
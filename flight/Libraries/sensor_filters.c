@@ -0,0 +1,85 @@
+/**
+ ******************************************************************************
+ * @addtogroup OpenPilotSystem OpenPilot System
+ * @{
+ * @addtogroup OpenPilotLibraries OpenPilot System Libraries
+ * @{
+ * @file       sensor_filters.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Set up the gyro and accel filters from SensorFilterSettings
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "openpilot.h"
+#include "pios.h"
+#include "sensorfiltersettings.h"
+#include "sensor_filters.h"
+
+/**
+ * Configure the gyro and accel filters for the rate of their sensors. The
+ * filters are applied to every sample, so a driver that does not report its
+ * rate is assumed to be read once per cycle of the caller.
+ * @param[out] gyro_filter The filter bank of the gyros
+ * @param[out] accel_filter The filter bank of the accels
+ * @param[in] default_rate The rate in Hz of sensors that do not report theirs
+ * @return 0 if the settings were applied, -1 if a filter cannot be built at
+ * the rate of its sensor, e.g. at or above the Nyquist frequency, in which
+ * case the settings are rejected and neither sensor is filtered
+ */
+int32_t sensor_filters_configure(struct filter_bank *gyro_filter, struct filter_bank *accel_filter,
+		float default_rate)
+{
+	SensorFilterSettingsData filterSettings;
+	SensorFilterSettingsGet(&filterSettings);
+
+	float gyro_rate = PIOS_SENSORS_GetSampleRate(PIOS_SENSOR_GYRO);
+	float accel_rate = PIOS_SENSORS_GetSampleRate(PIOS_SENSOR_ACCEL);
+	if (gyro_rate == 0)
+		gyro_rate = default_rate;
+	if (accel_rate == 0)
+		accel_rate = default_rate;
+
+	int32_t ret = 0;
+	if (filter_bank_configure(gyro_filter, gyro_rate,
+			filterSettings.LowpassCutoff[SENSORFILTERSETTINGS_LOWPASSCUTOFF_GYRO],
+			filterSettings.LowpassOrder[SENSORFILTERSETTINGS_LOWPASSORDER_GYRO],
+			filterSettings.NotchCenter[SENSORFILTERSETTINGS_NOTCHCENTER_GYRO],
+			filterSettings.NotchBandwidth[SENSORFILTERSETTINGS_NOTCHBANDWIDTH_GYRO]) != 0)
+		ret = -1;
+	if (filter_bank_configure(accel_filter, accel_rate,
+			filterSettings.LowpassCutoff[SENSORFILTERSETTINGS_LOWPASSCUTOFF_ACCEL],
+			filterSettings.LowpassOrder[SENSORFILTERSETTINGS_LOWPASSORDER_ACCEL],
+			filterSettings.NotchCenter[SENSORFILTERSETTINGS_NOTCHCENTER_ACCEL],
+			filterSettings.NotchBandwidth[SENSORFILTERSETTINGS_NOTCHBANDWIDTH_ACCEL]) != 0)
+		ret = -1;
+
+	// Do not run with only part of the filters that were asked for
+	if (ret != 0) {
+		filter_bank_init(gyro_filter);
+		filter_bank_init(accel_filter);
+	}
+
+	return ret;
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -57,7 +57,9 @@
 #include "attitudesettings.h"
 #include "flightstatus.h"
 #include "manualcontrolcommand.h"
+#include "sensorfiltersettings.h"
 #include "CoordinateConversions.h"
+#include "sensor_filters.h"
 #include <pios_board_info.h>
  
 // Private constants
@@ -90,6 +92,7 @@ static int32_t updateSensors(AccelsData *, GyrosData *);
 static int32_t updateSensorsCC3D(AccelsData * accelsData, GyrosData * gyrosData);
 static void updateAttitude(AccelsData *, GyrosData *);
 static void settingsUpdatedCb(UAVObjEvent * objEv);
+static void filterSettingsUpdatedCb(UAVObjEvent * objEv);
 static void update_accels(struct pios_sensor_accel_data *accels, AccelsData * accelsData);
 static void update_gyros(struct pios_sensor_gyro_data *gyros, GyrosData * gyrosData);
 static void update_trimming(AccelsData * accelsData);
@@ -115,6 +118,12 @@ static int8_t rotate = 0;
 static bool zero_during_arming = false;
 static bool bias_correct_gyro = true;
 
+//! Filters run on every raw CC3D sample, rebuilt by the task when the settings change
+static struct filter_bank accel_filter_bank;
+static struct filter_bank gyro_filter_bank;
+static volatile bool filter_settings_updated = true;
+static bool filter_settings_valid = true;
+
 // For computing the average gyro during arming
 static bool accumulating_gyro = false;
 static uint32_t accumulated_gyro_samples = 0;
@@ -156,6 +165,7 @@ int32_t AttitudeInitialize(void)
 	AttitudeSettingsInitialize();
 	AccelsInitialize();
 	GyrosInitialize();
+	SensorFilterSettingsInitialize();
 	
 	// Initialize quaternion
 	AttitudeActualData attitude;
@@ -183,6 +193,7 @@ int32_t AttitudeInitialize(void)
 	
 	AttitudeSettingsConnectCallback(&settingsUpdatedCb);
 	InertialSensorSettingsConnectCallback(&settingsUpdatedCb);
+	SensorFilterSettingsConnectCallback(&filterSettingsUpdatedCb);
 	
 	return 0;
 }
@@ -340,6 +351,7 @@ static int32_t updateSensors(AccelsData * accelsData, GyrosData * gyrosData)
 	
 	// Convert the ADC data into the standard normalized format
 	struct pios_sensor_gyro_data gyros;
+	gyros.timestamp = PIOS_DELAY_GetuS();
 	gyros.temperature = gyro[0];
 	gyros.x = -(gyro[1] - GYRO_NEUTRAL) * IDG_GYRO_GAIN;
 	gyros.y = (gyro[2] - GYRO_NEUTRAL) * IDG_GYRO_GAIN;
@@ -364,6 +376,7 @@ static int32_t updateSensors(AccelsData * accelsData, GyrosData * gyrosData)
 	accels.x = ((float) x / i) * ADXL345_ACCEL_SCALE;
 	accels.y = ((float) y / i) * ADXL345_ACCEL_SCALE;
 	accels.z = ((float) z / i) * ADXL345_ACCEL_SCALE;
+	accels.timestamp = gyros.timestamp;
 
 	// Apply rotation / calibration and assign to the UAVO
 	update_gyros(&gyros, gyrosData);
@@ -388,17 +401,24 @@ static int32_t updateSensorsCC3D(AccelsData * accelsData, GyrosData * gyrosData)
 {
 	struct pios_sensor_gyro_data gyros;
 	struct pios_sensor_accel_data accels;
-	xQueueHandle queue;
 
-	queue = PIOS_SENSORS_GetQueue(PIOS_SENSOR_GYRO);
-	if(queue == NULL || xQueueReceive(queue, (void *) &gyros, 4) == errQUEUE_EMPTY) {
+	if (filter_settings_updated) {
+		filter_settings_updated = false;
+
+		filter_settings_valid = sensor_filters_configure(&gyro_filter_bank, &accel_filter_bank,
+				1000.0f / SENSOR_PERIOD) == 0;
+	}
+
+	// Average all the samples since the last update
+	if(PIOS_SENSORS_ReceiveFiltered(PIOS_SENSOR_GYRO, &gyros,
+			filter_bank_apply_cb, &gyro_filter_bank, 4) <= 0) {
 		return-1;
 	}
 
 	// As it says below, because the rest of the code expects the accel to be ready when
 	// the gyro is we must block here too
-	queue = PIOS_SENSORS_GetQueue(PIOS_SENSOR_ACCEL);
-	if(queue == NULL || xQueueReceive(queue, (void *) &accels, 1) == errQUEUE_EMPTY) {
+	if(PIOS_SENSORS_ReceiveFiltered(PIOS_SENSOR_ACCEL, &accels,
+			filter_bank_apply_cb, &accel_filter_bank, 1) <= 0) {
 		return -1;
 	}
 	else
@@ -408,6 +428,15 @@ static int32_t updateSensorsCC3D(AccelsData * accelsData, GyrosData * gyrosData)
 	// the accels to be available first
 	update_gyros(&gyros, gyrosData);
 
+	// Rejected filter settings leave the sensors unfiltered and samples the
+	// driver had to drop are missing from the filters
+	uint32_t dropped = PIOS_SENSORS_GetOverruns(PIOS_SENSOR_GYRO) +
+			PIOS_SENSORS_GetOverruns(PIOS_SENSOR_ACCEL);
+	if (filter_settings_valid && dropped == 0)
+		AlarmsClear(SYSTEMALARMS_ALARM_SENSORS);
+	else
+		AlarmsSet(SYSTEMALARMS_ALARM_SENSORS, SYSTEMALARMS_ALARM_WARNING);
+
 	update_trimming(accelsData);
 
 	GyrosSet(gyrosData);
@@ -440,6 +469,7 @@ static void update_accels(struct pios_sensor_accel_data *accels, AccelsData * ac
 	}
 
 	accelsData->temperature = accels->temperature;
+	accelsData->SampleTime = accels->timestamp;
 }
 
 /**
@@ -480,6 +510,7 @@ static void update_gyros(struct pios_sensor_gyro_data *gyros, GyrosData * gyrosD
 	gyro_correct_int[2] += gyrosData->z * yawBiasRate;
 
 	gyrosData->temperature = gyros->temperature;
+	gyrosData->SampleTime = gyros->timestamp;
 }
 
 /**
@@ -674,6 +705,14 @@ static void updateAttitude(AccelsData * accelsData, GyrosData * gyrosData)
 	AttitudeActualSet(&attitudeActual);
 }
 
+/**
+ * The filters are only rebuilt by the attitude task, which is the one running them
+ */
+static void filterSettingsUpdatedCb(UAVObjEvent * objEv)
+{
+	filter_settings_updated = true;
+}
+
 static void settingsUpdatedCb(UAVObjEvent * objEv) {
 	AttitudeSettingsData attitudeSettings;
 	AttitudeSettingsGet(&attitudeSettings);
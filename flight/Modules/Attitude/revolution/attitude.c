@@ -85,6 +85,10 @@
 // exp(-(1/f) / tau ) ~=~ 0.9997
 #define BARO_OFFSET_LOWPASS_ALPHA 0.9997f 
 
+// Length of the INSGPS state history used to fuse delayed measurements
+#define INS_HISTORY_LENGTH 64
+#define INS_HISTORY_PERIOD_US 5000
+
 // Private types
 
 
@@ -152,6 +156,7 @@ static void settingsUpdatedCb(UAVObjEvent * objEv);
 //! A low pass filter on the accels which helps with vibration resistance
 static void apply_accel_filter(const float * raw, float * filtered);
 static int32_t getNED(GPSPositionData * gpsPosition, float * NED);
+static uint32_t sample_time(uint32_t timestamp);
 
 //! Compute the mean gyro accumulated and assign the bias
 static void accumulate_gyro_compute();
@@ -308,7 +313,7 @@ static int32_t updateAttitudeComplementary(bool first_run)
 	UAVObjEvent ev;
 	GyrosData gyrosData;
 	AccelsData accelsData;
-	static int32_t timeval;
+	static uint32_t timeval;
 	float dT;
 
 	// Wait until the accel and gyro object is updated, if a timeout then go to failsafe
@@ -333,7 +338,7 @@ static int32_t updateAttitudeComplementary(bool first_run)
 		magData.z = 0;
 
 		// Wait for a mag reading if a magnetometer was registered
-		if (PIOS_SENSORS_GetQueue(PIOS_SENSOR_MAG) != NULL) {
+		if (PIOS_SENSORS_IsRegistered(PIOS_SENSOR_MAG)) {
 			if ( xQueueReceive(magQueue, &ev, 0 / portTICK_RATE_MS) != pdTRUE ) {
 				return -1;
 			}
@@ -351,7 +356,9 @@ static int32_t updateAttitudeComplementary(bool first_run)
 
 		complimentary_filter_state.initialization = CF_POWERON;
 		complimentary_filter_state.reset_timeval = PIOS_DELAY_GetRaw();
-		timeval = PIOS_DELAY_GetRaw();
+
+		GyrosGet(&gyrosData);
+		timeval = sample_time(gyrosData.SampleTime);
 
 		complimentary_filter_state.arming_count = 0;
 
@@ -426,9 +433,10 @@ static int32_t updateAttitudeComplementary(bool first_run)
 	GyrosGet(&gyrosData);
 	accumulate_gyro(&gyrosData);
 
-	// Compute the dT using the cpu clock
-	dT = PIOS_DELAY_DiffuS(timeval) / 1000000.0f;
-	timeval = PIOS_DELAY_GetRaw();
+	// Compute the dT from the time the gyros were sampled
+	uint32_t gyro_time = sample_time(gyrosData.SampleTime);
+	dT = (int32_t) (gyro_time - timeval) / 1000000.0f;
+	timeval = gyro_time;
 
 	float q[4];
 
@@ -682,6 +690,26 @@ static void accumulate_gyro(GyrosData *gyrosData)
 int32_t ins_failed = 0;
 int32_t init_stage = 0;
 
+//! State of the filter at the time of an earlier prediction
+struct ins_history_entry {
+	uint32_t time;
+	float Pos[3];
+	float Vel[3];
+	float q[4];
+};
+
+static struct ins_history_entry ins_history[INS_HISTORY_LENGTH];
+static uint8_t ins_history_head;
+static uint8_t ins_history_count;
+static uint32_t ins_history_time; //!< time of the current state
+
+static void ins_history_reset();
+static void ins_history_store(uint32_t time, const struct NavStruct *Nav);
+static bool ins_history_find(uint32_t time, const struct NavStruct *Nav,
+		struct ins_history_entry *state);
+static void ins_history_advance(uint32_t time, struct NavStruct *Nav,
+		float *mag, float *pos, float *vel, float *alt);
+
 /**
  * @brief Use the INSGPS fusion algorithm in either indoor or outdoor mode (use GPS)
  * @params[in] first_run This is the first run so trigger reinitialization
@@ -707,6 +735,8 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	static bool baro_updated;
 	static bool gps_updated;
 	static bool gps_vel_updated;
+	static uint32_t gps_time;
+	static uint32_t gps_vel_time;
 
 	static float baroOffset = 0;
 
@@ -748,15 +778,24 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		gps_updated = 0;
 		gps_vel_updated = 0;
 
-		ins_last_time = PIOS_DELAY_GetRaw();
+		ins_last_time = PIOS_DELAY_GetuS();
+		ins_history_reset();
 
 		return 0;
 	}
 
 	mag_updated |= (xQueueReceive(magQueue, &ev, 0 / portTICK_RATE_MS) == pdTRUE);
 	baro_updated |= xQueueReceive(baroQueue, &ev, 0 / portTICK_RATE_MS) == pdTRUE;
-	gps_updated |= (xQueueReceive(gpsQueue, &ev, 0 / portTICK_RATE_MS) == pdTRUE) && outdoor_mode;
-	gps_vel_updated |= (xQueueReceive(gpsVelQueue, &ev, 0 / portTICK_RATE_MS) == pdTRUE) && outdoor_mode;
+
+	// The GPS does not timestamp its solutions, use the time they arrived
+	if ((xQueueReceive(gpsQueue, &ev, 0 / portTICK_RATE_MS) == pdTRUE) && outdoor_mode) {
+		gps_updated = true;
+		gps_time = PIOS_DELAY_GetuS();
+	}
+	if ((xQueueReceive(gpsVelQueue, &ev, 0 / portTICK_RATE_MS) == pdTRUE) && outdoor_mode) {
+		gps_vel_updated = true;
+		gps_vel_time = PIOS_DELAY_GetuS();
+	}
 
 	// Get most recent data
 	GyrosGet(&gyrosData);
@@ -869,7 +908,7 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 			INSResetP(Pdiag);
 		} else if (init_stage > 0) {
 			// Run prediction a bit before any corrections
-			dT = PIOS_DELAY_DiffuS(ins_last_time) / 1.0e6f;
+			dT = (int32_t) (sample_time(gyrosData.SampleTime) - ins_last_time) / 1.0e6f;
 
 			GyrosBiasGet(&gyrosBias);
 			float gyros[3] = {(gyrosData.x + gyrosBias.x) * F_PI / 180.0f, 
@@ -891,7 +930,8 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 		if(init_stage > 10)
 			inited = true;
 
-		ins_last_time = PIOS_DELAY_GetRaw();	
+		ins_last_time = sample_time(gyrosData.SampleTime);
+		ins_history_reset();
 
 		return 0;
 	}
@@ -899,8 +939,11 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	if (!inited)
 		return 0;
 
-	dT = PIOS_DELAY_DiffuS(ins_last_time) / 1.0e6f;
-	ins_last_time = PIOS_DELAY_GetRaw();
+	// Integrate over the time between the gyro samples, not when they
+	// were processed
+	uint32_t gyro_time = sample_time(gyrosData.SampleTime);
+	dT = (int32_t) (gyro_time - ins_last_time) / 1.0e6f;
+	ins_last_time = gyro_time;
 
 	// This should only happen at start up or at mode switches
 	if(dT > 0.01f)
@@ -927,6 +970,7 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 
 	// Advance the state estimate
 	INSStatePrediction(gyros, &accelsData.x, dT);
+	ins_history_store(gyro_time, Nav);
 
 	// Copy the attitude into the UAVO
 	AttitudeActualData attitude;
@@ -997,8 +1041,22 @@ static int32_t updateAttitudeINSGPS(bool first_run, bool outdoor_mode)
 	 * TODO: Need to add a general sanity check for all the inputs to make sure their kosher
 	 * although probably should occur within INS itself
 	 */
+	float baroAlt = baroData.Altitude + baroOffset;
+
+	// The measurements were taken before the current state, move them by how
+	// much the state changed since then so the innovation is computed at the
+	// time they were taken
+	if (sensors & MAG_SENSORS)
+		ins_history_advance(sample_time(magData.SampleTime), Nav, &magData.x, NULL, NULL, NULL);
+	if (sensors & BARO_SENSOR)
+		ins_history_advance(sample_time(baroData.SampleTime), Nav, NULL, NULL, NULL, &baroAlt);
+	if (gps_updated && outdoor_mode)
+		ins_history_advance(gps_time - insSettings.GPSDelay * 1000, Nav, NULL, NED, NULL, NULL);
+	if (gps_vel_updated && outdoor_mode)
+		ins_history_advance(gps_vel_time - insSettings.GPSDelay * 1000, Nav, NULL, NULL, vel, NULL);
+
 	if (sensors)
-		INSCorrection(&magData.x, NED, vel, ( baroData.Altitude + baroOffset ), sensors);
+		INSCorrection(&magData.x, NED, vel, baroAlt, sensors);
 
 	// Copy the position and velocity into the UAVO
 	PositionActualData positionActual;
@@ -1066,6 +1124,157 @@ static int32_t getNED(GPSPositionData * gpsPosition, float * NED)
 	return 0;
 }
 
+/**
+ * Get the time a sample was taken, which is the current time for sources
+ * that do not timestamp their samples (e.g. HITL)
+ * @param[in] timestamp The SampleTime of the object in us
+ * @return the time of the sample in us
+ */
+static uint32_t sample_time(uint32_t timestamp)
+{
+	return (timestamp != 0) ? timestamp : PIOS_DELAY_GetuS();
+}
+
+/**
+ * Clear the state history after the filter was reset
+ */
+static void ins_history_reset()
+{
+	ins_history_head = 0;
+	ins_history_count = 0;
+}
+
+/**
+ * Store the state after a prediction, at most every INS_HISTORY_PERIOD_US
+ * @param[in] time The time of the gyro sample the state was predicted to
+ * @param[in] Nav The state estimate
+ */
+static void ins_history_store(uint32_t time, const struct NavStruct *Nav)
+{
+	ins_history_time = time;
+
+	if (ins_history_count > 0) {
+		const struct ins_history_entry *last =
+			&ins_history[(ins_history_head + INS_HISTORY_LENGTH - 1) % INS_HISTORY_LENGTH];
+		if (time - last->time < INS_HISTORY_PERIOD_US)
+			return;
+	}
+
+	struct ins_history_entry *entry = &ins_history[ins_history_head];
+	entry->time = time;
+	memcpy(entry->Pos, Nav->Pos, sizeof(entry->Pos));
+	memcpy(entry->Vel, Nav->Vel, sizeof(entry->Vel));
+	memcpy(entry->q, Nav->q, sizeof(entry->q));
+
+	ins_history_head = (ins_history_head + 1) % INS_HISTORY_LENGTH;
+	if (ins_history_count < INS_HISTORY_LENGTH)
+		ins_history_count++;
+}
+
+/**
+ * Interpolate the state at a time between the stored states and the
+ * current one, so that measurements are not shifted by the spacing of
+ * the history
+ * @param[in] time The time in us
+ * @param[in] Nav The current state estimate
+ * @param[out] state The state at that time
+ * @return true if found, false if the time is older than the history
+ * or not older than the current state
+ */
+static bool ins_history_find(uint32_t time, const struct NavStruct *Nav,
+		struct ins_history_entry *state)
+{
+	if (ins_history_count == 0 || (int32_t) (ins_history_time - time) <= 0)
+		return false;
+
+	struct ins_history_entry current;
+	current.time = ins_history_time;
+	memcpy(current.Pos, Nav->Pos, sizeof(current.Pos));
+	memcpy(current.Vel, Nav->Vel, sizeof(current.Vel));
+	memcpy(current.q, Nav->q, sizeof(current.q));
+
+	const struct ins_history_entry *newer = &current;
+	for (uint8_t i = 1; i <= ins_history_count; i++) {
+		const struct ins_history_entry *entry =
+			&ins_history[(ins_history_head + INS_HISTORY_LENGTH - i) % INS_HISTORY_LENGTH];
+		if ((int32_t) (time - entry->time) >= 0) {
+			float k = (float) (time - entry->time) / (float) (newer->time - entry->time);
+
+			state->time = time;
+			for (uint8_t j = 0; j < 3; j++) {
+				state->Pos[j] = entry->Pos[j] + k * (newer->Pos[j] - entry->Pos[j]);
+				state->Vel[j] = entry->Vel[j] + k * (newer->Vel[j] - entry->Vel[j]);
+			}
+
+			// The attitude changes little within one period, so a normalized
+			// linear interpolation is close enough
+			float qmag = 0;
+			for (uint8_t j = 0; j < 4; j++) {
+				state->q[j] = entry->q[j] + k * (newer->q[j] - entry->q[j]);
+				qmag += state->q[j] * state->q[j];
+			}
+			qmag = sqrtf(qmag);
+			for (uint8_t j = 0; j < 4; j++)
+				state->q[j] /= qmag;
+
+			return true;
+		}
+		newer = entry;
+	}
+
+	return false;
+}
+
+/**
+ * Move delayed measurements to the current state. Each measurement is changed
+ * by the difference between the current state and the state at the time it
+ * was taken, which makes the innovation relative to the past state. This is
+ * applied with the current covariance instead of running the filter again
+ * from the past state. Measurements older than the history or taken at the
+ * time of the current state are not changed.
+ * @param[in] time When the measurements were taken in us
+ * @param[in] Nav The current state estimate
+ * @param[in,out] mag Magnetometer measurement in the body frame or NULL
+ * @param[in,out] pos NED position or NULL
+ * @param[in,out] vel NED velocity or NULL
+ * @param[in,out] alt Barometric altitude or NULL
+ */
+static void ins_history_advance(uint32_t time, struct NavStruct *Nav,
+		float *mag, float *pos, float *vel, float *alt)
+{
+	struct ins_history_entry past;
+	if (!ins_history_find(time, Nav, &past))
+		return;
+	const struct ins_history_entry *entry = &past;
+
+	if (mag) {
+		// Rotate into the earth frame with the past attitude and back
+		// into the body frame with the current one
+		float q[4] = {entry->q[0], entry->q[1], entry->q[2], entry->q[3]};
+		float Rbe[3][3];
+		float Be[3];
+
+		Quaternion2R(q, Rbe);
+		rot_mult(Rbe, mag, Be, true);
+		Quaternion2R(Nav->q, Rbe);
+		rot_mult(Rbe, Be, mag, false);
+	}
+
+	if (pos) {
+		for (uint8_t i = 0; i < 3; i++)
+			pos[i] += Nav->Pos[i] - entry->Pos[i];
+	}
+
+	if (vel) {
+		for (uint8_t i = 0; i < 3; i++)
+			vel[i] += Nav->Vel[i] - entry->Vel[i];
+	}
+
+	// Altitude is positive up and the position is NED
+	if (alt)
+		*alt -= Nav->Pos[2] - entry->Pos[2];
+}
+
 static void settingsUpdatedCb(UAVObjEvent * ev) 
 {
 	if (ev == NULL || ev->obj == InertialSensorSettingsHandle()) {
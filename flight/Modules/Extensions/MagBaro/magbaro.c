@@ -178,6 +178,7 @@ static void magbaroTask(void *parameters)
 
 			// Compute the current altitude (all pressures in kPa)
 			data.Altitude = 44330.0 * (1.0 - powf((data.Pressure / (BMP085_P0 / 1000.0)), (1.0 / 5.255)));
+			data.SampleTime = PIOS_DELAY_GetuS();
 
 			// Update the AltitudeActual UAVObject
 			BaroAltitudeSet(&data);
@@ -186,8 +187,7 @@ static void magbaroTask(void *parameters)
 
 #if defined(PIOS_INCLUDE_HMC5883)
 		struct pios_sensor_mag_data mags;
-		xQueueHandle queue = PIOS_SENSORS_GetQueue(PIOS_SENSOR_MAG);
-		if (queue != NULL && xQueueReceive(queue, (void *) &mags, 0) != errQUEUE_EMPTY) {
+		if (PIOS_SENSORS_Receive(PIOS_SENSOR_MAG, &mags, 1, 0) > 0) {
 			update_mags(&mags);
 		}
 #endif
@@ -209,6 +209,7 @@ static void update_mags(struct pios_sensor_mag_data *mag)
 	magData.x = mags[0];
 	magData.y = mags[1];
 	magData.z = mags[2];
+	magData.SampleTime = mag->timestamp;
 	MagnetometerSet(&magData);
 }
 
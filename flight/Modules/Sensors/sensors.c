@@ -63,7 +63,9 @@
 #include "magnetometer.h"
 #include "magbias.h"
 #include "revocalibration.h"
+#include "sensorfiltersettings.h"
 #include "CoordinateConversions.h"
+#include "sensor_filters.h"
 
 // Private constants
 #define STACK_SIZE_BYTES 1000
@@ -80,6 +82,7 @@ enum mag_calibration_algo {
 // Private functions
 static void SensorsTask(void *parameters);
 static void settingsUpdatedCb(UAVObjEvent * objEv);
+static void filterSettingsUpdatedCb(UAVObjEvent * objEv);
 
 static void update_accels(struct pios_sensor_accel_data *accel);
 static void update_gyros(struct pios_sensor_gyro_data *gyro);
@@ -106,6 +109,12 @@ static float gyro_scale[3] = {0,0,0};
 static float Rbs[3][3] = {{0}};
 static int8_t rotate = 0;
 
+//! Filters run on every raw sample, rebuilt by the task when the settings change
+static struct filter_bank accel_filter;
+static struct filter_bank gyro_filter;
+static volatile bool filter_settings_updated = true;
+static bool filter_settings_valid = true;
+
 //! Select the algorithm to try and null out the magnetometer bias error
 static enum mag_calibration_algo mag_calibration_algo = MAG_CALIBRATION_PRELEMARI;
 
@@ -134,6 +143,7 @@ static int32_t SensorsInitialize(void)
 	AttitudeSettingsInitialize();
 	InertialSensorSettingsInitialize();
 	INSSettingsInitialize();
+	SensorFilterSettingsInitialize();
 
 	rotate = 0;
 
@@ -141,6 +151,7 @@ static int32_t SensorsInitialize(void)
 	AttitudeSettingsConnectCallback(&settingsUpdatedCb);
 	InertialSensorSettingsConnectCallback(&settingsUpdatedCb);
 	INSSettingsConnectCallback(&settingsUpdatedCb);
+	SensorFilterSettingsConnectCallback(&filterSettingsUpdatedCb);
 
 	return 0;
 }
@@ -186,6 +197,10 @@ static void SensorsTask(void *parameters)
 			lastSysTime = xTaskGetTickCount();
 			AlarmsSet(SYSTEMALARMS_ALARM_SENSORS, SYSTEMALARMS_ALARM_CRITICAL);
 			vTaskDelayUntil(&lastSysTime, SENSOR_PERIOD / portTICK_RATE_MS);
+
+			// Do not filter across the gap in the samples
+			filter_bank_reset(&gyro_filter);
+			filter_bank_reset(&accel_filter);
 		}
 
 		struct pios_sensor_gyro_data gyros;
@@ -195,17 +210,24 @@ static void SensorsTask(void *parameters)
 
 		uint32_t timeval = PIOS_DELAY_GetRaw();
 
-		xQueueHandle queue;
-		queue = PIOS_SENSORS_GetQueue(PIOS_SENSOR_GYRO);
-		if(queue == NULL || xQueueReceive(queue, (void *) &gyros, SENSOR_PERIOD) == errQUEUE_EMPTY) {
+		if (filter_settings_updated) {
+			filter_settings_updated = false;
+			filter_settings_valid = sensor_filters_configure(&gyro_filter, &accel_filter,
+					1000.0f / SENSOR_PERIOD) == 0;
+		}
+
+		// Drain everything the gyro and accel produced since the last
+		// cycle, which is several samples when they run faster
+		if (PIOS_SENSORS_ReceiveFiltered(PIOS_SENSOR_GYRO, &gyros,
+				filter_bank_apply_cb, &gyro_filter, SENSOR_PERIOD) <= 0) {
 			good_runs = 0;
 			continue;
 		}
 
 		// As it says below, because the rest of the code expects the accel to be ready when
 		// the gyro is we must block here too
-		queue = PIOS_SENSORS_GetQueue(PIOS_SENSOR_ACCEL);
-		if(queue == NULL || xQueueReceive(queue, (void *) &accels, SENSOR_PERIOD) == errQUEUE_EMPTY) {
+		if (PIOS_SENSORS_ReceiveFiltered(PIOS_SENSOR_ACCEL, &accels,
+				filter_bank_apply_cb, &accel_filter, SENSOR_PERIOD) <= 0) {
 			good_runs = 0;
 			continue;
 		}
@@ -216,19 +238,25 @@ static void SensorsTask(void *parameters)
 		// the accels to be available first
 		update_gyros(&gyros);
 
-		queue = PIOS_SENSORS_GetQueue(PIOS_SENSOR_MAG);
-		if(queue != NULL && xQueueReceive(queue, (void *) &mags, 0) != errQUEUE_EMPTY) {
+		if (PIOS_SENSORS_Receive(PIOS_SENSOR_MAG, &mags, 1, 0) > 0) {
 			update_mags(&mags);
 		}
 
-		queue = PIOS_SENSORS_GetQueue(PIOS_SENSOR_BARO);
-		if (queue != NULL && xQueueReceive(queue, (void *) &baro, 0) != errQUEUE_EMPTY) {
+		if (PIOS_SENSORS_Receive(PIOS_SENSOR_BARO, &baro, 1, 0) > 0) {
 			update_baro(&baro);
 		}
 
-		if (good_runs > REQUIRED_GOOD_CYCLES)
-			AlarmsClear(SYSTEMALARMS_ALARM_SENSORS);
-		else
+		// Samples the drivers had to drop are missing from the filters
+		uint32_t dropped = PIOS_SENSORS_GetOverruns(PIOS_SENSOR_GYRO) +
+				PIOS_SENSORS_GetOverruns(PIOS_SENSOR_ACCEL);
+
+		if (good_runs > REQUIRED_GOOD_CYCLES) {
+			// Rejected filter settings leave the sensors unfiltered
+			if (filter_settings_valid && dropped == 0)
+				AlarmsClear(SYSTEMALARMS_ALARM_SENSORS);
+			else
+				AlarmsSet(SYSTEMALARMS_ALARM_SENSORS, SYSTEMALARMS_ALARM_WARNING);
+		} else
 			good_runs++;
 		PIOS_WDG_UpdateFlag(PIOS_WDG_SENSORS);
 
@@ -267,6 +295,7 @@ static void update_accels(struct pios_sensor_accel_data *accels)
 	}
 
 	accelsData.temperature = accels->temperature;
+	accelsData.SampleTime = accels->timestamp;
 	AccelsSet(&accelsData);
 }
 
@@ -306,6 +335,7 @@ static void update_gyros(struct pios_sensor_gyro_data *gyros)
 	}
 
 	gyrosData.temperature = gyros->temperature;
+	gyrosData.SampleTime = gyros->timestamp;
 	GyrosSet(&gyrosData);
 }
 
@@ -322,6 +352,7 @@ static void update_mags(struct pios_sensor_mag_data *mag)
 	};
 
 	MagnetometerData magData;
+	magData.SampleTime = mag->timestamp;
 	if (rotate) {
 		float mag_out[3];
 		rot_mult(Rbs, mags, mag_out, false);
@@ -359,6 +390,7 @@ static void update_baro(struct pios_sensor_baro_data *baro)
 	baroAltitude.Temperature = baro->temperature;
 	baroAltitude.Pressure = baro->pressure;
 	baroAltitude.Altitude = baro->altitude;
+	baroAltitude.SampleTime = baro->timestamp;
 	BaroAltitudeSet(&baroAltitude);
 }
 
@@ -522,6 +554,15 @@ static void settingsUpdatedCb(UAVObjEvent * objEv) {
 	}
 
 }
+
+/**
+ * The filters are only rebuilt by the sensor task, which is the one running them
+ */
+static void filterSettingsUpdatedCb(UAVObjEvent * objEv)
+{
+	filter_settings_updated = true;
+}
+
 /**
   * @}
   * @}
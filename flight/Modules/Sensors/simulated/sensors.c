@@ -219,6 +219,7 @@ static void simulateConstant()
 	accelsData.y = 0;
 	accelsData.z = -GRAV;
 	accelsData.temperature = 0;
+	accelsData.SampleTime = PIOS_DELAY_GetuS();
 	AccelsSet(&accelsData);
 
 	GyrosData gyrosData; // Skip get as we set all the fields
@@ -233,11 +234,13 @@ static void simulateConstant()
 	gyrosData.y += gyrosBias.y;
 	gyrosData.z += gyrosBias.z;
 
+	gyrosData.SampleTime = PIOS_DELAY_GetuS();
 	GyrosSet(&gyrosData);
 
 	BaroAltitudeData baroAltitude;
 	BaroAltitudeGet(&baroAltitude);
 	baroAltitude.Altitude = 1;
+	baroAltitude.SampleTime = PIOS_DELAY_GetuS();
 	BaroAltitudeSet(&baroAltitude);
 
 	GPSPositionData gpsPosition;
@@ -253,6 +256,7 @@ static void simulateConstant()
 	mag.x = 400;
 	mag.y = 0;
 	mag.z = 800;
+	mag.SampleTime = PIOS_DELAY_GetuS();
 	MagnetometerSet(&mag);
 }
 
@@ -275,6 +279,7 @@ static void simulateModelAgnostic()
 	accelsData.y = -GRAV * Rbe[1][2];
 	accelsData.z = -GRAV * Rbe[2][2];
 	accelsData.temperature = 30;
+	accelsData.SampleTime = PIOS_DELAY_GetuS();
 	AccelsSet(&accelsData);
 
 	RateDesiredData rateDesired;
@@ -292,11 +297,13 @@ static void simulateModelAgnostic()
 	gyrosData.y += gyrosBias.y;
 	gyrosData.z += gyrosBias.z;
 
+	gyrosData.SampleTime = PIOS_DELAY_GetuS();
 	GyrosSet(&gyrosData);
 
 	BaroAltitudeData baroAltitude;
 	BaroAltitudeGet(&baroAltitude);
 	baroAltitude.Altitude = 1;
+	baroAltitude.SampleTime = PIOS_DELAY_GetuS();
 	BaroAltitudeSet(&baroAltitude);
 
 	GPSPositionData gpsPosition;
@@ -312,6 +319,7 @@ static void simulateModelAgnostic()
 	mag.x = 400;
 	mag.y = 0;
 	mag.z = 800;
+	mag.SampleTime = PIOS_DELAY_GetuS();
 	MagnetometerSet(&mag);
 }
 
@@ -375,6 +383,7 @@ static void simulateModelQuadcopter()
 	gyrosData.x = rpy[0] + rand_gauss();
 	gyrosData.y = rpy[1] + rand_gauss();
 	gyrosData.z = rpy[2] + rand_gauss();
+	gyrosData.SampleTime = PIOS_DELAY_GetuS();
 	GyrosSet(&gyrosData);
 	
 	// Predict the attitude forward in time
@@ -449,6 +458,7 @@ static void simulateModelQuadcopter()
 	accelsData.y = ned_accel[0] * Rbe[1][0] + ned_accel[1] * Rbe[1][1] + ned_accel[2] * Rbe[1][2] + accel_bias[1];
 	accelsData.z = ned_accel[0] * Rbe[2][0] + ned_accel[1] * Rbe[2][1] + ned_accel[2] * Rbe[2][2] + accel_bias[2];
 	accelsData.temperature = 30;
+	accelsData.SampleTime = PIOS_DELAY_GetuS();
 	AccelsSet(&accelsData);
 
 	if(baro_offset == 0) {
@@ -464,6 +474,7 @@ static void simulateModelQuadcopter()
 		BaroAltitudeData baroAltitude;
 		BaroAltitudeGet(&baroAltitude);
 		baroAltitude.Altitude = -pos[2] + baro_offset;
+		baroAltitude.SampleTime = PIOS_DELAY_GetuS();
 		BaroAltitudeSet(&baroAltitude);
 		last_baro_time = PIOS_DELAY_GetRaw();
 	}
@@ -527,6 +538,7 @@ static void simulateModelQuadcopter()
 		// Run the offset compensation algorithm from the firmware
 		magOffsetEstimation(&mag);
 
+		mag.SampleTime = PIOS_DELAY_GetuS();
 		MagnetometerSet(&mag);
 		last_mag_time = PIOS_DELAY_GetRaw();
 	}
@@ -627,6 +639,7 @@ static void simulateModelAirplane()
 	gyrosData.x = rpy[0] + rand_gauss();
 	gyrosData.y = rpy[1] + rand_gauss();
 	gyrosData.z = rpy[2] + rand_gauss();
+	gyrosData.SampleTime = PIOS_DELAY_GetuS();
 	GyrosSet(&gyrosData);
 	
 	// Predict the attitude forward in time
@@ -722,6 +735,7 @@ static void simulateModelAirplane()
 	accelsData.y = ned_accel[0] * Rbe[1][0] + ned_accel[1] * Rbe[1][1] + ned_accel[2] * Rbe[1][2] + accel_bias[1];
 	accelsData.z = ned_accel[0] * Rbe[2][0] + ned_accel[1] * Rbe[2][1] + ned_accel[2] * Rbe[2][2] + accel_bias[2];
 	accelsData.temperature = 30;
+	accelsData.SampleTime = PIOS_DELAY_GetuS();
 	AccelsSet(&accelsData);
 	
 	if(baro_offset == 0) {
@@ -737,6 +751,7 @@ static void simulateModelAirplane()
 		BaroAltitudeData baroAltitude;
 		BaroAltitudeGet(&baroAltitude);
 		baroAltitude.Altitude = -pos[2] + baro_offset;
+		baroAltitude.SampleTime = PIOS_DELAY_GetuS();
 		BaroAltitudeSet(&baroAltitude);
 		last_baro_time = PIOS_DELAY_GetRaw();
 	}
@@ -808,6 +823,7 @@ static void simulateModelAirplane()
 		mag.y = 100+homeLocation.Be[0] * Rbe[1][0] + homeLocation.Be[1] * Rbe[1][1] + homeLocation.Be[2] * Rbe[1][2];
 		mag.z = 100+homeLocation.Be[0] * Rbe[2][0] + homeLocation.Be[1] * Rbe[2][1] + homeLocation.Be[2] * Rbe[2][2];
 		magOffsetEstimation(&mag);
+		mag.SampleTime = PIOS_DELAY_GetuS();
 		MagnetometerSet(&mag);
 		last_mag_time = PIOS_DELAY_GetRaw();
 	}
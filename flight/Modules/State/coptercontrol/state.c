@@ -423,6 +423,9 @@ static int32_t updateIntertialSensors(AccelsData * accels, GyrosData * gyros, bo
 		memcpy(prelim_gyros, tmpVec, sizeof(tmpVec));
 	}
 
+	// The sensors are read as they are converted
+	accels->SampleTime = gyros->SampleTime = PIOS_DELAY_GetuS();
+
 	// Store rotated accels
 	accels->x = prelim_accels[0];
 	accels->y = prelim_accels[1];
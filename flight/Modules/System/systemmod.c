@@ -222,6 +222,12 @@ static void systemTask(void *parameters)
 		FlightStatusData flightStatus;
 		FlightStatusGet(&flightStatus);
 
+#if defined(PIOS_INCLUDE_FLASH_SECTOR_SETTINGS)
+		// Collect the settings flash garbage while nothing critical needs the flash
+		if (flightStatus.Armed == FLIGHTSTATUS_ARMED_DISARMED)
+			PIOS_FLASHFS_GarbageCollect(0);
+#endif
+
 		UAVObjEvent ev;
 		int delayTime = flightStatus.Armed == FLIGHTSTATUS_ARMED_ARMED ?
 			SYSTEM_UPDATE_PERIOD_MS / portTICK_RATE_MS / (LED_BLINK_RATE_HZ * 2) :
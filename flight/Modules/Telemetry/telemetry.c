@@ -65,6 +65,8 @@ static xTaskHandle telemetryRxTaskHandle;
 static uint32_t txErrors;
 static uint32_t txRetries;
 static uint32_t timeOfLastObjectUpdate;
+static bool batchingEnabled;
+static bool deltaEnabled;
 static UAVTalkConnection uavTalkCon;
 
 // Private functions
@@ -75,6 +77,7 @@ static void registerObject(UAVObjHandle obj);
 static void updateObject(UAVObjHandle obj, int32_t eventType);
 static int32_t setUpdatePeriod(UAVObjHandle obj, int32_t updatePeriodMs);
 static void processObjEvent(UAVObjEvent * ev);
+static void processObjEvents(xQueueHandle eventQueue, portTickType timeout);
 static void updateTelemetryStats();
 static void gcsTelemetryStatsUpdated();
 static void updateSettings();
@@ -264,7 +267,23 @@ static void processObjEvent(UAVObjEvent * ev)
 		// Act on event
 		retries = 0;
 		success = -1;
-		if (ev->event == EV_UPDATED || ev->event == EV_UPDATED_MANUAL || ((ev->event == EV_UPDATED_PERIODIC) && (updateMode != UPDATEMODE_THROTTLED))) {
+		if ((ev->event == EV_UPDATED || ev->event == EV_UPDATED_MANUAL || ((ev->event == EV_UPDATED_PERIODIC) && (updateMode != UPDATEMODE_THROTTLED)))
+				&& UAVObjGetTelemetryAcked(&metadata)) {
+			// Send update to GCS without waiting for the ack, retries are handled by UAVTalk
+			if (UAVTalkSendObjectWindowed(uavTalkCon, ev->obj, ev->instId, REQ_TIMEOUT_MS, MAX_RETRIES - 1) == -1) {
+				++txErrors;
+			}
+		} else if (deltaEnabled && ev->event == EV_UPDATED_PERIODIC && updateMode == UPDATEMODE_PERIODIC) {
+			// Periodic updates mostly repeat the previous data, only send the fields that changed
+			if (UAVTalkSendObjectDelta(uavTalkCon, ev->obj, ev->instId) == -1) {
+				++txErrors;
+			}
+		} else if (batchingEnabled && (ev->event == EV_UPDATED || ev->event == EV_UPDATED_MANUAL || ((ev->event == EV_UPDATED_PERIODIC) && (updateMode != UPDATEMODE_THROTTLED)))) {
+			// Add update to the frame that is sent once the queue is empty
+			if (UAVTalkSendObjectBatched(uavTalkCon, ev->obj, ev->instId) == -1) {
+				++txErrors;
+			}
+		} else if (ev->event == EV_UPDATED || ev->event == EV_UPDATED_MANUAL || ((ev->event == EV_UPDATED_PERIODIC) && (updateMode != UPDATEMODE_THROTTLED))) {
 			// Send update to GCS (with retries)
 			while (retries < MAX_RETRIES && success == -1) {
 				success = UAVTalkSendObject(uavTalkCon, ev->obj, ev->instId, UAVObjGetTelemetryAcked(&metadata), REQ_TIMEOUT_MS);	// call blocks until ack is received or timeout
@@ -299,20 +318,38 @@ static void processObjEvent(UAVObjEvent * ev)
 	}
 }
 
+/**
+ * Wait for an event and process it along with all the other events that are queued,
+ * then send the updates that were batched while doing so in one frame.
+ */
+static void processObjEvents(xQueueHandle eventQueue, portTickType timeout)
+{
+	UAVObjEvent ev;
+
+	if (xQueueReceive(eventQueue, &ev, timeout) == pdTRUE) {
+		do {
+			processObjEvent(&ev);
+		} while (batchingEnabled && xQueueReceive(eventQueue, &ev, 0) == pdTRUE);
+
+		if (batchingEnabled) {
+			UAVTalkFlushBatch(uavTalkCon);
+		}
+	}
+}
+
 /**
  * Telemetry transmit task, regular priority
  */
 static void telemetryTxTask(void *parameters)
 {
-	UAVObjEvent ev;
+	int32_t timeToNextRetry;
 
 	// Loop forever
 	while (1) {
-		// Wait for queue message
-		if (xQueueReceive(queue, &ev, portMAX_DELAY) == pdTRUE) {
-			// Process event
-			processObjEvent(&ev);
-		}
+		// Retransmit the acked objects that timed out and wait for queue message,
+		// waking up in time for the next retransmission
+		timeToNextRetry = UAVTalkProcessPendingAcks(uavTalkCon);
+		processObjEvents(queue, timeToNextRetry < 0 ? portMAX_DELAY : timeToNextRetry / portTICK_RATE_MS);
 	}
 }
 
@@ -322,15 +359,14 @@ static void telemetryTxTask(void *parameters)
 #if defined(PIOS_TELEM_PRIORITY_QUEUE)
 static void telemetryTxPriTask(void *parameters)
 {
-	UAVObjEvent ev;
+	int32_t timeToNextRetry;
 
 	// Loop forever
 	while (1) {
-		// Wait for queue message
-		if (xQueueReceive(priorityQueue, &ev, portMAX_DELAY) == pdTRUE) {
-			// Process event
-			processObjEvent(&ev);
-		}
+		// The acked updates on this queue are windowed too, so this task also
+		// retransmits them instead of waiting for the regular task to wake up
+		timeToNextRetry = UAVTalkProcessPendingAcks(uavTalkCon);
+		processObjEvents(priorityQueue, timeToNextRetry < 0 ? portMAX_DELAY : timeToNextRetry / portTICK_RATE_MS);
 	}
 }
 #endif
@@ -438,8 +474,8 @@ static void updateTelemetryStats()
 		flightStats.RxDataRate = (float)utalkStats.rxBytes / ((float)STATS_UPDATE_PERIOD_MS / 1000.0);
 		flightStats.TxDataRate = (float)utalkStats.txBytes / ((float)STATS_UPDATE_PERIOD_MS / 1000.0);
 		flightStats.RxFailures += utalkStats.rxErrors;
-		flightStats.TxFailures += txErrors;
-		flightStats.TxRetries += txRetries;
+		flightStats.TxFailures += txErrors + utalkStats.txErrors;
+		flightStats.TxRetries += txRetries + utalkStats.txRetries;
 		txErrors = 0;
 		txRetries = 0;
 	} else {
@@ -512,7 +548,16 @@ static void updateTelemetryStats()
  */
 static void updateSettings()
 {
-	
+	// Only batch updates when the GCS was told to expect multi-object frames
+	uint8_t batching;
+	ModuleSettingsTelemetryBatchingGet(&batching);
+	batchingEnabled = (batching == MODULESETTINGS_TELEMETRYBATCHING_ENABLED);
+
+	// Same for delta updates of periodic objects
+	uint8_t delta;
+	ModuleSettingsTelemetryDeltaUpdatesGet(&delta);
+	deltaEnabled = (delta == MODULESETTINGS_TELEMETRYDELTAUPDATES_ENABLED);
+
 	if (telemetryPort) {
 		// Retrieve settings
 		uint8_t speed;
@@ -0,0 +1,166 @@
+/**
+ ******************************************************************************
+ * @addtogroup TauLabsModules Tau Labs Modules
+ * @{
+ * @addtogroup UAVOBenchmarkModule UAVObject benchmark module
+ * @brief Measures the latency of UAVObject reads under telemetry load
+ * @{
+ *
+ * @file       uavobenchmark.c
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Reports the worst case GyrosGet latency while another task keeps
+ *             packing every registered object, like the telemetry module does.
+ *             Only intended for the simulator (SITL) build.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "openpilot.h"
+#include "gyros.h"
+#include <stdio.h>
+
+// Private constants
+#define STACK_SIZE_BYTES 2048
+#define LOAD_TASK_PRIORITY (tskIDLE_PRIORITY + 1)
+#define READ_TASK_PRIORITY (tskIDLE_PRIORITY + 3)
+#define READ_PERIOD_MS 2
+#define REPORT_PERIOD_MS 5000
+#define MAX_OBJECT_SIZE 256
+
+// Private variables
+static xTaskHandle loadTaskHandle;
+static xTaskHandle readTaskHandle;
+static UAVObjHandle *objects;
+static uint16_t numObjects;
+
+// Private functions
+int32_t UAVOBenchmarkInitialize(void);
+int32_t UAVOBenchmarkStart(void);
+static void loadTask(void *parameters);
+static void readTask(void *parameters);
+static void countObject(UAVObjHandle obj);
+static void addObject(UAVObjHandle obj);
+
+/**
+ * Initialise the module
+ * \return 0 on success or -1 if initialisation failed
+ */
+int32_t UAVOBenchmarkInitialize(void)
+{
+	return 0;
+}
+
+/**
+ * Start the module, called after all objects are registered
+ * \return 0 on success or -1 if initialisation failed
+ */
+int32_t UAVOBenchmarkStart(void)
+{
+	// Build the list of objects the load task packs. This is done once
+	// so that the benchmark does not hold the object list lock.
+	numObjects = 0;
+	UAVObjIterate(&countObject);
+	objects = (UAVObjHandle *) pvPortMalloc(numObjects * sizeof(UAVObjHandle));
+	if (objects == NULL)
+		return -1;
+	numObjects = 0;
+	UAVObjIterate(&addObject);
+
+	xTaskCreate(loadTask, (signed char *)"UAVOBenchLoad", STACK_SIZE_BYTES/4, NULL, LOAD_TASK_PRIORITY, &loadTaskHandle);
+	xTaskCreate(readTask, (signed char *)"UAVOBenchRead", STACK_SIZE_BYTES/4, NULL, READ_TASK_PRIORITY, &readTaskHandle);
+
+	return 0;
+}
+
+MODULE_INITCALL(UAVOBenchmarkInitialize, UAVOBenchmarkStart)
+
+static void countObject(UAVObjHandle obj)
+{
+	numObjects++;
+}
+
+static void addObject(UAVObjHandle obj)
+{
+	objects[numObjects++] = obj;
+}
+
+/**
+ * Pack every instance of every object as fast as possible, which is the
+ * worst case load the telemetry module can put on the object manager.
+ */
+static void loadTask(void *parameters)
+{
+	static uint8_t buffer[MAX_OBJECT_SIZE];
+
+	while (1) {
+		for (uint16_t n = 0; n < numObjects; ++n) {
+			if (UAVObjGetNumBytes(objects[n]) > MAX_OBJECT_SIZE)
+				continue;
+
+			uint16_t numInstances = UAVObjGetNumInstances(objects[n]);
+			for (uint16_t instId = 0; instId < numInstances; ++instId)
+				UAVObjPack(objects[n], instId, buffer);
+		}
+
+		// Give the idle task a chance to run
+		vTaskDelay(1);
+	}
+}
+
+/**
+ * Read the gyros at a fixed rate and report the worst and average time
+ * a read took over the last reporting period.
+ */
+static void readTask(void *parameters)
+{
+	GyrosData gyros;
+	uint32_t worst = 0;
+	uint32_t total = 0;
+	uint32_t reads = 0;
+	portTickType lastReport = xTaskGetTickCount();
+	portTickType lastSysTime = lastReport;
+
+	while (1) {
+		vTaskDelayUntil(&lastSysTime, READ_PERIOD_MS / portTICK_RATE_MS);
+
+		uint32_t start = PIOS_DELAY_GetRaw();
+		GyrosGet(&gyros);
+		uint32_t dT = PIOS_DELAY_DiffuS(start);
+
+		if (dT > worst)
+			worst = dT;
+		total += dT;
+		reads++;
+
+		if (xTaskGetTickCount() - lastReport >= REPORT_PERIOD_MS / portTICK_RATE_MS) {
+			fprintf(stdout, "UAVOBenchmark: GyrosGet worst %u us, mean %.2f us over %u reads, %u objects packed per sweep\n",
+				(unsigned int) worst, (double) total / reads, (unsigned int) reads, numObjects);
+
+			worst = 0;
+			total = 0;
+			reads = 0;
+			lastReport = xTaskGetTickCount();
+		}
+	}
+}
+
+/**
+ * @}
+ * @}
+ */
@@ -52,6 +52,13 @@
 #endif
 
 
+/* Run the tick and PIOS_DELAY on a simulated clock, which advances as soon as all tasks are blocked */
+#if defined(SIM_LOCKSTEP)
+#define configUSE_LOCKSTEP		1
+#else
+#define configUSE_LOCKSTEP		0
+#endif
+
 #define configUSE_IDLE_HOOK		1
 #define configUSE_TICK_HOOK		0
 #define configCPU_CLOCK_HZ		( ( unsigned long ) 72000000 )	
@@ -32,15 +32,24 @@
 #define PIOS_SENSOR_H
 
 #include "stdint.h"
+#include "stdbool.h"
 #include "FreeRTOS.h"
 #include "queue.h"
 
+/*
+ * Every sample carries the PIOS_DELAY_GetuS() time at which the sensor
+ * took it, as close to the hardware as the driver can tell (usually the
+ * data ready interrupt), so consumers do not depend on when they run.
+ * All the fields before the timestamp are floats.
+ */
+
 //! Pios sensor structure for generic gyro data
 struct pios_sensor_gyro_data {
 	float x;
 	float y; 
 	float z;
 	float temperature;
+	uint32_t timestamp;
 };
 
 //! Pios sensor structure for generic accel data
@@ -49,6 +58,7 @@ struct pios_sensor_accel_data {
 	float y; 
 	float z;
 	float temperature;
+	uint32_t timestamp;
 };
 
 //! Pios sensor structure for generic mag data
@@ -56,6 +66,7 @@ struct pios_sensor_mag_data {
 	float x;
 	float y; 
 	float z;
+	uint32_t timestamp;
 };
 
 //! Pios sensor structure for generic baro data
@@ -63,6 +74,7 @@ struct pios_sensor_baro_data {
 	float temperature;
 	float pressure;
 	float altitude;
+	uint32_t timestamp;
 };
 
 //! The types of sensors this module supports
@@ -81,13 +93,61 @@ struct pios_sensor_registration {
 	xQueueHandle queue;
 };
 
+/*
+ * Sensors that read several samples at once (e.g. a FIFO burst) register a
+ * ring instead of a queue. The driver is the only producer and pushes the
+ * whole burst before signalling the consumer once, the consumer is the only
+ * reader and drains everything that is pending. No locks are needed.
+ */
+struct pios_sensor_ring;
+
+//! Filter run in place on the first three values (x, y and z) of each sample
+typedef void (*pios_sensors_filter)(void *context, float values[3]);
+
 //! Initialize the PIOS_SENSORS interface
 int32_t PIOS_SENSORS_Init();
 
 //! Register a sensor with the PIOS_SENSORS interface
 int32_t PIOS_SENSORS_Register(enum pios_sensor_type type, xQueueHandle queue);
 
-//! Get the data queue for a sensor type
+//! Register a sensor that uses a ring with the PIOS_SENSORS interface
+int32_t PIOS_SENSORS_RegisterRing(enum pios_sensor_type type, struct pios_sensor_ring *ring);
+
+//! Check if a sensor of a type was registered
+bool PIOS_SENSORS_IsRegistered(enum pios_sensor_type type);
+
+//! Get the data queue for a sensor type, NULL for sensors that use a ring
 xQueueHandle PIOS_SENSORS_GetQueue(enum pios_sensor_type type);
 
+//! Set the rate in Hz at which a sensor produces samples, only if none are dropped before the consumer
+void PIOS_SENSORS_SetSampleRate(enum pios_sensor_type type, uint32_t sample_rate);
+
+//! Get the rate in Hz at which a sensor produces samples, 0 if unknown
+uint32_t PIOS_SENSORS_GetSampleRate(enum pios_sensor_type type);
+
+//! Get up to max_samples pending samples, waiting for the first
+int32_t PIOS_SENSORS_Receive(enum pios_sensor_type type, void *samples, uint16_t max_samples, portTickType timeout);
+
+//! Get the average of all the pending samples, waiting for the first
+int32_t PIOS_SENSORS_ReceiveAverage(enum pios_sensor_type type, void *sample, portTickType timeout);
+
+//! Get the average of all the pending samples after filtering each one, waiting for the first
+int32_t PIOS_SENSORS_ReceiveFiltered(enum pios_sensor_type type, void *sample,
+		pios_sensors_filter filter, void *context, portTickType timeout);
+
+//! Get the number of samples of a sensor dropped since the last call
+uint32_t PIOS_SENSORS_GetOverruns(enum pios_sensor_type type);
+
+//! Create a ring for a sensor that produces bursts of samples
+struct pios_sensor_ring *PIOS_SENSORS_RingCreate(enum pios_sensor_type type, uint16_t length);
+
+//! Add a sample to the ring, only called by the driver
+bool PIOS_SENSORS_RingPush(struct pios_sensor_ring *ring, const void *sample);
+
+//! Wake up the consumer after a burst was pushed from a task
+void PIOS_SENSORS_RingSignal(struct pios_sensor_ring *ring);
+
+//! Wake up the consumer after a burst was pushed from an interrupt
+bool PIOS_SENSORS_RingSignalFromISR(struct pios_sensor_ring *ring);
+
 #endif /* PIOS_SENSOR_H */
\ No newline at end of file
@@ -85,6 +85,12 @@ Preemption is done by the main scheduler thread which attempts to run a tick
 handler at accurate intervals using nanosleep and gettimeofday, which allows
 more accurate high frequency ticks than a timer signal handler.
 
+With configUSE_LOCKSTEP the supervisor does not sleep at all. The tick handler
+is called as soon as no task above the idle priority is ready to run, or a
+task busy waits past the next tick, and the simulated time is moved to that
+tick. The simulated time therefore runs as fast as the tasks allow and only
+depends on what the tasks do, not on the load of the host.
+
 All public functions in this port are protected by a safeguard mutex which
 assures priority access on all data objects
 
@@ -158,6 +164,12 @@ static volatile portBASE_TYPE xInterruptsEnabled = pdFALSE;
 static volatile portBASE_TYPE xSchedulerNesting = 0;
 static volatile portBASE_TYPE xPendYield = pdFALSE;
 static volatile portLONG lIndexOfLastAddedTask = 0;
+#if ( configUSE_LOCKSTEP == 1 )
+static volatile portBASE_TYPE xOnlyIdleReady = pdFALSE;
+static volatile portBASE_TYPE xTickWaiting = pdFALSE;
+static volatile unsigned long long ullSimulatedTimeUS = 0;
+static volatile unsigned long long ullNextTickTimeUS = portTICK_RATE_MICROSECONDS;
+#endif
 /*-----------------------------------------------------------*/
 
 /*
@@ -291,6 +303,20 @@ portBASE_TYPE xPortStartScheduler( void )
 	/* Start the first task. This gives up the RunningThreadMutex*/
 	vPortStartFirstTask();
 
+#if ( configUSE_LOCKSTEP == 1 )
+	/**
+	 * Lock step scheduling loop. Call the tick handler whenever all tasks
+	 * are blocked or the running task waits for the next tick. A tick
+	 * that could not be handled yet is simply retried.
+	 */
+	while ( pdTRUE != xSchedulerEnd )
+	{
+		if ( pdTRUE == xOnlyIdleReady || pdTRUE == xTickWaiting ) {
+			vPortSystemTickHandler();
+		}
+		sched_yield();
+	}
+#else
 	/**
 	 * Main scheduling loop. Call the tick handler every
 	 * portTICK_RATE_MICROSECONDS
@@ -333,6 +359,7 @@ portBASE_TYPE xPortStartScheduler( void )
 		if (sleepTimeUS <=0 || sleepTimeUS >= 3 * portTICK_RATE_MICROSECONDS) sleepTimeUS = portTICK_RATE_MICROSECONDS;
 
 	}
+#endif /* configUSE_LOCKSTEP */
 
 	PORT_PRINT( "Cleaning Up, Exiting.\n" );
 	/* Cleanup the mutexes */
@@ -643,6 +670,18 @@ void vPortSystemTickHandler()
 	 * vTaskIncrementTick()...
 	 */
 
+#if ( configUSE_LOCKSTEP == 1 )
+	/**
+	 * move the simulated time to this tick, unless a delay inside a
+	 * critical section already took it further
+	 */
+	if ( ullSimulatedTimeUS < ullNextTickTimeUS ) {
+		ullSimulatedTimeUS = ullNextTickTimeUS;
+	}
+	ullNextTickTimeUS += portTICK_RATE_MICROSECONDS;
+	xTickWaiting = pdFALSE;
+#endif
+
 	/**
 	 * call tick handler
 	 */
@@ -673,6 +712,63 @@ void vPortSystemTickHandler()
 }
 /*-----------------------------------------------------------*/
 
+#if ( configUSE_LOCKSTEP == 1 )
+/**
+ * called by the scheduler every time it selected the task to run next
+ */
+void vPortTaskSwitchedIn( portBASE_TYPE xIdle )
+{
+	xOnlyIdleReady = xIdle;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * current simulated time in lock step mode
+ */
+unsigned long long ullPortGetSimulatedTimeUS( void )
+{
+	return ullSimulatedTimeUS;
+}
+/*-----------------------------------------------------------*/
+
+/**
+ * busy wait in simulated time. The running task advances the simulated time
+ * up to the next tick and then waits there until the supervisor called the
+ * tick handler, so it is preempted at the same point on every run.
+ */
+void vPortSimulatedDelay( unsigned long ulMicroseconds )
+{
+	struct timespec wait;
+
+	/* threads outside of the scheduler, like the network drivers, do not take part */
+	if ( xSchedulerStarted == pdTRUE &&
+			prvGetThreadHandleByThread( pthread_self() ) != prvGetThreadHandle( xTaskGetCurrentTaskHandle() ) ) {
+		wait.tv_sec = ulMicroseconds / 1000000;
+		wait.tv_nsec = 1000 * ( ulMicroseconds % 1000000 );
+		nanosleep( &wait, NULL );
+		return;
+	}
+
+	while ( ulMicroseconds > 0 ) {
+		/* without ticks the time can only jump ahead */
+		if ( xSchedulerStarted != pdTRUE || xInterruptsEnabled != pdTRUE ||
+				ullSimulatedTimeUS + ulMicroseconds < ullNextTickTimeUS ) {
+			ullSimulatedTimeUS += ulMicroseconds;
+			return;
+		}
+
+		if ( ullSimulatedTimeUS < ullNextTickTimeUS ) {
+			ulMicroseconds -= ullNextTickTimeUS - ullSimulatedTimeUS;
+			ullSimulatedTimeUS = ullNextTickTimeUS;
+		}
+
+		xTickWaiting = pdTRUE;
+		while ( pdTRUE == xTickWaiting ) sched_yield();
+	}
+}
+/*-----------------------------------------------------------*/
+#endif /* configUSE_LOCKSTEP */
+
 /**
  * thread kill implementation
  */
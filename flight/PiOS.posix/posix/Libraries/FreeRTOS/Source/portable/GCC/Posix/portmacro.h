@@ -140,6 +140,15 @@ extern void vPortForciblyEndThread( void *pxTaskToDelete );
 extern void vPortAddTaskHandle( void *pxTaskHandle );
 #define traceTASK_CREATE( pxNewTCB )			vPortAddTaskHandle( pxNewTCB )
 
+#if ( configUSE_LOCKSTEP == 1 )
+/* Lock step mode, see port.c. The tick is due once nothing above the idle task is ready. */
+extern void vPortTaskSwitchedIn( portBASE_TYPE xIdle );
+#define traceTASK_SWITCHED_IN()					vPortTaskSwitchedIn( uxTopReadyPriority == tskIDLE_PRIORITY )
+
+extern unsigned long long ullPortGetSimulatedTimeUS( void );
+extern void vPortSimulatedDelay( unsigned long ulMicroseconds );
+#endif
+
 /* Posix Signal definitions that can be changed or read as appropriate. */
 #define SIG_SUSPEND					SIGUSR1
 
@@ -65,12 +65,16 @@ int32_t PIOS_DELAY_Init(void)
 */
 int32_t PIOS_DELAY_WaituS(uint32_t uS)
 {
+#if (configUSE_LOCKSTEP == 1)
+	vPortSimulatedDelay(uS);
+#else
 	static struct timespec wait,rest;
 	wait.tv_sec=0;
 	wait.tv_nsec=1000*uS;
 	while (nanosleep(&wait,&rest)!=0) {
 		wait=rest;
 	}
+#endif
 
 	/* No error */
 	return 0;
@@ -89,6 +93,9 @@ int32_t PIOS_DELAY_WaituS(uint32_t uS)
 */
 int32_t PIOS_DELAY_WaitmS(uint32_t mS)
 {
+#if (configUSE_LOCKSTEP == 1)
+	vPortSimulatedDelay(mS * 1000);
+#else
 	//for(int i = 0; i < mS; i++) {
 	//	PIOS_DELAY_WaituS(1000);
 	static struct timespec wait,rest;
@@ -98,6 +105,7 @@ int32_t PIOS_DELAY_WaitmS(uint32_t mS)
 		wait=rest;
 	}
 	//}
+#endif
 
 	/* No error */
 	return 0;
@@ -105,10 +113,14 @@ int32_t PIOS_DELAY_WaitmS(uint32_t mS)
 
 /**
  * @brief Query the Delay timer for the current uS 
+ * In lock step mode this is the simulated time of the FreeRTOS port.
  * @return A microsecond value
  */
 uint32_t PIOS_DELAY_GetuS()
 {
+#if (configUSE_LOCKSTEP == 1)
+	return (uint32_t) ullPortGetSimulatedTimeUS();
+#else
 	static struct timespec current;
 
 #ifdef __MACH__ // OS X does not have clock_gettime, use clock_get_time
@@ -123,6 +135,7 @@ uint32_t PIOS_DELAY_GetuS()
 	clock_gettime(CLOCK_REALTIME, &current);
 #endif	
 	return ((current.tv_sec * 1000000) + (current.tv_nsec / 1000));
+#endif
 }
 
 /**
@@ -31,16 +31,60 @@
 // TODO: Make this pios driver actually create the queue and set that to the 
 // lower driver (??)
 
+#include "pios.h"
 #include "pios_sensors.h"
+#include <stddef.h>
 
-//! The list of queue handles
-static xQueueHandle queues[PIOS_SENSOR_LAST];
+//! Single producer, single consumer ring of samples
+struct pios_sensor_ring {
+	uint8_t *samples;
+	uint16_t sample_size;
+	uint16_t length;           /* power of two */
+	volatile uint16_t head;    /* only written by the producer */
+	volatile uint16_t tail;    /* only written by the consumer */
+	volatile uint32_t overruns;
+	enum pios_sensor_type type;
+	xSemaphoreHandle data_available;
+};
+
+//! Where samples of a sensor come from
+struct pios_sensor_source {
+	xQueueHandle queue;
+	struct pios_sensor_ring *ring;
+	uint32_t sample_rate;      /* Hz, 0 if unknown */
+	uint32_t overruns_seen;    /* only used by the consumer */
+};
+
+//! The list of registered sensors
+static struct pios_sensor_source sources[PIOS_SENSOR_LAST];
+
+//! Size of the samples of each sensor type
+static const uint16_t sample_size[PIOS_SENSOR_LAST] = {
+	[PIOS_SENSOR_ACCEL] = sizeof(struct pios_sensor_accel_data),
+	[PIOS_SENSOR_GYRO]  = sizeof(struct pios_sensor_gyro_data),
+	[PIOS_SENSOR_MAG]   = sizeof(struct pios_sensor_mag_data),
+	[PIOS_SENSOR_BARO]  = sizeof(struct pios_sensor_baro_data),
+};
+
+//! Offset of the timestamp, all fields before it are floats
+static const uint16_t timestamp_offset[PIOS_SENSOR_LAST] = {
+	[PIOS_SENSOR_ACCEL] = offsetof(struct pios_sensor_accel_data, timestamp),
+	[PIOS_SENSOR_GYRO]  = offsetof(struct pios_sensor_gyro_data, timestamp),
+	[PIOS_SENSOR_MAG]   = offsetof(struct pios_sensor_mag_data, timestamp),
+	[PIOS_SENSOR_BARO]  = offsetof(struct pios_sensor_baro_data, timestamp),
+};
+
+#define MAX_SAMPLE_SIZE 32
 
 //! Initialize the sensors interface
 int32_t PIOS_SENSORS_Init()
 {
-	for (uint32_t i = 0; i < PIOS_SENSOR_LAST; i++)
-		queues[i] = NULL;
+	for (uint32_t i = 0; i < PIOS_SENSOR_LAST; i++) {
+		sources[i].queue = NULL;
+		sources[i].ring = NULL;
+		sources[i].sample_rate = 0;
+		sources[i].overruns_seen = 0;
+	}
 
 	return 0;
 }
@@ -48,19 +92,307 @@ int32_t PIOS_SENSORS_Init()
 //! Register a sensor with the PIOS_SENSORS interface
 int32_t PIOS_SENSORS_Register(enum pios_sensor_type type, xQueueHandle queue)
 {
-	if(queues[type] != NULL)
+	if (PIOS_SENSORS_IsRegistered(type))
 		return -1;
 
-	queues[type] = queue;
+	sources[type].queue = queue;
 
 	return 0;
 }
 
+//! Register a sensor that uses a ring with the PIOS_SENSORS interface
+int32_t PIOS_SENSORS_RegisterRing(enum pios_sensor_type type, struct pios_sensor_ring *ring)
+{
+	if (PIOS_SENSORS_IsRegistered(type) || ring == NULL || ring->type != type)
+		return -1;
+
+	sources[type].ring = ring;
+
+	return 0;
+}
+
+//! Check if a sensor of a type was registered
+bool PIOS_SENSORS_IsRegistered(enum pios_sensor_type type)
+{
+	if (type < 0 || type >= PIOS_SENSOR_LAST)
+		return false;
+
+	return sources[type].queue != NULL || sources[type].ring != NULL;
+}
+
 //! Get the data queue for a sensor type
 xQueueHandle PIOS_SENSORS_GetQueue(enum pios_sensor_type type)
 {
 	if (type < 0 || type >= PIOS_SENSOR_LAST)
 		return NULL;
 
-	return queues[type];
-}
\ No newline at end of file
+	return sources[type].queue;
+}
+
+//! Set the rate in Hz at which a sensor produces samples, only if none are dropped before the consumer
+void PIOS_SENSORS_SetSampleRate(enum pios_sensor_type type, uint32_t sample_rate)
+{
+	if (type < 0 || type >= PIOS_SENSOR_LAST)
+		return;
+
+	sources[type].sample_rate = sample_rate;
+}
+
+//! Get the rate in Hz at which a sensor produces samples, 0 if unknown
+uint32_t PIOS_SENSORS_GetSampleRate(enum pios_sensor_type type)
+{
+	if (type < 0 || type >= PIOS_SENSOR_LAST)
+		return 0;
+
+	return sources[type].sample_rate;
+}
+
+/**
+ * Get the number of samples of a sensor that were dropped since the last
+ * call because the consumer fell behind. Only called by the consumer.
+ * @param[in] type The sensor
+ * @return the number of samples dropped, always 0 for sensors without a ring
+ */
+uint32_t PIOS_SENSORS_GetOverruns(enum pios_sensor_type type)
+{
+	if (type < 0 || type >= PIOS_SENSOR_LAST || sources[type].ring == NULL)
+		return 0;
+
+	uint32_t overruns = sources[type].ring->overruns;
+	uint32_t dropped = overruns - sources[type].overruns_seen;
+	sources[type].overruns_seen = overruns;
+
+	return dropped;
+}
+
+/**
+ * Create a ring for a sensor that produces bursts of samples
+ * @param[in] type The type of the sensor, which sets the sample size
+ * @param[in] length Number of samples, must be a power of two
+ * @return the ring or NULL if it could not be allocated
+ */
+struct pios_sensor_ring *PIOS_SENSORS_RingCreate(enum pios_sensor_type type, uint16_t length)
+{
+	if (type < 0 || type >= PIOS_SENSOR_LAST)
+		return NULL;
+	if (length == 0 || (length & (length - 1)) != 0)
+		return NULL;
+
+	struct pios_sensor_ring *ring = (struct pios_sensor_ring *) pvPortMalloc(sizeof(*ring));
+	if (ring == NULL)
+		return NULL;
+
+	ring->samples = (uint8_t *) pvPortMalloc(length * sample_size[type]);
+	if (ring->samples == NULL) {
+		vPortFree(ring);
+		return NULL;
+	}
+
+	vSemaphoreCreateBinary(ring->data_available);
+	if (ring->data_available == NULL) {
+		vPortFree(ring->samples);
+		vPortFree(ring);
+		return NULL;
+	}
+	xSemaphoreTake(ring->data_available, 0);
+
+	ring->sample_size = sample_size[type];
+	ring->length = length;
+	ring->head = 0;
+	ring->tail = 0;
+	ring->overruns = 0;
+	ring->type = type;
+
+	return ring;
+}
+
+/**
+ * Add a sample to the ring. When the ring is full the sample is dropped,
+ * since only the consumer may move the tail.
+ * @param[in] ring The ring
+ * @param[in] sample The sample to copy in
+ * @return true if the sample was added
+ */
+bool PIOS_SENSORS_RingPush(struct pios_sensor_ring *ring, const void *sample)
+{
+	uint16_t head = ring->head;
+
+	if ((uint16_t) (head - ring->tail) >= ring->length) {
+		ring->overruns++;
+		return false;
+	}
+
+	memcpy(&ring->samples[(head & (ring->length - 1)) * ring->sample_size], sample, ring->sample_size);
+
+	// The sample must be written before the consumer can see it
+	__sync_synchronize();
+	ring->head = head + 1;
+
+	return true;
+}
+
+//! Wake up the consumer after a burst was pushed from a task
+void PIOS_SENSORS_RingSignal(struct pios_sensor_ring *ring)
+{
+	xSemaphoreGive(ring->data_available);
+}
+
+/**
+ * Wake up the consumer after a burst was pushed from an interrupt
+ * @return true if a higher priority task was woken
+ */
+bool PIOS_SENSORS_RingSignalFromISR(struct pios_sensor_ring *ring)
+{
+	portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
+	xSemaphoreGiveFromISR(ring->data_available, &xHigherPriorityTaskWoken);
+
+	return xHigherPriorityTaskWoken == pdTRUE;
+}
+
+//! Take the oldest sample out of the ring
+static bool PIOS_SENSORS_RingPop(struct pios_sensor_ring *ring, void *sample)
+{
+	uint16_t tail = ring->tail;
+
+	if (tail == ring->head)
+		return false;
+
+	// Read the sample only after seeing the head that covers it
+	__sync_synchronize();
+	memcpy(sample, &ring->samples[(tail & (ring->length - 1)) * ring->sample_size], ring->sample_size);
+
+	// and let the producer reuse the slot only after it was read
+	__sync_synchronize();
+	ring->tail = tail + 1;
+
+	return true;
+}
+
+/**
+ * Get the next sample of a sensor
+ * @param[in] source The sensor
+ * @param[out] sample Where to copy the sample
+ * @param[in] timeout How long to wait if no sample is pending
+ * @return true if a sample was copied
+ */
+static bool PIOS_SENSORS_Next(struct pios_sensor_source *source, void *sample, portTickType timeout)
+{
+	if (source->queue != NULL)
+		return xQueueReceive(source->queue, sample, timeout) == pdTRUE;
+
+	struct pios_sensor_ring *ring = source->ring;
+
+	if (PIOS_SENSORS_RingPop(ring, sample))
+		return true;
+	if (timeout == 0)
+		return false;
+
+	// The signal can be left over from a burst that was already
+	// drained, in which case wait once more
+	for (uint8_t i = 0; i < 2; i++) {
+		if (xSemaphoreTake(ring->data_available, timeout) != pdTRUE)
+			return false;
+		if (PIOS_SENSORS_RingPop(ring, sample))
+			return true;
+	}
+
+	return false;
+}
+
+/**
+ * Get the samples of a sensor that are pending, waiting for the first one.
+ * Works the same for sensors that use a queue and those that use a ring.
+ * @param[in] type The type of the sensor
+ * @param[out] samples Array of at least max_samples samples of the type
+ * @param[in] max_samples Most samples to copy
+ * @param[in] timeout How long to wait if no sample is pending
+ * @return the number of samples copied, or -1 if no sensor is registered
+ */
+int32_t PIOS_SENSORS_Receive(enum pios_sensor_type type, void *samples, uint16_t max_samples, portTickType timeout)
+{
+	if (!PIOS_SENSORS_IsRegistered(type))
+		return -1;
+
+	struct pios_sensor_source *source = &sources[type];
+	uint8_t *out = (uint8_t *) samples;
+	int32_t count = 0;
+
+	while (count < max_samples && PIOS_SENSORS_Next(source, out, count == 0 ? timeout : 0)) {
+		out += sample_size[type];
+		count++;
+	}
+
+	return count;
+}
+
+/**
+ * Get the average of all the samples of a sensor that are pending, waiting
+ * for the first one. The timestamp is the mean time of the samples. This is
+ * a box car filter over whatever arrived since the last call, which limits
+ * aliasing when the sensor runs faster than the consumer.
+ * @param[in] type The type of the sensor
+ * @param[out] sample The averaged sample
+ * @param[in] timeout How long to wait if no sample is pending
+ * @return the number of samples averaged, or -1 if no sensor is registered
+ */
+int32_t PIOS_SENSORS_ReceiveAverage(enum pios_sensor_type type, void *sample, portTickType timeout)
+{
+	return PIOS_SENSORS_ReceiveFiltered(type, sample, NULL, NULL, timeout);
+}
+
+/**
+ * Same as PIOS_SENSORS_ReceiveAverage() but each sample is passed through a
+ * filter before it is averaged, so the filter runs at the rate the sensor
+ * produced the samples instead of the rate of the consumer.
+ * @param[in] type The type of the sensor, whose first three values are filtered
+ * @param[out] sample The averaged sample
+ * @param[in] filter Called on each sample, or NULL to only average
+ * @param[in] context Passed to the filter
+ * @param[in] timeout How long to wait if no sample is pending
+ * @return the number of samples averaged, or -1 if no sensor is registered
+ */
+int32_t PIOS_SENSORS_ReceiveFiltered(enum pios_sensor_type type, void *sample,
+		pios_sensors_filter filter, void *context, portTickType timeout)
+{
+	if (!PIOS_SENSORS_IsRegistered(type))
+		return -1;
+
+	struct pios_sensor_source *source = &sources[type];
+	if (!PIOS_SENSORS_Next(source, sample, timeout))
+		return 0;
+
+	const uint16_t num_floats = timestamp_offset[type] / sizeof(float);
+	float *sum = (float *) sample;
+	uint32_t *first_time = (uint32_t *) ((uint8_t *) sample + timestamp_offset[type]);
+	int32_t time_sum = 0;
+	int32_t count = 1;
+
+	if (filter)
+		filter(context, sum);
+
+	union {
+		uint8_t bytes[MAX_SAMPLE_SIZE];
+		float values[MAX_SAMPLE_SIZE / sizeof(float)];
+	} next;
+
+	while (PIOS_SENSORS_Next(source, next.bytes, 0)) {
+		if (filter)
+			filter(context, next.values);
+		for (uint16_t i = 0; i < num_floats; i++)
+			sum[i] += next.values[i];
+
+		// Relative to the first sample so this works across the wrap
+		uint32_t time;
+		memcpy(&time, &next.bytes[timestamp_offset[type]], sizeof(time));
+		time_sum += (int32_t) (time - *first_time);
+		count++;
+	}
+
+	if (count > 1) {
+		for (uint16_t i = 0; i < num_floats; i++)
+			sum[i] /= count;
+		*first_time += time_sum / count;
+	}
+
+	return count;
+}
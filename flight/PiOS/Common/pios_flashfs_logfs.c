@@ -29,9 +29,47 @@
 #include "pios_flashfs_logfs_priv.h"
 
 #include <stdbool.h>
+#include <string.h>		/* memset */
 
 #define MIN(x,y) ((x) < (y) ? (x) : (y))
 
+/*
+ * Number of entries in the RAM directory of active slots, must be a power of 2.
+ * Boards can lower this to save RAM, when an arena holds more active slots than
+ * the directory can take, lookups fall back to scanning the arena.
+ */
+#ifndef PIOS_FLASHFS_LOGFS_DIR_SIZE
+#define PIOS_FLASHFS_LOGFS_DIR_SIZE 256
+#endif
+
+/* Garbage collection starts early once this fraction of the slots is free and as many are obsolete */
+#define LOGFS_GC_START_FRACTION 4
+/* Garbage collection work done by every call of PIOS_FLASHFS_GarbageCollect() */
+#define LOGFS_GC_BACKGROUND_STEPS 4
+
+/*
+ * Directory entry mapping an object instance to the slot that holds it.
+ * Only a hash of the object and instance id is kept, lookups confirm
+ * a match against the slot header in flash.
+ */
+struct logfs_dir_entry {
+	uint16_t hash;
+	uint16_t slot_id; /* 0 for an unused entry since slot 0 holds the arena header */
+	uint16_t gc_slot_id; /* copy made by a garbage collection in progress, 0 if none */
+};
+
+/*
+ * State of an incremental garbage collection, see logfs_gc_step()
+ */
+struct logfs_gc_state {
+	bool active;
+	uint8_t dst_arena_id;
+	uint16_t erase_sector_id; /* next sector of the destination arena to erase */
+	uint16_t src_slot_id;     /* next slot of the active arena to copy */
+	uint16_t dst_slot_id;     /* next free slot of the destination arena */
+	uint32_t erase_count;     /* erase count of the destination arena once erased */
+};
+
 /*
  * Filesystem state data tracked in RAM
  */
@@ -48,6 +86,13 @@ struct logfs_state {
 	uint16_t num_free_slots;   /* slots in free state */
 	uint16_t num_active_slots; /* slots in active state */
 
+	/* Open addressed (linear probing) directory of the active slots */
+	struct logfs_dir_entry dir[PIOS_FLASHFS_LOGFS_DIR_SIZE];
+	uint16_t dir_count;
+	bool dir_valid; /* false when the arena has to be scanned instead */
+
+	struct logfs_gc_state gc;
+
 	/* Underlying flash driver glue */
 	const struct pios_flash_driver * driver;
 	uintptr_t flash_id;
@@ -97,6 +142,7 @@ enum arena_state {
 struct arena_header {
 	uint32_t magic;
 	enum arena_state state;
+	uint32_t erase_count; /* left erased (0xFFFFFFFF) by older versions that did not count */
 } __attribute__((packed));
 
 
@@ -105,34 +151,93 @@ struct arena_header {
  ****************************************/
 
 /**
- * @brief Erases all sectors within the given arena and sets arena to erased state.
+ * @brief Return how many times the given arena was erased
+ * @return erase count or 0 if the arena header does not hold one
+ * @note Must be called while holding the flash transaction lock
+ */
+static uint32_t logfs_get_erase_count(uint8_t arena_id)
+{
+	uintptr_t arena_addr = logfs_get_addr (arena_id, 0);
+
+	struct arena_header arena_hdr;
+	if (logfs.driver->read_data(logfs.flash_id,
+					arena_addr,
+					(uint8_t *)&arena_hdr,
+					sizeof(arena_hdr)) != 0) {
+		return 0;
+	}
+	if ((arena_hdr.magic != logfs.cfg->fs_magic) ||
+		(arena_hdr.erase_count == 0xFFFFFFFF)) {
+		return 0;
+	}
+
+	return arena_hdr.erase_count;
+}
+
+/**
+ * @brief Erases one sector of the given arena
  * @return 0 if success, < 0 on failure
  * @note Must be called while holding the flash transaction lock
  */
-static int32_t logfs_erase_arena(uint8_t arena_id)
+static int32_t logfs_erase_arena_sector(uint8_t arena_id, uint16_t sector_id)
 {
 	uintptr_t arena_addr = logfs_get_addr (arena_id, 0);
 
-	/* Erase all of the sectors in the arena */
-	for (uint8_t sector_id = 0;
-	     sector_id < (logfs.cfg->arena_size / logfs.cfg->sector_size);
-	     sector_id++) {
-		if (logfs.driver->erase_sector(logfs.flash_id,
-						arena_addr + (sector_id * logfs.cfg->sector_size))) {
-			return -1;
-		}
+	if (logfs.driver->erase_sector(logfs.flash_id,
+					arena_addr + (sector_id * logfs.cfg->sector_size))) {
+		return -1;
 	}
 
+	return 0;
+}
+
+/**
+ * @brief Sets a fully erased arena to erased state.
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_mark_arena_erased(uint8_t arena_id, uint32_t erase_count)
+{
+	uintptr_t arena_addr = logfs_get_addr (arena_id, 0);
+
 	/* Mark this arena as fully erased */
 	struct arena_header arena_hdr = {
-		.magic = logfs.cfg->fs_magic,
-		.state = ARENA_STATE_ERASED,
+		.magic       = logfs.cfg->fs_magic,
+		.state       = ARENA_STATE_ERASED,
+		.erase_count = erase_count,
 	};
 
 	if (logfs.driver->write_data(logfs.flash_id,
 					arena_addr,
 					(uint8_t *)&arena_hdr,
 					sizeof(arena_hdr)) != 0) {
+		return -1;
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Erases all sectors within the given arena and sets arena to erased state.
+ * @return 0 if success, < 0 on failure
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_erase_arena(uint8_t arena_id)
+{
+	/* The erase count is kept in the header, which is about to be erased */
+	uint32_t erase_count = logfs_get_erase_count(arena_id) + 1;
+
+	/* Erase all of the sectors in the arena */
+	for (uint8_t sector_id = 0;
+	     sector_id < (logfs.cfg->arena_size / logfs.cfg->sector_size);
+	     sector_id++) {
+		if (logfs_erase_arena_sector(arena_id, sector_id) != 0) {
+			return -1;
+		}
+	}
+
+	/* Mark this arena as fully erased */
+	if (logfs_mark_arena_erased(arena_id, erase_count) != 0) {
 		return -2;
 	}
 
@@ -398,6 +503,145 @@ static bool logfs_log_is_full(void)
 	return (logfs.num_free_slots == 0);
 }
 
+/*
+ * RAM directory of the active slots
+ *
+ * The directory is rebuilt while mounting the arena, which already reads
+ * every slot header, so finding an object later does not need to scan the
+ * arena again. Garbage collection remounts the destination arena and thus
+ * rebuilds the directory as well.
+ */
+
+static uint16_t logfs_dir_hash(uint32_t obj_id, uint16_t obj_inst_id)
+{
+	/* Object ids are hashes already, fold in the instance id */
+	uint32_t h = obj_id ^ (obj_inst_id * 0x9E3779B1);
+	return (uint16_t)(h ^ (h >> 16));
+}
+
+static void logfs_dir_clear(void)
+{
+	memset(logfs.dir, 0, sizeof(logfs.dir));
+	logfs.dir_count = 0;
+	logfs.dir_valid = true;
+}
+
+/**
+ * @brief Add an active slot to the directory
+ * @note Invalidates the directory when it is full or when the object already has an
+ *       active slot, which only happens with a log that was written by a damaged filesystem
+ */
+static void logfs_dir_insert(uint32_t obj_id, uint16_t obj_inst_id, uint16_t slot_id)
+{
+	if (!logfs.dir_valid)
+		return;
+
+	/* Always keep an unused entry so that probing for a missing object terminates */
+	if (logfs.dir_count >= PIOS_FLASHFS_LOGFS_DIR_SIZE - 1) {
+		logfs.dir_valid = false;
+		return;
+	}
+
+	uint16_t hash = logfs_dir_hash(obj_id, obj_inst_id);
+	uint16_t i = hash & (PIOS_FLASHFS_LOGFS_DIR_SIZE - 1);
+	while (logfs.dir[i].slot_id != 0) {
+		if (logfs.dir[i].hash == hash) {
+			/* Possibly the same object, check the slot to find out */
+			struct slot_header slot_hdr;
+			if (logfs.driver->read_data(logfs.flash_id,
+							logfs_get_addr(logfs.active_arena_id, logfs.dir[i].slot_id),
+							(uint8_t *)&slot_hdr,
+							sizeof(slot_hdr)) != 0 ||
+				(slot_hdr.obj_id == obj_id && slot_hdr.obj_inst_id == obj_inst_id)) {
+				logfs.dir_valid = false;
+				return;
+			}
+		}
+		i = (i + 1) & (PIOS_FLASHFS_LOGFS_DIR_SIZE - 1);
+	}
+
+	logfs.dir[i].hash       = hash;
+	logfs.dir[i].slot_id    = slot_id;
+	logfs.dir[i].gc_slot_id = 0;
+	logfs.dir_count++;
+}
+
+/**
+ * @brief Find the active slot of an object in the directory
+ * @param[out] slot_hdr The header of the slot that was found
+ * @param[out] dir_index The directory entry of the slot
+ * @return slot id of the object or 0 if it is not in the directory
+ * @return -1 if reading a slot header failed
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_dir_find(struct slot_header * slot_hdr, uint16_t * dir_index, uint32_t obj_id, uint16_t obj_inst_id)
+{
+	uint16_t hash = logfs_dir_hash(obj_id, obj_inst_id);
+	uint16_t i = hash & (PIOS_FLASHFS_LOGFS_DIR_SIZE - 1);
+	while (logfs.dir[i].slot_id != 0) {
+		if (logfs.dir[i].hash == hash) {
+			if (logfs.driver->read_data(logfs.flash_id,
+							logfs_get_addr(logfs.active_arena_id, logfs.dir[i].slot_id),
+							(uint8_t *)slot_hdr,
+							sizeof(*slot_hdr)) != 0) {
+				return -1;
+			}
+			if (slot_hdr->obj_id == obj_id && slot_hdr->obj_inst_id == obj_inst_id) {
+				*dir_index = i;
+				return logfs.dir[i].slot_id;
+			}
+		}
+		i = (i + 1) & (PIOS_FLASHFS_LOGFS_DIR_SIZE - 1);
+	}
+
+	return 0;
+}
+
+/**
+ * @brief Remove an entry from the directory
+ * @note Moves back the entries that follow so no tombstones are needed
+ */
+static void logfs_dir_remove(uint16_t dir_index)
+{
+	const uint16_t mask = PIOS_FLASHFS_LOGFS_DIR_SIZE - 1;
+	uint16_t hole = dir_index;
+	uint16_t i = (hole + 1) & mask;
+
+	while (logfs.dir[i].slot_id != 0) {
+		/* Entries can fill the hole unless their home position lies after it */
+		uint16_t home = logfs.dir[i].hash & mask;
+		if (((i - home) & mask) >= ((i - hole) & mask)) {
+			logfs.dir[hole] = logfs.dir[i];
+			hole = i;
+		}
+		i = (i + 1) & mask;
+	}
+
+	logfs.dir[hole].hash       = 0;
+	logfs.dir[hole].slot_id    = 0;
+	logfs.dir[hole].gc_slot_id = 0;
+	logfs.dir_count--;
+}
+
+/**
+ * @brief Record where garbage collection copied an active slot
+ */
+static void logfs_dir_set_gc_slot(uint32_t obj_id, uint16_t obj_inst_id, uint16_t slot_id, uint16_t gc_slot_id)
+{
+	if (!logfs.dir_valid)
+		return;
+
+	/* The slot id identifies the entry, no need to check the slot header */
+	uint16_t i = logfs_dir_hash(obj_id, obj_inst_id) & (PIOS_FLASHFS_LOGFS_DIR_SIZE - 1);
+	while (logfs.dir[i].slot_id != 0) {
+		if (logfs.dir[i].slot_id == slot_id) {
+			logfs.dir[i].gc_slot_id = gc_slot_id;
+			return;
+		}
+		i = (i + 1) & (PIOS_FLASHFS_LOGFS_DIR_SIZE - 1);
+	}
+}
+
 static int32_t logfs_unmount_log(void)
 {
 	PIOS_Assert (logfs.mounted);
@@ -405,6 +649,8 @@ static int32_t logfs_unmount_log(void)
 	logfs.num_active_slots = 0;
 	logfs.num_free_slots   = 0;
 	logfs.mounted          = false;
+	logfs.gc.active        = false;
+	logfs_dir_clear();
 
 	return 0;
 }
@@ -416,6 +662,7 @@ static int32_t logfs_mount_log(uint8_t arena_id)
 	logfs.num_active_slots = 0;
 	logfs.num_free_slots   = 0;
 	logfs.active_arena_id  = arena_id;
+	logfs_dir_clear();
 
 	/* Scan the log to find out how full it is */
 	for (uint16_t slot_id = 1;
@@ -443,6 +690,8 @@ static int32_t logfs_mount_log(uint8_t arena_id)
 			break;
 		case SLOT_STATE_ACTIVE:
 			logfs.num_active_slots++;
+			/* Build the directory in the same pass */
+			logfs_dir_insert(slot_hdr.obj_id, slot_hdr.obj_inst_id, slot_id);
 			break;
 		case SLOT_STATE_RESERVED:
 		case SLOT_STATE_OBSOLETE:
@@ -482,6 +731,7 @@ int32_t PIOS_FLASHFS_Logfs_Init(uintptr_t * fs_id, const struct flashfs_logfs_cf
 	logfs.driver   = driver; /* lower-level flash driver */
 	logfs.flash_id = flash_id; /* lower-level flash device id */
 	logfs.mounted  = false;
+	logfs.gc.active = false;
 
 	int8_t rc;
 
@@ -533,76 +783,196 @@ out_exit:
 	return rc;
 }
 
-/* NOTE: Must be called while holding the flash transaction lock */
-static int32_t logfs_garbage_collect (void) {
-	PIOS_Assert (logfs.mounted);
+/*
+ * Garbage collection
+ *
+ * Garbage collection copies the active slots of the active arena into another
+ * arena, which then replaces the active one. The work is split in steps which
+ * either erase one sector or copy one slot, so that it can be spread over
+ * several saves and over the idle time between them. The destination arena is
+ * only reserved until the copy is complete, if power is lost before that the
+ * active arena is still mounted on the next boot and the copy starts over.
+ */
 
-	/* Source arena is the active arena */
-	uint8_t src_arena_id = logfs.active_arena_id;
+/**
+ * @brief Should garbage collection start before the log is full
+ * @return true when enough slots are obsolete for the collection to be worth an erase
+ */
+static bool logfs_gc_wanted(void)
+{
+	uint16_t num_slots = logfs.cfg->arena_size / logfs.cfg->slot_size;
+	uint16_t num_obsolete_slots = num_slots - 1 - logfs.num_free_slots - logfs.num_active_slots;
 
-	/* Compute destination arena */
-	uint8_t dst_arena_id = (logfs.active_arena_id + 1) % (logfs.cfg->total_fs_size / logfs.cfg->arena_size);
+	return (logfs.num_free_slots <= num_slots / LOGFS_GC_START_FRACTION) &&
+		(num_obsolete_slots >= num_slots / LOGFS_GC_START_FRACTION);
+}
 
-	/* Erase destination arena */
-	if (logfs_erase_arena (dst_arena_id) != 0) {
-		return -1;
+/**
+ * @brief Start a garbage collection into the arena that was erased the least
+ * @note Must be called while holding the flash transaction lock
+ */
+static void logfs_gc_start(void)
+{
+	PIOS_Assert (logfs.mounted);
+	PIOS_Assert (!logfs.gc.active);
+
+	uint8_t num_arenas = logfs.cfg->total_fs_size / logfs.cfg->arena_size;
+
+	/* On ties the arena following the active one wins, so wear rotates through all of them */
+	uint8_t dst_arena_id = 0;
+	uint32_t min_erase_count = 0xFFFFFFFF;
+	for (uint8_t i = 1; i < num_arenas; i++) {
+		uint8_t arena_id = (logfs.active_arena_id + i) % num_arenas;
+		uint32_t erase_count = logfs_get_erase_count(arena_id);
+		if (erase_count < min_erase_count) {
+			min_erase_count = erase_count;
+			dst_arena_id    = arena_id;
+		}
 	}
 
-	/* Reserve the destination arena so we can start filling it */
-	if (logfs_reserve_arena (dst_arena_id) != 0) {
-		/* Unable to reserve the arena */
-		return -2;
+	logfs.gc.active          = true;
+	logfs.gc.dst_arena_id    = dst_arena_id;
+	logfs.gc.erase_count     = min_erase_count + 1;
+	logfs.gc.erase_sector_id = 0;
+	logfs.gc.src_slot_id     = 1;
+	logfs.gc.dst_slot_id     = 1;
+}
+
+/**
+ * @brief Number of steps left in the garbage collection in progress, including the final one
+ */
+static uint16_t logfs_gc_remaining(void)
+{
+	uint16_t num_sectors = logfs.cfg->arena_size / logfs.cfg->sector_size;
+	uint16_t src_end = (logfs.cfg->arena_size / logfs.cfg->slot_size) - logfs.num_free_slots;
+
+	return (num_sectors - logfs.gc.erase_sector_id) + (src_end - logfs.gc.src_slot_id) + 1;
+}
+
+/**
+ * @brief Number of steps a save has to do so that the garbage collection in
+ *        progress completes before the log is full
+ * @note Every save adds a slot to copy and takes a free slot, so the steps
+ *       beyond that one must finish the remaining work with the free slots left
+ */
+static uint16_t logfs_gc_steps_needed(void)
+{
+	uint16_t remaining = logfs_gc_remaining();
+
+	if (logfs.num_free_slots == 0) {
+		return remaining;
 	}
 
-	/* Copy active slots from active arena to destination arena */
-	uint16_t dst_slot_id = 1;
-	for (uint16_t src_slot_id = 1;
-	     src_slot_id < (logfs.cfg->arena_size / logfs.cfg->slot_size);
-	     src_slot_id++) {
-		struct slot_header slot_hdr;
-		uintptr_t src_addr = logfs_get_addr (src_arena_id, src_slot_id);
-		if (logfs.driver->read_data(logfs.flash_id,
-						src_addr,
-						(uint8_t *)&slot_hdr,
-						sizeof (slot_hdr)) != 0) {
-			return -3;
+	return (remaining + logfs.num_free_slots - 1) / logfs.num_free_slots + 1;
+}
+
+/**
+ * @brief Do up to max_steps steps of the garbage collection in progress
+ * @return 0 if success, < 0 on failure
+ * @note The last step activates the destination arena and mounts it
+ * @note Must be called while holding the flash transaction lock
+ */
+static int32_t logfs_gc_step(uint16_t max_steps)
+{
+	PIOS_Assert (logfs.mounted);
+	PIOS_Assert (logfs.gc.active);
+
+	uint8_t src_arena_id = logfs.active_arena_id;
+	uint8_t dst_arena_id = logfs.gc.dst_arena_id;
+	uint16_t num_sectors = logfs.cfg->arena_size / logfs.cfg->sector_size;
+
+	for (; max_steps > 0; max_steps--) {
+		/* Erase destination arena */
+		if (logfs.gc.erase_sector_id < num_sectors) {
+			if (logfs_erase_arena_sector (dst_arena_id, logfs.gc.erase_sector_id) != 0) {
+				logfs.gc.active = false;
+				return -1;
+			}
+			logfs.gc.erase_sector_id++;
+
+			if (logfs.gc.erase_sector_id == num_sectors) {
+				/* Reserve the destination arena so we can start filling it */
+				if ((logfs_mark_arena_erased (dst_arena_id, logfs.gc.erase_count) != 0) ||
+					(logfs_reserve_arena (dst_arena_id) != 0)) {
+					/* Unable to reserve the arena */
+					logfs.gc.active = false;
+					return -2;
+				}
+			}
+			continue;
 		}
 
-		if (slot_hdr.state == SLOT_STATE_ACTIVE) {
-			uintptr_t dst_addr = logfs_get_addr (dst_arena_id, dst_slot_id);
-			if (logfs_raw_copy_bytes(src_addr,
-							sizeof(slot_hdr) + slot_hdr.obj_size,
-							dst_addr) != 0) {
-				/* Failed to copy all bytes */
-				return -4;
+		/* Copy active slots from active arena to destination arena, up to the current end of the log */
+		uint16_t src_end = (logfs.cfg->arena_size / logfs.cfg->slot_size) - logfs.num_free_slots;
+		if (logfs.gc.src_slot_id < src_end) {
+			struct slot_header slot_hdr;
+			uintptr_t src_addr = logfs_get_addr (src_arena_id, logfs.gc.src_slot_id);
+			if (logfs.driver->read_data(logfs.flash_id,
+							src_addr,
+							(uint8_t *)&slot_hdr,
+							sizeof (slot_hdr)) != 0) {
+				logfs.gc.active = false;
+				return -3;
+			}
+
+			if (slot_hdr.state == SLOT_STATE_ACTIVE) {
+				uintptr_t dst_addr = logfs_get_addr (dst_arena_id, logfs.gc.dst_slot_id);
+				if (logfs_raw_copy_bytes(src_addr,
+								sizeof(slot_hdr) + slot_hdr.obj_size,
+								dst_addr) != 0) {
+					/* Failed to copy all bytes */
+					logfs.gc.active = false;
+					return -4;
+				}
+
+				/* Remember the copy in case the object is replaced before we are done */
+				logfs_dir_set_gc_slot(slot_hdr.obj_id, slot_hdr.obj_inst_id,
+						logfs.gc.src_slot_id, logfs.gc.dst_slot_id);
+				logfs.gc.dst_slot_id++;
 			}
-			dst_slot_id++;
+			logfs.gc.src_slot_id++;
+			continue;
 		}
-	}
 
-	/* Activate the destination arena */
-	if (logfs_activate_arena (dst_arena_id) != 0) {
-		return -5;
-	}
+		/* Everything has been copied */
+		logfs.gc.active = false;
 
-	/* Unmount the source arena */
-	if (logfs_unmount_log () != 0) {
-		return -6;
-	}
+		/* Activate the destination arena */
+		if (logfs_activate_arena (dst_arena_id) != 0) {
+			return -5;
+		}
 
-	/* Obsolete the source arena */
-	if (logfs_obsolete_arena (src_arena_id) != 0) {
-		return -7;
-	}
+		/* Unmount the source arena */
+		if (logfs_unmount_log () != 0) {
+			return -6;
+		}
+
+		/* Obsolete the source arena */
+		if (logfs_obsolete_arena (src_arena_id) != 0) {
+			return -7;
+		}
 
-	/* Mount the new arena */
-	if (logfs_mount_log (dst_arena_id) != 0) {
-		return -8;
+		/* Mount the new arena */
+		if (logfs_mount_log (dst_arena_id) != 0) {
+			return -8;
+		}
+
+		break;
 	}
 
 	return 0;
 }
 
+/* NOTE: Must be called while holding the flash transaction lock */
+static int32_t logfs_garbage_collect (void) {
+	/* Finish the garbage collection in progress or do a whole new one */
+	if (!logfs.gc.active) {
+		logfs_gc_start();
+	}
+
+	return logfs_gc_step(logfs_gc_remaining());
+}
+
 /* NOTE: Must be called while holding the flash transaction lock */
 static int16_t logfs_object_find_next (struct slot_header * slot_hdr, uint16_t * curr_slot, uint32_t obj_id, uint16_t obj_inst_id)
 {
@@ -641,11 +1011,50 @@ static int16_t logfs_object_find_next (struct slot_header * slot_hdr, uint16_t *
 }
 
 /* NOTE: Must be called while holding the flash transaction lock */
-/* OPTIMIZE: could trust that there is at most one active version of every object and terminate the search when we find one */
+/* The arena is only scanned when the directory is not usable, in that case every active version of the object is obsoleted */
 static int8_t logfs_delete_object (uint32_t obj_id, uint16_t obj_inst_id)
 {
 	int8_t rc;
 
+	if (logfs.dir_valid) {
+		/* The directory holds the only active version of the object */
+		struct slot_header slot_hdr;
+		uint16_t dir_index;
+		int32_t slot_id = logfs_dir_find(&slot_hdr, &dir_index, obj_id, obj_inst_id);
+		if (slot_id < 0) {
+			return -1;
+		}
+		if (slot_id == 0) {
+			/* Object not found */
+			return 0;
+		}
+
+		slot_hdr.state = SLOT_STATE_OBSOLETE;
+		if (logfs.driver->write_data(logfs.flash_id,
+						logfs_get_addr(logfs.active_arena_id, slot_id),
+						(uint8_t *)&slot_hdr,
+						sizeof(slot_hdr)) != 0) {
+			return -2;
+		}
+		logfs.num_active_slots--;
+
+		if (logfs.gc.active && logfs.dir[dir_index].gc_slot_id != 0) {
+			/* Garbage collection already copied this version, it must not come back */
+			if (logfs.driver->write_data(logfs.flash_id,
+							logfs_get_addr(logfs.gc.dst_arena_id, logfs.dir[dir_index].gc_slot_id),
+							(uint8_t *)&slot_hdr,
+							sizeof(slot_hdr)) != 0) {
+				return -2;
+			}
+		}
+
+		logfs_dir_remove(dir_index);
+		return 0;
+	}
+
+	/* Copies made by garbage collection can't be found without the directory, start it over later */
+	logfs.gc.active = false;
+
 	bool more = true;
 	uint16_t curr_slot_id = 0;
 	do {
@@ -784,6 +1193,7 @@ static int8_t logfs_append_to_log (uint32_t obj_id, uint16_t obj_inst_id, uint8_
 
 	/* Object has been successfully written to the slot */
 	logfs.num_active_slots++;
+	logfs_dir_insert(obj_id, obj_inst_id, free_slot_id);
 	return 0;
 }
 
@@ -839,25 +1249,32 @@ int32_t PIOS_FLASHFS_ObjSave(uint32_t fs_id, uint32_t obj_id, uint16_t obj_inst_
 	}
 
 	/* Is garbage collection required? */
-	if (logfs_log_is_full()) {
-		/* Note: Log Full means the log is full but may contain obsolete slots so gc may free some space */
-		if (logfs_garbage_collect() != 0) {
+	if (logfs.gc.active) {
+		/* Keep the garbage collection in progress ahead of the log filling up */
+		if (logfs_gc_step(logfs_gc_steps_needed()) != 0) {
 			rc = -4;
 			goto out_end_trans;
 		}
-		/* Check one more time just to be sure we actually free'd some space */
-		if (logfs_log_is_full()) {
-			/*
-			 * Log is still full even after gc!
-			 * NOTE: This should not happen since the filesystem wasn't full
-			 *       when we checked above so gc should have helped.
-			 */
-			PIOS_DEBUG_Assert(0);
-			rc = -5;
+	} else if (logfs_log_is_full()) {
+		/* Note: Log Full means the log is full but may contain obsolete slots so gc may free some space */
+		if (logfs_garbage_collect() != 0) {
+			rc = -4;
 			goto out_end_trans;
 		}
 	}
 
+	/* Check one more time just to be sure we actually free'd some space */
+	if (logfs_log_is_full()) {
+		/*
+		 * Log is still full even after gc!
+		 * NOTE: This should not happen since the filesystem wasn't full
+		 *       when we checked above so gc should have helped.
+		 */
+		PIOS_DEBUG_Assert(0);
+		rc = -5;
+		goto out_end_trans;
+	}
+
 	/* We have room for our new object.  Append it to the log. */
 	if (logfs_append_to_log(obj_id, obj_inst_id, obj_data, obj_size) != 0) {
 		/* Error during append */
@@ -865,6 +1282,11 @@ int32_t PIOS_FLASHFS_ObjSave(uint32_t fs_id, uint32_t obj_id, uint16_t obj_inst_
 		goto out_end_trans;
 	}
 
+	/* Start collecting garbage before the log is full, this only does the bookkeeping */
+	if (!logfs.gc.active && logfs_gc_wanted()) {
+		logfs_gc_start();
+	}
+
 	/* Object successfully written to the log */
 	rc = 0;
 
@@ -902,7 +1324,16 @@ int32_t PIOS_FLASHFS_ObjLoad(uint32_t fs_id, uint32_t obj_id, uint16_t obj_inst_
 	/* Find the object in the log */
 	uint16_t slot_id = 0;
 	struct slot_header slot_hdr;
-	if (logfs_object_find_next (&slot_hdr, &slot_id, obj_id, obj_inst_id) != 0) {
+	if (logfs.dir_valid) {
+		uint16_t dir_index;
+		int32_t found = logfs_dir_find(&slot_hdr, &dir_index, obj_id, obj_inst_id);
+		if (found <= 0) {
+			/* Object does not exist in fs */
+			rc = -2;
+			goto out_end_trans;
+		}
+		slot_id = found;
+	} else if (logfs_object_find_next (&slot_hdr, &slot_id, obj_id, obj_inst_id) != 0) {
 		/* Object does not exist in fs */
 		rc = -2;
 		goto out_end_trans;
@@ -971,6 +1402,49 @@ out_exit:
 	return rc;
 }
 
+/**
+ * @brief Do a few steps of garbage collection in the background
+ * @param[in] fs_id The filesystem to use for this action
+ * @return 0 if success or error code
+ * @retval -1 if the log is not mounted or failed to start transaction
+ * @retval -2 if garbage collection failed
+ * @note Meant to be called periodically from a low priority task, so that
+ *       saving objects rarely has to do any garbage collection itself
+ */
+int32_t PIOS_FLASHFS_GarbageCollect(uint32_t fs_id)
+{
+	int8_t rc;
+
+	/* Nothing to collect until the log is mounted */
+	if (!logfs.mounted) {
+		rc = -1;
+		goto out_exit;
+	}
+
+	if (logfs.driver->start_transaction(logfs.flash_id) != 0) {
+		rc = -1;
+		goto out_exit;
+	}
+
+	if (!logfs.gc.active && logfs_gc_wanted()) {
+		logfs_gc_start();
+	}
+
+	if (logfs.gc.active && logfs_gc_step(LOGFS_GC_BACKGROUND_STEPS) != 0) {
+		rc = -2;
+		goto out_end_trans;
+	}
+
+	/* Garbage collection is done or progressed */
+	rc = 0;
+
+out_end_trans:
+	logfs.driver->end_transaction(logfs.flash_id);
+
+out_exit:
+	return rc;
+}
+
 /**
  * @brief Erases all filesystem arenas and activate the first arena
  * @param[in] fs_id The filesystem to use for this action
@@ -52,6 +52,7 @@ struct hmc5883_dev {
 	xQueueHandle queue;
 	xTaskHandle task;
 	xSemaphoreHandle data_ready_sema;
+	volatile uint32_t interrupt_time;
 	enum pios_hmc5883_dev_magic magic;
 };
 
@@ -476,6 +477,9 @@ bool PIOS_HMC5883_IRQHandler(void)
 	if(PIOS_HMC5883_Validate(dev) != 0)
 		return false;
 
+	// The data ready interrupt is raised when the sample is taken
+	dev->interrupt_time = PIOS_DELAY_GetuS();
+
 	portBASE_TYPE xHigherPriorityTaskWoken;
 	xSemaphoreGiveFromISR(dev->data_ready_sema, &xHigherPriorityTaskWoken);
 
@@ -499,8 +503,10 @@ static void PIOS_HMC5883_Task(void *parameters)
 		}
 
 		struct pios_sensor_mag_data mag_data;
-		if (PIOS_HMC5883_ReadMag(&mag_data) == 0)
+		if (PIOS_HMC5883_ReadMag(&mag_data) == 0) {
+			mag_data.timestamp = dev->interrupt_time;
 			xQueueSend(dev->queue, (void *) &mag_data, 0);
+		}
 	}
 }
 
@@ -41,13 +41,14 @@ enum pios_l3gd20_dev_magic {
 	PIOS_L3GD20_DEV_MAGIC = 0x9d39bced,
 };
 
-#define PIOS_L3GD20_MAX_DOWNSAMPLE 1
+//! Samples buffered for the consumer, must be a power of two
+#define PIOS_L3GD20_RING_LENGTH 16
 
 //! Local types
 struct l3gd20_dev {
 	uint32_t spi_id;
 	uint32_t slave_num;
-	xQueueHandle queue;
+	struct pios_sensor_ring *ring;
 	const struct pios_l3gd20_cfg * cfg;
 	enum pios_l3gd20_filter bandwidth;
 	enum pios_l3gd20_range range;
@@ -95,8 +96,8 @@ static struct l3gd20_dev * PIOS_L3GD20_alloc(void)
 
 	l3gd20_dev->magic = PIOS_L3GD20_DEV_MAGIC;
 
-	l3gd20_dev->queue = xQueueCreate(PIOS_L3GD20_MAX_DOWNSAMPLE, sizeof(struct pios_sensor_gyro_data));
-	if(l3gd20_dev->queue == NULL) {
+	l3gd20_dev->ring = PIOS_SENSORS_RingCreate(PIOS_SENSOR_GYRO, PIOS_L3GD20_RING_LENGTH);
+	if(l3gd20_dev->ring == NULL) {
 		vPortFree(l3gd20_dev);
 		return NULL;
 	}
@@ -144,7 +145,10 @@ int32_t PIOS_L3GD20_Init(uint32_t spi_id, uint32_t slave_num, const struct pios_
 	struct pios_l3gd20_data data;
 	PIOS_L3GD20_ReadGyros(&data);
 
-	PIOS_SENSORS_Register(PIOS_SENSOR_GYRO, dev->queue);
+	// The ring keeps every sample for the consumer, so the output data
+	// rate of PIOS_L3GD20_CTRL1_FASTEST is also the rate it sees
+	PIOS_SENSORS_RegisterRing(PIOS_SENSOR_GYRO, dev->ring);
+	PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_GYRO, 760);
 
 	return 0;
 }
@@ -394,6 +398,9 @@ uint8_t PIOS_L3GD20_Test(void)
 */
 bool PIOS_L3GD20_IRQHandler(void)
 {
+	// The data ready interrupt is raised when the sample is taken
+	uint32_t timestamp = PIOS_DELAY_GetuS();
+
 	l3gd20_irq++;
 
 	struct pios_l3gd20_data data;
@@ -422,11 +429,12 @@ bool PIOS_L3GD20_IRQHandler(void)
 	normalized_data.x = data.gyro_y * scale;
 	normalized_data.z = -data.gyro_z * scale;
 	normalized_data.temperature = PIOS_L3GD20_GetRegIsr(PIOS_L3GD20_OUT_TEMP, &woken);
+	normalized_data.timestamp = timestamp;
 
-	portBASE_TYPE xHigherPriorityTaskWoken;
-	xQueueSendToBackFromISR(dev->queue, (void *) &normalized_data, &xHigherPriorityTaskWoken);
-	
-	return woken || (xHigherPriorityTaskWoken == pdTRUE);
+	PIOS_SENSORS_RingPush(dev->ring, &normalized_data);
+	woken |= PIOS_SENSORS_RingSignalFromISR(dev->ring);
+
+	return woken;
 }
 
 #endif /* PIOS_INCLUDE_L3GD20 */
@@ -42,16 +42,19 @@ enum pios_lsm303_dev_magic {
 };
 
 #define PIOS_LSM303_MAX_DOWNSAMPLE 1
+//! Accel samples buffered for the consumer, must be a power of two
+#define PIOS_LSM303_RING_LENGTH 16
 struct lsm303_dev {
 	uint32_t i2c_id;
 	uint8_t i2c_addr_accel;
 	uint8_t i2c_addr_mag;
 	enum pios_lsm303_accel_range accel_range;
 	enum pios_lsm303_mag_range mag_range;
-	xQueueHandle queue_accel;
+	struct pios_sensor_ring *accel_ring;
 	xQueueHandle queue_mag;
 	xTaskHandle TaskHandle;
 	xSemaphoreHandle data_ready_sema;
+	volatile uint32_t interrupt_time;
 	volatile bool configured;
 	const struct pios_lsm303_cfg * cfg;
 	enum pios_lsm303_dev_magic magic;
@@ -99,8 +102,8 @@ static struct lsm303_dev * PIOS_LSM303_alloc(void)
 	
 	lsm303_dev->magic = PIOS_LSM303_DEV_MAGIC;
 	
-	lsm303_dev->queue_accel = xQueueCreate(PIOS_LSM303_MAX_DOWNSAMPLE, sizeof(struct pios_sensor_accel_data));
-	if (lsm303_dev->queue_accel == NULL) {
+	lsm303_dev->accel_ring = PIOS_SENSORS_RingCreate(PIOS_SENSOR_ACCEL, PIOS_LSM303_RING_LENGTH);
+	if (lsm303_dev->accel_ring == NULL) {
 		vPortFree(lsm303_dev);
 		return NULL;
 	}
@@ -171,8 +174,10 @@ int32_t PIOS_LSM303_Init(uint32_t i2c_id, const struct pios_lsm303_cfg * cfg)
 	/* Set up EXTI line */
 	PIOS_EXTI_Init(cfg->exti_cfg);
 
-	PIOS_SENSORS_Register(PIOS_SENSOR_ACCEL, dev->queue_accel);
+	PIOS_SENSORS_RegisterRing(PIOS_SENSOR_ACCEL, dev->accel_ring);
 	PIOS_SENSORS_Register(PIOS_SENSOR_MAG, dev->queue_mag);
+	// Every accel sample reaches the consumer through the ring
+	PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_ACCEL, 400);
 
 	return 0;
 }
@@ -577,6 +582,9 @@ bool PIOS_LSM303_IRQHandler(void)
 {
     portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
+    // The data ready interrupt is raised when the sample is taken
+    dev->interrupt_time = PIOS_DELAY_GetuS();
+
     xSemaphoreGiveFromISR(dev->data_ready_sema, &xHigherPriorityTaskWoken);
 
     return xHigherPriorityTaskWoken == pdTRUE;
@@ -636,8 +644,10 @@ static void PIOS_LSM303_Task(void *parameters)
 			}
 			normalized_data.z = -data.accel_z * accel_scale;
 			normalized_data.temperature = 0;
+			normalized_data.timestamp = dev->interrupt_time;
 
-			xQueueSend(dev->queue_accel, (void*)&normalized_data, 0);
+			PIOS_SENSORS_RingPush(dev->accel_ring, &normalized_data);
+			PIOS_SENSORS_RingSignal(dev->accel_ring);
 		}
 
 		/*
@@ -646,6 +656,8 @@ static void PIOS_LSM303_Task(void *parameters)
 		{
 			if ((PIOS_LSM303_Mag_GetReg(PIOS_LSM303_SR_REG_M) & PIOS_LSM303_SR_DRDY) != 0)
 			{
+				// The mag has no interrupt, it is polled at the accel rate
+				uint32_t timestamp = PIOS_DELAY_GetuS();
 				struct pios_lsm303_mag_data data;
 				if (PIOS_LSM303_Mag_ReadData(&data) < 0) {
 					continue;
@@ -675,6 +687,7 @@ static void PIOS_LSM303_Task(void *parameters)
 						break;
 				}
 				normalized_data.z = -data.mag_z * mag_scale_z;
+				normalized_data.timestamp = timestamp;
 
 				xQueueSend(dev->queue_mag, (void*)&normalized_data, 0);
 			}
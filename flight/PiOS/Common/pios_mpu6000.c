@@ -40,14 +40,18 @@ enum pios_mpu6000_dev_magic {
 	PIOS_MPU6000_DEV_MAGIC = 0x9da9b3ed,
 };
 
-#define PIOS_MPU6000_MAX_DOWNSAMPLE 1
+//! Samples buffered for the consumers, must be a power of two
+#define PIOS_MPU6000_RING_LENGTH 16
+//! Most samples read from the FIFO in one transfer
+#define PIOS_MPU6000_MAX_BURST 8
 struct mpu6000_dev {
 	uint32_t spi_id;
 	uint32_t slave_num;
 	enum pios_mpu60x0_accel_range accel_range;
 	enum pios_mpu60x0_range gyro_range;
-	xQueueHandle gyro_queue;
-	xQueueHandle accel_queue;
+	struct pios_sensor_ring *gyro_ring;
+	struct pios_sensor_ring *accel_ring;
+	uint32_t sample_period_us;
 	const struct pios_mpu60x0_cfg * cfg;
 	bool configured;
 	enum pios_mpu6000_dev_magic magic;
@@ -64,6 +68,7 @@ static int32_t PIOS_MPU6000_ClaimBus();
 static int32_t PIOS_MPU6000_ReleaseBus();
 static int32_t PIOS_MPU6000_SetReg(uint8_t address, uint8_t buffer);
 static int32_t PIOS_MPU6000_GetReg(uint8_t address);
+static void PIOS_MPU6000_PushSample(const uint8_t *mpu6000_rec_buf, uint32_t timestamp);
 
 #define GRAV 9.81f
 
@@ -81,14 +86,14 @@ static struct mpu6000_dev * PIOS_MPU6000_alloc(void)
 
 	mpu6000_dev->configured = false;
 	
-	mpu6000_dev->accel_queue = xQueueCreate(PIOS_MPU6000_MAX_DOWNSAMPLE, sizeof(struct pios_sensor_gyro_data));
-	if(mpu6000_dev->accel_queue == NULL) {
+	mpu6000_dev->accel_ring = PIOS_SENSORS_RingCreate(PIOS_SENSOR_ACCEL, PIOS_MPU6000_RING_LENGTH);
+	if(mpu6000_dev->accel_ring == NULL) {
 		vPortFree(mpu6000_dev);
 		return NULL;
 	}
 
-	mpu6000_dev->gyro_queue = xQueueCreate(PIOS_MPU6000_MAX_DOWNSAMPLE, sizeof(struct pios_sensor_gyro_data));
-	if(mpu6000_dev->gyro_queue == NULL) {
+	mpu6000_dev->gyro_ring = PIOS_SENSORS_RingCreate(PIOS_SENSOR_GYRO, PIOS_MPU6000_RING_LENGTH);
+	if(mpu6000_dev->gyro_ring == NULL) {
 		vPortFree(mpu6000_dev);
 		return NULL;
 	}
@@ -133,8 +138,10 @@ int32_t PIOS_MPU6000_Init(uint32_t spi_id, uint32_t slave_num, const struct pios
 	/* Set up EXTI line */
 	PIOS_EXTI_Init(cfg->exti_cfg);
 
-	PIOS_SENSORS_Register(PIOS_SENSOR_ACCEL, dev->accel_queue);
-	PIOS_SENSORS_Register(PIOS_SENSOR_GYRO, dev->gyro_queue);
+	PIOS_SENSORS_RegisterRing(PIOS_SENSOR_ACCEL, dev->accel_ring);
+	PIOS_SENSORS_RegisterRing(PIOS_SENSOR_GYRO, dev->gyro_ring);
+	PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_ACCEL, 1000000 / dev->sample_period_us);
+	PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_GYRO, 1000000 / dev->sample_period_us);
 
 	return 0;
 }
@@ -193,6 +200,10 @@ static void PIOS_MPU6000_Config(struct pios_mpu60x0_cfg const * cfg)
 	// Digital low-pass filter and scale
 	PIOS_MPU6000_SetReg(PIOS_MPU60X0_DLPF_CFG_REG, cfg->filter);
 
+	// The gyro output rate is 8 kHz without the low-pass filter and 1 kHz with it
+	uint32_t output_period_us = (cfg->filter == PIOS_MPU60X0_LOWPASS_256_HZ) ? 125 : 1000;
+	dev->sample_period_us = output_period_us * (cfg->Smpl_rate_div + 1);
+
 	// Digital low-pass filter and scale
 	PIOS_MPU6000_SetGyroRange(PIOS_MPU60X0_SCALE_500_DEG);
 
@@ -426,6 +437,9 @@ static int32_t PIOS_MPU6000_GetStatus(void)
 */
 bool PIOS_MPU6000_IRQHandler(void)
 {
+	// The data ready interrupt is raised when the sample is taken
+	uint32_t interrupt_time = PIOS_DELAY_GetuS();
+
 	if (PIOS_MPU6000_Validate(dev) != 0)
 		return false;
 
@@ -438,38 +452,57 @@ bool PIOS_MPU6000_IRQHandler(void)
 		return false;
 	}
 
-	uint32_t mpu6000_count = PIOS_MPU6000_FifoDepth();
-	if(mpu6000_count < sizeof(struct pios_mpu60x0_data))
+	// Samples keep coming in until the FIFO depth is read, date the newest
+	// one from the interrupt plus the sample periods since then
+	int32_t mpu6000_count = PIOS_MPU6000_FifoDepth();
+	uint32_t since_interrupt = PIOS_DELAY_GetuS() - interrupt_time;
+	uint32_t timestamp = interrupt_time + since_interrupt - since_interrupt % dev->sample_period_us;
+
+	if(mpu6000_count < (int32_t) sizeof(struct pios_mpu60x0_data))
 		return false;
 
+	// Read all the complete samples in one transfer. Anything beyond a
+	// burst stays in the FIFO and raises the next interrupt.
+	uint32_t fifo_samples = mpu6000_count / sizeof(struct pios_mpu60x0_data);
+	uint32_t burst = (fifo_samples > PIOS_MPU6000_MAX_BURST) ? PIOS_MPU6000_MAX_BURST : fifo_samples;
+
+	static uint8_t mpu6000_send_buf[1 + PIOS_MPU6000_MAX_BURST * sizeof(struct pios_mpu60x0_data)] = {PIOS_MPU60X0_FIFO_REG | 0x80};
+	static uint8_t mpu6000_rec_buf[1 + PIOS_MPU6000_MAX_BURST * sizeof(struct pios_mpu60x0_data)];
+
 	if(PIOS_MPU6000_ClaimBus() != 0)
 		return false;
 
-	uint8_t mpu6000_send_buf[1+sizeof(struct pios_mpu60x0_data)] = {PIOS_MPU60X0_FIFO_REG | 0x80, 0, 0, 0, 0, 0, 0, 0, 0};
-	uint8_t mpu6000_rec_buf[1+sizeof(struct pios_mpu60x0_data)];
-
-	if(PIOS_SPI_TransferBlock(dev->spi_id, &mpu6000_send_buf[0], &mpu6000_rec_buf[0], sizeof(mpu6000_send_buf), NULL) < 0) {
+	if(PIOS_SPI_TransferBlock(dev->spi_id, &mpu6000_send_buf[0], &mpu6000_rec_buf[0], 1 + burst * sizeof(struct pios_mpu60x0_data), NULL) < 0) {
 		PIOS_MPU6000_ReleaseBus();
 		return false;
 	}
 
 	PIOS_MPU6000_ReleaseBus();
 
-	struct pios_mpu60x0_data data;
-
-	// In the case where extras samples backed up grabbed an extra
-	if (mpu6000_count >= (sizeof(data) * 2)) {
-		if(PIOS_MPU6000_ClaimBus() != 0)
-			return false;		
-		
-		if(PIOS_SPI_TransferBlock(dev->spi_id, &mpu6000_send_buf[0], &mpu6000_rec_buf[0], sizeof(mpu6000_send_buf), NULL) < 0) {
-			PIOS_MPU6000_ReleaseBus();
-			return false;
-		}
-		
-		PIOS_MPU6000_ReleaseBus();
+	// The samples before the newest one were taken a sample period apart
+	for (uint32_t i = 0; i < burst; i++) {
+		uint32_t age = (fifo_samples - 1 - i) * dev->sample_period_us;
+		PIOS_MPU6000_PushSample(&mpu6000_rec_buf[i * sizeof(struct pios_mpu60x0_data)], timestamp - age);
 	}
-	
+
+	// Wake up the consumer once for the whole burst
+	bool woken = false;
+#if defined(PIOS_MPU6000_ACCEL)
+	woken |= PIOS_SENSORS_RingSignalFromISR(dev->accel_ring);
+#endif
+	woken |= PIOS_SENSORS_RingSignalFromISR(dev->gyro_ring);
+
+	return woken;
+}
+
+/**
+ * @brief Convert a sample from the FIFO and add it to the rings
+ * @param[in] mpu6000_rec_buf The sample starts at index 1, like the receive
+ * buffer of a transfer that reads a single sample
+ * @param[in] timestamp When the sample was taken
+ */
+static void PIOS_MPU6000_PushSample(const uint8_t *mpu6000_rec_buf, uint32_t timestamp)
+{
 	// Rotate the sensor to OP convention.  The datasheet defines X as towards the right
 	// and Y as forward.  OP convention transposes this.  Also the Z is defined negatively
 	// to our convention
@@ -525,13 +558,11 @@ bool PIOS_MPU6000_IRQHandler(void)
 	gyro_data.z *= gyro_scale;
 	gyro_data.temperature = temperature;
 
-	portBASE_TYPE xHigherPriorityTaskWoken_accel;
-	xQueueSendToBackFromISR(dev->accel_queue, (void *) &accel_data, &xHigherPriorityTaskWoken_accel);
+	accel_data.timestamp = timestamp;
+	gyro_data.timestamp = timestamp;
 
-	portBASE_TYPE xHigherPriorityTaskWoken_gyro;
-	xQueueSendToBackFromISR(dev->gyro_queue, (void *) &gyro_data, &xHigherPriorityTaskWoken_gyro);
-
-	return (xHigherPriorityTaskWoken_accel == pdTRUE) || (xHigherPriorityTaskWoken_gyro == pdTRUE);
+	PIOS_SENSORS_RingPush(dev->accel_ring, &accel_data);
+	PIOS_SENSORS_RingPush(dev->gyro_ring, &gyro_data);
 
 #else
 
@@ -565,11 +596,9 @@ bool PIOS_MPU6000_IRQHandler(void)
 	gyro_data.y *= gyro_scale;
 	gyro_data.z *= gyro_scale;
 	gyro_data.temperature = temperature;
+	gyro_data.timestamp = timestamp;
 
-	portBASE_TYPE xHigherPriorityTaskWoken_gyro;
-	xQueueSendToBackFromISR(dev->gyro_queue, (void *) &gyro_data, &xHigherPriorityTaskWoken_gyro);
-
-	return (xHigherPriorityTaskWoken_gyro == pdTRUE);
+	PIOS_SENSORS_RingPush(dev->gyro_ring, &gyro_data);
 
 #endif
 
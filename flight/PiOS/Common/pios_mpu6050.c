@@ -45,16 +45,21 @@ enum pios_mpu6050_dev_magic {
 	PIOS_MPU6050_DEV_MAGIC = 0xf21d26a2,
 };
 
-#define PIOS_MPU6050_MAX_DOWNSAMPLE 2
+//! Samples buffered for the consumers, must be a power of two
+#define PIOS_MPU6050_RING_LENGTH 16
+//! Most samples read from the FIFO in one transfer
+#define PIOS_MPU6050_MAX_BURST 8
 struct mpu6050_dev {
 	uint32_t i2c_id;
 	uint8_t i2c_addr;
 	enum pios_mpu60x0_accel_range accel_range;
 	enum pios_mpu60x0_range gyro_range;
-	xQueueHandle gyro_queue;
-	xQueueHandle accel_queue;
+	struct pios_sensor_ring *gyro_ring;
+	struct pios_sensor_ring *accel_ring;
+	uint32_t sample_period_us;
 	xTaskHandle TaskHandle;
 	xSemaphoreHandle data_ready_sema;
+	volatile uint32_t interrupt_time;
 	const struct pios_mpu60x0_cfg * cfg;
 	bool configured;
 	enum pios_mpu6050_dev_magic magic;
@@ -71,6 +76,7 @@ static int32_t PIOS_MPU6050_SetReg(uint8_t address, uint8_t buffer);
 static int32_t PIOS_MPU6050_GetReg(uint8_t address);
 static int32_t PIOS_MPU6050_ReadID();
 static void PIOS_MPU6050_Task(void *parameters);
+static void PIOS_MPU6050_PushSample(const uint8_t *mpu6050_rec_buf, uint32_t timestamp);
 
 #define GRAV 9.81f
 
@@ -86,14 +92,14 @@ static struct mpu6050_dev * PIOS_MPU6050_alloc(void)
 	
 	mpu6050_dev->magic = PIOS_MPU6050_DEV_MAGIC;
 	
-	mpu6050_dev->accel_queue = xQueueCreate(PIOS_MPU6050_MAX_DOWNSAMPLE, sizeof(struct pios_sensor_gyro_data));
-	if(mpu6050_dev->accel_queue == NULL) {
+	mpu6050_dev->accel_ring = PIOS_SENSORS_RingCreate(PIOS_SENSOR_ACCEL, PIOS_MPU6050_RING_LENGTH);
+	if(mpu6050_dev->accel_ring == NULL) {
 		vPortFree(mpu6050_dev);
 		return NULL;
 	}
 
-	mpu6050_dev->gyro_queue = xQueueCreate(PIOS_MPU6050_MAX_DOWNSAMPLE, sizeof(struct pios_sensor_gyro_data));
-	if(mpu6050_dev->gyro_queue == NULL) {
+	mpu6050_dev->gyro_ring = PIOS_SENSORS_RingCreate(PIOS_SENSOR_GYRO, PIOS_MPU6050_RING_LENGTH);
+	if(mpu6050_dev->gyro_ring == NULL) {
 		vPortFree(mpu6050_dev);
 		return NULL;
 	}
@@ -147,8 +153,10 @@ int32_t PIOS_MPU6050_Init(uint32_t i2c_id, uint8_t i2c_addr, const struct pios_m
 	/* Set up EXTI line */
 	PIOS_EXTI_Init(cfg->exti_cfg);
 
-	PIOS_SENSORS_Register(PIOS_SENSOR_ACCEL, dev->accel_queue);
-	PIOS_SENSORS_Register(PIOS_SENSOR_GYRO, dev->gyro_queue);
+	PIOS_SENSORS_RegisterRing(PIOS_SENSOR_ACCEL, dev->accel_ring);
+	PIOS_SENSORS_RegisterRing(PIOS_SENSOR_GYRO, dev->gyro_ring);
+	PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_ACCEL, 1000000 / dev->sample_period_us);
+	PIOS_SENSORS_SetSampleRate(PIOS_SENSOR_GYRO, 1000000 / dev->sample_period_us);
 
 	return 0;
 }
@@ -194,6 +202,10 @@ static void PIOS_MPU6050_Config(struct pios_mpu60x0_cfg const * cfg)
 	
 	// Digital low-pass filter and scale
 	while (PIOS_MPU6050_SetReg(PIOS_MPU60X0_DLPF_CFG_REG, cfg->filter) != 0) ;
+
+	// The gyro output rate is 8 kHz without the low-pass filter and 1 kHz with it
+	uint32_t output_period_us = (cfg->filter == PIOS_MPU60X0_LOWPASS_256_HZ) ? 125 : 1000;
+	dev->sample_period_us = output_period_us * (cfg->Smpl_rate_div + 1);
 	
 	// Digital low-pass filter and scale
 	PIOS_MPU6050_SetGyroRange(PIOS_MPU60X0_SCALE_500_DEG);
@@ -428,6 +440,9 @@ bool PIOS_MPU6050_IRQHandler(void)
 {
     portBASE_TYPE xHigherPriorityTaskWoken = pdFALSE;
 
+    // The data ready interrupt is raised when the sample is taken
+    dev->interrupt_time = PIOS_DELAY_GetuS();
+
     xSemaphoreGiveFromISR(dev->data_ready_sema, &xHigherPriorityTaskWoken);
 
     return xHigherPriorityTaskWoken == pdTRUE;
@@ -455,124 +470,145 @@ static void PIOS_MPU6050_Task(void *parameters)
 			continue;
 		}
 
+		// Samples keep coming in until the FIFO depth is read, date the
+		// newest one from the interrupt plus the sample periods since then
+		uint32_t interrupt_time = dev->interrupt_time;
 		int32_t mpu6050_count = PIOS_MPU6050_FifoDepth();
-		if(mpu6050_count < sizeof(struct pios_mpu60x0_data))
-			continue;
-	
-		static uint8_t mpu6050_rec_buf[sizeof(struct pios_mpu60x0_data)];
-		
-		if (PIOS_MPU6050_Read(PIOS_MPU60X0_FIFO_REG, mpu6050_rec_buf, sizeof(mpu6050_rec_buf)) < 0) {
-			continue;
-		}
-	
-		// In the case where extras samples backed up grabbed an extra
-		if (mpu6050_count >= (sizeof(mpu6050_rec_buf) * 2)) {
+		uint32_t since_interrupt = PIOS_DELAY_GetuS() - interrupt_time;
+		uint32_t timestamp = interrupt_time + since_interrupt - since_interrupt % dev->sample_period_us;
 
-			//overwrite until the newest entry is present in mpu6050_rec_buf
-			if (PIOS_MPU6050_Read(PIOS_MPU60X0_FIFO_REG, mpu6050_rec_buf, sizeof(mpu6050_rec_buf)) < 0) {
-				continue;
-			}
-		}
+		if(mpu6050_count < (int32_t) sizeof(struct pios_mpu60x0_data))
+			continue;
 
-		// Rotate the sensor to OP convention.  The datasheet defines X as towards the right
-		// and Y as forward.  OP convention transposes this.  Also the Z is defined negatively
-		// to our convention
+		// Read all the complete samples in one transfer. Anything beyond a
+		// burst stays in the FIFO and raises the next interrupt.
+		uint32_t fifo_samples = mpu6050_count / sizeof(struct pios_mpu60x0_data);
+		uint32_t burst = (fifo_samples > PIOS_MPU6050_MAX_BURST) ? PIOS_MPU6050_MAX_BURST : fifo_samples;
 
-#if defined(PIOS_MPU6050_ACCEL)
+		static uint8_t mpu6050_rec_buf[PIOS_MPU6050_MAX_BURST * sizeof(struct pios_mpu60x0_data)];
 
-		// Currently we only support rotations on top so switch X/Y accordingly
-		struct pios_sensor_accel_data accel_data;
-		struct pios_sensor_gyro_data gyro_data;
-
-		switch(dev->cfg->orientation) {
-		case PIOS_MPU60X0_TOP_0DEG:
-			accel_data.y = (int16_t) (mpu6050_rec_buf[0] << 8 | mpu6050_rec_buf[1]);    // chip X
-			accel_data.x = (int16_t) (mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);    // chip Y
-			gyro_data.y  = (int16_t) (mpu6050_rec_buf[8] << 8  | mpu6050_rec_buf[9]);   // chip X
-			gyro_data.x  = (int16_t) (mpu6050_rec_buf[10] << 8 | mpu6050_rec_buf[11]);  // chip Y
-			break;
-		case PIOS_MPU60X0_TOP_90DEG:
-			accel_data.y = (int16_t) -(mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);   // chip Y
-			accel_data.x = (int16_t)  (mpu6050_rec_buf[0] << 8 | mpu6050_rec_buf[1]);   // chip X
-			gyro_data.y  = (int16_t) -(mpu6050_rec_buf[10] << 8 | mpu6050_rec_buf[11]); // chip Y
-			gyro_data.x  = (int16_t)  (mpu6050_rec_buf[8] << 8  | mpu6050_rec_buf[9]);  // chip X
-			break;
-		case PIOS_MPU60X0_TOP_180DEG:
-			accel_data.y = (int16_t) -(mpu6050_rec_buf[0] << 8 | mpu6050_rec_buf[1]);   // chip X
-			accel_data.x = (int16_t) -(mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);   // chip Y
-			gyro_data.y  = (int16_t) -(mpu6050_rec_buf[8] << 8  | mpu6050_rec_buf[9]); // chip X
-			gyro_data.x  = (int16_t) -(mpu6050_rec_buf[10] << 8 | mpu6050_rec_buf[11]); // chip Y
-			break;
-		case PIOS_MPU60X0_TOP_270DEG:
-			accel_data.y = (int16_t)  (mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);   // chip Y
-			accel_data.x = (int16_t) -(mpu6050_rec_buf[0] << 8 | mpu6050_rec_buf[1]);   // chip X
-			gyro_data.y  = (int16_t)  (mpu6050_rec_buf[10] << 8 | mpu6050_rec_buf[11]); // chip Y
-			gyro_data.x  = (int16_t) -(mpu6050_rec_buf[8] << 8  | mpu6050_rec_buf[9]); // chip X
-			break;
+		if (PIOS_MPU6050_Read(PIOS_MPU60X0_FIFO_REG, mpu6050_rec_buf, burst * sizeof(struct pios_mpu60x0_data)) < 0) {
+			continue;
 		}
-		gyro_data.z  = (int16_t) -(mpu6050_rec_buf[12] << 8 | mpu6050_rec_buf[13]);
-		accel_data.z = (int16_t) -(mpu6050_rec_buf[4] << 8 | mpu6050_rec_buf[5]);
 
-		int16_t raw_temp = mpu6050_rec_buf[6] << 8 | mpu6050_rec_buf[7];
-		float temperature = 35.0f + ((float) raw_temp + 512.0f) / 340.0f;
+		// The samples before the newest one were taken a sample period apart
+		for (uint32_t i = 0; i < burst; i++) {
+			uint32_t age = (fifo_samples - 1 - i) * dev->sample_period_us;
+			PIOS_MPU6050_PushSample(&mpu6050_rec_buf[i * sizeof(struct pios_mpu60x0_data)], timestamp - age);
+		}
 
-		// Apply sensor scaling
-		float accel_scale = PIOS_MPU6050_GetAccelScale();
-		accel_data.x *= accel_scale;
-		accel_data.y *= accel_scale;
-		accel_data.z *= accel_scale;
-		accel_data.temperature = temperature;
+		// Wake up the consumer once for the whole burst
+#if defined(PIOS_MPU6050_ACCEL)
+		PIOS_SENSORS_RingSignal(dev->accel_ring);
+#endif
+		PIOS_SENSORS_RingSignal(dev->gyro_ring);
+	}
+}
 
-		float gyro_scale = PIOS_MPU6050_GetGyroScale();
-		gyro_data.x *= gyro_scale;
-		gyro_data.y *= gyro_scale;
-		gyro_data.z *= gyro_scale;
-		gyro_data.temperature = temperature;
+/**
+ * @brief Convert a sample from the FIFO and add it to the rings
+ * @param[in] mpu6050_rec_buf The sample
+ * @param[in] timestamp When the sample was taken
+ */
+static void PIOS_MPU6050_PushSample(const uint8_t *mpu6050_rec_buf, uint32_t timestamp)
+{
+	// Rotate the sensor to OP convention.  The datasheet defines X as towards the right
+	// and Y as forward.  OP convention transposes this.  Also the Z is defined negatively
+	// to our convention
 
-		portBASE_TYPE xHigherPriorityTaskWoken_accel;
-		xQueueSendToBackFromISR(dev->accel_queue, (void *) &accel_data, &xHigherPriorityTaskWoken_accel);
+#if defined(PIOS_MPU6050_ACCEL)
 
-		portBASE_TYPE xHigherPriorityTaskWoken_gyro;
-		xQueueSendToBackFromISR(dev->gyro_queue, (void *) &gyro_data, &xHigherPriorityTaskWoken_gyro);
+	// Currently we only support rotations on top so switch X/Y accordingly
+	struct pios_sensor_accel_data accel_data;
+	struct pios_sensor_gyro_data gyro_data;
+
+	switch(dev->cfg->orientation) {
+	case PIOS_MPU60X0_TOP_0DEG:
+		accel_data.y = (int16_t) (mpu6050_rec_buf[0] << 8 | mpu6050_rec_buf[1]);    // chip X
+		accel_data.x = (int16_t) (mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);    // chip Y
+		gyro_data.y  = (int16_t) (mpu6050_rec_buf[8] << 8  | mpu6050_rec_buf[9]);   // chip X
+		gyro_data.x  = (int16_t) (mpu6050_rec_buf[10] << 8 | mpu6050_rec_buf[11]);  // chip Y
+		break;
+	case PIOS_MPU60X0_TOP_90DEG:
+		accel_data.y = (int16_t) -(mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);   // chip Y
+		accel_data.x = (int16_t)  (mpu6050_rec_buf[0] << 8 | mpu6050_rec_buf[1]);   // chip X
+		gyro_data.y  = (int16_t) -(mpu6050_rec_buf[10] << 8 | mpu6050_rec_buf[11]); // chip Y
+		gyro_data.x  = (int16_t)  (mpu6050_rec_buf[8] << 8  | mpu6050_rec_buf[9]);  // chip X
+		break;
+	case PIOS_MPU60X0_TOP_180DEG:
+		accel_data.y = (int16_t) -(mpu6050_rec_buf[0] << 8 | mpu6050_rec_buf[1]);   // chip X
+		accel_data.x = (int16_t) -(mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);   // chip Y
+		gyro_data.y  = (int16_t) -(mpu6050_rec_buf[8] << 8  | mpu6050_rec_buf[9]); // chip X
+		gyro_data.x  = (int16_t) -(mpu6050_rec_buf[10] << 8 | mpu6050_rec_buf[11]); // chip Y
+		break;
+	case PIOS_MPU60X0_TOP_270DEG:
+		accel_data.y = (int16_t)  (mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);   // chip Y
+		accel_data.x = (int16_t) -(mpu6050_rec_buf[0] << 8 | mpu6050_rec_buf[1]);   // chip X
+		gyro_data.y  = (int16_t)  (mpu6050_rec_buf[10] << 8 | mpu6050_rec_buf[11]); // chip Y
+		gyro_data.x  = (int16_t) -(mpu6050_rec_buf[8] << 8  | mpu6050_rec_buf[9]); // chip X
+		break;
+	}
+	gyro_data.z  = (int16_t) -(mpu6050_rec_buf[12] << 8 | mpu6050_rec_buf[13]);
+	accel_data.z = (int16_t) -(mpu6050_rec_buf[4] << 8 | mpu6050_rec_buf[5]);
+
+	int16_t raw_temp = mpu6050_rec_buf[6] << 8 | mpu6050_rec_buf[7];
+	float temperature = 35.0f + ((float) raw_temp + 512.0f) / 340.0f;
+
+	// Apply sensor scaling
+	float accel_scale = PIOS_MPU6050_GetAccelScale();
+	accel_data.x *= accel_scale;
+	accel_data.y *= accel_scale;
+	accel_data.z *= accel_scale;
+	accel_data.temperature = temperature;
+	accel_data.timestamp = timestamp;
+
+	float gyro_scale = PIOS_MPU6050_GetGyroScale();
+	gyro_data.x *= gyro_scale;
+	gyro_data.y *= gyro_scale;
+	gyro_data.z *= gyro_scale;
+	gyro_data.temperature = temperature;
+	gyro_data.timestamp = timestamp;
+
+	PIOS_SENSORS_RingPush(dev->accel_ring, &accel_data);
+	PIOS_SENSORS_RingPush(dev->gyro_ring, &gyro_data);
 
 #else
 
-		struct pios_sensor_gyro_data gyro_data;
-		switch(dev->cfg->orientation) {
-		case PIOS_MPU60X0_TOP_0DEG:
-			gyro_data.y  = (int16_t) (mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);
-			gyro_data.x  = (int16_t) (mpu6050_rec_buf[4] << 8 | mpu6050_rec_buf[5]);
-			break;
-		case PIOS_MPU60X0_TOP_90DEG:
-			gyro_data.y  = (int16_t) -(mpu6050_rec_buf[4] << 8 | mpu6050_rec_buf[5]); // chip Y
-			gyro_data.x  = (int16_t)  (mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]); // chip X
-			break;
-		case PIOS_MPU60X0_TOP_180DEG:
-			gyro_data.y  = (int16_t) -(mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);
-			gyro_data.x  = (int16_t) -(mpu6050_rec_buf[4] << 8 | mpu6050_rec_buf[5]);
-			break;
-		case PIOS_MPU60X0_TOP_270DEG:
-			gyro_data.y  = (int16_t)  (mpu6050_rec_buf[4] << 8 | mpu6050_rec_buf[5]); // chip Y
-			gyro_data.x  = (int16_t) -(mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]); // chip X
-			break;
-		}
-		gyro_data.z = (int16_t) -(mpu6050_rec_buf[6] << 8 | mpu6050_rec_buf[7]);
+	struct pios_sensor_gyro_data gyro_data;
+	switch(dev->cfg->orientation) {
+	case PIOS_MPU60X0_TOP_0DEG:
+		gyro_data.y  = (int16_t) (mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);
+		gyro_data.x  = (int16_t) (mpu6050_rec_buf[4] << 8 | mpu6050_rec_buf[5]);
+		break;
+	case PIOS_MPU60X0_TOP_90DEG:
+		gyro_data.y  = (int16_t) -(mpu6050_rec_buf[4] << 8 | mpu6050_rec_buf[5]); // chip Y
+		gyro_data.x  = (int16_t)  (mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]); // chip X
+		break;
+	case PIOS_MPU60X0_TOP_180DEG:
+		gyro_data.y  = (int16_t) -(mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]);
+		gyro_data.x  = (int16_t) -(mpu6050_rec_buf[4] << 8 | mpu6050_rec_buf[5]);
+		break;
+	case PIOS_MPU60X0_TOP_270DEG:
+		gyro_data.y  = (int16_t)  (mpu6050_rec_buf[4] << 8 | mpu6050_rec_buf[5]); // chip Y
+		gyro_data.x  = (int16_t) -(mpu6050_rec_buf[2] << 8 | mpu6050_rec_buf[3]); // chip X
+		break;
+	}
+	gyro_data.z = (int16_t) -(mpu6050_rec_buf[6] << 8 | mpu6050_rec_buf[7]);
 
-		int32_t raw_temp = mpu6050_rec_buf[0] << 8 | mpu6050_rec_buf[1];
-		float temperature = 35.0f + ((float) raw_temp + 512.0f) / 340.0f;
+	int32_t raw_temp = mpu6050_rec_buf[0] << 8 | mpu6050_rec_buf[1];
+	float temperature = 35.0f + ((float) raw_temp + 512.0f) / 340.0f;
 
-		// Apply sensor scaling
-		float gyro_scale = PIOS_MPU6050_GetGyroScale();
-		gyro_data.x *= gyro_scale;
-		gyro_data.y *= gyro_scale;
-		gyro_data.z *= gyro_scale;
-		gyro_data.temperature = temperature;
+	// Apply sensor scaling
+	float gyro_scale = PIOS_MPU6050_GetGyroScale();
+	gyro_data.x *= gyro_scale;
+	gyro_data.y *= gyro_scale;
+	gyro_data.z *= gyro_scale;
+	gyro_data.temperature = temperature;
+	gyro_data.timestamp = timestamp;
 
-		portBASE_TYPE xHigherPriorityTaskWoken_gyro;
-		xQueueSendToBackFromISR(dev->gyro_queue, (void *) &gyro_data, &xHigherPriorityTaskWoken_gyro);
+	PIOS_SENSORS_RingPush(dev->gyro_ring, &gyro_data);
 
 #endif
-	}
 }
 
 #endif
@@ -378,7 +378,9 @@ static void PIOS_MS5611_Task(void *parameters)
 			temp_press_interleave_count = dev->temperature_interleaving;
 		}
 
-		// Update the pressure data
+		// Update the pressure data. The pressure is integrated over the
+		// conversion, so it is sampled half way through it.
+		uint32_t conversion_start = PIOS_DELAY_GetuS();
 		PIOS_MS5611_StartADC(PRESSURE_CONV);
 		vTaskDelay(PIOS_MS5611_GetDelay());
 		PIOS_MS5611_ReadADC();
@@ -388,6 +390,7 @@ static void PIOS_MS5611_Task(void *parameters)
 		data.temperature = ((float) dev->temperature_unscaled) / 100.0f;
 		data.pressure = ((float) dev->pressure_unscaled) / 1000.0f;
 		data.altitude = 44330.0f * (1.0f - powf(data.pressure / MS5611_P0, (1.0f / 5.255f)));
+		data.timestamp = conversion_start + PIOS_MS5611_GetDelay() * portTICK_RATE_MS * 1000 / 2;
 
 		xQueueSend(dev->queue, (void*)&data, 0);
 	}
@@ -81,6 +81,7 @@
 
 #define PIOS_INCLUDE_ADXL345
 #define PIOS_INCLUDE_FLASH
+#define PIOS_FLASHFS_LOGFS_DIR_SIZE 128 /* Fewer settings objects than slots, saves RAM */
 #define PIOS_INCLUDE_MPU6000
 #define PIOS_MPU6000_ACCEL
 
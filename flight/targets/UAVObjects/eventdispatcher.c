@@ -41,6 +41,8 @@
 
 #define TASK_PRIORITY (tskIDLE_PRIORITY + 3)
 #define MAX_UPDATE_PERIOD_MS 1000
+#define PERIODIC_HEAP_INITIAL_SIZE 16
+#define PERIODIC_DISABLED INT32_MAX
 
 // Private types
 
@@ -55,18 +57,24 @@ typedef struct {
 } EventCallbackInfo;
 
 /**
- * List of object properties that are needed for the periodic updates.
+ * Object properties that are needed for the periodic updates.
  */
 struct PeriodicObjectListStruct {
 	EventCallbackInfo evInfo; /** Event callback information */
-    uint16_t updatePeriodMs; /** Update period in ms or 0 if no periodic updates are needed */
-    int32_t timeToNextUpdateMs; /** Time delay to the next update */
-    struct PeriodicObjectListStruct* next; /** Needed by linked list library (utlist.h) */
+	uint16_t updatePeriodMs; /** Update period in ms or 0 if no periodic updates are needed */
+	uint16_t heapIndex; /** Position in the heap of periodic events */
+	int32_t timeToNextUpdateMs; /** Time of the next update, PERIODIC_DISABLED if none */
 };
 typedef struct PeriodicObjectListStruct PeriodicObjectList;
 
 // Private variables
-static PeriodicObjectList* objList;
+/**
+ * Periodic events as a binary min-heap on timeToNextUpdateMs, so the next event
+ * to dispatch is always the first one and rescheduling it costs O(log n).
+ */
+static PeriodicObjectList** heap;
+static uint16_t heapSize;
+static uint16_t heapCapacity;
 static xQueueHandle queue;
 static xTaskHandle eventTaskHandle;
 static xSemaphoreHandle mutex;
@@ -78,6 +86,11 @@ static void eventTask();
 static int32_t eventPeriodicCreate(UAVObjEvent* ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static int32_t eventPeriodicUpdate(UAVObjEvent* ev, UAVObjEventCallback cb, xQueueHandle queue, uint16_t periodMs);
 static uint16_t randomizePeriod(uint16_t periodMs);
+static PeriodicObjectList* findPeriodic(UAVObjEvent* ev, UAVObjEventCallback cb, xQueueHandle queue);
+static int32_t heapInsert(PeriodicObjectList* entry);
+static void heapUpdate(PeriodicObjectList* entry);
+static void heapUp(uint16_t index);
+static void heapDown(uint16_t index);
 
 
 /**
@@ -87,7 +100,9 @@ static uint16_t randomizePeriod(uint16_t periodMs);
 int32_t EventDispatcherInitialize()
 {
 	// Initialize variables
-	objList = NULL;
+	heap = NULL;
+	heapSize = 0;
+	heapCapacity = 0;
 	memset(&stats, 0, sizeof(EventStats));
 
 	// Create mutex
@@ -206,34 +221,44 @@ static int32_t eventPeriodicCreate(UAVObjEvent* ev, UAVObjEventCallback cb, xQue
 	// Get lock
 	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 	// Check that the object is not already connected
-	LL_FOREACH(objList, objEntry)
+	if (findPeriodic(ev, cb, queue) != NULL)
 	{
-		if (objEntry->evInfo.cb == cb &&
-			objEntry->evInfo.queue == queue &&
-			objEntry->evInfo.ev.obj == ev->obj &&
-			objEntry->evInfo.ev.instId == ev->instId &&
-			objEntry->evInfo.ev.event == ev->event)
-		{
-			// Already registered, do nothing
-			xSemaphoreGiveRecursive(mutex);
-			return -1;
-		}
+		// Already registered, do nothing
+		xSemaphoreGiveRecursive(mutex);
+		return -1;
 	}
-    // Create handle
+	// Create handle
 	objEntry = (PeriodicObjectList*)pvPortMalloc(sizeof(PeriodicObjectList));
-	if (objEntry == NULL) return -1;
+	if (objEntry == NULL)
+	{
+		xSemaphoreGiveRecursive(mutex);
+		return -1;
+	}
 	objEntry->evInfo.ev.obj = ev->obj;
 	objEntry->evInfo.ev.instId = ev->instId;
 	objEntry->evInfo.ev.event = ev->event;
 	objEntry->evInfo.cb = cb;
 	objEntry->evInfo.queue = queue;
-    objEntry->updatePeriodMs = periodMs;
-    objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
-    // Add to list
-    LL_APPEND(objList, objEntry);
+	objEntry->updatePeriodMs = periodMs;
+	if (periodMs > 0)
+	{
+		// Start at a random point of the period to avoid bunching of updates
+		objEntry->timeToNextUpdateMs = xTaskGetTickCount()*portTICK_RATE_MS + randomizePeriod(periodMs);
+	}
+	else
+	{
+		objEntry->timeToNextUpdateMs = PERIODIC_DISABLED;
+	}
+	// Add to heap
+	if (heapInsert(objEntry) != 0)
+	{
+		vPortFree(objEntry);
+		xSemaphoreGiveRecursive(mutex);
+		return -1;
+	}
 	// Release lock
 	xSemaphoreGiveRecursive(mutex);
-    return 0;
+	return 0;
 }
 
 /**
@@ -250,25 +275,49 @@ static int32_t eventPeriodicUpdate(UAVObjEvent* ev, UAVObjEventCallback cb, xQue
 	// Get lock
 	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 	// Find object
-	LL_FOREACH(objList, objEntry)
+	objEntry = findPeriodic(ev, cb, queue);
+	if (objEntry == NULL)
+	{
+		// The object was not found
+		xSemaphoreGiveRecursive(mutex);
+		return -1;
+	}
+	// Update period
+	objEntry->updatePeriodMs = periodMs;
+	if (periodMs > 0)
+	{
+		// Restart at a random point of the period to avoid bunching of updates
+		objEntry->timeToNextUpdateMs = xTaskGetTickCount()*portTICK_RATE_MS + randomizePeriod(periodMs);
+	}
+	else
+	{
+		objEntry->timeToNextUpdateMs = PERIODIC_DISABLED;
+	}
+	heapUpdate(objEntry);
+	// Release lock
+	xSemaphoreGiveRecursive(mutex);
+	return 0;
+}
+
+/**
+ * Find a periodic event, must be called with the lock held.
+ * \return The periodic event or NULL if it is not registered
+ */
+static PeriodicObjectList* findPeriodic(UAVObjEvent* ev, UAVObjEventCallback cb, xQueueHandle queue)
+{
+	for (uint16_t n = 0; n < heapSize; ++n)
 	{
+		PeriodicObjectList* objEntry = heap[n];
 		if (objEntry->evInfo.cb == cb &&
 			objEntry->evInfo.queue == queue &&
 			objEntry->evInfo.ev.obj == ev->obj &&
 			objEntry->evInfo.ev.instId == ev->instId &&
 			objEntry->evInfo.ev.event == ev->event)
 		{
-			// Object found, update period
-			objEntry->updatePeriodMs = periodMs;
-			objEntry->timeToNextUpdateMs = randomizePeriod(periodMs); // avoid bunching of updates
-			// Release lock
-			xSemaphoreGiveRecursive(mutex);
-			return 0;
+			return objEntry;
 		}
 	}
-    // If this point is reached the object was not found
-	xSemaphoreGiveRecursive(mutex);
-    return -1;
+	return NULL;
 }
 
 /**
@@ -322,54 +371,137 @@ static int32_t processPeriodicUpdates()
 {
 	PeriodicObjectList* objEntry;
 	int32_t timeNow;
-    int32_t timeToNextUpdate;
-    int32_t offset;
+	int32_t timeToNextUpdate;
+	int32_t latency;
 
 	// Get lock
 	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
-    // Iterate through each object and update its timer, if zero then transmit object.
-    // Also calculate smallest delay to next update.
-    timeToNextUpdate = xTaskGetTickCount()*portTICK_RATE_MS + MAX_UPDATE_PERIOD_MS;
-    LL_FOREACH(objList, objEntry)
-    {
-        // If object is configured for periodic updates
-        if (objEntry->updatePeriodMs > 0)
-        {
-            // Check if time for the next update
-        	timeNow = xTaskGetTickCount()*portTICK_RATE_MS;
-            if (objEntry->timeToNextUpdateMs <= timeNow)
-            {
-                // Reset timer
-            	offset = ( timeNow - objEntry->timeToNextUpdateMs ) % objEntry->updatePeriodMs;
-            	objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - offset;
-    			// Invoke callback, if one
-    			if ( objEntry->evInfo.cb != 0)
-    			{
-    				objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
-    			}
-    			// Push event to queue, if one
-    			if ( objEntry->evInfo.queue != 0)
-    			{
-    				if ( xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE ) // do not block if queue is full
-    				{
-						if (objEntry->evInfo.ev.obj != NULL)
-							stats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
-    					++stats.eventErrors;
-    				}
-    			}
-            }
-            // Update minimum delay
-            if (objEntry->timeToNextUpdateMs < timeToNextUpdate)
-            {
-            	timeToNextUpdate = objEntry->timeToNextUpdateMs;
-            }
-        }
-    }
-
-    // Done
-    xSemaphoreGiveRecursive(mutex);
-    return timeToNextUpdate;
+	// Dispatch the events that are due, the earliest one is always at the top of the heap
+	timeNow = xTaskGetTickCount()*portTICK_RATE_MS;
+	while (heapSize > 0 && heap[0]->timeToNextUpdateMs <= timeNow)
+	{
+		objEntry = heap[0];
+
+		// Reset timer, skipping any updates that were missed
+		latency = timeNow - objEntry->timeToNextUpdateMs;
+		objEntry->timeToNextUpdateMs = timeNow + objEntry->updatePeriodMs - latency % objEntry->updatePeriodMs;
+		heapDown(0);
+
+		// Invoke callback, if one
+		if ( objEntry->evInfo.cb != 0)
+		{
+			objEntry->evInfo.cb(&objEntry->evInfo.ev); // the function is expected to copy the event information
+		}
+		// Push event to queue, if one
+		if ( objEntry->evInfo.queue != 0)
+		{
+			if ( xQueueSend(objEntry->evInfo.queue, &objEntry->evInfo.ev, 0) != pdTRUE ) // do not block if queue is full
+			{
+				if (objEntry->evInfo.ev.obj != NULL)
+					stats.lastErrorID = UAVObjGetID(objEntry->evInfo.ev.obj);
+				++stats.eventErrors;
+			}
+		}
+
+		// Callbacks take time, so check against the current time for the next event
+		timeNow = xTaskGetTickCount()*portTICK_RATE_MS;
+	}
+
+	// Wait for the next event, but wake up at least every MAX_UPDATE_PERIOD_MS
+	timeToNextUpdate = timeNow + MAX_UPDATE_PERIOD_MS;
+	if (heapSize > 0 && heap[0]->timeToNextUpdateMs < timeToNextUpdate)
+	{
+		timeToNextUpdate = heap[0]->timeToNextUpdateMs;
+	}
+
+	// Done
+	xSemaphoreGiveRecursive(mutex);
+	return timeToNextUpdate;
+}
+
+/**
+ * Add a periodic event to the heap, growing the heap if needed.
+ * \return Success (0), failure (-1)
+ */
+static int32_t heapInsert(PeriodicObjectList* entry)
+{
+	if (heapSize == heapCapacity)
+	{
+		uint16_t newCapacity = heapCapacity ? 2 * heapCapacity : PERIODIC_HEAP_INITIAL_SIZE;
+		PeriodicObjectList** newHeap = (PeriodicObjectList**)pvPortMalloc(newCapacity * sizeof(PeriodicObjectList*));
+		if (newHeap == NULL)
+		{
+			return -1;
+		}
+		if (heap != NULL)
+		{
+			memcpy(newHeap, heap, heapSize * sizeof(PeriodicObjectList*));
+			vPortFree(heap);
+		}
+		heap = newHeap;
+		heapCapacity = newCapacity;
+	}
+
+	entry->heapIndex = heapSize;
+	heap[heapSize++] = entry;
+	heapUp(entry->heapIndex);
+	return 0;
+}
+
+/**
+ * Restore the heap order after the update time of an event changed.
+ */
+static void heapUpdate(PeriodicObjectList* entry)
+{
+	heapUp(entry->heapIndex);
+	heapDown(entry->heapIndex);
+}
+
+/**
+ * Move an event towards the top of the heap until its parent is due earlier.
+ */
+static void heapUp(uint16_t index)
+{
+	PeriodicObjectList* entry = heap[index];
+	while (index > 0)
+	{
+		uint16_t parent = (index - 1) / 2;
+		if (heap[parent]->timeToNextUpdateMs <= entry->timeToNextUpdateMs)
+		{
+			break;
+		}
+		heap[index] = heap[parent];
+		heap[index]->heapIndex = index;
+		index = parent;
+	}
+	heap[index] = entry;
+	entry->heapIndex = index;
+}
+
+/**
+ * Move an event towards the bottom of the heap until its children are due later.
+ */
+static void heapDown(uint16_t index)
+{
+	PeriodicObjectList* entry = heap[index];
+	while (2 * index + 1 < heapSize)
+	{
+		uint16_t child = 2 * index + 1;
+		if (child + 1 < heapSize && heap[child + 1]->timeToNextUpdateMs < heap[child]->timeToNextUpdateMs)
+		{
+			++child;
+		}
+		if (entry->timeToNextUpdateMs <= heap[child]->timeToNextUpdateMs)
+		{
+			break;
+		}
+		heap[index] = heap[child];
+		heap[index]->heapIndex = index;
+		index = child;
+	}
+	heap[index] = entry;
+	entry->heapIndex = index;
 }
 
 /**
@@ -31,4 +31,17 @@ void UAVObjectsInitializeAll();
 
 #define UAVOBJECTS_LARGEST $(SIZECALCULATION)
 
+/* IDs of all objects in increasing order, used by UAVObjGetByID */
+#define UAVOBJECTS_COUNT $(OBJCOUNT)
+#define UAVOBJECTS_IDS { \
+$(OBJIDS)}
+
+/* Offsets of the fields in the data of each object, in the order of the IDs.
+ * The fields of the object at position n in UAVOBJECTS_IDS start at position
+ * n of UAVOBJECTS_FIELDS_INDEX in UAVOBJECTS_FIELD_OFFSETS. */
+#define UAVOBJECTS_FIELDS_INDEX { \
+$(OBJFIELDSINDEX)}
+#define UAVOBJECTS_FIELD_OFFSETS { \
+$(OBJFIELDOFFSETS)}
+
 #endif // UAVOBJECTSINIT_H
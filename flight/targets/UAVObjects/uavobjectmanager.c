@@ -33,6 +33,7 @@
 
 #include "openpilot.h"
 #include "pios_struct_helper.h"
+#include "uavobjectsinit.h"
 
 // Constants
 
@@ -40,6 +41,7 @@
 
 // Macros
 #define SET_BITS(var, shift, value, mask) var = (var & ~(mask << shift)) | (value << shift);
+#define COMPILER_BARRIER() __asm__ __volatile__ ("" : : : "memory")
 
 /**
  * List of event queues and the eventmask associated with the queue.
@@ -58,11 +60,12 @@ struct ObjectEventEntry {
 /*
   MetaInstance   == [UAVOBase [UAVObjMetadata]]
   SingleInstance == [UAVOBase [UAVOData [InstanceData]]]
-  MultiInstance  == [UAVOBase [UAVOData [NumInstances [InstanceData0 [next]]]]
-                                                  ____________________/
-                                                  \-->[InstanceData1 [next]]
-                                                  _________...________/
-                                                  \-->[InstanceDataN [next]]
+  MultiInstance  == [UAVOBase [UAVOData [NumInstances [Chunks[0..7] [InstanceData0]]]]]
+                                                     |
+                                                     \-->[InstanceData1 .. InstanceData4]
+                                                     |
+                                                     \-->[InstanceData5 .. InstanceData12]
+                                                     ...
  */
 
 /*
@@ -81,6 +84,12 @@ struct UAVOBase {
 		bool isSettings    : 1;
 	} flags;
 
+	/*
+	 * Incremented before and after every write of the instance data,
+	 * readers retry their copy when it changed (see readData)
+	 */
+	volatile uint16_t seq;
+
 } __attribute__((packed));
 
 /* Augmented type for Meta UAVO */
@@ -113,22 +122,23 @@ struct UAVOSingle {
 	 */
 } __attribute__((packed));
 
-/* Part of a linked list of instances chained off of a multi instance UAVO. */
-struct UAVOMultiInst {
-	struct UAVOMultiInst * next;
-	uint8_t                instance[];
-	/* 
-	 * Additional space will be malloc'd here to hold the
-	 * the data for this instance.
-	 */
-} __attribute__((packed));
+/*
+ * Instances after the first one of a multi instance UAVO are allocated in
+ * chunks, chunk n holds INSTANCE_CHUNK_SIZE << n instances. Chunks never
+ * move once allocated and 8 chunks hold 1020 instances, which is more than
+ * UAVOBJ_MAX_INSTANCES.
+ */
+#define INSTANCE_CHUNK_SHIFT 2
+#define INSTANCE_CHUNK_SIZE (1 << INSTANCE_CHUNK_SHIFT)
+#define INSTANCE_NUM_CHUNKS 8
 
 /* Augmented type for Multi Instance Data UAVO */
 struct UAVOMulti {
 	struct UAVOData        uavo;
 
 	uint16_t               num_instances;
-	struct UAVOMultiInst   instance0;
+	uint8_t *              chunks[INSTANCE_NUM_CHUNKS];
+	uint8_t                instance0[];
 	/*
 	 * Additional space will be malloc'd here to hold the
 	 * the data for instance 0.
@@ -145,7 +155,6 @@ struct UAVOMulti {
 
 /** all information about instances are dependant on object type **/
 #define ObjSingleInstanceDataOffset(obj) ((void*)(&(( (struct UAVOSingle*)obj )->instance0)))
-#define InstanceDataOffset(inst) ((void*)&(( (struct UAVOMultiInst*)inst )->instance))
 #define InstanceData(instance) (void*)instance
 
 // Private functions
@@ -153,10 +162,16 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 			UAVObjEventType event);
 static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId);
 static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId);
+static void instanceLocation(uint16_t instId, uint8_t * chunk, uint16_t * index);
+static int32_t objectIndex(uint32_t id);
 static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
 			UAVObjEventCallback cb, uint8_t eventMask);
 static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue,
 			UAVObjEventCallback cb);
+static void readData(struct UAVOBase * obj, void * dataOut, const void * data,
+			uint32_t size);
+static void writeData(struct UAVOBase * obj, void * data, const void * dataIn,
+			uint32_t size);
 
 #if defined(PIOS_INCLUDE_SDCARD)
 static void objectFilename(UAVObjHandle obj_handle, uint8_t * filename);
@@ -166,6 +181,14 @@ static void customSPrintf(uint8_t * buffer, uint8_t * format, ...);
 // Private variables
 static struct UAVOData * uavo_list;
 static xSemaphoreHandle mutex;
+
+/* IDs of all objects known to the generator in increasing order, and the
+ * registered objects at the same position */
+static const uint32_t uavo_ids[UAVOBJECTS_COUNT] = UAVOBJECTS_IDS;
+static struct UAVOData * uavo_index[UAVOBJECTS_COUNT];
+/* Offsets of the fields of the objects, see UAVObjGetFieldOffsets() */
+static const uint16_t uavo_fields_index[UAVOBJECTS_COUNT + 1] = UAVOBJECTS_FIELDS_INDEX;
+static const uint16_t uavo_field_offsets[] = UAVOBJECTS_FIELD_OFFSETS;
 static const UAVObjMetadata defMetadata = {
 	.flags = (ACCESS_READWRITE << UAVOBJ_ACCESS_SHIFT |
 		ACCESS_READWRITE << UAVOBJ_GCS_ACCESS_SHIFT |
@@ -189,6 +212,7 @@ int32_t UAVObjInitialize()
 {
 	// Initialize variables
 	uavo_list = NULL;
+	memset(uavo_index, 0, sizeof(uavo_index));
 	memset(&stats, 0, sizeof(UAVObjStats));
 
 	// Create mutex
@@ -283,6 +307,7 @@ static struct UAVOData * UAVObjAllocMulti(uint32_t num_bytes)
 
 	/* Set up the type-specific part of the UAVO */
 	uavo_multi->num_instances = 1;
+	memset(uavo_multi->chunks, 0, sizeof(uavo_multi->chunks));
 
 	/* Clear the instance data carried in the UAVO */
 	memset (&(uavo_multi->instance0), 0, num_bytes);
@@ -352,6 +377,11 @@ UAVObjHandle UAVObjRegister(uint32_t id,
 	if (uavo_data->base.flags.isSettings)
 		UAVObjLoad((UAVObjHandle) uavo_data, 0);
 
+	/* Make the object visible to UAVObjGetByID, which does not lock */
+	int32_t index = objectIndex(id);
+	if (index >= 0)
+		uavo_index[index] = uavo_data;
+
 	// fire events for outer object and its embedded meta object
 	UAVObjInstanceUpdated((UAVObjHandle) uavo_data, 0);
 	UAVObjInstanceUpdated((UAVObjHandle) &(uavo_data->metaObj), 0);
@@ -370,10 +400,22 @@ UAVObjHandle UAVObjGetByID(uint32_t id)
 {
 	UAVObjHandle * found_obj = (UAVObjHandle *) NULL;
 
+	// Objects known at compile time are found in the ID table, metaobjects
+	// have the ID of their parent plus one
+	int32_t index = objectIndex(id & ~1);
+	if (index >= 0) {
+		struct UAVOData * obj = uavo_index[index];
+		if (obj == NULL)
+			return NULL;
+		if (obj->id == id)
+			return (UAVObjHandle) obj;
+		return (UAVObjHandle) &(obj->metaObj);
+	}
+
 	// Get lock
 	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 
-	// Look for object
+	// Look for any other object
 	struct UAVOData * tmp_obj;
 	LL_FOREACH(uavo_list, tmp_obj) {
 		if (tmp_obj->id == id) {
@@ -416,6 +458,28 @@ uint32_t UAVObjGetID(UAVObjHandle obj_handle)
 	}
 }
 
+/**
+ * Get the offsets of the fields in the object's data, as generated from the
+ * object definition. Fields with several elements are a single field.
+ * \param[in] obj The object handle
+ * \param[out] offsets Set to the offset of every field in increasing order
+ * \return The number of fields or -1 for metaobjects and objects the generator does not know
+ */
+int32_t UAVObjGetFieldOffsets(UAVObjHandle obj, const uint16_t ** offsets)
+{
+	PIOS_Assert(obj);
+
+	if (UAVObjIsMetaobject(obj))
+		return -1;
+
+	int32_t index = objectIndex(UAVObjGetID(obj));
+	if (index < 0)
+		return -1;
+
+	*offsets = &uavo_field_offsets[uavo_fields_index[index]];
+	return uavo_fields_index[index + 1] - uavo_fields_index[index];
+}
+
 /**
  * Get the number of bytes of the object's data (for one instance)
  * \param[in] obj The object handle
@@ -584,16 +648,11 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId,
 {
 	PIOS_Assert(obj_handle);
 
-	// Lock
-	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-	int32_t rc = -1;
-
 	if (UAVObjIsMetaobject(obj_handle)) {
 		if (instId != 0) {
-			goto unlock_exit;
+			return -1;
 		}
-		memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle), dataIn, MetaNumBytes);
+		writeData((struct UAVOBase *)obj_handle, MetaDataPtr((struct UAVOMeta *)obj_handle), dataIn, MetaNumBytes);
 	} else {
 		struct UAVOData *obj;
 		InstanceHandle instEntry;
@@ -606,22 +665,23 @@ int32_t UAVObjUnpack(UAVObjHandle obj_handle, uint16_t instId,
 
 		// If the instance does not exist create it and any other instances before it
 		if (instEntry == NULL) {
-			instEntry = createInstance(obj, instId);
+			xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
+			instEntry = getInstance(obj, instId);
 			if (instEntry == NULL) {
-				goto unlock_exit;
+				instEntry = createInstance(obj, instId);
+			}
+			xSemaphoreGiveRecursive(mutex);
+			if (instEntry == NULL) {
+				return -1;
 			}
 		}
 		// Set the data
-		memcpy(InstanceData(instEntry), dataIn, obj->instance_size);
+		writeData((struct UAVOBase *)obj_handle, InstanceData(instEntry), dataIn, obj->instance_size);
 	}
 
 	// Fire event
 	sendEvent((struct UAVOBase*)obj_handle, instId, EV_UNPACKED);
-	rc = 0;
-
-unlock_exit:
-	xSemaphoreGiveRecursive(mutex);
-	return rc;
+	return 0;
 }
 
 /**
@@ -635,16 +695,11 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t * dataOut)
 {
 	PIOS_Assert(obj_handle);
 
-	// Lock
-	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-	int32_t rc = -1;
-
 	if (UAVObjIsMetaobject(obj_handle)) {
 		if (instId != 0) {
-			goto unlock_exit;
+			return -1;
 		}
-		memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
+		readData((struct UAVOBase *)obj_handle, dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
 	} else {
 		struct UAVOData *obj;
 		InstanceHandle instEntry;
@@ -655,17 +710,13 @@ int32_t UAVObjPack(UAVObjHandle obj_handle, uint16_t instId, uint8_t * dataOut)
 		// Get the instance
 		instEntry = getInstance(obj, instId);
 		if (instEntry == NULL) {
-			goto unlock_exit;
+			return -1;
 		}
 		// Pack data
-		memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
+		readData((struct UAVOBase *)obj_handle, dataOut, InstanceData(instEntry), obj->instance_size);
 	}
 
-	rc = 0;
-
-unlock_exit:
-	xSemaphoreGiveRecursive(mutex);
-	return rc;
+	return 0;
 }
 
 #if defined(PIOS_INCLUDE_SDCARD)
@@ -1252,16 +1303,11 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 {
 	PIOS_Assert(obj_handle);
 
-	// Lock
-	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-	int32_t rc = -1;
-
 	if (UAVObjIsMetaobject(obj_handle)) {
 		if (instId != 0) {
-			goto unlock_exit;
+			return -1;
 		}
-		memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle), dataIn, MetaNumBytes);
+		writeData((struct UAVOBase *)obj_handle, MetaDataPtr((struct UAVOMeta *)obj_handle), dataIn, MetaNumBytes);
 	} else {
 		struct UAVOData *obj;
 		InstanceHandle instEntry;
@@ -1271,24 +1317,20 @@ int32_t UAVObjSetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 
 		// Check access level
 		if (UAVObjReadOnly(obj_handle)) {
-			goto unlock_exit;
+			return -1;
 		}
 		// Get instance information
 		instEntry = getInstance(obj, instId);
 		if (instEntry == NULL) {
-			goto unlock_exit;
+			return -1;
 		}
 		// Set data
-		memcpy(InstanceData(instEntry), dataIn, obj->instance_size);
+		writeData((struct UAVOBase *)obj_handle, InstanceData(instEntry), dataIn, obj->instance_size);
 	}
 
 	// Fire event
 	sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED);
-	rc = 0;
-
-unlock_exit:
-	xSemaphoreGiveRecursive(mutex);
-	return rc;
+	return 0;
 }
 
 /**
@@ -1302,24 +1344,19 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
 {
 	PIOS_Assert(obj_handle);
 
-	// Lock
-	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-	int32_t rc = -1;
-
 	if (UAVObjIsMetaobject(obj_handle)) {
 		// Get instance information
 		if (instId != 0) {
-			goto unlock_exit;
+			return -1;
 		}
 
 		// Check for overrun
 		if ((size + offset) > MetaNumBytes) {
-			goto unlock_exit;
+			return -1;
 		}
 
 		// Set data
-		memcpy(MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, dataIn, size);
+		writeData((struct UAVOBase *)obj_handle, (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, dataIn, size);
 	} else {
 		struct UAVOData * obj;
 		InstanceHandle instEntry;
@@ -1329,32 +1366,28 @@ int32_t UAVObjSetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, con
 
 		// Check access level
 		if (UAVObjReadOnly(obj_handle)) {
-			goto unlock_exit;
+			return -1;
 		}
 
 		// Get instance information
 		instEntry = getInstance(obj, instId);
 		if (instEntry == NULL) {
-			goto unlock_exit;
+			return -1;
 		}
 
 		// Check for overrun
 		if ((size + offset) > obj->instance_size) {
-			goto unlock_exit;
+			return -1;
 		}
 
 		// Set data
-		memcpy(InstanceData(instEntry) + offset, dataIn, size);
+		writeData((struct UAVOBase *)obj_handle, InstanceData(instEntry) + offset, dataIn, size);
 	}
 
 
 	// Fire event
 	sendEvent((struct UAVOBase *)obj_handle, instId, EV_UPDATED);
-	rc = 0;
-
-unlock_exit:
-	xSemaphoreGiveRecursive(mutex);
-	return rc;
+	return 0;
 }
 
 /**
@@ -1369,18 +1402,13 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 {
 	PIOS_Assert(obj_handle);
 
-	// Lock
-	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-	int32_t rc = -1;
-
 	if (UAVObjIsMetaobject(obj_handle)) {
 		// Get instance information
 		if (instId != 0) {
-			goto unlock_exit;
+			return -1;
 		}
 		// Set data
-		memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
+		readData((struct UAVOBase *)obj_handle, dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle), MetaNumBytes);
 	} else {
 		struct UAVOData *obj;
 		InstanceHandle instEntry;
@@ -1391,17 +1419,13 @@ int32_t UAVObjGetInstanceData(UAVObjHandle obj_handle, uint16_t instId,
 		// Get instance information
 		instEntry = getInstance(obj, instId);
 		if (instEntry == NULL) {
-			goto unlock_exit;
+			return -1;
 		}
 		// Set data
-		memcpy(dataOut, InstanceData(instEntry), obj->instance_size);
+		readData((struct UAVOBase *)obj_handle, dataOut, InstanceData(instEntry), obj->instance_size);
 	}
 
-	rc = 0;
-
-unlock_exit:
-	xSemaphoreGiveRecursive(mutex);
-	return rc;
+	return 0;
 }
 
 /**
@@ -1415,24 +1439,19 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 {
 	PIOS_Assert(obj_handle);
 
-	// Lock
-	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
-	int32_t rc = -1;
-
 	if (UAVObjIsMetaobject(obj_handle)) {
 		// Get instance information
 		if (instId != 0) {
-			goto unlock_exit;
+			return -1;
 		}
 
 		// Check for overrun
 		if ((size + offset) > MetaNumBytes) {
-			goto unlock_exit;
+			return -1;
 		}
 
 		// Set data
-		memcpy(dataOut, MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, size);
+		readData((struct UAVOBase *)obj_handle, dataOut, (uint8_t *)MetaDataPtr((struct UAVOMeta *)obj_handle) + offset, size);
 	} else {
 		struct UAVOData * obj;
 		InstanceHandle instEntry;
@@ -1443,23 +1462,19 @@ int32_t UAVObjGetInstanceDataField(UAVObjHandle obj_handle, uint16_t instId, voi
 		// Get instance information
 		instEntry = getInstance(obj, instId);
 		if (instEntry == NULL) {
-			goto unlock_exit;
+			return -1;
 		}
 
 		// Check for overrun
 		if ((size + offset) > obj->instance_size) {
-			goto unlock_exit;
+			return -1;
 		}
 		
 		// Set data
-		memcpy(dataOut, InstanceData(instEntry) + offset, size);
+		readData((struct UAVOBase *)obj_handle, dataOut, InstanceData(instEntry) + offset, size);
 	}
 
-	rc = 0;
-
-unlock_exit:
-	xSemaphoreGiveRecursive(mutex);
-	return rc;
+	return 0;
 }
 
 /**
@@ -1477,11 +1492,8 @@ int32_t UAVObjSetMetadata(UAVObjHandle obj_handle, const UAVObjMetadata * dataIn
 		return -1;
 	}
 
-	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
 	UAVObjSetData((UAVObjHandle) MetaObjectPtr((struct UAVOData *)obj_handle), dataIn);
 
-	xSemaphoreGiveRecursive(mutex);
 	return 0;
 }
 
@@ -1495,9 +1507,6 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata * dataOut)
 {
 	PIOS_Assert(obj_handle);
 
-	// Lock
-	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
-
 	// Get metadata
 	if (UAVObjIsMetaobject(obj_handle)) {
 		memcpy(dataOut, &defMetadata, sizeof(UAVObjMetadata));
@@ -1506,8 +1515,6 @@ int32_t UAVObjGetMetadata(UAVObjHandle obj_handle, UAVObjMetadata * dataOut)
 			dataOut);
 	}
 
-	// Unlock
-	xSemaphoreGiveRecursive(mutex);
 	return 0;
 }
 
@@ -1747,9 +1754,7 @@ void UAVObjRequestUpdate(UAVObjHandle obj_handle)
 void UAVObjRequestInstanceUpdate(UAVObjHandle obj_handle, uint16_t instId)
 {
 	PIOS_Assert(obj_handle);
-	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 	sendEvent((struct UAVOBase *) obj_handle, instId, EV_UPDATE_REQ);
-	xSemaphoreGiveRecursive(mutex);
 }
 
 /**
@@ -1769,9 +1774,7 @@ void UAVObjUpdated(UAVObjHandle obj_handle)
 void UAVObjInstanceUpdated(UAVObjHandle obj_handle, uint16_t instId)
 {
 	PIOS_Assert(obj_handle);
-	xSemaphoreTakeRecursive(mutex, portMAX_DELAY);
 	sendEvent((struct UAVOBase *) obj_handle, instId, EV_UPDATED_MANUAL);
-	xSemaphoreGiveRecursive(mutex);
 }
 
 /**
@@ -1797,8 +1800,51 @@ void UAVObjIterate(void (*iterator) (UAVObjHandle obj))
 	xSemaphoreGiveRecursive(mutex);
 }
 
+/**
+ * Copy data out of an object without taking a lock. If a writer updated the
+ * object while the copy was in progress the copy is repeated, so the caller
+ * always gets a consistent snapshot.
+ */
+static void readData(struct UAVOBase * obj, void * dataOut, const void * data,
+			uint32_t size)
+{
+	uint16_t seq;
+
+	do {
+		seq = obj->seq;
+		if (seq & 1) {
+			// Update in progress, let the writer finish first
+			taskYIELD();
+			continue;
+		}
+		COMPILER_BARRIER();
+		memcpy(dataOut, data, size);
+		COMPILER_BARRIER();
+	} while ((seq & 1) || obj->seq != seq);
+}
+
+/**
+ * Copy data into an object. Writers run with the scheduler suspended, which
+ * serializes them without a mutex and means a reader can never run in the
+ * middle of an update. Readers that were preempted by the writer see the
+ * sequence number change and retry.
+ */
+static void writeData(struct UAVOBase * obj, void * data, const void * dataIn,
+			uint32_t size)
+{
+	vTaskSuspendAll();
+	obj->seq++;
+	COMPILER_BARRIER();
+	memcpy(data, dataIn, size);
+	COMPILER_BARRIER();
+	obj->seq++;
+	xTaskResumeAll();
+}
+
 /**
  * Send a triggered event to all event queues registered on the object.
+ * This is called without any lock held, the event list is only ever
+ * appended to and disconnectObj() only clears entries in place.
  */
 static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 			UAVObjEventType triggered_event)
@@ -1813,21 +1859,29 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
 	// Go through each object and push the event message in the queue (if event is activated for the queue)
 	struct ObjectEventEntry *event;
 	LL_FOREACH(obj->next_event, event) {
-		if (event->eventMask == 0
-			|| (event->eventMask & triggered_event) != 0) {
+		// Take a consistent copy of the entry, disconnectObj() clears
+		// it with the scheduler suspended in the same way
+		vTaskSuspendAll();
+		uint8_t eventMask = event->eventMask;
+		xQueueHandle queue = event->queue;
+		UAVObjEventCallback cb = event->cb;
+		xTaskResumeAll();
+
+		if (eventMask == 0
+			|| (eventMask & triggered_event) != 0) {
 			// Send to queue if a valid queue is registered
-			if (event->queue) {
+			if (queue) {
 				// will not block
-				if (xQueueSend(event->queue, &msg, 0) != pdTRUE) {
+				if (xQueueSend(queue, &msg, 0) != pdTRUE) {
 					stats.lastQueueErrorID = UAVObjGetID(obj);
 					++stats.eventQueueErrors;
 				}
 			}
 
 			// Invoke callback (from event task) if a valid one is registered
-			if (event->cb) {
+			if (cb) {
 				// invoke callback from the event task, will not block
-				if (EventCallbackDispatch(&msg, event->cb) != pdTRUE) {
+				if (EventCallbackDispatch(&msg, cb) != pdTRUE) {
 					++stats.eventCallbackErrors;
 					stats.lastCallbackErrorID = UAVObjGetID(obj);
 				}
@@ -1843,7 +1897,7 @@ static int32_t sendEvent(struct UAVOBase * obj, uint16_t instId,
  */
 static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 {
-	struct UAVOMultiInst *instEntry;
+	struct UAVOMulti *uavo_multi = (struct UAVOMulti *) obj;
 
 	/* Don't allow more than one instance for single instance objects */
 	if (UAVObjIsSingleInstance(&(obj->base))) {
@@ -1861,27 +1915,71 @@ static InstanceHandle createInstance(struct UAVOData * obj, uint16_t instId)
 		return NULL;
 	}
 
-	// Create any missing instances (all instance IDs must be sequential)
-	for (uint16_t n = UAVObjGetNumInstances(&(obj->base)); n < instId; ++n) {
-		if (createInstance(obj, n) == NULL) {
-			return NULL;
+	// Create the instance and any missing ones before it (all instance IDs must be sequential)
+	for (uint16_t n = uavo_multi->num_instances; n <= instId; ++n) {
+		uint8_t chunk;
+		uint16_t index;
+		instanceLocation(n, &chunk, &index);
+
+		// The first instance in a chunk allocates the storage for all of them
+		if (index == 0) {
+			uint32_t chunk_bytes = (INSTANCE_CHUNK_SIZE << chunk) * obj->instance_size;
+			uint8_t *chunk_data = (uint8_t *) pvPortMalloc(chunk_bytes);
+			if (!chunk_data)
+				return NULL;
+			memset(chunk_data, 0, chunk_bytes);
+			uavo_multi->chunks[chunk] = chunk_data;
 		}
+
+		// Readers do not take the lock, only make the instance visible once it is allocated
+		COMPILER_BARRIER();
+		uavo_multi->num_instances = n + 1;
+
+		// Fire event
+		UAVObjInstanceUpdated((UAVObjHandle) obj, n);
 	}
 
-	/* Create the actual instance */
-	instEntry = (struct UAVOMultiInst *) pvPortMalloc(sizeof(struct UAVOMultiInst)+obj->instance_size);
-	if (!instEntry)
-		return NULL;
-	memset(InstanceDataOffset(instEntry), 0, obj->instance_size);
-	LL_APPEND(( (struct UAVOMulti*)obj )->instance0.next, instEntry);
+	// Done
+	return getInstance(obj, instId);
+}
 
-	( (struct UAVOMulti*)obj )->num_instances++;
+/**
+ * Find where an instance of a multi instance object is stored.
+ * \param[in] instId The instance ID, must be larger than 0
+ * \param[out] chunk The chunk holding the instance
+ * \param[out] index The position of the instance in the chunk
+ */
+static void instanceLocation(uint16_t instId, uint8_t * chunk, uint16_t * index)
+{
+	// Count as if a chunk of INSTANCE_CHUNK_SIZE came before the first one,
+	// then the chunk is given by the highest bit set
+	uint32_t pos = instId - 1 + INSTANCE_CHUNK_SIZE;
 
-	// Fire event
-	UAVObjInstanceUpdated((UAVObjHandle) obj, instId);
+	*chunk = (31 - __builtin_clz(pos)) - INSTANCE_CHUNK_SHIFT;
+	*index = pos - (INSTANCE_CHUNK_SIZE << *chunk);
+}
 
-	// Done
-	return InstanceDataOffset(instEntry);
+/**
+ * Find the position of an object in the table of known object IDs
+ * \param[in] id The object ID
+ * \return The position in uavo_ids or -1 if the ID is not known
+ */
+static int32_t objectIndex(uint32_t id)
+{
+	int32_t low = 0;
+	int32_t high = UAVOBJECTS_COUNT - 1;
+
+	while (low <= high) {
+		int32_t mid = (low + high) / 2;
+		if (uavo_ids[mid] < id)
+			low = mid + 1;
+		else if (uavo_ids[mid] > id)
+			high = mid - 1;
+		else
+			return mid;
+	}
+
+	return -1;
 }
 
 /**
@@ -1915,17 +2013,13 @@ static InstanceHandle getInstance(struct UAVOData * obj, uint16_t instId)
 		if (instId >= uavo_multi->num_instances)
 			return NULL;
 
-		// Look for specified instance ID
-		uint16_t instance = 0;
-		struct UAVOMultiInst *instEntry;
-		LL_FOREACH(&(uavo_multi->instance0), instEntry) {
-			if (instance++ == instId) {
-				/* Found it */
-				return &(instEntry->instance);
-			}
-		}
-		/* Instance was not found */
-		return NULL;
+		if (instId == 0)
+			return (&(uavo_multi->instance0));
+
+		uint8_t chunk;
+		uint16_t index;
+		instanceLocation(instId, &chunk, &index);
+		return (uavo_multi->chunks[chunk] + index * obj->instance_size);
 	}
 }
 
@@ -1953,6 +2047,18 @@ static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
 		}
 	}
 
+	// Reuse an entry that was disconnected before
+	LL_FOREACH(obj->next_event, event) {
+		if (event->queue == NULL && event->cb == NULL) {
+			vTaskSuspendAll();
+			event->queue = queue;
+			event->cb = cb;
+			event->eventMask = eventMask;
+			xTaskResumeAll();
+			return 0;
+		}
+	}
+
 	// Add queue to list
 	event =	(struct ObjectEventEntry *) pvPortMalloc(sizeof(struct ObjectEventEntry));
 	if (event == NULL) {
@@ -1961,6 +2067,7 @@ static int32_t connectObj(UAVObjHandle obj_handle, xQueueHandle queue,
 	event->queue = queue;
 	event->cb = cb;
 	event->eventMask = eventMask;
+	COMPILER_BARRIER();
 	LL_APPEND(obj->next_event, event);
 
 	// Done
@@ -1980,13 +2087,17 @@ static int32_t disconnectObj(UAVObjHandle obj_handle, xQueueHandle queue,
 	struct ObjectEventEntry *event;
 	struct UAVOBase *obj;
 
-	// Find queue and remove it
+	// Find queue and deactivate it. Events are sent without holding a lock,
+	// so the entry stays in the list and is reused by the next connect.
 	obj = (struct UAVOBase *) obj_handle;
 	LL_FOREACH(obj->next_event, event) {
 		if ((event->queue == queue
 				&& event->cb == cb)) {
-			LL_DELETE(obj->next_event, event);
-			vPortFree(event);
+			vTaskSuspendAll();
+			event->queue = NULL;
+			event->cb = NULL;
+			event->eventMask = 0;
+			xTaskResumeAll();
 			return 0;
 		}
 	}
@@ -55,6 +55,11 @@ typedef uint8_t uavtalk_checksum;
 #define UAVTALK_MAX_PAYLOAD_LENGTH      (UAVOBJECTS_LARGEST + 1)
 #define UAVTALK_MIN_PACKET_LENGTH       UAVTALK_MAX_HEADER_LENGTH + UAVTALK_CHECKSUM_LENGTH
 #define UAVTALK_MAX_PACKET_LENGTH       UAVTALK_MIN_PACKET_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH
+#define UAVTALK_MAX_PENDING_ACKS        4
+// Largest size field of a multi-object frame, keeps its payload below the limit every receiver checks
+#define UAVTALK_MAX_MULTI_SIZE          (UAVTALK_MIN_HEADER_LENGTH + UAVTALK_MAX_PAYLOAD_LENGTH - 1)
+#define UAVTALK_MAX_DELTA_OBJECTS       8
+#define UAVTALK_DELTA_KEYFRAME_INTERVAL 10
 
 typedef struct {
     UAVObjHandle obj;
@@ -72,6 +77,30 @@ typedef struct {
     uint16_t rxPacketLength;
 } UAVTalkInputProcessor;
 
+/**
+ * An acked object that was sent with UAVTalkSendObjectWindowed() and is
+ * waiting for its ack. Unused entries have obj set to NULL.
+ */
+typedef struct {
+    UAVObjHandle obj;
+    uint16_t instId;
+    uint8_t retriesRemaining;
+    uint16_t timeoutMs;
+    portTickType deadline;
+} UAVTalkPendingAck;
+
+/**
+ * Reference state of an object instance sent with UAVTalkSendObjectDelta(),
+ * which is the last keyframe that was sent. Unused entries have obj set to NULL.
+ */
+typedef struct {
+    UAVObjHandle obj;
+    uint16_t instId;
+    uint8_t updatesSinceKeyframe;
+    uint8_t keyframeCrc;
+    uint8_t *keyframe;
+} UAVTalkDeltaState;
+
 typedef struct {
     uint8_t canari;
     UAVTalkOutputStream outStream;
@@ -80,6 +109,13 @@ typedef struct {
     xSemaphoreHandle respSema;
     UAVObjHandle respObj;
     uint16_t respInstId;
+    xSemaphoreHandle windowSema;
+    UAVTalkPendingAck pending[UAVTALK_MAX_PENDING_ACKS];
+    uint8_t *batchBuffer;
+    uint16_t batchLength;
+    uint8_t batchCount;
+    UAVTalkDeltaState *delta;
+    uint8_t *deltaBuffer;
     UAVTalkStats stats;
     UAVTalkInputProcessor iproc;
     uint8_t *rxBuffer;
@@ -99,6 +135,8 @@ typedef struct {
 #define UAVTALK_TYPE_OBJ_ACK   (UAVTALK_TYPE_VER | 0x02)
 #define UAVTALK_TYPE_ACK       (UAVTALK_TYPE_VER | 0x03)
 #define UAVTALK_TYPE_NACK      (UAVTALK_TYPE_VER | 0x04)
+#define UAVTALK_TYPE_OBJ_MULTI (UAVTALK_TYPE_VER | 0x05)
+#define UAVTALK_TYPE_OBJ_DELTA (UAVTALK_TYPE_VER | 0x06)
 #define UAVTALK_TYPE_OBJ_TS       (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ)
 #define UAVTALK_TYPE_OBJ_ACK_TS   (UAVTALK_TIMESTAMPED | UAVTALK_TYPE_OBJ_ACK)
 
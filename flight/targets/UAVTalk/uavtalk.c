@@ -40,6 +40,12 @@ static int32_t sendSingleObject(UAVTalkConnectionData *connection, UAVObjHandle
 static int32_t sendNack(UAVTalkConnectionData *connection, uint32_t objId);
 static int32_t receiveObject(UAVTalkConnectionData *connection, uint8_t type, uint32_t objId, uint16_t instId, uint8_t* data, int32_t length);
 static void updateAck(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId);
+static int32_t sendWindowed(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t maxRetries);
+static int32_t processPendingAcks(UAVTalkConnectionData *connection);
+static int32_t sendBatched(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId);
+static int32_t flushBatch(UAVTalkConnectionData *connection);
+static int32_t sendDelta(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId);
+static UAVTalkDeltaState *getDeltaState(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId);
 
 /**
  * Initialize the UAVTalk library
@@ -66,6 +72,14 @@ UAVTalkConnection UAVTalkInitialize(UAVTalkOutputStream outputStream)
 	if (!connection->txBuffer) return 0;
 	vSemaphoreCreateBinary(connection->respSema);
 	xSemaphoreTake(connection->respSema, 0); // reset to zero
+	vSemaphoreCreateBinary(connection->windowSema);
+	xSemaphoreTake(connection->windowSema, 0); // reset to zero
+	memset(connection->pending, 0, sizeof(connection->pending));
+	connection->batchBuffer = NULL; // only allocated when batching is used
+	connection->batchLength = 0;
+	connection->batchCount = 0;
+	connection->delta = NULL; // only allocated when delta updates are used
+	connection->deltaBuffer = NULL;
 	UAVTalkResetStats( (UAVTalkConnection) connection );
 	return (UAVTalkConnection) connection;
 }
@@ -202,6 +216,172 @@ int32_t UAVTalkSendObject(UAVTalkConnection connectionHandle, UAVObjHandle obj,
 	}
 }
 
+/**
+ * Send the specified object through the telemetry link with an ack, without waiting for
+ * the ack. Up to UAVTALK_MAX_PENDING_ACKS objects can wait for their ack at the same time,
+ * so a batch of acked objects is not limited by the round trip time of the link.
+ * Objects that are not acked in time are sent again by UAVTalkProcessPendingAcks(),
+ * failures and retries are reported in the txErrors and txRetries statistics.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \param[in] timeoutMs Time to wait for the ack before sending the object again
+ * \param[in] maxRetries Number of times the object is sent again before giving up
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectWindowed(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t maxRetries)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle,connection,return -1);
+
+	// If all instances are requested and this is a single instance object, force instance ID to zero
+	if (instId == UAVOBJ_ALL_INSTANCES && UAVObjIsSingleInstance(obj))
+	{
+		instId = 0;
+	}
+
+	if (instId == UAVOBJ_ALL_INSTANCES)
+	{
+		// Every instance is acked separately
+		uint16_t numInst = UAVObjGetNumInstances(obj);
+		for (uint16_t n = 0; n < numInst; ++n)
+		{
+			if (sendWindowed(connection, obj, n, timeoutMs, maxRetries) != 0)
+			{
+				return -1;
+			}
+		}
+		return 0;
+	}
+	else
+	{
+		return sendWindowed(connection, obj, instId, timeoutMs, maxRetries);
+	}
+}
+
+/**
+ * Send again the objects sent with UAVTalkSendObjectWindowed() which were not acked in
+ * time, or drop them if they ran out of retries. Must be called periodically while
+ * objects are waiting for their ack.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return Time in ms until the next object times out, -1 if no object is waiting for an ack
+ */
+int32_t UAVTalkProcessPendingAcks(UAVTalkConnection connectionHandle)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle,connection,return -1);
+
+	xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+	int32_t timeToNext = processPendingAcks(connection);
+	xSemaphoreGiveRecursive(connection->lock);
+
+	return timeToNext;
+}
+
+/**
+ * Add the specified object to a multi-object frame instead of sending it in its own packet.
+ * The frame is sent when the next object does not fit anymore or on UAVTalkFlushBatch(),
+ * which saves the header, checksum and write of every packet but the first one.
+ * Batched objects are never acked. Only use this when the remote end understands
+ * UAVTALK_TYPE_OBJ_MULTI frames.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectBatched(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle,connection,return -1);
+
+	// If all instances are requested and this is a single instance object, force instance ID to zero
+	if (instId == UAVOBJ_ALL_INSTANCES && UAVObjIsSingleInstance(obj))
+	{
+		instId = 0;
+	}
+
+	int32_t ret = 0;
+	xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+	if (instId == UAVOBJ_ALL_INSTANCES)
+	{
+		uint16_t numInst = UAVObjGetNumInstances(obj);
+		for (uint16_t n = 0; n < numInst && ret == 0; ++n)
+		{
+			ret = sendBatched(connection, obj, n);
+		}
+	}
+	else
+	{
+		ret = sendBatched(connection, obj, instId);
+	}
+	xSemaphoreGiveRecursive(connection->lock);
+
+	return ret;
+}
+
+/**
+ * Send the multi-object frame built by UAVTalkSendObjectBatched(), if it holds any object.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkFlushBatch(UAVTalkConnection connectionHandle)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle,connection,return -1);
+
+	xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+	int32_t ret = flushBatch(connection);
+	xSemaphoreGiveRecursive(connection->lock);
+
+	return ret;
+}
+
+/**
+ * Send the specified object as a delta against the last keyframe sent for it. Only the
+ * fields that differ from the keyframe are sent, along with a mask of these fields and
+ * the checksum of the keyframe, so a receiver that missed the keyframe ignores the
+ * delta. A keyframe with all fields is sent every UAVTALK_DELTA_KEYFRAME_INTERVAL updates.
+ * Delta updates are never acked, only use this when the remote end understands
+ * UAVTALK_TYPE_OBJ_DELTA packets.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object to send
+ * \param[in] instId The instance ID or UAVOBJ_ALL_INSTANCES for all instances.
+ * \return 0 Success
+ * \return -1 Failure
+ */
+int32_t UAVTalkSendObjectDelta(UAVTalkConnection connectionHandle, UAVObjHandle obj, uint16_t instId)
+{
+	UAVTalkConnectionData *connection;
+	CHECKCONHANDLE(connectionHandle,connection,return -1);
+
+	// If all instances are requested and this is a single instance object, force instance ID to zero
+	if (instId == UAVOBJ_ALL_INSTANCES && UAVObjIsSingleInstance(obj))
+	{
+		instId = 0;
+	}
+
+	int32_t ret = 0;
+	xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+	if (instId == UAVOBJ_ALL_INSTANCES)
+	{
+		uint16_t numInst = UAVObjGetNumInstances(obj);
+		for (uint16_t n = 0; n < numInst && ret == 0; ++n)
+		{
+			ret = sendDelta(connection, obj, n);
+		}
+	}
+	else
+	{
+		ret = sendDelta(connection, obj, instId);
+	}
+	xSemaphoreGiveRecursive(connection->lock);
+
+	return ret;
+}
+
 /**
  * Send the specified object through the telemetry link with a timestamp.
  * \param[in] connection UAVTalkConnection to be used
@@ -379,7 +559,16 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 			iproc->obj = UAVObjGetByID(iproc->objId);
 			
 			// Determine data length
-			if (iproc->type == UAVTALK_TYPE_OBJ_REQ || iproc->type == UAVTALK_TYPE_ACK || iproc->type == UAVTALK_TYPE_NACK)
+			if (iproc->type == UAVTALK_TYPE_OBJ_MULTI || iproc->type == UAVTALK_TYPE_OBJ_DELTA)
+			{
+				// The rest of the frame is taken as is, the object ID was the one of the first object
+				// for multi-object frames and the instance ID is part of the data for deltas
+				iproc->obj = 0;
+				iproc->instanceLength = 0;
+				iproc->timestampLength = 0;
+				iproc->length = iproc->packet_size - iproc->rxPacketLength;
+			}
+			else if (iproc->type == UAVTALK_TYPE_OBJ_REQ || iproc->type == UAVTALK_TYPE_ACK || iproc->type == UAVTALK_TYPE_NACK)
 			{
 				iproc->length = 0;
 				iproc->instanceLength = 0;
@@ -422,6 +611,10 @@ UAVTalkRxState UAVTalkProcessInputStreamQuiet(UAVTalkConnection connectionHandle
 				// If this is a NACK, we skip to Checksum
 				iproc->state = UAVTALK_STATE_CS;
 			}
+			else if (iproc->type == UAVTALK_TYPE_OBJ_MULTI || iproc->type == UAVTALK_TYPE_OBJ_DELTA)
+			{
+				iproc->state = (iproc->length > 0) ? UAVTALK_STATE_DATA : UAVTALK_STATE_CS;
+			}
 			// Check if this is a single instance object (i.e. if the instance ID field is coming next)
 			else if ((iproc->obj != 0) && !UAVObjIsSingleInstance(iproc->obj))
 			{
@@ -803,6 +996,404 @@ static void updateAck(UAVTalkConnectionData *connection, UAVObjHandle obj, uint1
 		xSemaphoreGive(connection->respSema);
 		connection->respObj = 0;
 	}
+
+	// Release the window entry of an object sent with UAVTalkSendObjectWindowed()
+	for (uint8_t n = 0; n < UAVTALK_MAX_PENDING_ACKS; ++n)
+	{
+		if (connection->pending[n].obj == obj && connection->pending[n].instId == instId)
+		{
+			connection->pending[n].obj = 0;
+			xSemaphoreGive(connection->windowSema);
+			break;
+		}
+	}
+}
+
+/**
+ * Send a single instance of an object with an ack and add it to the window of objects
+ * waiting for their ack. Blocks while the window is full.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle to send
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \param[in] timeoutMs Time to wait for the ack before sending the object again
+ * \param[in] maxRetries Number of times the object is sent again before giving up
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t sendWindowed(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId, int32_t timeoutMs, uint8_t maxRetries)
+{
+	UAVTalkPendingAck *entry;
+	int32_t timeToNext;
+
+	while (1)
+	{
+		xSemaphoreTakeRecursive(connection->lock, portMAX_DELAY);
+
+		// If this instance is already waiting for an ack, the new data replaces the old one.
+		// Otherwise take a free entry.
+		entry = NULL;
+		for (uint8_t n = 0; n < UAVTALK_MAX_PENDING_ACKS; ++n)
+		{
+			if (connection->pending[n].obj == obj && connection->pending[n].instId == instId)
+			{
+				entry = &connection->pending[n];
+				break;
+			}
+			if (entry == NULL && connection->pending[n].obj == 0)
+			{
+				entry = &connection->pending[n];
+			}
+		}
+
+		if (entry != NULL)
+		{
+			if (sendSingleObject(connection, obj, instId, UAVTALK_TYPE_OBJ_ACK) != 0)
+			{
+				xSemaphoreGiveRecursive(connection->lock);
+				return -1;
+			}
+			entry->obj = obj;
+			entry->instId = instId;
+			entry->retriesRemaining = maxRetries;
+			entry->timeoutMs = timeoutMs;
+			entry->deadline = xTaskGetTickCount() + timeoutMs / portTICK_RATE_MS;
+			xSemaphoreGiveRecursive(connection->lock);
+			return 0;
+		}
+
+		// Window is full, wait for an ack or for the next timeout to free an entry
+		timeToNext = processPendingAcks(connection);
+		xSemaphoreGiveRecursive(connection->lock);
+		if (timeToNext > 0)
+		{
+			xSemaphoreTake(connection->windowSema, timeToNext / portTICK_RATE_MS);
+		}
+	}
+}
+
+/**
+ * Retransmit or drop the objects in the window which were not acked in time.
+ * Must be called with the connection locked.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return Time in ms until the next object times out, -1 if no object is waiting for an ack
+ */
+static int32_t processPendingAcks(UAVTalkConnectionData *connection)
+{
+	portTickType timeNow = xTaskGetTickCount();
+	int32_t timeToNext = -1;
+	int32_t remaining;
+
+	for (uint8_t n = 0; n < UAVTALK_MAX_PENDING_ACKS; ++n)
+	{
+		UAVTalkPendingAck *entry = &connection->pending[n];
+		if (entry->obj == 0)
+		{
+			continue;
+		}
+
+		remaining = (int32_t)(entry->deadline - timeNow);
+		if (remaining <= 0)
+		{
+			if (entry->retriesRemaining > 0)
+			{
+				// Only this object is sent again, the others in the window are not affected
+				--entry->retriesRemaining;
+				++connection->stats.txRetries;
+				sendSingleObject(connection, entry->obj, entry->instId, UAVTALK_TYPE_OBJ_ACK);
+				entry->deadline = timeNow + entry->timeoutMs / portTICK_RATE_MS;
+				remaining = entry->timeoutMs / portTICK_RATE_MS;
+			}
+			else
+			{
+				// Give up on this object
+				++connection->stats.txErrors;
+				entry->obj = 0;
+				continue;
+			}
+		}
+
+		if (timeToNext < 0 || remaining * portTICK_RATE_MS < timeToNext)
+		{
+			timeToNext = remaining * portTICK_RATE_MS;
+		}
+	}
+
+	return timeToNext;
+}
+
+/**
+ * Append a single instance of an object to the multi-object frame, sending the frame
+ * first if the object does not fit anymore. Must be called with the connection locked.
+ * The frame has the usual sync, type and size fields followed by one record per object,
+ * made of its object ID, its instance ID for multi instance objects and its data.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle to send
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t sendBatched(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId)
+{
+	uint16_t instanceLength = UAVObjIsSingleInstance(obj) ? 0 : 2;
+	uint16_t recordLength = 4 + instanceLength + UAVObjGetNumBytes(obj);
+	uint32_t objId;
+	uint8_t *record;
+
+	// Objects that can never share a frame are sent on their own
+	if (4 + recordLength > UAVTALK_MAX_MULTI_SIZE)
+	{
+		return sendSingleObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+	}
+
+	if (connection->batchBuffer == NULL)
+	{
+		connection->batchBuffer = pvPortMalloc(UAVTALK_MAX_MULTI_SIZE + UAVTALK_CHECKSUM_LENGTH);
+		if (connection->batchBuffer == NULL)
+		{
+			return sendSingleObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+		}
+	}
+
+	if (connection->batchCount > 0 && connection->batchLength + recordLength > UAVTALK_MAX_MULTI_SIZE)
+	{
+		flushBatch(connection);
+	}
+	if (connection->batchCount == 0)
+	{
+		connection->batchLength = 4; // sync, type and size
+	}
+
+	record = &connection->batchBuffer[connection->batchLength];
+	objId = UAVObjGetID(obj);
+	record[0] = (uint8_t)(objId & 0xFF);
+	record[1] = (uint8_t)((objId >> 8) & 0xFF);
+	record[2] = (uint8_t)((objId >> 16) & 0xFF);
+	record[3] = (uint8_t)((objId >> 24) & 0xFF);
+	if (instanceLength > 0)
+	{
+		record[4] = (uint8_t)(instId & 0xFF);
+		record[5] = (uint8_t)((instId >> 8) & 0xFF);
+	}
+	if (UAVObjPack(obj, instId, &record[4 + instanceLength]) < 0)
+	{
+		return -1;
+	}
+
+	connection->batchLength += recordLength;
+	++connection->batchCount;
+	connection->stats.txObjectBytes += recordLength - 4 - instanceLength;
+
+	return 0;
+}
+
+/**
+ * Send the multi-object frame. A frame with a single object is sent as a plain object
+ * packet, which has exactly the same layout.
+ * Must be called with the connection locked.
+ * \param[in] connection UAVTalkConnection to be used
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t flushBatch(UAVTalkConnectionData *connection)
+{
+	if (connection->batchCount == 0)
+	{
+		return 0;
+	}
+
+	uint8_t *buf = connection->batchBuffer;
+	uint16_t size = connection->batchLength;
+	uint8_t count = connection->batchCount;
+	connection->batchCount = 0;
+	connection->batchLength = 0;
+
+	if (!connection->outStream) return -1;
+
+	buf[0] = UAVTALK_SYNC_VAL;
+	buf[1] = (count > 1) ? UAVTALK_TYPE_OBJ_MULTI : UAVTALK_TYPE_OBJ;
+	buf[2] = (uint8_t)(size & 0xFF);
+	buf[3] = (uint8_t)((size >> 8) & 0xFF);
+	buf[size] = PIOS_CRC_updateCRC(0, buf, size);
+
+	uint16_t tx_msg_len = size + UAVTALK_CHECKSUM_LENGTH;
+	int32_t rc = (*connection->outStream)(buf, tx_msg_len);
+
+	if (rc != tx_msg_len) {
+		return -1;
+	}
+
+	// Update stats
+	connection->stats.txObjects += count;
+	connection->stats.txBytes += tx_msg_len;
+
+	return 0;
+}
+
+/**
+ * Send a single instance of an object as a delta against its keyframe.
+ * The packet has the usual header and instance ID, followed by the checksum of the
+ * keyframe, a mask with one bit per field and the data of the fields set in the mask.
+ * A packet with every field set is a keyframe. Must be called with the connection locked.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle to send
+ * \param[in] instId The instance ID (can NOT be UAVOBJ_ALL_INSTANCES)
+ * \return 0 Success
+ * \return -1 Failure
+ */
+static int32_t sendDelta(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId)
+{
+	const uint16_t *offsets;
+	int32_t numFields = UAVObjGetFieldOffsets(obj, &offsets);
+	uint16_t numBytes = UAVObjGetNumBytes(obj);
+	uint16_t instanceLength = UAVObjIsSingleInstance(obj) ? 0 : 2;
+	uint16_t maskLength = (numFields + 7) / 8;
+	UAVTalkDeltaState *state;
+
+	if (!connection->outStream) return -1;
+
+	// Objects without field offsets or that do not fit as a keyframe are sent in full
+	if (numFields <= 0 || UAVTALK_MIN_HEADER_LENGTH + instanceLength + 1 + maskLength + numBytes > UAVTALK_MAX_MULTI_SIZE)
+	{
+		return sendSingleObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+	}
+
+	state = getDeltaState(connection, obj, instId);
+	if (state == NULL)
+	{
+		return sendSingleObject(connection, obj, instId, UAVTALK_TYPE_OBJ);
+	}
+
+	uint8_t *current = connection->deltaBuffer;
+	if (UAVObjPack(obj, instId, current) < 0)
+	{
+		return -1;
+	}
+
+	// Setup the header, the instance ID is always part of the data
+	uint32_t objId = UAVObjGetID(obj);
+	uint8_t *buf = connection->txBuffer;
+	buf[0] = UAVTALK_SYNC_VAL;
+	buf[1] = UAVTALK_TYPE_OBJ_DELTA;
+	buf[4] = (uint8_t)(objId & 0xFF);
+	buf[5] = (uint8_t)((objId >> 8) & 0xFF);
+	buf[6] = (uint8_t)((objId >> 16) & 0xFF);
+	buf[7] = (uint8_t)((objId >> 24) & 0xFF);
+	uint16_t length = UAVTALK_MIN_HEADER_LENGTH;
+	if (instanceLength > 0)
+	{
+		buf[length++] = (uint8_t)(instId & 0xFF);
+		buf[length++] = (uint8_t)((instId >> 8) & 0xFF);
+	}
+	buf[length++] = state->keyframeCrc;
+	uint8_t *mask = &buf[length];
+	memset(mask, 0, maskLength);
+	length += maskLength;
+
+	// Add the fields that changed since the keyframe, or all of them when a keyframe is due
+	bool keyframe = state->updatesSinceKeyframe >= UAVTALK_DELTA_KEYFRAME_INTERVAL;
+	int32_t numChanged = 0;
+	for (int32_t n = 0; n < numFields; ++n)
+	{
+		uint16_t start = offsets[n];
+		uint16_t end = (n + 1 < numFields) ? offsets[n + 1] : numBytes;
+		if (keyframe || memcmp(&current[start], &state->keyframe[start], end - start) != 0)
+		{
+			mask[n / 8] |= 1 << (n % 8);
+			memcpy(&buf[length], &current[start], end - start);
+			length += end - start;
+			++numChanged;
+		}
+	}
+
+	// Store the packet length and checksum
+	buf[2] = (uint8_t)(length & 0xFF);
+	buf[3] = (uint8_t)((length >> 8) & 0xFF);
+	buf[length] = PIOS_CRC_updateCRC(0, buf, length);
+
+	uint16_t tx_msg_len = length + UAVTALK_CHECKSUM_LENGTH;
+	int32_t rc = (*connection->outStream)(buf, tx_msg_len);
+
+	// The keyframe only moves once the receiver could have seen it
+	if (rc != tx_msg_len) {
+		return -1;
+	}
+
+	// With every field set the receiver takes this as a keyframe as well
+	if (numChanged == numFields)
+	{
+		memcpy(state->keyframe, current, numBytes);
+		state->keyframeCrc = PIOS_CRC_updateCRC(0, current, numBytes);
+		state->updatesSinceKeyframe = 0;
+	}
+	else
+	{
+		++state->updatesSinceKeyframe;
+	}
+
+	// Update stats
+	++connection->stats.txObjects;
+	connection->stats.txBytes += tx_msg_len;
+	connection->stats.txObjectBytes += length - UAVTALK_MIN_HEADER_LENGTH - instanceLength;
+
+	return 0;
+}
+
+/**
+ * Find the delta state of an object instance or set up a new one, which
+ * starts with a keyframe. Entries are never released, instances that find
+ * the table full keep being sent in full.
+ * \param[in] connection UAVTalkConnection to be used
+ * \param[in] obj Object handle
+ * \param[in] instId The instance ID
+ * \return The state or NULL if there is none
+ */
+static UAVTalkDeltaState *getDeltaState(UAVTalkConnectionData *connection, UAVObjHandle obj, uint16_t instId)
+{
+	UAVTalkDeltaState *state = NULL;
+
+	if (connection->delta == NULL)
+	{
+		connection->deltaBuffer = pvPortMalloc(UAVTALK_MAX_PAYLOAD_LENGTH);
+		if (connection->deltaBuffer == NULL)
+		{
+			return NULL;
+		}
+		connection->delta = pvPortMalloc(UAVTALK_MAX_DELTA_OBJECTS * sizeof(UAVTalkDeltaState));
+		if (connection->delta == NULL)
+		{
+			vPortFree(connection->deltaBuffer);
+			connection->deltaBuffer = NULL;
+			return NULL;
+		}
+		memset(connection->delta, 0, UAVTALK_MAX_DELTA_OBJECTS * sizeof(UAVTalkDeltaState));
+	}
+
+	for (uint8_t n = 0; n < UAVTALK_MAX_DELTA_OBJECTS; ++n)
+	{
+		if (connection->delta[n].obj == obj && connection->delta[n].instId == instId)
+		{
+			return &connection->delta[n];
+		}
+		if (state == NULL && connection->delta[n].obj == 0)
+		{
+			state = &connection->delta[n];
+		}
+	}
+
+	if (state != NULL)
+	{
+		state->keyframe = pvPortMalloc(UAVObjGetNumBytes(obj));
+		if (state->keyframe == NULL)
+		{
+			return NULL;
+		}
+		state->obj = obj;
+		state->instId = instId;
+		state->updatesSinceKeyframe = UAVTALK_DELTA_KEYFRAME_INTERVAL;
+		state->keyframeCrc = 0;
+	}
+
+	return state;
 }
 
 /**
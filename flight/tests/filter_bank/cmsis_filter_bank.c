@@ -0,0 +1,25 @@
+/*
+ * Builds the filter bank a second time on top of the CMSIS DSP library,
+ * which runs on the host with ARM_MATH_SIM, under different names so that
+ * both backends can be compared. The structure is larger with the CMSIS
+ * instances so the test only handles it through a pointer.
+ */
+
+#include <stdlib.h>
+
+#define FILTER_BANK_CMSIS
+#define filter_bank cmsis_filter_bank
+#define filter_bank_init cmsis_filter_bank_init
+#define filter_bank_reset cmsis_filter_bank_reset
+#define filter_bank_add_lowpass cmsis_filter_bank_add_lowpass
+#define filter_bank_add_notch cmsis_filter_bank_add_notch
+#define filter_bank_configure cmsis_filter_bank_configure
+#define filter_bank_apply cmsis_filter_bank_apply
+#define filter_bank_apply_cb cmsis_filter_bank_apply_cb
+
+#include "filter_bank.c"
+
+struct cmsis_filter_bank *cmsis_filter_bank_alloc(void)
+{
+	return malloc(sizeof(struct cmsis_filter_bank));
+}
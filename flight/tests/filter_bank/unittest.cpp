@@ -0,0 +1,256 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <string.h>		/* memcpy */
+#include <stdint.h>		/* uint*_t */
+#include <stdlib.h>		/* free */
+#include <math.h>		/* sinf */
+#include <time.h>		/* clock_gettime */
+#if defined(__i386__) || defined(__x86_64__)
+#include <x86intrin.h>		/* __rdtsc */
+#endif
+
+extern "C" {
+
+#include "filter_bank.h"
+
+/* The same filters built on the CMSIS DSP library, see cmsis_filter_bank.c */
+struct cmsis_filter_bank;
+struct cmsis_filter_bank *cmsis_filter_bank_alloc(void);
+void cmsis_filter_bank_init(struct cmsis_filter_bank *bank);
+int32_t cmsis_filter_bank_add_lowpass(struct cmsis_filter_bank *bank, float sample_rate, float cutoff, uint8_t order);
+int32_t cmsis_filter_bank_add_notch(struct cmsis_filter_bank *bank, float sample_rate, float center, float bandwidth);
+void cmsis_filter_bank_apply(struct cmsis_filter_bank *bank, float sample[FILTER_BANK_AXES]);
+
+}
+
+#define SAMPLE_RATE 1000.0f
+#define SETTLE_SAMPLES 2000
+#define MEASURE_SAMPLES 2000
+#define BENCH_BATCHES 20
+#define BENCH_ROUNDS 20000
+
+static double elapsedNs(const struct timespec &start, const struct timespec &end)
+{
+  return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+static uint64_t cycles()
+{
+#if defined(__i386__) || defined(__x86_64__)
+  return __rdtsc();
+#else
+  return 0;
+#endif
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class FilterBankTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    filter_bank_init(&bank);
+  }
+
+  /* Peak output for a sine on every axis, with the phase shifted per axis */
+  float gain(float freq) {
+    float peak = 0;
+
+    filter_bank_reset(&bank);
+    for (uint32_t i = 0; i < SETTLE_SAMPLES + MEASURE_SAMPLES; i++) {
+      float sample[FILTER_BANK_AXES];
+      for (uint8_t axis = 0; axis < FILTER_BANK_AXES; axis++) {
+        sample[axis] = sinf(2 * (float) M_PI * freq * i / SAMPLE_RATE + axis);
+      }
+      filter_bank_apply(&bank, sample);
+      if (i >= SETTLE_SAMPLES) {
+        for (uint8_t axis = 0; axis < FILTER_BANK_AXES; axis++) {
+          peak = fmaxf(peak, fabsf(sample[axis]));
+        }
+      }
+    }
+
+    return peak;
+  }
+
+  struct filter_bank bank;
+};
+
+TEST_F(FilterBankTest, PassThrough) {
+  float sample[FILTER_BANK_AXES] = { 1.5f, -2.0f, 0.25f };
+
+  filter_bank_apply(&bank, sample);
+  EXPECT_EQ(1.5f, sample[0]);
+  EXPECT_EQ(-2.0f, sample[1]);
+  EXPECT_EQ(0.25f, sample[2]);
+}
+
+TEST_F(FilterBankTest, Lowpass) {
+  ASSERT_EQ(0, filter_bank_add_lowpass(&bank, SAMPLE_RATE, 50, 2));
+  EXPECT_EQ(1, bank.num_stages);
+
+  /* Unity gain for a constant input */
+  float sample[FILTER_BANK_AXES];
+  for (uint32_t i = 0; i < SETTLE_SAMPLES; i++) {
+    sample[0] = 1; sample[1] = -3; sample[2] = 0.5f;
+    filter_bank_apply(&bank, sample);
+  }
+  EXPECT_NEAR(1, sample[0], 1e-4);
+  EXPECT_NEAR(-3, sample[1], 1e-4);
+  EXPECT_NEAR(0.5f, sample[2], 1e-4);
+
+  EXPECT_NEAR(1, gain(5), 0.01);
+  EXPECT_NEAR(M_SQRT1_2, gain(50), 0.01);
+  /* A second order filter falls by 40 dB per decade */
+  EXPECT_LT(gain(400), 0.02);
+}
+
+TEST_F(FilterBankTest, LowpassOrder) {
+  ASSERT_EQ(0, filter_bank_add_lowpass(&bank, SAMPLE_RATE, 50, 4));
+  EXPECT_EQ(2, bank.num_stages);
+
+  /* Still -3 dB at the cutoff but much steeper above it */
+  EXPECT_NEAR(1, gain(5), 0.01);
+  EXPECT_NEAR(M_SQRT1_2, gain(50), 0.01);
+  EXPECT_LT(gain(200), 0.005);
+
+  /* Odd orders are rounded up */
+  filter_bank_init(&bank);
+  ASSERT_EQ(0, filter_bank_add_lowpass(&bank, SAMPLE_RATE, 50, 3));
+  EXPECT_EQ(2, bank.num_stages);
+}
+
+TEST_F(FilterBankTest, Notch) {
+  ASSERT_EQ(0, filter_bank_add_notch(&bank, SAMPLE_RATE, 120, 20));
+
+  EXPECT_LT(gain(120), 0.01);
+  EXPECT_NEAR(M_SQRT1_2, gain(110), 0.05);
+  EXPECT_NEAR(1, gain(10), 0.01);
+  EXPECT_NEAR(1, gain(400), 0.01);
+}
+
+TEST_F(FilterBankTest, Cascade) {
+  ASSERT_EQ(0, filter_bank_add_lowpass(&bank, SAMPLE_RATE, 100, 2));
+  ASSERT_EQ(0, filter_bank_add_notch(&bank, SAMPLE_RATE, 60, 10));
+  EXPECT_EQ(2, bank.num_stages);
+
+  EXPECT_NEAR(1, gain(5), 0.01);
+  EXPECT_LT(gain(60), 0.01);
+  EXPECT_LT(gain(450), 0.1);
+}
+
+TEST_F(FilterBankTest, Invalid) {
+  EXPECT_EQ(-1, filter_bank_add_lowpass(&bank, SAMPLE_RATE, 0, 2));
+  EXPECT_EQ(-1, filter_bank_add_lowpass(&bank, SAMPLE_RATE, 500, 2));
+  EXPECT_EQ(-1, filter_bank_add_lowpass(&bank, SAMPLE_RATE, 50, 0));
+  EXPECT_EQ(-1, filter_bank_add_notch(&bank, SAMPLE_RATE, 600, 20));
+  EXPECT_EQ(-1, filter_bank_add_notch(&bank, SAMPLE_RATE, 100, 0));
+  EXPECT_EQ(0, bank.num_stages);
+
+  /* Filters that do not fit are not added at all */
+  ASSERT_EQ(0, filter_bank_add_lowpass(&bank, SAMPLE_RATE, 50, 6));
+  EXPECT_EQ(-1, filter_bank_add_lowpass(&bank, SAMPLE_RATE, 50, 4));
+  EXPECT_EQ(3, bank.num_stages);
+  ASSERT_EQ(0, filter_bank_add_notch(&bank, SAMPLE_RATE, 100, 20));
+  EXPECT_EQ(-1, filter_bank_add_notch(&bank, SAMPLE_RATE, 100, 20));
+  EXPECT_EQ(FILTER_BANK_MAX_STAGES, bank.num_stages);
+}
+
+TEST_F(FilterBankTest, Configure) {
+  /* Disabled filters are left out */
+  EXPECT_EQ(0, filter_bank_configure(&bank, SAMPLE_RATE, 0, 2, 0, 20));
+  EXPECT_EQ(0, bank.num_stages);
+
+  EXPECT_EQ(0, filter_bank_configure(&bank, SAMPLE_RATE, 50, 4, 0, 20));
+  EXPECT_EQ(2, bank.num_stages);
+  EXPECT_NEAR(M_SQRT1_2, gain(50), 0.01);
+
+  /* Reconfiguring replaces the filters */
+  EXPECT_EQ(0, filter_bank_configure(&bank, SAMPLE_RATE, 100, 2, 60, 10));
+  EXPECT_EQ(2, bank.num_stages);
+  EXPECT_LT(gain(60), 0.01);
+
+  /* The valid filters are kept when one is rejected */
+  EXPECT_EQ(-1, filter_bank_configure(&bank, SAMPLE_RATE, 600, 2, 60, 10));
+  EXPECT_EQ(1, bank.num_stages);
+  EXPECT_LT(gain(60), 0.01);
+}
+
+TEST_F(FilterBankTest, MatchesCmsis) {
+  struct cmsis_filter_bank *cmsis = cmsis_filter_bank_alloc();
+  ASSERT_TRUE(cmsis != NULL);
+
+  cmsis_filter_bank_init(cmsis);
+  ASSERT_EQ(0, filter_bank_add_lowpass(&bank, SAMPLE_RATE, 80, 4));
+  ASSERT_EQ(0, filter_bank_add_notch(&bank, SAMPLE_RATE, 150, 30));
+  ASSERT_EQ(0, cmsis_filter_bank_add_lowpass(cmsis, SAMPLE_RATE, 80, 4));
+  ASSERT_EQ(0, cmsis_filter_bank_add_notch(cmsis, SAMPLE_RATE, 150, 30));
+
+  for (uint32_t i = 0; i < 1000; i++) {
+    float sample[FILTER_BANK_AXES], expected[FILTER_BANK_AXES];
+    for (uint8_t axis = 0; axis < FILTER_BANK_AXES; axis++) {
+      sample[axis] = sinf(0.37f * i + axis) + 0.5f * sinf(0.011f * i * axis);
+    }
+    memcpy(expected, sample, sizeof(sample));
+    filter_bank_apply(&bank, expected);
+    cmsis_filter_bank_apply(cmsis, sample);
+    for (uint8_t axis = 0; axis < FILTER_BANK_AXES; axis++) {
+      EXPECT_NEAR(expected[axis], sample[axis], 1e-5);
+    }
+  }
+
+  free(cmsis);
+}
+
+/* Not a functional test, reports the time per sample of both backends */
+TEST_F(FilterBankTest, Benchmark) {
+  static const uint8_t stages[] = { 1, 2, 4 };
+  struct cmsis_filter_bank *cmsis = cmsis_filter_bank_alloc();
+  ASSERT_TRUE(cmsis != NULL);
+
+  for (uint32_t s = 0; s < sizeof(stages) / sizeof(stages[0]); s++) {
+    double best_ns[2] = { 1e12, 1e12 };
+    double best_cycles[2] = { 1e12, 1e12 };
+
+    filter_bank_init(&bank);
+    cmsis_filter_bank_init(cmsis);
+    for (uint8_t i = 0; i < stages[s]; i++) {
+      filter_bank_add_notch(&bank, SAMPLE_RATE, 50 + 100 * i, 20);
+      cmsis_filter_bank_add_notch(cmsis, SAMPLE_RATE, 50 + 100 * i, 20);
+    }
+
+    /* The minimum over several batches hides interruptions by other processes */
+    for (uint32_t batch = 0; batch < BENCH_BATCHES; batch++) {
+      for (uint32_t method = 0; method < 2; method++) {
+        struct timespec start, end;
+        float sample[FILTER_BANK_AXES] = { 0.1f, 0.2f, 0.3f };
+
+        clock_gettime(CLOCK_MONOTONIC, &start);
+        uint64_t start_cycles = cycles();
+        for (uint32_t round = 0; round < BENCH_ROUNDS; round++) {
+          sample[round % FILTER_BANK_AXES] += 1;
+          if (method == 0) {
+            filter_bank_apply(&bank, sample);
+          } else {
+            cmsis_filter_bank_apply(cmsis, sample);
+          }
+        }
+        uint64_t end_cycles = cycles();
+        clock_gettime(CLOCK_MONOTONIC, &end);
+
+        double ns = elapsedNs(start, end) / BENCH_ROUNDS;
+        double cyc = (double) (end_cycles - start_cycles) / BENCH_ROUNDS;
+        if (ns < best_ns[method]) {
+          best_ns[method] = ns;
+        }
+        if (cyc < best_cycles[method]) {
+          best_cycles[method] = cyc;
+        }
+      }
+    }
+
+    printf("%u stages, ns (cycles) per 3 axis sample: portable %.1f (%.0f), CMSIS %.1f (%.0f)\n",
+      stages[s], best_ns[0], best_cycles[0], best_ns[1], best_cycles[1]);
+  }
+
+  free(cmsis);
+}
@@ -0,0 +1,15 @@
+/*
+ * Builds the INSGPS matrix kernels a second time on top of the CMSIS DSP
+ * library, which runs on the host with ARM_MATH_SIM, under different names
+ * so that both backends can be compared.
+ */
+
+#define INSGPS_MATRIX_CMSIS
+#define insgps_mat_mult cmsis_mat_mult
+#define insgps_mat_trans cmsis_mat_trans
+#define insgps_vec_dot cmsis_vec_dot
+#define insgps_vec_axpy cmsis_vec_axpy
+#define insgps_covariance_prediction cmsis_covariance_prediction
+#define insgps_serial_update cmsis_serial_update
+
+#include "insgps_matrix.c"
@@ -0,0 +1,516 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <math.h>		/* fabs */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+
+#include "insgps_matrix.h"
+
+/* The same kernels built on the CMSIS DSP library, see cmsis_matrix.c */
+void cmsis_covariance_prediction(float *P, uint16_t n,
+		const float *F, const struct insgps_block *Fblocks, uint8_t numFblocks,
+		const float *G, const struct insgps_block *Gblocks, uint8_t numGblocks, uint16_t nw,
+		const float *Q, float dT, float *work);
+void cmsis_serial_update(float *P, float *X, uint16_t n,
+		const float *H, const struct insgps_block *Hblocks, uint8_t numHblocks, uint16_t nv,
+		const float *R, const float *Z, const float *Y, float *K,
+		uint16_t SensorsUsed, float *work);
+
+}
+
+#define MAXX 16
+#define MAXW 12
+#define NUMV 10
+#define ALL_SENSORS 0x3FF
+#define BENCH_BATCHES 20
+#define BENCH_ROUNDS 2000
+#define BENCH_METHODS 9
+
+/* Non-zero blocks of F, G and H of insgps13state.c and insgps16state.c */
+static const struct insgps_block Hblocks[] = {
+  { 0, 0, 1, 1 }, { 1, 1, 1, 1 }, { 2, 2, 1, 1 },
+  { 3, 3, 1, 1 }, { 4, 4, 1, 1 }, { 5, 5, 1, 1 },
+  { 6, 6, 3, 4 },
+  { 9, 2, 1, 1 },
+};
+static const struct insgps_block Fblocks13[] = {
+  { 0, 3, 1, 1 }, { 1, 4, 1, 1 }, { 2, 5, 1, 1 },
+  { 3, 6, 3, 4 },
+  { 6, 6, 4, 7 },
+};
+static const struct insgps_block Gblocks13[] = {
+  { 3, 3, 3, 3 },
+  { 6, 0, 4, 3 },
+  { 10, 6, 3, 3 },
+};
+static const struct insgps_block Fblocks16[] = {
+  { 0, 3, 1, 1 }, { 1, 4, 1, 1 }, { 2, 5, 1, 1 },
+  { 3, 6, 3, 4 },
+  { 3, 13, 3, 3 },
+  { 6, 6, 4, 7 },
+};
+static const struct insgps_block Gblocks16[] = {
+  { 3, 3, 3, 3 },
+  { 6, 0, 4, 3 },
+  { 10, 6, 6, 6 },
+};
+
+/* Subsets of the sensors the update is timed for, baro, mag and GPS with baro */
+static const uint16_t benchSensors[] = { 0x200, 0x1C0, 0x23F };
+
+#define NUM_BLOCKS(x) (sizeof(x) / sizeof(x[0]))
+
+static double elapsedNs(const struct timespec &start, const struct timespec &end)
+{
+  return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+/* Reproducible values in [-1, 1) */
+static uint32_t seed;
+static float randomValue()
+{
+  seed = seed * 1103515245 + 12345;
+  return ((seed >> 8) & 0xFFFF) / 32768.0f - 1.0f;
+}
+
+static void fillBlocks(float *M, uint16_t cols, const struct insgps_block *blocks, uint8_t numBlocks)
+{
+  for (uint8_t b = 0; b < numBlocks; b++) {
+    for (uint16_t i = blocks[b].row; i < blocks[b].row + blocks[b].rows; i++) {
+      for (uint16_t j = blocks[b].col; j < blocks[b].col + blocks[b].cols; j++) {
+        M[i * cols + j] = randomValue();
+      }
+    }
+  }
+}
+
+/* Dense double precision references of the filter steps */
+static void referencePrediction(float *P, uint16_t n, const float *F, const float *G,
+  uint16_t nw, const float *Q, float dT)
+{
+  double A[MAXX][MAXX], AP[MAXX][MAXX];
+
+  for (uint16_t i = 0; i < n; i++) {
+    for (uint16_t j = 0; j < n; j++) {
+      A[i][j] = (i == j) + (double) F[i * n + j] * dT;
+    }
+  }
+  for (uint16_t i = 0; i < n; i++) {
+    for (uint16_t j = 0; j < n; j++) {
+      AP[i][j] = 0;
+      for (uint16_t k = 0; k < n; k++) {
+        AP[i][j] += A[i][k] * P[k * n + j];
+      }
+    }
+  }
+  for (uint16_t i = 0; i < n; i++) {
+    for (uint16_t j = 0; j < n; j++) {
+      double sum = 0;
+      for (uint16_t k = 0; k < n; k++) {
+        sum += AP[i][k] * A[j][k];
+      }
+      for (uint16_t k = 0; k < nw; k++) {
+        sum += (double) dT * dT * G[i * nw + k] * Q[k] * G[j * nw + k];
+      }
+      P[i * n + j] = sum;
+    }
+  }
+}
+
+static void referenceUpdate(float *P, float *X, uint16_t n, const float *H, const float *R,
+  const float *Z, const float *Y, uint16_t SensorsUsed)
+{
+  double HP[MAXX];
+
+  for (uint16_t m = 0; m < NUMV; m++) {
+    if (!(SensorsUsed & (1 << m)))
+      continue;
+
+    double HPHR = R[m];
+    for (uint16_t j = 0; j < n; j++) {
+      HP[j] = 0;
+      for (uint16_t k = 0; k < n; k++) {
+        HP[j] += (double) H[m * n + k] * P[k * n + j];
+      }
+      HPHR += HP[j] * H[m * n + j];
+    }
+    for (uint16_t i = 0; i < n; i++) {
+      for (uint16_t j = 0; j < n; j++) {
+        P[i * n + j] -= HP[i] * HP[j] / HPHR;
+      }
+      X[i] += HP[i] / HPHR * (Z[m] - Y[m]);
+    }
+  }
+}
+
+/* Float version of the dense loops the filters used before the block kernels */
+static void densePrediction(float *P, uint16_t n, const float *F, const float *G,
+  uint16_t nw, const float *Q, float dT)
+{
+  float Dummy[MAXX][MAXX];
+
+  for (uint16_t i = 0; i < n; i++) {
+    for (uint16_t j = i; j < n; j++) {
+      float FP = 0, GQG = 0;
+      for (uint16_t k = 0; k < n; k++) {
+        FP += F[i * n + k] * P[k * n + j] + P[i * n + k] * F[j * n + k];
+      }
+      for (uint16_t k = 0; k < nw; k++) {
+        GQG += G[i * nw + k] * Q[k] * G[j * nw + k];
+      }
+      Dummy[i][j] = P[i * n + j] + FP * dT + GQG * dT * dT;
+    }
+  }
+  for (uint16_t i = 0; i < n; i++) {
+    for (uint16_t j = i; j < n; j++) {
+      P[i * n + j] = P[j * n + i] = Dummy[i][j];
+    }
+  }
+}
+
+static void denseUpdate(float *P, float *X, uint16_t n, const float *H, const float *R,
+  const float *Z, const float *Y, float *K, uint16_t SensorsUsed)
+{
+  float HP[MAXX];
+
+  for (uint16_t m = 0; m < NUMV; m++) {
+    if (!(SensorsUsed & (1 << m)))
+      continue;
+
+    float HPHR = R[m];
+    for (uint16_t j = 0; j < n; j++) {
+      HP[j] = 0;
+      for (uint16_t k = 0; k < n; k++) {
+        HP[j] += H[m * n + k] * P[k * n + j];
+      }
+      HPHR += HP[j] * H[m * n + j];
+    }
+    for (uint16_t k = 0; k < n; k++) {
+      K[k * NUMV + m] = HP[k] / HPHR;
+    }
+    for (uint16_t i = 0; i < n; i++) {
+      for (uint16_t j = i; j < n; j++) {
+        P[i * n + j] = P[j * n + i] = P[i * n + j] - K[i * NUMV + m] * HP[j];
+      }
+    }
+    for (uint16_t k = 0; k < n; k++) {
+      X[k] += K[k * NUMV + m] * (Z[m] - Y[m]);
+    }
+  }
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class InsgpsMatrixTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    seed = 1;
+    memset(F, 0, sizeof(F));
+    memset(G, 0, sizeof(G));
+    memset(H, 0, sizeof(H));
+  }
+
+  virtual void TearDown() {
+  }
+
+  /* A random system with the block pattern of one of the filters */
+  void setup(uint16_t numX, const struct insgps_block *Fblocks, uint8_t numF,
+    const struct insgps_block *Gblocks, uint8_t numG, uint16_t numW) {
+    n = numX;
+    nw = numW;
+    fillBlocks(F, n, Fblocks, numF);
+    fillBlocks(G, nw, Gblocks, numG);
+    fillBlocks(H, n, Hblocks, NUM_BLOCKS(Hblocks));
+
+    /* P = L*L' + I is symmetric and positive definite */
+    float L[MAXX][MAXX];
+    for (uint16_t i = 0; i < n; i++) {
+      for (uint16_t j = 0; j < n; j++) {
+        L[i][j] = randomValue() * 0.3f;
+      }
+    }
+    for (uint16_t i = 0; i < n; i++) {
+      for (uint16_t j = 0; j < n; j++) {
+        float sum = (i == j);
+        for (uint16_t k = 0; k < n; k++) {
+          sum += L[i][k] * L[j][k];
+        }
+        P[i * n + j] = sum;
+      }
+      X[i] = randomValue();
+    }
+    for (uint16_t k = 0; k < nw; k++) {
+      Q[k] = 1e-3f * (1.0f + randomValue());
+    }
+    for (uint16_t m = 0; m < NUMV; m++) {
+      R[m] = 0.5f + randomValue() * 0.25f;
+      Z[m] = randomValue();
+      Y[m] = randomValue();
+    }
+  }
+
+  void expectNear(const float *expected, const float *actual, uint16_t count) {
+    for (uint16_t i = 0; i < count; i++) {
+      EXPECT_NEAR(expected[i], actual[i], 1e-5f * (1.0f + fabsf(expected[i]))) << "element " << i;
+    }
+  }
+
+  void checkPrediction(const struct insgps_block *Fblocks, uint8_t numF,
+    const struct insgps_block *Gblocks, uint8_t numG) {
+    float expected[MAXX * MAXX], portable[MAXX * MAXX], cmsis[MAXX * MAXX];
+    float dT = 0.002f;
+
+    /* Several steps, so that errors would add up */
+    memcpy(expected, P, sizeof(P));
+    memcpy(portable, P, sizeof(P));
+    memcpy(cmsis, P, sizeof(P));
+    for (uint32_t step = 0; step < 10; step++) {
+      referencePrediction(expected, n, F, G, nw, Q, dT);
+      insgps_covariance_prediction(portable, n, F, Fblocks, numF, G, Gblocks, numG, nw, Q, dT, work);
+      cmsis_covariance_prediction(cmsis, n, F, Fblocks, numF, G, Gblocks, numG, nw, Q, dT, work);
+    }
+
+    expectNear(expected, portable, n * n);
+    expectNear(expected, cmsis, n * n);
+
+    /* The result is exactly symmetric */
+    for (uint16_t i = 0; i < n; i++) {
+      for (uint16_t j = 0; j < i; j++) {
+        EXPECT_EQ(portable[i * n + j], portable[j * n + i]);
+        EXPECT_EQ(cmsis[i * n + j], cmsis[j * n + i]);
+      }
+    }
+  }
+
+  void checkUpdate(uint16_t SensorsUsed) {
+    float expectedP[MAXX * MAXX], expectedX[MAXX];
+
+    memcpy(expectedP, P, sizeof(P));
+    memcpy(expectedX, X, sizeof(X));
+    referenceUpdate(expectedP, expectedX, n, H, R, Z, Y, SensorsUsed);
+
+    float portableP[MAXX * MAXX], portableX[MAXX], portableK[MAXX * NUMV];
+    memcpy(portableP, P, sizeof(P));
+    memcpy(portableX, X, sizeof(X));
+    memset(portableK, 0, sizeof(portableK));
+    insgps_serial_update(portableP, portableX, n, H, Hblocks, NUM_BLOCKS(Hblocks), NUMV,
+      R, Z, Y, portableK, SensorsUsed, work);
+    expectNear(expectedP, portableP, n * n);
+    expectNear(expectedX, portableX, n);
+
+    float cmsisP[MAXX * MAXX], cmsisX[MAXX], cmsisK[MAXX * NUMV];
+    memcpy(cmsisP, P, sizeof(P));
+    memcpy(cmsisX, X, sizeof(X));
+    memset(cmsisK, 0, sizeof(cmsisK));
+    cmsis_serial_update(cmsisP, cmsisX, n, H, Hblocks, NUM_BLOCKS(Hblocks), NUMV,
+      R, Z, Y, cmsisK, SensorsUsed, work);
+    expectNear(expectedP, cmsisP, n * n);
+    expectNear(expectedX, cmsisX, n);
+
+    /* The result is exactly symmetric */
+    for (uint16_t i = 0; i < n; i++) {
+      for (uint16_t j = 0; j < i; j++) {
+        EXPECT_EQ(portableP[i * n + j], portableP[j * n + i]);
+        EXPECT_EQ(cmsisP[i * n + j], cmsisP[j * n + i]);
+      }
+    }
+
+    /* Gains of unused sensors are left alone */
+    for (uint16_t m = 0; m < NUMV; m++) {
+      if (SensorsUsed & (1 << m))
+        continue;
+      for (uint16_t k = 0; k < n; k++) {
+        EXPECT_EQ(0, portableK[k * NUMV + m]);
+        EXPECT_EQ(0, cmsisK[k * NUMV + m]);
+      }
+    }
+  }
+
+  uint16_t n;
+  uint16_t nw;
+  float F[MAXX * MAXX];
+  float G[MAXX * MAXW];
+  float H[NUMV * MAXX];
+  float P[MAXX * MAXX];
+  float X[MAXX];
+  float Q[MAXW];
+  float R[NUMV];
+  float Z[NUMV];
+  float Y[NUMV];
+  float work[INSGPS_PREDICTION_WORK_SIZE(MAXX)];
+};
+
+TEST_F(InsgpsMatrixTest, MatMult) {
+  float A[3 * 5], B[5 * 7], C[3 * 7], Cc[3 * 7];
+
+  for (uint16_t i = 0; i < sizeof(A) / sizeof(A[0]); i++) {
+    A[i] = randomValue();
+  }
+  for (uint16_t i = 0; i < sizeof(B) / sizeof(B[0]); i++) {
+    B[i] = randomValue();
+  }
+
+  insgps_mat_mult(A, B, C, 3, 5, 7);
+  for (uint16_t i = 0; i < 3; i++) {
+    for (uint16_t j = 0; j < 7; j++) {
+      float sum = 0;
+      for (uint16_t k = 0; k < 5; k++) {
+        sum += A[i * 5 + k] * B[k * 7 + j];
+      }
+      Cc[i * 7 + j] = sum;
+    }
+  }
+  expectNear(Cc, C, 3 * 7);
+
+  float At[5 * 3];
+  insgps_mat_trans(A, At, 3, 5);
+  for (uint16_t i = 0; i < 3; i++) {
+    for (uint16_t j = 0; j < 5; j++) {
+      EXPECT_EQ(A[i * 5 + j], At[j * 3 + i]);
+    }
+  }
+}
+
+TEST_F(InsgpsMatrixTest, VectorOps) {
+  float a[11], b[11], y[11];
+  float dot = 0;
+
+  for (uint16_t i = 0; i < 11; i++) {
+    a[i] = randomValue();
+    b[i] = randomValue();
+    y[i] = b[i];
+    dot += a[i] * b[i];
+  }
+
+  EXPECT_NEAR(dot, insgps_vec_dot(a, b, 11), 1e-5f);
+
+  insgps_vec_axpy(0.5f, a, y, 11);
+  for (uint16_t i = 0; i < 11; i++) {
+    EXPECT_FLOAT_EQ(b[i] + 0.5f * a[i], y[i]);
+  }
+}
+
+TEST_F(InsgpsMatrixTest, Prediction13State) {
+  setup(13, Fblocks13, NUM_BLOCKS(Fblocks13), Gblocks13, NUM_BLOCKS(Gblocks13), 9);
+  checkPrediction(Fblocks13, NUM_BLOCKS(Fblocks13), Gblocks13, NUM_BLOCKS(Gblocks13));
+}
+
+TEST_F(InsgpsMatrixTest, Prediction16State) {
+  setup(16, Fblocks16, NUM_BLOCKS(Fblocks16), Gblocks16, NUM_BLOCKS(Gblocks16), 12);
+  checkPrediction(Fblocks16, NUM_BLOCKS(Fblocks16), Gblocks16, NUM_BLOCKS(Gblocks16));
+}
+
+TEST_F(InsgpsMatrixTest, Update13State) {
+  setup(13, Fblocks13, NUM_BLOCKS(Fblocks13), Gblocks13, NUM_BLOCKS(Gblocks13), 9);
+  checkUpdate(ALL_SENSORS);
+}
+
+TEST_F(InsgpsMatrixTest, Update16State) {
+  setup(16, Fblocks16, NUM_BLOCKS(Fblocks16), Gblocks16, NUM_BLOCKS(Gblocks16), 12);
+  checkUpdate(ALL_SENSORS);
+}
+
+TEST_F(InsgpsMatrixTest, UpdateSomeSensors) {
+  setup(13, Fblocks13, NUM_BLOCKS(Fblocks13), Gblocks13, NUM_BLOCKS(Gblocks13), 9);
+  checkUpdate(0x0047);	/* Position, altitude and magnetometer X */
+  checkUpdate(0);
+}
+
+TEST_F(InsgpsMatrixTest, UpdateAccurateSensors) {
+  setup(13, Fblocks13, NUM_BLOCKS(Fblocks13), Gblocks13, NUM_BLOCKS(Gblocks13), 9);
+  for (uint16_t m = 0; m < NUMV; m++) {
+    R[m] = 1e-6f;
+  }
+
+  /* Repeated updates with measurements much better than the state drive
+   * P towards zero, where rounding would otherwise make it indefinite */
+  for (uint32_t step = 0; step < 50; step++) {
+    insgps_covariance_prediction(P, n, F, Fblocks13, NUM_BLOCKS(Fblocks13),
+      G, Gblocks13, NUM_BLOCKS(Gblocks13), nw, Q, 0.002f, work);
+    insgps_serial_update(P, X, n, H, Hblocks, NUM_BLOCKS(Hblocks), NUMV,
+      R, Z, Y, work, ALL_SENSORS, &work[MAXX * NUMV]);
+  }
+
+  for (uint16_t i = 0; i < n; i++) {
+    EXPECT_GT(P[i * n + i], 0);
+    for (uint16_t j = 0; j < i; j++) {
+      EXPECT_EQ(P[i * n + j], P[j * n + i]);
+      EXPECT_LE(P[i * n + j] * P[i * n + j], P[i * n + i] * P[j * n + j]);
+    }
+  }
+}
+
+/* Not a functional test, reports the time of the dense loops and both kernel backends */
+TEST_F(InsgpsMatrixTest, Benchmark) {
+  struct timespec start, end;
+  float P0[MAXX * MAXX], X0[MAXX], K[MAXX * NUMV];
+  double best[BENCH_METHODS];
+  float dT = 0.002f;
+
+  setup(13, Fblocks13, NUM_BLOCKS(Fblocks13), Gblocks13, NUM_BLOCKS(Gblocks13), 9);
+  memcpy(P0, P, sizeof(P));
+  memcpy(X0, X, sizeof(X));
+
+  for (uint32_t i = 0; i < BENCH_METHODS; i++) {
+    best[i] = 1e12;
+  }
+
+  /* The minimum over several batches hides interruptions by other processes */
+  for (uint32_t batch = 0; batch < BENCH_BATCHES; batch++) {
+    for (uint32_t method = 0; method < BENCH_METHODS; method++) {
+      memcpy(P, P0, sizeof(P));
+      memcpy(X, X0, sizeof(X));
+      clock_gettime(CLOCK_MONOTONIC, &start);
+      for (uint32_t round = 0; round < BENCH_ROUNDS; round++) {
+        switch (method) {
+        case 0:
+          densePrediction(P, n, F, G, nw, Q, dT);
+          break;
+        case 1:
+          insgps_covariance_prediction(P, n, F, Fblocks13, NUM_BLOCKS(Fblocks13),
+            G, Gblocks13, NUM_BLOCKS(Gblocks13), nw, Q, dT, work);
+          break;
+        case 2:
+          cmsis_covariance_prediction(P, n, F, Fblocks13, NUM_BLOCKS(Fblocks13),
+            G, Gblocks13, NUM_BLOCKS(Gblocks13), nw, Q, dT, work);
+          break;
+        case 3:
+          denseUpdate(P, X, n, H, R, Z, Y, K, ALL_SENSORS);
+          break;
+        case 4:
+          insgps_serial_update(P, X, n, H, Hblocks, NUM_BLOCKS(Hblocks), NUMV,
+            R, Z, Y, K, ALL_SENSORS, work);
+          break;
+        case 5:
+          cmsis_serial_update(P, X, n, H, Hblocks, NUM_BLOCKS(Hblocks), NUMV,
+            R, Z, Y, K, ALL_SENSORS, work);
+          break;
+        default:
+          insgps_serial_update(P, X, n, H, Hblocks, NUM_BLOCKS(Hblocks), NUMV,
+            R, Z, Y, K, benchSensors[method - 6], work);
+          break;
+        }
+        /* Keep P from collapsing to zero over the rounds */
+        if ((round & 63) == 63) {
+          memcpy(P, P0, sizeof(P));
+        }
+      }
+      clock_gettime(CLOCK_MONOTONIC, &end);
+
+      double ns = elapsedNs(start, end) / BENCH_ROUNDS;
+      if (ns < best[method]) {
+        best[method] = ns;
+      }
+    }
+  }
+
+  printf("13 states, ns per covariance prediction: dense %.0f, portable %.0f, CMSIS %.0f\n",
+    best[0], best[1], best[2]);
+  printf("13 states, ns per serial update: dense %.0f, portable %.0f, CMSIS %.0f\n",
+    best[3], best[4], best[5]);
+  printf("13 states, ns per portable serial update of: baro %.0f, mag %.0f, GPS and baro %.0f\n",
+    best[6], best[7], best[8]);
+}
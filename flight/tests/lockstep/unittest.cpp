@@ -0,0 +1,227 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdint.h>		/* uint*_t */
+#include <unistd.h>		/* fork, pipe */
+#include <sys/wait.h>		/* waitpid */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+
+#include "FreeRTOS.h"
+#include "task.h"
+#include "queue.h"
+
+void vApplicationIdleHook(void) {}
+void vApplicationStackOverflowHook(xTaskHandle *, signed char *) {}
+
+}
+
+/* Wall clock time after which a run is abandoned, in case the clock stalls */
+#define WALL_TIMEOUT_S 60
+
+struct lockstep_result {
+  uint32_t ticks;
+  uint64_t time_us;
+  uint64_t hash;
+};
+
+static int result_fd;
+
+/* Hand the result of a run to the test and stop the scheduler process */
+static void report(const struct lockstep_result *result)
+{
+  if (write(result_fd, result, sizeof(*result)) != sizeof(*result)) {
+    _exit(2);
+  }
+  _exit(0);
+}
+
+static uint64_t wallTimeUs()
+{
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec * 1000000ULL + now.tv_nsec / 1000;
+}
+
+/*
+ * The posix port cannot restart the scheduler, so every run gets a process
+ * of its own. create_tasks() is called in that process before the
+ * scheduler starts and one of the tasks has to call report().
+ */
+static bool runScheduler(void (*create_tasks)(void), struct lockstep_result *result, uint64_t *wall_us)
+{
+  int fds[2];
+  if (pipe(fds) != 0) {
+    return false;
+  }
+
+  uint64_t start = wallTimeUs();
+  pid_t pid = fork();
+  if (pid == 0) {
+    close(fds[0]);
+    result_fd = fds[1];
+    alarm(WALL_TIMEOUT_S);
+    create_tasks();
+    vTaskStartScheduler();
+    _exit(1);
+  }
+  close(fds[1]);
+  if (pid < 0) {
+    close(fds[0]);
+    return false;
+  }
+
+  ssize_t len = read(fds[0], result, sizeof(*result));
+  close(fds[0]);
+
+  int status;
+  waitpid(pid, &status, 0);
+  if (wall_us) {
+    *wall_us = wallTimeUs() - start;
+  }
+
+  return len == sizeof(*result) && WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+static void createTask(pdTASK_CODE code, unsigned portBASE_TYPE priority)
+{
+  xTaskCreate(code, (signed char *) "test", configMINIMAL_STACK_SIZE, NULL, priority, NULL);
+}
+
+/* Ten simulated seconds of vTaskDelay() */
+static void delayTask(void *)
+{
+  struct lockstep_result result;
+  portTickType start_ticks = xTaskGetTickCount();
+  unsigned long long start_us = ullPortGetSimulatedTimeUS();
+
+  vTaskDelay(10000 / portTICK_RATE_MS);
+
+  result.ticks = xTaskGetTickCount() - start_ticks;
+  result.time_us = ullPortGetSimulatedTimeUS() - start_us;
+  result.hash = 0;
+  report(&result);
+}
+
+static void createDelayTasks(void)
+{
+  createTask(delayTask, 2);
+}
+
+TEST(LockstepTest, DelayRunsOnSimulatedTime) {
+  struct lockstep_result result;
+  uint64_t wall_us;
+
+  ASSERT_TRUE(runScheduler(createDelayTasks, &result, &wall_us));
+  EXPECT_EQ(10000u, result.ticks);
+  EXPECT_EQ(10000000u, result.time_us);
+
+  /* The clock only waits for the tasks, not for the wall clock */
+  EXPECT_LT(wall_us, result.time_us);
+  printf("10 s simulated in %.3f s\n", wall_us / 1e6);
+}
+
+/* Busy wait with vPortSimulatedDelay() starting on a tick boundary */
+static unsigned long busy_wait_us;
+
+static void busyWaitTask(void *)
+{
+  struct lockstep_result result;
+
+  vTaskDelay(1);
+  portTickType start_ticks = xTaskGetTickCount();
+  unsigned long long start_us = ullPortGetSimulatedTimeUS();
+
+  vPortSimulatedDelay(busy_wait_us);
+
+  result.ticks = xTaskGetTickCount() - start_ticks;
+  result.time_us = ullPortGetSimulatedTimeUS() - start_us;
+  result.hash = 0;
+  report(&result);
+}
+
+static void createBusyWaitTasks(void)
+{
+  createTask(busyWaitTask, 2);
+}
+
+TEST(LockstepTest, BusyWait) {
+  struct lockstep_result result;
+
+  /* Within a tick the time only moves ahead */
+  busy_wait_us = 300;
+  ASSERT_TRUE(runScheduler(createBusyWaitTasks, &result, NULL));
+  EXPECT_EQ(300u, result.time_us);
+  EXPECT_EQ(0u, result.ticks);
+
+  /* Across ticks the task waits for the tick handler at every boundary */
+  busy_wait_us = 2500;
+  ASSERT_TRUE(runScheduler(createBusyWaitTasks, &result, NULL));
+  EXPECT_EQ(2500u, result.time_us);
+  EXPECT_EQ(2u, result.ticks);
+}
+
+/*
+ * A producer on a fixed period, a consumer blocking on its queue and a low
+ * priority task that busy waits across ticks, so the other two preempt it
+ */
+#define WORKLOAD_ITEMS 20000
+
+static xQueueHandle workload_queue;
+
+static void producerTask(void *)
+{
+  portTickType last = xTaskGetTickCount();
+  uint32_t item = 0;
+
+  while (1) {
+    vTaskDelayUntil(&last, 2);
+    item++;
+    xQueueSend(workload_queue, &item, 0);
+  }
+}
+
+static void consumerTask(void *)
+{
+  struct lockstep_result result = { 0, 0, 0 };
+  uint32_t item;
+
+  while (1) {
+    xQueueReceive(workload_queue, &item, portMAX_DELAY);
+    result.hash = result.hash * 31 + ullPortGetSimulatedTimeUS() + xTaskGetTickCount();
+    if (item == WORKLOAD_ITEMS) {
+      result.ticks = xTaskGetTickCount();
+      result.time_us = ullPortGetSimulatedTimeUS();
+      report(&result);
+    }
+  }
+}
+
+static void busyTask(void *)
+{
+  while (1) {
+    vPortSimulatedDelay(2500);
+    vTaskDelay(3);
+  }
+}
+
+static void createWorkloadTasks(void)
+{
+  workload_queue = xQueueCreate(4, sizeof(uint32_t));
+  createTask(producerTask, 3);
+  createTask(consumerTask, 2);
+  createTask(busyTask, 1);
+}
+
+TEST(LockstepTest, Repeatable) {
+  struct lockstep_result first, second;
+
+  ASSERT_TRUE(runScheduler(createWorkloadTasks, &first, NULL));
+  ASSERT_TRUE(runScheduler(createWorkloadTasks, &second, NULL));
+
+  EXPECT_EQ(2u * WORKLOAD_ITEMS, first.ticks);
+  EXPECT_EQ(first.ticks, second.ticks);
+  EXPECT_EQ(first.time_us, second.time_us);
+  EXPECT_EQ(first.hash, second.hash);
+}
@@ -15,6 +15,9 @@ struct flash_ut_dev {
 	const struct pios_flash_ut_cfg * cfg;
 	bool transaction_in_progress;
 	FILE * flash_file;
+	uint32_t num_reads;
+	uint32_t num_writes;
+	uint32_t * num_erases; /* per sector */
 };
 
 static struct flash_ut_dev * PIOS_Flash_UT_Alloc(void)
@@ -40,6 +43,10 @@ int32_t PIOS_Flash_UT_Init(uintptr_t * flash_id, const struct pios_flash_ut_cfg
 
 	flash_dev->cfg = cfg;
 	flash_dev->transaction_in_progress = false;
+	flash_dev->num_reads = 0;
+	flash_dev->num_writes = 0;
+	flash_dev->num_erases = calloc(cfg->size_of_flash / cfg->size_of_sector, sizeof(uint32_t));
+	assert(flash_dev->num_erases);
 
 	flash_dev->flash_file = fopen ("theflash.bin", "r+");
 	if (flash_dev->flash_file == NULL) {
@@ -61,9 +68,33 @@ void PIOS_Flash_UT_Destroy(uintptr_t flash_id)
 
 	fclose(flash_dev->flash_file);
 
+	free(flash_dev->num_erases);
 	free(flash_dev);
 }
 
+uint32_t PIOS_Flash_UT_GetReadCount(uintptr_t flash_id)
+{
+	struct flash_ut_dev * flash_dev = (struct flash_ut_dev *)flash_id;
+
+	return flash_dev->num_reads;
+}
+
+uint32_t PIOS_Flash_UT_GetWriteCount(uintptr_t flash_id)
+{
+	struct flash_ut_dev * flash_dev = (struct flash_ut_dev *)flash_id;
+
+	return flash_dev->num_writes;
+}
+
+uint32_t PIOS_Flash_UT_GetEraseCount(uintptr_t flash_id, uint32_t sector)
+{
+	struct flash_ut_dev * flash_dev = (struct flash_ut_dev *)flash_id;
+
+	assert(sector < flash_dev->cfg->size_of_flash / flash_dev->cfg->size_of_sector);
+
+	return flash_dev->num_erases[sector];
+}
+
 /**********************************
  *
  * Provide a PIOS flash driver API
@@ -114,6 +145,8 @@ static int32_t PIOS_Flash_UT_EraseSector(uintptr_t flash_id, uint32_t addr)
 
 	assert (s == flash_dev->cfg->size_of_sector);
 
+	flash_dev->num_erases[addr / flash_dev->cfg->size_of_sector]++;
+
 	return 0;
 }
 
@@ -135,6 +168,8 @@ static int32_t PIOS_Flash_UT_WriteData(uintptr_t flash_id, uint32_t addr, uint8_
 
 	assert (s == len);
 
+	flash_dev->num_writes++;
+
 	return 0;
 }
 
@@ -153,6 +188,7 @@ static int32_t PIOS_Flash_UT_ReadData(uintptr_t flash_id, uint32_t addr, uint8_t
 
 	size_t s;
 	s = fread (data, 1, len, flash_dev->flash_file);
+	flash_dev->num_reads++;
 
 	assert (s == len);
 
@@ -3,6 +3,7 @@
 #include <stdio.h>		/* printf */
 #include <stdlib.h>		/* abort */
 #include <string.h>		/* memset */
+#include <time.h>		/* clock_gettime */
 
 extern "C" {
 
@@ -265,3 +266,238 @@ TEST_F(LogfsTestCooked, WriteManyVerify) {
   EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ3_ID, 0, obj3_check, sizeof(obj3_check)));
   EXPECT_EQ(0, memcmp(obj3, obj3_check, sizeof(obj3)));
 }
+
+class LogfsTestRemount : public LogfsTestCooked {
+protected:
+  /* Mount the filesystem again, as after a reboot */
+  void Remount() {
+    PIOS_Flash_UT_Destroy(flash_id);
+    EXPECT_EQ(0, PIOS_Flash_UT_Init(&flash_id, &flash_config));
+    EXPECT_EQ(0, PIOS_FLASHFS_Logfs_Init(&fs_id, &flashfs_config, &pios_ut_flash_driver, flash_id));
+  }
+};
+
+#define NUM_SETTINGS 60
+
+TEST_F(LogfsTestRemount, RemountFindsObjects) {
+  /* Save many instances, then replace and delete some of them */
+  for (uint16_t i = 0; i < NUM_SETTINGS; i++) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1, sizeof(obj1)));
+  }
+  for (uint16_t i = 0; i < NUM_SETTINGS; i += 3) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID, i, obj1_alt, sizeof(obj1_alt)));
+  }
+  for (uint16_t i = 1; i < NUM_SETTINGS; i += 3) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID, i));
+  }
+
+  Remount();
+
+  unsigned char obj1_check[OBJ1_SIZE];
+  for (uint16_t i = 0; i < NUM_SETTINGS; i++) {
+    memset(obj1_check, 0, sizeof(obj1_check));
+    switch (i % 3) {
+    case 0:
+      EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+      EXPECT_EQ(0, memcmp(obj1_alt, obj1_check, sizeof(obj1_alt)));
+      break;
+    case 1:
+      EXPECT_EQ(-2, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+      break;
+    case 2:
+      EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID, i, obj1_check, sizeof(obj1_check)));
+      EXPECT_EQ(0, memcmp(obj1, obj1_check, sizeof(obj1)));
+      break;
+    }
+  }
+}
+
+TEST_F(LogfsTestRemount, LoadAfterRemountReadCount) {
+  for (uint16_t i = 0; i < NUM_SETTINGS; i++) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ2_ID, i, obj2, sizeof(obj2)));
+  }
+
+  Remount();
+  uint32_t mount_reads = PIOS_Flash_UT_GetReadCount(flash_id);
+
+  /* Loading every object only reads its slot header and data */
+  unsigned char obj2_check[OBJ2_SIZE];
+  for (uint16_t i = 0; i < NUM_SETTINGS; i++) {
+    EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ2_ID, i, obj2_check, sizeof(obj2_check)));
+  }
+  uint32_t load_reads = PIOS_Flash_UT_GetReadCount(flash_id) - mount_reads;
+  EXPECT_EQ((uint32_t) (2 * NUM_SETTINGS), load_reads);
+
+  /* Objects that were never saved are not looked for in flash */
+  uint32_t reads = PIOS_Flash_UT_GetReadCount(flash_id);
+  EXPECT_EQ(-2, PIOS_FLASHFS_ObjLoad(fs_id, OBJ3_ID, 0, obj2_check, sizeof(obj2_check)));
+  EXPECT_EQ(reads, PIOS_Flash_UT_GetReadCount(flash_id));
+
+  printf("%u objects: %u reads to mount, %u reads to load them all\n",
+    NUM_SETTINGS, mount_reads, load_reads);
+}
+
+#define WORKLOAD_OBJECTS 100
+#define WORKLOAD_OPERATIONS 50000
+
+/* Deterministic pseudo random numbers so failures can be reproduced */
+static uint32_t workload_rand(uint32_t * state)
+{
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+  return *state;
+}
+
+static void workload_fill(unsigned char * data, uint16_t size, uint32_t key, uint32_t version)
+{
+  for (uint16_t i = 0; i < size; i++) {
+    data[i] = (key * 31 + version * 7 + i) & 0xFF;
+  }
+}
+
+class LogfsTestWorkload : public LogfsTestRemount {
+protected:
+  virtual void SetUp() {
+    LogfsTestRemount::SetUp();
+
+    for (uint32_t i = 0; i < WORKLOAD_OBJECTS; i++) {
+      sizes[i] = 1 + (i * 37) % (flashfs_config.slot_size - 12);
+      versions[i] = 0;
+      present[i] = false;
+    }
+  }
+
+  uint32_t Reads() { return PIOS_Flash_UT_GetReadCount(flash_id); }
+  uint32_t Writes() { return PIOS_Flash_UT_GetWriteCount(flash_id); }
+  uint32_t Erases() {
+    uint32_t erases = 0;
+    for (uint32_t i = 0; i < flash_config.size_of_flash / flash_config.size_of_sector; i++) {
+      erases += PIOS_Flash_UT_GetEraseCount(flash_id, i);
+    }
+    return erases;
+  }
+
+  /* Mount again as after losing power, keeping the erase counts of the old device */
+  void PowerCycle() {
+    for (uint32_t i = 0; i < flash_config.size_of_flash / flash_config.size_of_sector; i++) {
+      erases[i] += PIOS_Flash_UT_GetEraseCount(flash_id, i);
+    }
+    Remount();
+  }
+
+  void VerifyAll() {
+    unsigned char expected[256];
+    unsigned char check[256];
+    for (uint32_t i = 0; i < WORKLOAD_OBJECTS; i++) {
+      if (present[i]) {
+        workload_fill(expected, sizes[i], i, versions[i]);
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID + i, i % 3, check, sizes[i]));
+        EXPECT_EQ(0, memcmp(expected, check, sizes[i]));
+      } else {
+        EXPECT_EQ(-2, PIOS_FLASHFS_ObjLoad(fs_id, OBJ1_ID + i, i % 3, check, sizes[i]));
+      }
+    }
+  }
+
+  /* Random saves and deletes, with the given chance in 1000 of losing power before an operation */
+  void Run(uint32_t power_loss) {
+    uint32_t state = 0x12345678;
+    unsigned char data[256];
+
+    worst_accesses = 0;
+    worst_erases = 0;
+    worst_us = 0;
+    memset(erases, 0, sizeof(erases));
+
+    for (uint32_t op = 0; op < WORKLOAD_OPERATIONS; op++) {
+      uint32_t r = workload_rand(&state);
+      uint32_t key = (r >> 12) % WORKLOAD_OBJECTS;
+
+      if ((r >> 20) % 1000 < power_loss) {
+        /* Possibly in the middle of garbage collection */
+        PowerCycle();
+        VerifyAll();
+      }
+
+      switch (r % 100) {
+      case 0 ... 4:
+        /* What the system task does when it gets to run */
+        EXPECT_EQ(0, PIOS_FLASHFS_GarbageCollect(fs_id));
+        break;
+      case 5 ... 14:
+        EXPECT_EQ(0, PIOS_FLASHFS_ObjDelete(fs_id, OBJ1_ID + key, key % 3));
+        present[key] = false;
+        break;
+      default:
+        {
+          versions[key]++;
+          workload_fill(data, sizes[key], key, versions[key]);
+
+          uint32_t accesses = Reads() + Writes();
+          uint32_t erased = Erases();
+          struct timespec start, end;
+          clock_gettime(CLOCK_MONOTONIC, &start);
+          EXPECT_EQ(0, PIOS_FLASHFS_ObjSave(fs_id, OBJ1_ID + key, key % 3, data, sizes[key]));
+          clock_gettime(CLOCK_MONOTONIC, &end);
+          accesses = Reads() + Writes() - accesses;
+          erased = Erases() - erased;
+          present[key] = true;
+
+          double us = (end.tv_sec - start.tv_sec) * 1e6 + (end.tv_nsec - start.tv_nsec) / 1e3;
+          if (us > worst_us)
+            worst_us = us;
+          if (accesses > worst_accesses)
+            worst_accesses = accesses;
+          if (erased > worst_erases)
+            worst_erases = erased;
+        }
+        break;
+      }
+    }
+
+    VerifyAll();
+    PowerCycle();
+    VerifyAll();
+  }
+
+  uint16_t sizes[WORKLOAD_OBJECTS];
+  uint32_t versions[WORKLOAD_OBJECTS];
+  bool present[WORKLOAD_OBJECTS];
+  uint32_t erases[32];
+  uint32_t worst_accesses;
+  uint32_t worst_erases;
+  double worst_us;
+};
+
+/* Not only a functional test, reports the worst ObjSave cost and how evenly the arenas wear */
+TEST_F(LogfsTestWorkload, RandomSaveDelete) {
+  Run(0);
+
+  /* A save never erases more than one sector nor copies the whole arena */
+  EXPECT_GE(1u, worst_erases);
+  EXPECT_GT((uint32_t) (WORKLOAD_OBJECTS * 4), worst_accesses);
+
+  uint32_t num_arenas = flashfs_config.total_fs_size / flashfs_config.arena_size;
+  uint32_t min_erases = 0xFFFFFFFF;
+  uint32_t max_erases = 0;
+  printf("Worst ObjSave: %.0f us, %u flash accesses, %u sector erases\nArena erases:",
+    worst_us, worst_accesses, worst_erases);
+  for (uint32_t i = 0; i < num_arenas; i++) {
+    uint32_t sector = i * flashfs_config.arena_size / flash_config.size_of_sector;
+    if (erases[sector] < min_erases)
+      min_erases = erases[sector];
+    if (erases[sector] > max_erases)
+      max_erases = erases[sector];
+    printf(" %u", erases[sector]);
+  }
+  printf("\n");
+
+  /* Wear is spread over all arenas */
+  EXPECT_GE(1u, max_erases - min_erases);
+}
+
+TEST_F(LogfsTestWorkload, RandomSaveDeletePowerLoss) {
+  /* Losing power restarts the garbage collection, the objects must survive it */
+  Run(10);
+}
@@ -0,0 +1,30 @@
+#include <stdint.h>
+
+/* Single threaded stand-ins for the parts of FreeRTOS the object manager uses */
+
+typedef void * xSemaphoreHandle;
+typedef void * xQueueHandle;
+typedef uint32_t portTickType;
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define portMAX_DELAY 0xFFFFFFFF
+#define portTICK_RATE_MS 1
+
+extern xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void);
+extern int xSemaphoreTakeRecursive(xSemaphoreHandle sem, portTickType ticks);
+extern int xSemaphoreGiveRecursive(xSemaphoreHandle sem);
+
+#define vSemaphoreCreateBinary(sem) ((sem) = xSemaphoreCreateRecursiveMutex())
+extern int xSemaphoreTake(xSemaphoreHandle sem, portTickType ticks);
+extern int xSemaphoreGive(xSemaphoreHandle sem);
+
+extern int xQueueSend(xQueueHandle queue, const void * item, portTickType ticks);
+
+extern portTickType xTaskGetTickCount(void);
+extern void vTaskSuspendAll(void);
+extern int xTaskResumeAll(void);
+#define taskYIELD()
+
+extern void * pvPortMalloc(size_t size);
+extern void vPortFree(void * ptr);
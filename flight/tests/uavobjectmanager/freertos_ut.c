@@ -0,0 +1,63 @@
+#include <stdlib.h>
+#include "openpilot.h"
+
+static int mutex;
+
+xSemaphoreHandle xSemaphoreCreateRecursiveMutex(void)
+{
+	return &mutex;
+}
+
+int xSemaphoreTakeRecursive(xSemaphoreHandle sem, portTickType ticks)
+{
+	return pdTRUE;
+}
+
+int xSemaphoreGiveRecursive(xSemaphoreHandle sem)
+{
+	return pdTRUE;
+}
+
+int xSemaphoreTake(xSemaphoreHandle sem, portTickType ticks)
+{
+	return pdTRUE;
+}
+
+int xSemaphoreGive(xSemaphoreHandle sem)
+{
+	return pdTRUE;
+}
+
+int xQueueSend(xQueueHandle queue, const void * item, portTickType ticks)
+{
+	return pdTRUE;
+}
+
+portTickType xTaskGetTickCount(void)
+{
+	return 0;
+}
+
+void vTaskSuspendAll(void)
+{
+}
+
+int xTaskResumeAll(void)
+{
+	return pdFALSE;
+}
+
+void * pvPortMalloc(size_t size)
+{
+	return malloc(size);
+}
+
+void vPortFree(void * ptr)
+{
+	free(ptr);
+}
+
+int32_t EventCallbackDispatch(UAVObjEvent* ev, UAVObjEventCallback cb)
+{
+	return pdTRUE;
+}
@@ -0,0 +1,18 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+#define PIOS_Assert(x) if (!(x)) { while (1) ; }
+
+#define PIOS_DEBUG_Assert(x) PIOS_Assert(x)
+
+#define NELEMENTS(x) (sizeof(x) / sizeof(*(x)))
+
+#include "pios.h"
+#include "FreeRTOS_ut.h"
+#include "utlist.h"
+#include "uavobjectmanager.h"
+#include "eventdispatcher.h"
+#include "uavtalk.h"
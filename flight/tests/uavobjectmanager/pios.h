@@ -0,0 +1,3 @@
+#include <stdint.h>
+
+#include "pios_crc.h"
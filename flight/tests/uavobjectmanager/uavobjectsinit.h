@@ -0,0 +1,302 @@
+/* Like a full firmware, the largest object is well above most of the others */
+#define UAVOBJECTS_LARGEST 64
+
+/* Object IDs as the generator emits them, 96 objects like a full firmware */
+#define UAVOBJECTS_COUNT 96
+#define UAVOBJECTS_IDS { \
+    0x99950D8, \
+    0xBECD7B0, \
+    0xC5C7FD0, \
+    0xCB1E29C, \
+    0xED90474, \
+    0xF21DDB6, \
+    0xF4205B4, \
+    0xFD630F0, \
+    0x1012F036, \
+    0x11E20B8E, \
+    0x128B2F32, \
+    0x14F4733E, \
+    0x1600A35A, \
+    0x1738F7D8, \
+    0x1818E810, \
+    0x18F135D2, \
+    0x1A61DBE2, \
+    0x1E27A1C0, \
+    0x1FB17C22, \
+    0x2217BEAC, \
+    0x24EDE6A4, \
+    0x269E0D36, \
+    0x2E05319A, \
+    0x2E44158A, \
+    0x301850C4, \
+    0x34B9B5DE, \
+    0x36F675CC, \
+    0x3898D190, \
+    0x39263058, \
+    0x3D9C1724, \
+    0x3E7D1BFA, \
+    0x3F98E276, \
+    0x4A23D596, \
+    0x4CBD87AC, \
+    0x4CDD2054, \
+    0x4EF8AA38, \
+    0x506BF2EE, \
+    0x52E6B438, \
+    0x57EE05CC, \
+    0x5C90A958, \
+    0x5D9DC9F8, \
+    0x5F557202, \
+    0x6513270E, \
+    0x658CDA14, \
+    0x6B0D549A, \
+    0x6B4CB242, \
+    0x6CAD4A26, \
+    0x6D76B07E, \
+    0x6F03675A, \
+    0x7403E430, \
+    0x7731AF10, \
+    0x7EBFF206, \
+    0x7F150524, \
+    0x81E74EF4, \
+    0x86734720, \
+    0x881ED162, \
+    0x892F902A, \
+    0x8A6A63EC, \
+    0x8C38FB28, \
+    0x8D116ECE, \
+    0x8E81973E, \
+    0x8F6D0558, \
+    0x907A70C2, \
+    0x90C192CE, \
+    0x92276658, \
+    0x923A7368, \
+    0x930D6EAE, \
+    0x93BD04CE, \
+    0x94E3BF90, \
+    0x9531985C, \
+    0x953F48F0, \
+    0x95E60AF4, \
+    0x95E761D0, \
+    0x9E7769B0, \
+    0xA09F76B4, \
+    0xA170B338, \
+    0xA38FD546, \
+    0xA6A3A450, \
+    0xAE2EB154, \
+    0xAE97BA94, \
+    0xB2F14C94, \
+    0xB64CE422, \
+    0xC6F87718, \
+    0xC7A2EA20, \
+    0xCB5C7426, \
+    0xD0EDA82E, \
+    0xD23F0824, \
+    0xD3AC94AE, \
+    0xDBC496CA, \
+    0xE00902C6, \
+    0xE8E25D94, \
+    0xEC66A786, \
+    0xF28C105C, \
+    0xF29D0DA8, \
+    0xF2A74DE4, \
+    0xF9EBDACC, \
+}
+
+/* Every object has four fields of four bytes */
+#define UAVOBJECTS_FIELDS_INDEX { \
+    0, \
+    4, \
+    8, \
+    12, \
+    16, \
+    20, \
+    24, \
+    28, \
+    32, \
+    36, \
+    40, \
+    44, \
+    48, \
+    52, \
+    56, \
+    60, \
+    64, \
+    68, \
+    72, \
+    76, \
+    80, \
+    84, \
+    88, \
+    92, \
+    96, \
+    100, \
+    104, \
+    108, \
+    112, \
+    116, \
+    120, \
+    124, \
+    128, \
+    132, \
+    136, \
+    140, \
+    144, \
+    148, \
+    152, \
+    156, \
+    160, \
+    164, \
+    168, \
+    172, \
+    176, \
+    180, \
+    184, \
+    188, \
+    192, \
+    196, \
+    200, \
+    204, \
+    208, \
+    212, \
+    216, \
+    220, \
+    224, \
+    228, \
+    232, \
+    236, \
+    240, \
+    244, \
+    248, \
+    252, \
+    256, \
+    260, \
+    264, \
+    268, \
+    272, \
+    276, \
+    280, \
+    284, \
+    288, \
+    292, \
+    296, \
+    300, \
+    304, \
+    308, \
+    312, \
+    316, \
+    320, \
+    324, \
+    328, \
+    332, \
+    336, \
+    340, \
+    344, \
+    348, \
+    352, \
+    356, \
+    360, \
+    364, \
+    368, \
+    372, \
+    376, \
+    380, \
+    384, \
+}
+#define UAVOBJECTS_FIELD_OFFSETS { \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+    0, 4, 8, 12, \
+}
@@ -0,0 +1,417 @@
+#include "gtest/gtest.h"
+
+#include <stdio.h>		/* printf */
+#include <stdlib.h>		/* abort */
+#include <string.h>		/* memset */
+#include <stdint.h>		/* uint*_t */
+#include <time.h>		/* clock_gettime */
+
+extern "C" {
+
+#include "openpilot.h"
+#include "uavobjectsinit.h"
+#include "uavtalk_priv.h"
+
+}
+
+#define OBJ_SIZE 16
+#define UNKNOWN_ID 0x00000100
+#define LOOKUP_ROUNDS 20000
+
+static const uint32_t ids[] = UAVOBJECTS_IDS;
+
+static UAVObjHandle listed[2 * UAVOBJECTS_COUNT + 2];
+static uint32_t numListed;
+
+static void listObject(UAVObjHandle obj)
+{
+  listed[numListed++] = obj;
+}
+
+static uint8_t sentPacket[UAVTALK_MAX_PACKET_LENGTH];
+static int32_t sentLength;
+
+static int32_t capturePacket(uint8_t *data, int32_t length)
+{
+  memcpy(sentPacket, data, length);
+  sentLength = length;
+  return length;
+}
+
+static double elapsedNs(const struct timespec &start, const struct timespec &end)
+{
+  return (end.tv_sec - start.tv_sec) * 1e9 + (end.tv_nsec - start.tv_nsec);
+}
+
+// To use a test fixture, derive a class from testing::Test.
+class UAVObjectManagerTest : public testing::Test {
+protected:
+  virtual void SetUp() {
+    ASSERT_EQ(0, UAVObjInitialize());
+
+    /* Register every object known to the table, in a different order than the IDs */
+    for (uint32_t i = 0; i < UAVOBJECTS_COUNT; i++) {
+      uint32_t n = (i * 37) % UAVOBJECTS_COUNT;
+      handles[n] = UAVObjRegister(ids[n], (n % 8) != 0, 0, OBJ_SIZE, NULL);
+      ASSERT_TRUE(handles[n] != NULL);
+    }
+  }
+
+  virtual void TearDown() {
+  }
+
+  UAVObjHandle handles[UAVOBJECTS_COUNT];
+};
+
+TEST_F(UAVObjectManagerTest, GetByIdFindsObjects) {
+  for (uint32_t n = 0; n < UAVOBJECTS_COUNT; n++) {
+    EXPECT_EQ(handles[n], UAVObjGetByID(ids[n]));
+    EXPECT_EQ(ids[n], UAVObjGetID(handles[n]));
+  }
+}
+
+TEST_F(UAVObjectManagerTest, GetByIdFindsMetaobjects) {
+  for (uint32_t n = 0; n < UAVOBJECTS_COUNT; n++) {
+    UAVObjHandle meta = UAVObjGetByID(ids[n] + 1);
+    EXPECT_EQ(UAVObjGetLinkedObj(handles[n]), meta);
+    EXPECT_TRUE(UAVObjIsMetaobject(meta));
+    EXPECT_EQ(ids[n] + 1, UAVObjGetID(meta));
+  }
+}
+
+TEST_F(UAVObjectManagerTest, DuplicateRegistration) {
+  EXPECT_TRUE(UAVObjRegister(ids[0], 1, 0, OBJ_SIZE, NULL) == NULL);
+}
+
+TEST_F(UAVObjectManagerTest, UnknownObject) {
+  EXPECT_TRUE(UAVObjGetByID(UNKNOWN_ID) == NULL);
+  EXPECT_TRUE(UAVObjGetByID(UNKNOWN_ID + 1) == NULL);
+
+  /* Objects missing from the ID table are still found */
+  UAVObjHandle obj = UAVObjRegister(UNKNOWN_ID, 1, 0, OBJ_SIZE, NULL);
+  ASSERT_TRUE(obj != NULL);
+  EXPECT_EQ(obj, UAVObjGetByID(UNKNOWN_ID));
+  EXPECT_EQ(UAVObjGetLinkedObj(obj), UAVObjGetByID(UNKNOWN_ID + 1));
+}
+
+TEST_F(UAVObjectManagerTest, SingleInstanceData) {
+  uint8_t in[OBJ_SIZE];
+  uint8_t out[OBJ_SIZE];
+
+  for (uint32_t i = 0; i < sizeof(in); i++) {
+    in[i] = 0x10 + i;
+  }
+
+  UAVObjHandle obj = handles[1];
+  ASSERT_TRUE(UAVObjIsSingleInstance(obj));
+  EXPECT_EQ(0, UAVObjSetData(obj, in));
+  EXPECT_EQ(0, UAVObjGetData(obj, out));
+  EXPECT_EQ(0, memcmp(in, out, sizeof(in)));
+
+  EXPECT_EQ(0, UAVObjGetDataField(obj, out, 4, 2));
+  EXPECT_EQ(in[4], out[0]);
+  EXPECT_EQ(in[5], out[1]);
+  EXPECT_EQ(-1, UAVObjGetDataField(obj, out, OBJ_SIZE - 1, 2));
+
+  EXPECT_EQ(-1, UAVObjGetInstanceData(obj, 1, out));
+}
+
+TEST_F(UAVObjectManagerTest, MultiInstanceData) {
+  UAVObjHandle obj = handles[0];
+  ASSERT_FALSE(UAVObjIsSingleInstance(obj));
+  EXPECT_EQ(1, UAVObjGetNumInstances(obj));
+
+  for (uint16_t instId = 1; instId < 100; instId++) {
+    EXPECT_EQ(instId, UAVObjCreateInstance(obj, NULL));
+  }
+  EXPECT_EQ(100, UAVObjGetNumInstances(obj));
+
+  /* Every instance holds its own data */
+  uint8_t data[OBJ_SIZE];
+  for (uint16_t instId = 0; instId < 100; instId++) {
+    memset(data, instId, sizeof(data));
+    EXPECT_EQ(0, UAVObjSetInstanceData(obj, instId, data));
+  }
+  for (uint16_t instId = 0; instId < 100; instId++) {
+    EXPECT_EQ(0, UAVObjGetInstanceData(obj, instId, data));
+    for (uint32_t i = 0; i < sizeof(data); i++) {
+      EXPECT_EQ(instId, data[i]);
+    }
+  }
+
+  EXPECT_EQ(-1, UAVObjGetInstanceData(obj, 100, data));
+}
+
+TEST_F(UAVObjectManagerTest, UnpackCreatesInstances) {
+  UAVObjHandle obj = handles[0];
+  uint8_t in[OBJ_SIZE];
+  uint8_t out[OBJ_SIZE];
+
+  memset(in, 0x5A, sizeof(in));
+  EXPECT_EQ(0, UAVObjUnpack(obj, 300, in));
+  EXPECT_EQ(301, UAVObjGetNumInstances(obj));
+
+  /* The instances in between are created empty */
+  EXPECT_EQ(0, UAVObjPack(obj, 150, out));
+  for (uint32_t i = 0; i < sizeof(out); i++) {
+    EXPECT_EQ(0, out[i]);
+  }
+
+  EXPECT_EQ(0, UAVObjPack(obj, 300, out));
+  EXPECT_EQ(0, memcmp(in, out, sizeof(in)));
+
+  EXPECT_EQ(-1, UAVObjUnpack(obj, UAVOBJ_MAX_INSTANCES, in));
+}
+
+TEST_F(UAVObjectManagerTest, FieldOffsets) {
+  const uint16_t *offsets = NULL;
+
+  ASSERT_EQ(4, UAVObjGetFieldOffsets(handles[5], &offsets));
+  for (uint32_t i = 0; i < 4; i++) {
+    EXPECT_EQ(4 * i, offsets[i]);
+  }
+
+  /* Metaobjects and objects missing from the table have no field offsets */
+  EXPECT_EQ(-1, UAVObjGetFieldOffsets(UAVObjGetLinkedObj(handles[5]), &offsets));
+  UAVObjHandle obj = UAVObjRegister(UNKNOWN_ID, 1, 0, OBJ_SIZE, NULL);
+  ASSERT_TRUE(obj != NULL);
+  EXPECT_EQ(-1, UAVObjGetFieldOffsets(obj, &offsets));
+}
+
+/*
+ * The receiving end of delta updates, as in the GCS: frame the packet with
+ * the flight receiver, then apply the fields in the mask to the keyframe.
+ * Deltas against another keyframe than the one held are dropped.
+ */
+class UAVTalkDeltaTest : public UAVObjectManagerTest {
+protected:
+  virtual void SetUp() {
+    UAVObjectManagerTest::SetUp();
+    tx = UAVTalkInitialize(&capturePacket);
+    rx = UAVTalkInitialize(&capturePacket);
+    ASSERT_TRUE(tx != NULL);
+    ASSERT_TRUE(rx != NULL);
+    haveKeyframe = false;
+  }
+
+  /* Send the current data of an object and take the packet off the link */
+  void send(UAVObjHandle obj, uint16_t instId) {
+    sentLength = 0;
+    ASSERT_EQ(0, UAVTalkSendObjectDelta(tx, obj, instId));
+    ASSERT_GT(sentLength, 0);
+    memcpy(packet, sentPacket, sentLength);
+    packetLength = sentLength;
+  }
+
+  /* Pass the last packet to the receiver, false if it was dropped */
+  bool receive(UAVObjHandle obj) {
+    UAVTalkRxState state = UAVTALK_STATE_ERROR;
+    for (int32_t i = 0; i < packetLength; i++) {
+      state = UAVTalkProcessInputStreamQuiet(rx, packet[i]);
+    }
+    if (state != UAVTALK_STATE_COMPLETE) {
+      return false;
+    }
+
+    UAVTalkConnectionData *connection = (UAVTalkConnectionData *) rx;
+    EXPECT_EQ(UAVTALK_TYPE_OBJ_DELTA, connection->iproc.type);
+    EXPECT_EQ(UAVObjGetID(obj), connection->iproc.objId);
+    const uint8_t *data = connection->rxBuffer;
+    uint32_t length = connection->iproc.length;
+
+    const uint16_t *offsets = NULL;
+    int32_t numFields = UAVObjGetFieldOffsets(obj, &offsets);
+    uint32_t instanceLength = UAVObjIsSingleInstance(obj) ? 0 : 2;
+    uint32_t maskLength = (numFields + 7) / 8;
+    if (instanceLength + 1 + maskLength > length) {
+      return false;
+    }
+    receivedInstId = instanceLength ? (data[0] | data[1] << 8) : 0;
+    uint8_t baseCrc = data[instanceLength];
+    const uint8_t *mask = &data[instanceLength + 1];
+    uint32_t pos = instanceLength + 1 + maskLength;
+
+    bool keyframe = true;
+    for (int32_t n = 0; n < numFields; n++) {
+      keyframe = keyframe && (mask[n / 8] & (1 << (n % 8)));
+    }
+    if (!keyframe && (!haveKeyframe || PIOS_CRC_updateCRC(0, received, OBJ_SIZE) != baseCrc)) {
+      return false;
+    }
+
+    uint8_t decoded[OBJ_SIZE];
+    memcpy(decoded, received, OBJ_SIZE);
+    for (int32_t n = 0; n < numFields; n++) {
+      uint16_t end = (n + 1 < numFields) ? offsets[n + 1] : OBJ_SIZE;
+      if (mask[n / 8] & (1 << (n % 8))) {
+        memcpy(&decoded[offsets[n]], &data[pos], end - offsets[n]);
+        pos += end - offsets[n];
+      }
+    }
+    if (pos != length) {
+      return false;
+    }
+
+    /* Only keyframes replace what the next deltas are applied to */
+    memcpy(current, decoded, OBJ_SIZE);
+    if (keyframe) {
+      memcpy(received, decoded, OBJ_SIZE);
+      haveKeyframe = true;
+    }
+    return true;
+  }
+
+  /* The field mask of the last packet */
+  uint8_t sentMask(UAVObjHandle obj) {
+    return packet[UAVTALK_MIN_HEADER_LENGTH + (UAVObjIsSingleInstance(obj) ? 0 : 2) + 1];
+  }
+
+  UAVTalkConnection tx;
+  UAVTalkConnection rx;
+  uint8_t packet[UAVTALK_MAX_PACKET_LENGTH];
+  int32_t packetLength;
+  uint8_t received[OBJ_SIZE];
+  uint8_t current[OBJ_SIZE];
+  bool haveKeyframe;
+  uint16_t receivedInstId;
+};
+
+TEST_F(UAVTalkDeltaTest, KeyframeFirst) {
+  UAVObjHandle obj = handles[1];
+  uint8_t data[OBJ_SIZE];
+
+  ASSERT_TRUE(UAVObjIsSingleInstance(obj));
+  for (uint32_t i = 0; i < sizeof(data); i++) {
+    data[i] = 0x30 + i;
+  }
+  ASSERT_EQ(0, UAVObjSetData(obj, data));
+
+  /* The first update of an object carries every field */
+  send(obj, 0);
+  EXPECT_EQ(0x0F, sentMask(obj));
+  EXPECT_EQ((int32_t) (UAVTALK_MIN_HEADER_LENGTH + 1 + 1 + OBJ_SIZE + UAVTALK_CHECKSUM_LENGTH), packetLength);
+  ASSERT_TRUE(receive(obj));
+  EXPECT_EQ(0, memcmp(data, current, sizeof(data)));
+}
+
+TEST_F(UAVTalkDeltaTest, ChangedFieldsOnly) {
+  UAVObjHandle obj = handles[0];
+  uint8_t data[OBJ_SIZE];
+
+  ASSERT_FALSE(UAVObjIsSingleInstance(obj));
+  ASSERT_EQ(1, UAVObjCreateInstance(obj, NULL));
+  memset(data, 0x11, sizeof(data));
+  ASSERT_EQ(0, UAVObjSetInstanceData(obj, 1, data));
+  send(obj, 1);
+  ASSERT_TRUE(receive(obj));
+  EXPECT_EQ(1, receivedInstId);
+
+  /* Nothing changed, only the header, keyframe checksum and mask are sent */
+  send(obj, 1);
+  EXPECT_EQ(0x00, sentMask(obj));
+  EXPECT_EQ((int32_t) (UAVTALK_MIN_HEADER_LENGTH + 2 + 1 + 1 + UAVTALK_CHECKSUM_LENGTH), packetLength);
+  ASSERT_TRUE(receive(obj));
+  EXPECT_EQ(0, memcmp(data, current, sizeof(data)));
+
+  /* Fields 1 and 3 changed */
+  memset(&data[4], 0x22, 4);
+  memset(&data[12], 0x33, 4);
+  ASSERT_EQ(0, UAVObjSetInstanceData(obj, 1, data));
+  send(obj, 1);
+  EXPECT_EQ(0x0A, sentMask(obj));
+  EXPECT_EQ((int32_t) (UAVTALK_MIN_HEADER_LENGTH + 2 + 1 + 1 + 8 + UAVTALK_CHECKSUM_LENGTH), packetLength);
+  ASSERT_TRUE(receive(obj));
+  EXPECT_EQ(1, receivedInstId);
+  EXPECT_EQ(0, memcmp(data, current, sizeof(data)));
+
+  /* Deltas stay against the keyframe, so field 1 is sent again after it is reverted */
+  memset(&data[4], 0x11, 4);
+  ASSERT_EQ(0, UAVObjSetInstanceData(obj, 1, data));
+  send(obj, 1);
+  EXPECT_EQ(0x08, sentMask(obj));
+  ASSERT_TRUE(receive(obj));
+  EXPECT_EQ(0, memcmp(data, current, sizeof(data)));
+}
+
+TEST_F(UAVTalkDeltaTest, DropsDeltaAgainstLostKeyframe) {
+  UAVObjHandle obj = handles[1];
+  uint8_t data[OBJ_SIZE];
+
+  memset(data, 0x44, sizeof(data));
+  ASSERT_EQ(0, UAVObjSetData(obj, data));
+  send(obj, 0);
+  ASSERT_TRUE(receive(obj));
+
+  /* Run up to the next keyframe with a changing field */
+  for (uint32_t n = 0; n < UAVTALK_DELTA_KEYFRAME_INTERVAL; n++) {
+    data[0] = n;
+    ASSERT_EQ(0, UAVObjSetData(obj, data));
+    send(obj, 0);
+    EXPECT_EQ(0x01, sentMask(obj));
+    ASSERT_TRUE(receive(obj));
+  }
+
+  /* The keyframe gets lost on the link */
+  data[0] = 0x55;
+  ASSERT_EQ(0, UAVObjSetData(obj, data));
+  send(obj, 0);
+  EXPECT_EQ(0x0F, sentMask(obj));
+
+  /* Deltas against it do not match the keyframe of the receiver */
+  data[4] = 0x66;
+  ASSERT_EQ(0, UAVObjSetData(obj, data));
+  send(obj, 0);
+  EXPECT_EQ(0x02, sentMask(obj));
+  EXPECT_FALSE(receive(obj));
+  EXPECT_NE(0x66, current[4]);
+
+  /* The next keyframe brings the receiver back */
+  for (uint32_t n = 1; n < UAVTALK_DELTA_KEYFRAME_INTERVAL; n++) {
+    send(obj, 0);
+    EXPECT_FALSE(receive(obj));
+  }
+  send(obj, 0);
+  EXPECT_EQ(0x0F, sentMask(obj));
+  ASSERT_TRUE(receive(obj));
+  EXPECT_EQ(0, memcmp(data, current, sizeof(data)));
+}
+
+/* Not a functional test, reports the lookup time compared to walking the object list */
+TEST_F(UAVObjectManagerTest, GetByIdBenchmark) {
+  struct timespec start, end;
+  uint32_t found = 0;
+
+  numListed = 0;
+  UAVObjIterate(&listObject);
+  ASSERT_EQ((uint32_t) (2 * UAVOBJECTS_COUNT), numListed);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t round = 0; round < LOOKUP_ROUNDS; round++) {
+    for (uint32_t n = 0; n < UAVOBJECTS_COUNT; n++) {
+      for (uint32_t i = 0; i < numListed; i++) {
+        if (UAVObjGetID(listed[i]) == ids[n] + (round & 1)) {
+          found++;
+          break;
+        }
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double linear = elapsedNs(start, end) / (LOOKUP_ROUNDS * UAVOBJECTS_COUNT);
+
+  clock_gettime(CLOCK_MONOTONIC, &start);
+  for (uint32_t round = 0; round < LOOKUP_ROUNDS; round++) {
+    for (uint32_t n = 0; n < UAVOBJECTS_COUNT; n++) {
+      if (UAVObjGetByID(ids[n] + (round & 1)) != NULL) {
+        found++;
+      }
+    }
+  }
+  clock_gettime(CLOCK_MONOTONIC, &end);
+  double indexed = elapsedNs(start, end) / (LOOKUP_ROUNDS * UAVOBJECTS_COUNT);
+
+  EXPECT_EQ((uint32_t) (2 * LOOKUP_ROUNDS * UAVOBJECTS_COUNT), found);
+
+  printf("%u objects: list walk %.1f ns, UAVObjGetByID %.1f ns per lookup\n",
+    UAVOBJECTS_COUNT, linear, indexed);
+}
@@ -31,11 +31,86 @@
 namespace core {
     qlonglong PureImageCache::ConnCounter=0;
 
+    PureImageCacheConnection::PureImageCacheConnection(const QString &file,const QString &name):file(file),name(name),insertTile(0),insertTileData(0),selectTile(0),pendingInserts(0),open(false)
+    {
+        db = QSqlDatabase::addDatabase("QSQLITE",name);
+        db.setDatabaseName(file);
+        db.setConnectOptions("QSQLITE_BUSY_TIMEOUT=5000");
+        if(!db.open())
+        {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug()<<"PureImageCacheConnection: Unable to open database "<<db.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+            return;
+        }
+        {
+            // With the write ahead log readers do not block the writer and
+            // commits do not need to sync the whole database
+            QSqlQuery query(db);
+            query.exec("PRAGMA journal_mode=WAL");
+            query.exec("PRAGMA synchronous=NORMAL");
+            // Databases created by older versions lack the index
+            query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+        }
+        insertTile=new QSqlQuery(db);
+        insertTile->prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
+        insertTileData=new QSqlQuery(db);
+        insertTileData->prepare("INSERT INTO TilesData(id, Tile) VALUES(?, ?)");
+        selectTile=new QSqlQuery(db);
+        selectTile->setForwardOnly(true);
+        selectTile->prepare("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=? AND Y=? AND Zoom=? AND Type=?)");
+        open=true;
+    }
+    PureImageCacheConnection::~PureImageCacheConnection()
+    {
+        if(open)
+            Commit();
+        delete insertTile;
+        delete insertTileData;
+        delete selectTile;
+        db.close();
+        db=QSqlDatabase();
+        QSqlDatabase::removeDatabase(name);
+    }
+    void PureImageCacheConnection::Commit()
+    {
+        if(pendingInserts==0)
+            return;
+        if(!db.commit())
+        {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug()<<"PureImageCacheConnection: Commit failed "<<db.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+        }
+        pendingInserts=0;
+    }
+
     PureImageCache::PureImageCache()
     {
 
     }
 
+    /**
+    * Get the connection of the calling thread, opening it on first use or
+    * when the cache location changed
+    */
+    PureImageCacheConnection *PureImageCache::Connection()
+    {
+        QString db=gtilecache+"Data.qmdb";
+        PureImageCacheConnection *cn=connections.localData();
+        if(cn==0 || cn->file!=db)
+        {
+            Mcounter.lock();
+            qlonglong id=++ConnCounter;
+            Mcounter.unlock();
+            // Deletes the previous connection of this thread, if any
+            connections.setLocalData(0);
+            cn=new PureImageCacheConnection(db,QString("PureImageCache%1").arg(id));
+            connections.setLocalData(cn);
+        }
+        return cn->isOpen()?cn:0;
+    }
+
     void PureImageCache::setGtileCache(const QString &value)
     {
         lock.lockForWrite();
@@ -108,6 +183,15 @@ namespace core {
         {
 #ifdef DEBUG_PUREIMAGECACHE
             qDebug()<<"CreateEmptyDB: "<<query.lastError().driverText();
+#endif //DEBUG_PUREIMAGECACHE
+            db.close();
+            return false;
+        }
+        query.exec("CREATE INDEX IF NOT EXISTS IndexOfTiles ON Tiles (X, Y, Zoom, Type)");
+        if(query.numRowsAffected()==-1)
+        {
+#ifdef DEBUG_PUREIMAGECACHE
+            qDebug()<<"CreateEmptyDB: "<<query.lastError().driverText();
 #endif //DEBUG_PUREIMAGECACHE
             db.close();
             return false;
@@ -169,6 +253,10 @@ namespace core {
         QSqlDatabase::removeDatabase(QLatin1String("CreateConn"));
         return true;
     }
+    /**
+    * Insert a tile. Inserts are grouped in a transaction which is committed by
+    * CommitPendingTiles() or once enough tiles are pending.
+    */
     bool PureImageCache::PutImageToCache(const QByteArray &tile, const MapType::Types &type,const Point &pos,const int &zoom)
     {
         if(gtilecache.isEmpty()|gtilecache.isNull())
@@ -177,80 +265,64 @@ namespace core {
 #ifdef DEBUG_PUREIMAGECACHE
         qDebug()<<"PutImageToCache Start:";//<<pos;
 #endif //DEBUG_PUREIMAGECACHE
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        bool ret=false;
+        PureImageCacheConnection *cn=Connection();
+        if(cn)
         {
-            QSqlDatabase cn;
-            cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-            QString db=gtilecache+"Data.qmdb";
-            cn.setDatabaseName(db);
-            cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-            if(cn.open())
+            if(cn->pendingInserts==0)
+                cn->db.transaction();
+            cn->insertTile->addBindValue(pos.X());
+            cn->insertTile->addBindValue(pos.Y());
+            cn->insertTile->addBindValue(zoom);
+            cn->insertTile->addBindValue((int)type);
+            cn->insertTile->addBindValue(QDateTime::currentDateTime().toString());
+            if(cn->insertTile->exec())
             {
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO Tiles(X, Y, Zoom, Type,Date) VALUES(?, ?, ?, ?,?)");
-                    query.addBindValue(pos.X());
-                    query.addBindValue(pos.Y());
-                    query.addBindValue(zoom);
-
-                    query.addBindValue((int)type);
-                    query.addBindValue(QDateTime::currentDateTime().toString());
-                    query.exec();
-                }
-                {
-                    QSqlQuery query(cn);
-                    query.prepare("INSERT INTO TilesData(id, Tile) VALUES((SELECT last_insert_rowid()), ?)");
-                    query.addBindValue(tile);
-                    query.exec();
-                }
-                cn.close();
+                cn->insertTileData->addBindValue(cn->insertTile->lastInsertId());
+                cn->insertTileData->addBindValue(tile);
+                ret=cn->insertTileData->exec();
             }
+            cn->pendingInserts++;
+            if(cn->pendingInserts>=MaxPendingInserts)
+                cn->Commit();
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
         lock.unlock();
-        return true;
+        return ret;
     }
-    QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
+    /**
+    * Commit the tiles inserted by the calling thread
+    */
+    void PureImageCache::CommitPendingTiles()
     {
         lock.lockForRead();
+        PureImageCacheConnection *cn=connections.localData();
+        if(cn && cn->isOpen())
+            cn->Commit();
+        lock.unlock();
+    }
+    QByteArray PureImageCache::GetImageFromCache(MapType::Types type, Point pos, int zoom)
+    {
         QByteArray ar;
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return ar;
-        QString dir=gtilecache;
-        Mcounter.lock();
-        qlonglong id=++ConnCounter;
-        Mcounter.unlock();
+        lock.lockForRead();
 #ifdef DEBUG_PUREIMAGECACHE
-        qDebug()<<"Cache dir="<<dir<<" Try to GET:"<<pos.X()+","+pos.Y();
+        qDebug()<<"Cache dir="<<gtilecache<<" Try to GET:"<<pos.X()+","+pos.Y();
 #endif //DEBUG_PUREIMAGECACHE
-
+        PureImageCacheConnection *cn=Connection();
+        if(cn)
         {
-            QString db=dir+"Data.qmdb";
+            cn->selectTile->addBindValue(pos.X());
+            cn->selectTile->addBindValue(pos.Y());
+            cn->selectTile->addBindValue(zoom);
+            cn->selectTile->addBindValue((int)type);
+            if(cn->selectTile->exec() && cn->selectTile->next())
             {
-                QSqlDatabase cn;
-
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
-                {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT Tile FROM TilesData WHERE id = (SELECT id FROM Tiles WHERE X=%1 AND Y=%2 AND Zoom=%3 AND Type=%4)").arg(pos.X()).arg(pos.Y()).arg(zoom).arg((int) type));
-                        query.next();
-                        if(query.isValid())
-                        {
-                            ar=query.value(0).toByteArray();
-                        }
-                    }
-                    cn.close();
-                }
+                ar=cn->selectTile->value(0).toByteArray();
             }
+            // Release the read snapshot so the log can be checkpointed
+            cn->selectTile->finish();
         }
-        QSqlDatabase::removeDatabase(QString::number(id));
         lock.unlock();
         return ar;
     }
@@ -259,41 +331,29 @@ namespace core {
         if(gtilecache.isEmpty()|gtilecache.isNull())
             return;
         QList<long> add;
-        bool ret=true;
-        QString dir=gtilecache;
+        lock.lockForRead();
+        PureImageCacheConnection *cn=Connection();
+        if(cn)
         {
-            QString db=dir+"Data.qmdb";
-            ret=QFileInfo(db).exists();
-            if(ret)
+            cn->Commit();
+            QSqlQuery query(cn->db);
+            query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
+            while(query.next())
             {
-                QSqlDatabase cn;
-                Mcounter.lock();
-                qlonglong id=++ConnCounter;
-                Mcounter.unlock();
-                cn = QSqlDatabase::addDatabase("QSQLITE",QString::number(id));
-                cn.setDatabaseName(db);
-                cn.setConnectOptions("QSQLITE_ENABLE_SHARED_CACHE");
-                if(cn.open())
-                {
-                    {
-                        QSqlQuery query(cn);
-                        query.exec(QString("SELECT id, X, Y, Zoom, Type, Date FROM Tiles"));
-                        while(query.next())
-                        {
-                            if(QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime())>days)
-                                add.append(query.value(0).toLongLong());
-                        }
-                        foreach(long i,add)
-                        {
-                            query.exec(QString("DELETE FROM Tiles WHERE id = %1;").arg(i));
-                        }
-                    }
-
-                    cn.close();
-                }
-                QSqlDatabase::removeDatabase(QString::number(id));
+                if(QDateTime::fromString(query.value(5).toString()).daysTo(QDateTime::currentDateTime())>days)
+                    add.append(query.value(0).toLongLong());
+            }
+            query.finish();
+            cn->db.transaction();
+            query.prepare("DELETE FROM Tiles WHERE id = ?");
+            foreach(long i,add)
+            {
+                query.addBindValue((qlonglong)i);
+                query.exec();
             }
+            cn->db.commit();
         }
+        lock.unlock();
     }
     // PureImageCache::ExportMapDataToDB("C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data.qmdb","C:/Users/Xapo/Documents/mapcontrol/debug/mapscache/data2.qmdb");
     bool PureImageCache::ExportMapDataToDB(QString sourceFile, QString destFile)
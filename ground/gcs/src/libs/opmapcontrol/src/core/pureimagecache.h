@@ -42,7 +42,31 @@
 #include <QList>
 #include <QMutex>
 #include <QReadWriteLock>
+#include <QThreadStorage>
 namespace core {
+    /**
+    * Connection to the tile database owned by one thread. It stays open
+    * for the life of the thread and keeps its statements prepared.
+    */
+    class PureImageCacheConnection
+    {
+    public:
+        PureImageCacheConnection(const QString &file,const QString &name);
+        ~PureImageCacheConnection();
+        bool isOpen(){return open;}
+        void Commit();
+
+        QString file;
+        QString name;
+        QSqlDatabase db;
+        QSqlQuery *insertTile;
+        QSqlQuery *insertTileData;
+        QSqlQuery *selectTile;
+        int pendingInserts;
+    private:
+        bool open;
+    };
+
     class PureImageCache
     {
 
@@ -55,11 +79,15 @@ namespace core {
         void setGtileCache(const QString &value);
         static bool ExportMapDataToDB(QString sourceFile, QString destFile);
         void deleteOlderTiles(int const& days);
+        void CommitPendingTiles();
     private:
+        PureImageCacheConnection *Connection();
         QString gtilecache;
         QMutex Mcounter;
         QReadWriteLock lock;
+        QThreadStorage<PureImageCacheConnection*> connections;
         static qlonglong ConnCounter;
+        static const int MaxPendingInserts=64;
 
     };
 
@@ -92,8 +92,13 @@ void TileCacheQueue::run()
             qDebug()<<"Cache engine Put:"<<task->GetPosition().X()<<","<<task->GetPosition().Y();
 #endif //DEBUG_TILECACHEQUEUE
             Cache::Instance()->ImageCache.PutImageToCache(task->GetImg(),task->GetMapType(),task->GetPosition(),task->GetZoom());
-            usleep(44);
             delete task;
+            // Tiles are inserted in one transaction until the queue runs dry
+            mutex.lock();
+            bool empty=tileCacheQueue.isEmpty();
+            mutex.unlock();
+            if(empty)
+                Cache::Instance()->ImageCache.CommitPendingTiles();
         }
 
         else
@@ -33,6 +33,25 @@ qlonglong internals::Core::debugcounter=0;
 using namespace projections;
 
 namespace internals {
+    /**
+     * Orders load tasks by their distance to the center tile
+     */
+    struct LoadTaskDistanceLessThan
+    {
+        LoadTaskDistanceLessThan(core::Point const& center):center(center){}
+        bool operator()(LoadTask const& lhs,LoadTask const& rhs) const
+        {
+            return Distance(lhs) < Distance(rhs);
+        }
+        qint64 Distance(LoadTask const& task) const
+        {
+            qint64 dx=task.Pos.X()-center.X();
+            qint64 dy=task.Pos.Y()-center.Y();
+            return dx*dx+dy*dy;
+        }
+        core::Point center;
+    };
+
     Core::Core():MouseWheelZooming(false),currentPosition(0,0),currentPositionPixel(0,0),LastLocationInBounds(-1,-1),sizeOfMapArea(0,0)
             ,minOfTiles(0,0),maxOfTiles(0,0),zoom(0),isDragging(false),TooltipTextPadding(10,10),mapType(MapType::None),loaderLimit(5),maxzoom(21),started(false),runningThreads(0)
     {
@@ -69,21 +88,32 @@ namespace internals {
 
         MtileLoadQueue.lock();
         {
-            if(tileLoadQueue.count() > 0)
+            // The queue is kept sorted by distance from the center, tasks which
+            // scrolled out of view or belong to another zoom level are dropped
+            while(tileLoadQueue.count() > 0 && !task.HasValue())
             {
                 task = tileLoadQueue.dequeue();
+                if(IsLoadTaskStale(task))
                 {
-
-                    last = (tileLoadQueue.count() == 0);
+                    task = LoadTask();
+                    MtileToload.lock();
+                    --tilesToload;
+                    MtileToload.unlock();
+                }
+            }
+            if(task.HasValue())
+            {
+                tileLoadInProgress.append(task);
+                last = (tileLoadQueue.count() == 0);
 #ifdef DEBUG_CORE
-                    qDebug()<<"TileLoadQueue: " << tileLoadQueue.count()<<" Point:"<<task.Pos.ToString()<<" ID="<<debug;;
+                qDebug()<<"TileLoadQueue: " << tileLoadQueue.count()<<" Point:"<<task.Pos.ToString()<<" ID="<<debug;;
 #endif //DEBUG_CORE
-                }
             }
         }
         MtileLoadQueue.unlock();
 
         if(task.HasValue())
+        {
             if(loaderLimit.tryAcquire(1,OPMaps::Instance()->Timeout))
             {
             MtileToload.lock();
@@ -101,7 +131,7 @@ namespace internals {
                 {
                     Tile* m = Matrix.TileAt(task.Pos);
 
-                    if(m==0 || m->Overlays.count() == 0)
+                    if((m==0 || m->Overlays.count() == 0) && !IsLoadTaskStale(task))
                     {
 #ifdef DEBUG_CORE
                         qDebug()<<"Fill empty TileMatrix: " + task.ToString()<<" ID="<<debug;;
@@ -140,9 +170,12 @@ namespace internals {
 
                                 if(tileImage.length()!=0)
                                 {
+                                    // Decode here rather than when painting on the GUI thread
+                                    QImage image=QImage::fromData(tileImage);
                                     Moverlays.lock();
                                     {
                                         t->Overlays.append(tileImage);
+                                        t->Images.append(image);
 #ifdef DEBUG_CORE
                                         qDebug()<<"Core::run append tileImage:"<<tileImage.length()<<" to tile:"<<t->GetPos().ToString()<<" now has "<<t->Overlays.count()<<" overlays"<<" ID="<<debug;
 #endif //DEBUG_CORE
@@ -152,7 +185,7 @@ namespace internals {
 
                                     break;
                                 }
-                                else if(OPMaps::Instance()->RetryLoadTile > 0)
+                                else if(OPMaps::Instance()->RetryLoadTile > 0 && tl == MapType::UserImage && !IsLoadTaskStale(task))
                                 {
 #ifdef DEBUG_CORE
                                     qDebug()<<"ProcessLoadTask: " << task.ToString()<< " -> empty tile, retry " << retry<<" ID="<<debug;;
@@ -165,10 +198,11 @@ namespace internals {
                                     }
                                 }
                             }
-                            while((++retry < OPMaps::Instance()->RetryLoadTile) && (tl == MapType::UserImage));
+                            while((++retry < OPMaps::Instance()->RetryLoadTile) && (tl == MapType::UserImage) && !IsLoadTaskStale(task));
                         }
 
-                        if(t->Overlays.count() > 0)
+                        // The zoom may have changed while loading, the tile would end up at the wrong place
+                        if(t->Overlays.count() > 0 && task.Zoom == zoom)
                         {
                             Matrix.SetTileAt(task.Pos,t);
                             emit OnNeedInvalidation();
@@ -223,6 +257,11 @@ namespace internals {
 #endif
             emit OnTilesStillToLoad(tilesToload<0? 0:tilesToload);
             loaderLimit.release();
+            }
+
+            MtileLoadQueue.lock();
+            tileLoadInProgress.removeOne(task);
+            MtileLoadQueue.unlock();
         }
         MrunningThreads.lock();
         --runningThreads;
@@ -663,13 +702,16 @@ namespace internals {
             emit OnTileLoadStart();
 
 
+            PruneLoadQueue();
+
             foreach(Point p,tileDrawingList)
             {
                 LoadTask task = LoadTask(p, Zoom());
                 {
                     MtileLoadQueue.lock();
                     {
-                        if(!tileLoadQueue.contains(task))
+                        // Tiles being loaded are not requested again
+                        if(!tileLoadQueue.contains(task) && !tileLoadInProgress.contains(task))
                         {
                             MtileToload.lock();
                             ++tilesToload;
@@ -685,10 +727,46 @@ namespace internals {
                 }
 
             }
+
+            // Load the tiles closest to the center first
+            MtileLoadQueue.lock();
+            qStableSort(tileLoadQueue.begin(),tileLoadQueue.end(),LoadTaskDistanceLessThan(centerTileXYLocation));
+            MtileLoadQueue.unlock();
         }
         MtileDrawingList.unlock();
         UpdateGroundResolution();
     }
+    /**
+     * @brief Core::IsLoadTaskStale A task is stale when its tile is no longer
+     * visible, because the map was dragged or zoomed since it was queued
+     */
+    bool Core::IsLoadTaskStale(LoadTask const& task)
+    {
+        if(task.Zoom != zoom)
+            return true;
+        Point center=centerTileXYLocation;
+        return qAbs(task.Pos.X()-center.X()) > sizeOfMapArea.Width() || qAbs(task.Pos.Y()-center.Y()) > sizeOfMapArea.Height();
+    }
+    /**
+     * @brief Core::PruneLoadQueue Drop the queued tasks which became stale
+     */
+    void Core::PruneLoadQueue()
+    {
+        MtileLoadQueue.lock();
+        {
+            for(int i = tileLoadQueue.count() - 1; i >= 0; --i)
+            {
+                if(IsLoadTaskStale(tileLoadQueue.at(i)))
+                {
+                    tileLoadQueue.removeAt(i);
+                    MtileToload.lock();
+                    --tilesToload;
+                    MtileToload.unlock();
+                }
+            }
+        }
+        MtileLoadQueue.unlock();
+    }
     void Core::FindTilesAround(QList<Point> &list)
     {
         list.clear();;
@@ -240,6 +240,10 @@ namespace internals {
         Rectangle CurrentRegion;
 
         QQueue<LoadTask> tileLoadQueue;
+        QList<LoadTask> tileLoadInProgress;
+
+        bool IsLoadTaskStale(LoadTask const& task);
+        void PruneLoadQueue();
 
         int zoom;
 
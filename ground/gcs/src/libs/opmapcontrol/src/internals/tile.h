@@ -54,6 +54,7 @@ public:
     }
     bool HasValue(){return !(zoom==0);}
     QList<QByteArray> Overlays;
+    QList<QImage> Images; //Decoded Overlays, so painting does not decode
 protected:
 
     QMutex mutex;
@@ -365,14 +365,14 @@ namespace mapcontrol
                             //lock(t.Overlays)
                             if(t!=0)
                             {
-                                foreach(QByteArray img,t->Overlays)
+                                foreach(QImage img,t->Images)
                                 {
-                                    if(img.count()!=0)
+                                    if(!img.isNull())
                                     {
                                         if(!found)
                                             found = true;
                                         {
-                                            painter->drawPixmap(core->tileRect.X(),core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height(),PureImageProxy::FromStream(img));
+                                            painter->drawImage(QRectF(core->tileRect.X(),core->tileRect.Y(), core->tileRect.Width(), core->tileRect.Height()),img);
                                         }
                                     }
                                 }
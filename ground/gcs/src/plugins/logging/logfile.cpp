@@ -2,16 +2,23 @@
 #include <QDebug>
 #include <QtGlobal>
 #include <QTextStream>
+#include <QDataStream>
+#include <QtEndian>
  #include <QMessageBox>
 
 // autogenerated version info string. MUST GO BEFORE coreconstants.h INCLUDE
 #include "../../../../../build/ground/gcs/gcsversioninfo.h"
 
 #include <coreplugin/coreconstants.h>
+#include <extensionsystem/pluginmanager.h>
 
 LogFile::LogFile(QObject *parent) :
     QIODevice(parent),
-    timestampBufferIdx(0)
+    objMngr(NULL),
+    dataStart(0),
+    dataEnd(0),
+    lastTimeStampPos(0),
+    lastDataSize(0)
 {
     connect(&timer, SIGNAL(timeout()), this, SLOT(timerFired()));
 }
@@ -40,6 +47,9 @@ bool LogFile::open(OpenMode mode) {
         return false;
     }
 
+    secondIndex.clear();
+    objectIndex.clear();
+
     // TODO: Write a header at the beginng describing objects so that in future
     // they can be read back if ID's change
 
@@ -117,6 +127,8 @@ void LogFile::close()
 
     if (timer.isActive())
         timer.stop();
+    if (file.isOpen() && file.isWritable())
+        writeIndex();
     file.close();
     QIODevice::close();
 }
@@ -127,6 +139,8 @@ qint64 LogFile::writeData(const char * data, qint64 dataSize) {
 
     quint32 timeStamp = myTime.elapsed();
 
+    indexRecord(file.pos(), timeStamp, data, dataSize);
+
     file.write((char *) &timeStamp,sizeof(timeStamp));
     file.write((char *) &dataSize, sizeof(dataSize));
 
@@ -152,68 +166,54 @@ qint64 LogFile::bytesAvailable() const
 
 void LogFile::timerFired()
 {
-    qint64 dataSize;
+    int time;
+    time = myTime.elapsed();
 
-    if(file.bytesAvailable() > 4)
+    //Read packets
+    while ((lastPlayTime + ((time - lastPlayTimeOffset)* playbackSpeed) > lastTimeStamp))
     {
+        lastPlayTime += ((time - lastPlayTimeOffset)* playbackSpeed);
 
-        int time;
-        time = myTime.elapsed();
+        if (lastDataSize<1 || lastDataSize>(1024*1024)) {
+            qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << lastDataSize << "\n";
+            stopReplay();
+            return;
+        }
+        if (lastTimeStampPos + RECORD_HEADER_LENGTH + lastDataSize > dataEnd) {
+            stopReplay();
+            return;
+        }
+
+        // Records are replayed in file order, so this normally does not move
+        if (file.pos() != lastTimeStampPos + RECORD_HEADER_LENGTH)
+            file.seek(lastTimeStampPos + RECORD_HEADER_LENGTH);
 
-        //Read packets
-        while ((lastPlayTime + ((time - lastPlayTimeOffset)* playbackSpeed) > lastTimeStamp))
-        {
-            lastPlayTime += ((time - lastPlayTimeOffset)* playbackSpeed);
-            if(file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
-
-            file.seek(lastTimeStampPos+sizeof(lastTimeStamp));
-
-            file.read((char *) &dataSize, sizeof(dataSize));
-
-            if (dataSize<1 || dataSize>(1024*1024)) {
-                qDebug() << "Error: Logfile corrupted! Unlikely packet size: " << dataSize << "\n";
-                stopReplay();
-                return;
-            }
-            if(file.bytesAvailable() < dataSize) {
-                stopReplay();
-                return;
-            }
-
-            mutex.lock();
-            dataBuffer.append(file.read(dataSize));
-            mutex.unlock();
-            emit readyRead();
-
-            if(file.bytesAvailable() < 4) {
-                stopReplay();
-                return;
-            }
-
-            int save=lastTimeStamp;
-
-            lastTimeStampPos=timestampPos[timestampBufferIdx];
-            lastTimeStamp = timestampBuffer[timestampBufferIdx];
-            timestampBufferIdx++;
-            // some validity checks
-            if (lastTimeStamp<save // logfile goies back in time
-                    || (lastTimeStamp-save) > (60*60*1000)) { // gap of more than 60 minutes)
-                qDebug() << "Error: Logfile corrupted! Unlikely timestamp " << lastTimeStamp << " after "<< save << "\n";
-                stopReplay();
-                return;
-            }
-
-            lastPlayTimeOffset = time;
-            time = myTime.elapsed();
+        mutex.lock();
+        dataBuffer.append(file.read(lastDataSize));
+        mutex.unlock();
+        emit readyRead();
 
+        int save=lastTimeStamp;
+
+        quint32 timeStamp;
+        lastTimeStampPos += RECORD_HEADER_LENGTH + lastDataSize;
+        if (!readRecordHeader(lastTimeStampPos, timeStamp, lastDataSize)) {
+            stopReplay();
+            return;
+        }
+        lastTimeStamp = timeStamp;
+
+        // some validity checks
+        if (lastTimeStamp<save // logfile goies back in time
+                || (lastTimeStamp-save) > (60*60*1000)) { // gap of more than 60 minutes)
+            qDebug() << "Error: Logfile corrupted! Unlikely timestamp " << lastTimeStamp << " after "<< save << "\n";
+            stopReplay();
+            return;
         }
-    } else {
-        stopReplay();
-    }
 
+        lastPlayTimeOffset = time;
+        time = myTime.elapsed();
+    }
 }
 
 bool LogFile::startReplay() {
@@ -223,49 +223,16 @@ bool LogFile::startReplay() {
     lastPlayTime = 0;
     playbackSpeed = 1;
 
-    //Read all log timestamps into array
-    timestampBuffer.clear(); //Save beginning of log for later use
-    timestampPos.clear();
-    quint64 logFileStartIdx=file.pos();
-    timestampBufferIdx=0;
-    lastTimeStamp=0;
-
-    while (!file.atEnd()){
-        qint64 dataSize;
-
-        //Get time stamp position
-        timestampPos.append(file.pos());
-
-        //Read timestamp and logfile packet size
-        file.read((char *) &lastTimeStamp, sizeof(lastTimeStamp));
-        file.read((char *) &dataSize, sizeof(dataSize));
-
-        //Check if dataSize sync bytes are correct.
-        //TODO: LIKELY AS NOT, THIS WILL FAIL TO RESYNC BECAUSE THERE IS TOO LITTLE INFORMATION IN THE STRING OF SIX 0x00
-        if ((dataSize & 0xFFFFFFFFFFFF0000)!=0){
-            qDebug() << "Wrong sync byte. At file location 0x"  << QString("%1").arg(file.pos(),0,16) << "Got 0x" << QString("%1").arg(dataSize & 0xFFFFFFFFFFFF0000,0,16) << ", but expected 0x""00"".";
-            file.seek(timestampPos.last()+1);
-            timestampPos.pop_back();
-            continue;
-        }
-
-        //Check if timestamps are sequential.
-        if (!timestampBuffer.isEmpty() && lastTimeStamp < timestampBuffer.last()){
-            QMessageBox msgBox;
-            msgBox.setText("Corrupted file.");
-            msgBox.setInformativeText("Timestamps are not sequential. Playback may have unexpected behavior"); //<--TODO: add hyperlink to webpage with better description.
-            msgBox.exec();
-
-            qDebug() << "Timestamp: " << timestampBuffer.last() << " " << lastTimeStamp;
-        }
-
-        timestampBuffer.append(lastTimeStamp);
-
-        file.seek(timestampPos.last()+sizeof(lastTimeStamp)+sizeof(dataSize)+dataSize);
-    }
+    // Use the index at the end of the file when there is one, otherwise
+    // fall back to scanning the whole log
+    dataStart = file.pos();
+    if (!loadIndex())
+        buildIndex();
 
     //Check if any timestamps were successfully read
-    if (timestampBuffer.size() == 0){
+    quint32 timeStamp = 0;
+    lastTimeStampPos = dataStart;
+    if (secondIndex.isEmpty() || !readRecordHeader(lastTimeStampPos, timeStamp, lastDataSize)){
         QMessageBox msgBox;
         msgBox.setText("Empty logfile.");
         msgBox.setInformativeText("No log data can be found."); //<--TODO: add hyperlink to webpage with better description.
@@ -274,13 +241,8 @@ bool LogFile::startReplay() {
         stopReplay();
         return false;
     }
+    lastTimeStamp = timeStamp;
 
-    //Reset to log beginning. WHY DOES PLAYBACK FAIL IF I DON'T DO THIS?
-    file.seek(logFileStartIdx+sizeof(lastTimeStamp));
-
-    lastTimeStampPos=timestampPos[timestampBufferIdx];
-    lastTimeStamp = timestampBuffer[timestampBufferIdx];
-    timestampBufferIdx++;
     timer.setInterval(10);
     timer.start();
     emit replayStarted();
@@ -306,21 +268,322 @@ void LogFile::resumeReplay()
 
 /**
  * @brief LogFile::setReplayTime, sets the playback time
- * @param val, the time in
+ * @param val, the time in seconds
  */
 void LogFile::setReplayTime(double val)
 {
-    quint32 tmpIdx=0;
-    while(timestampBuffer[tmpIdx++] <= val*1000 && tmpIdx <= timestampBufferIdx){
+    if (val < 0)
+        val = 0;
+
+    seekReplay(val * 1000);
+}
+
+/**
+ * Moves the replay to the given time. The last packet of every object logged
+ * before that time is sent first, so that the objects hold the same values
+ * as if the log had been replayed up to there.
+ * @param msec Time from the beginning of the log in ms
+ * @return true if the replay position was changed
+ */
+bool LogFile::seekReplay(quint32 msec)
+{
+    if (!file.isOpen() || secondIndex.isEmpty())
+        return false;
+
+    quint32 second = qMin(msec / 1000, (quint32)(secondIndex.size() - 1));
+
+    // Last record of each object instance in the seconds before the target one
+    QList<qint64> restorePos;
+    QHash<quint64, QVector<ObjectIndexEntry> >::const_iterator it;
+    for (it = objectIndex.constBegin(); it != objectIndex.constEnd(); ++it) {
+        const QVector<ObjectIndexEntry> &entries = it.value();
+        int low = 0;
+        int high = entries.size();
+        while (low < high) {
+            int mid = (low + high) / 2;
+            if (entries[mid].second < second)
+                low = mid + 1;
+            else
+                high = mid;
+        }
+        if (low > 0)
+            restorePos.append(entries[low - 1].pos);
     }
+    qSort(restorePos);
 
-    lastTimeStampPos=timestampPos[tmpIdx];
-    lastTimeStamp=timestampBuffer[tmpIdx];
-    timestampBufferIdx=tmpIdx;
+    QByteArray restoreData;
+    foreach (qint64 pos, restorePos) {
+        quint32 timeStamp;
+        qint64 dataSize;
+        if (readRecordHeader(pos, timeStamp, dataSize) && dataSize > 0 && dataSize <= 1024*1024)
+            restoreData.append(file.read(dataSize));
+    }
+
+    // Within the target second, pass on the packets up to the requested time
+    qint64 pos = secondIndex[second];
+    quint32 timeStamp;
+    qint64 dataSize;
+    bool found = readRecordHeader(pos, timeStamp, dataSize);
+    while (found && timeStamp < msec && dataSize > 0 && dataSize <= 1024*1024) {
+        restoreData.append(file.read(dataSize));
+        pos += RECORD_HEADER_LENGTH + dataSize;
+        found = readRecordHeader(pos, timeStamp, dataSize);
+    }
+
+    mutex.lock();
+    dataBuffer.append(restoreData);
+    mutex.unlock();
+    if (!restoreData.isEmpty())
+        emit readyRead();
+
+    if (!found) {
+        stopReplay();
+        return true;
+    }
+
+    lastTimeStampPos = pos;
+    lastTimeStamp = timeStamp;
+    lastDataSize = dataSize;
 
     lastPlayTimeOffset = myTime.elapsed();
-    lastPlayTime=lastTimeStamp;
+    lastPlayTime = msec;
 
-    qDebug() << "Replaying at: " << lastTimeStamp << ", but requestion at" << val*1000;
+    qDebug() << "Replaying at: " << lastTimeStamp << ", but requestion at" << msec;
+    return true;
 }
 
+/**
+ * Adds a record to the index of the file being written.
+ * @param pos Position of the record in the file
+ * @param timeStamp Timestamp of the record in ms
+ * @param data The UAVTalk packet held by the record
+ * @param dataSize Length of the packet
+ */
+void LogFile::indexRecord(qint64 pos, quint32 timeStamp, const char *data, qint64 dataSize)
+{
+    quint32 second = timeStamp / 1000;
+    while ((quint32)secondIndex.size() <= second)
+        secondIndex.append(pos);
+
+    // Only index packets which start with the UAVTalk sync byte, the
+    // object ID follows the sync, type and length fields
+    if (dataSize < 8 || (quint8)data[0] != 0x3C)
+        return;
+
+    QVector<ObjectIndexEntry> &entries = objectIndex[indexKey(data, dataSize)];
+    if (!entries.isEmpty() && entries.last().second == second) {
+        entries.last().pos = pos;
+    } else {
+        ObjectIndexEntry entry;
+        entry.second = second;
+        entry.pos = pos;
+        entries.append(entry);
+    }
+}
+
+/**
+ * Key of the index for a UAVTalk packet, made of the object ID and, for
+ * multi instance objects, the instance ID which follows it.
+ * @param data The UAVTalk packet, at least 8 bytes long
+ * @param dataSize Length of the packet
+ */
+quint64 LogFile::indexKey(const char *data, qint64 dataSize)
+{
+    quint32 objId = qFromLittleEndian<quint32>((const uchar *)data + 4);
+    quint16 instId = 0;
+
+    if (objMngr == NULL)
+        objMngr = ExtensionSystem::PluginManager::instance()->getObject<UAVObjectManager>();
+
+    // Only the object knows whether the packet carries an instance ID
+    UAVObject *obj = objMngr ? objMngr->getObject(objId) : NULL;
+    if (obj != NULL && !obj->isSingleInstance() && dataSize >= 10)
+        instId = qFromLittleEndian<quint16>((const uchar *)data + 8);
+
+    return ((quint64)objId << 16) | instId;
+}
+
+/**
+ * Appends the index as the last record of the file. The record ends with
+ * its own position, the format version and a magic number, so that readers
+ * can find it from the end of the file.
+ */
+void LogFile::writeIndex()
+{
+    // Readers without index support stop at a record without data, so they
+    // never pass the index on as a UAVTalk packet
+    quint32 timeStamp = myTime.elapsed();
+    qint64 dataSize = 0;
+    file.write((char *) &timeStamp, sizeof(timeStamp));
+    file.write((char *) &dataSize, sizeof(dataSize));
+
+    qint64 indexPos = file.pos();
+
+    QByteArray index;
+    QDataStream out(&index, QIODevice::WriteOnly);
+    out.setByteOrder(QDataStream::LittleEndian);
+
+    out << (quint32)secondIndex.size();
+    foreach (qint64 pos, secondIndex)
+        out << pos;
+
+    out << (quint32)objectIndex.size();
+    QHash<quint64, QVector<ObjectIndexEntry> >::const_iterator it;
+    for (it = objectIndex.constBegin(); it != objectIndex.constEnd(); ++it) {
+        out << (quint32)(it.key() >> 16) << (quint16)it.key() << (quint32)it.value().size();
+        foreach (const ObjectIndexEntry &entry, it.value())
+            out << entry.second << entry.pos;
+    }
+
+    out << indexPos << LOG_FORMAT_VERSION << INDEX_MAGIC;
+
+    dataSize = index.size();
+    file.write((char *) &timeStamp, sizeof(timeStamp));
+    file.write((char *) &dataSize, sizeof(dataSize));
+    file.write(index);
+}
+
+/**
+ * Reads the index from the end of the file.
+ * @return false if the file has no valid index, as is the case for logs
+ * written by older versions or not closed properly
+ */
+bool LogFile::loadIndex()
+{
+    secondIndex.clear();
+    objectIndex.clear();
+
+    qint64 fileSize = file.size();
+    dataEnd = fileSize;
+    if (fileSize - dataStart < RECORD_HEADER_LENGTH + INDEX_TRAILER_LENGTH)
+        return false;
+
+    file.seek(fileSize - INDEX_TRAILER_LENGTH);
+    QDataStream trailer(file.read(INDEX_TRAILER_LENGTH));
+    trailer.setByteOrder(QDataStream::LittleEndian);
+    qint64 indexPos;
+    quint32 version;
+    quint32 magic;
+    trailer >> indexPos >> version >> magic;
+
+    if (trailer.status() != QDataStream::Ok || magic != INDEX_MAGIC ||
+            indexPos < dataStart || indexPos > fileSize - RECORD_HEADER_LENGTH - INDEX_TRAILER_LENGTH)
+        return false;
+
+    // Never replay the index, or the empty record in front of it, even when
+    // the index itself cannot be used
+    dataEnd = indexPos;
+    if (version != LOG_FORMAT_VERSION)
+        return false;
+    if (indexPos - RECORD_HEADER_LENGTH >= dataStart)
+        dataEnd = indexPos - RECORD_HEADER_LENGTH;
+
+    // The index is a record of its own which spans the rest of the file
+    quint32 timeStamp;
+    qint64 indexSize;
+    file.seek(indexPos);
+    file.read((char *) &timeStamp, sizeof(timeStamp));
+    file.read((char *) &indexSize, sizeof(indexSize));
+    if (indexSize != fileSize - indexPos - RECORD_HEADER_LENGTH)
+        return false;
+
+    QByteArray index = file.read(indexSize);
+    QDataStream in(index);
+    in.setByteOrder(QDataStream::LittleEndian);
+
+    quint32 numSeconds;
+    in >> numSeconds;
+    if (numSeconds > indexSize / sizeof(qint64))
+        return false;
+    secondIndex.resize(numSeconds);
+    for (quint32 i = 0; i < numSeconds; i++)
+        in >> secondIndex[i];
+
+    quint32 numObjects;
+    in >> numObjects;
+    for (quint32 i = 0; i < numObjects && in.status() == QDataStream::Ok; i++) {
+        quint32 objId;
+        quint16 instId;
+        quint32 numEntries;
+        in >> objId >> instId >> numEntries;
+        if (numEntries > indexSize / sizeof(ObjectIndexEntry))
+            break;
+        QVector<ObjectIndexEntry> &entries = objectIndex[((quint64)objId << 16) | instId];
+        entries.resize(numEntries);
+        for (quint32 j = 0; j < numEntries; j++)
+            in >> entries[j].second >> entries[j].pos;
+    }
+
+    if (in.status() != QDataStream::Ok || objectIndex.size() != (int)numObjects) {
+        qDebug() << "Logfile index corrupted, scanning the file instead";
+        secondIndex.clear();
+        objectIndex.clear();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * Builds the index by reading the header of every record, for logs which
+ * were written without one. Only the records before dataEnd, as set by
+ * loadIndex(), are indexed.
+ */
+void LogFile::buildIndex()
+{
+    secondIndex.clear();
+    objectIndex.clear();
+
+    qint64 pos = dataStart;
+    quint32 timeStamp;
+    qint64 dataSize;
+    quint32 previousTimeStamp = 0;
+    bool first = true;
+
+    while (readRecordHeader(pos, timeStamp, dataSize)) {
+        //Check if timestamps are sequential.
+        if (!first && timeStamp < previousTimeStamp){
+            QMessageBox msgBox;
+            msgBox.setText("Corrupted file.");
+            msgBox.setInformativeText("Timestamps are not sequential. Playback may have unexpected behavior"); //<--TODO: add hyperlink to webpage with better description.
+            msgBox.exec();
+
+            qDebug() << "Timestamp: " << previousTimeStamp << " " << timeStamp;
+        }
+        first = false;
+        previousTimeStamp = timeStamp;
+
+        // Only the start of the packet is needed to find the object and instance ID
+        QByteArray data = file.read(qMin(dataSize, (qint64)10));
+        indexRecord(pos, timeStamp, data.constData(), data.size());
+
+        pos += RECORD_HEADER_LENGTH + dataSize;
+    }
+}
+
+/**
+ * Reads the timestamp and size of the record at the given position, skipping
+ * ahead byte by byte if the size does not look valid.
+ * @param pos Position of the record, updated when bytes were skipped
+ * @return false if there is no record left before the end of the data
+ */
+bool LogFile::readRecordHeader(qint64 &pos, quint32 &timeStamp, qint64 &dataSize)
+{
+    while (pos + RECORD_HEADER_LENGTH <= dataEnd) {
+        if (file.pos() != pos)
+            file.seek(pos);
+
+        //Read timestamp and logfile packet size
+        file.read((char *) &timeStamp, sizeof(timeStamp));
+        file.read((char *) &dataSize, sizeof(dataSize));
+
+        //Check if dataSize sync bytes are correct.
+        //TODO: LIKELY AS NOT, THIS WILL FAIL TO RESYNC BECAUSE THERE IS TOO LITTLE INFORMATION IN THE STRING OF SIX 0x00
+        if ((dataSize & 0xFFFFFFFFFFFF0000)==0)
+            return true;
+
+        qDebug() << "Wrong sync byte. At file location 0x"  << QString("%1").arg(file.pos(),0,16) << "Got 0x" << QString("%1").arg(dataSize & 0xFFFFFFFFFFFF0000,0,16) << ", but expected 0x""00"".";
+        pos++;
+    }
+    return false;
+}
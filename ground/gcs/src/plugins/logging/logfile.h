@@ -7,6 +7,8 @@
 #include <QMutexLocker>
 #include <QDebug>
 #include <QBuffer>
+#include <QHash>
+#include <QVector>
 #include "uavobjectmanager.h"
 #include <math.h>
 
@@ -25,6 +27,7 @@ public:
 
     bool startReplay();
     bool stopReplay();
+    bool seekReplay(quint32 msec);
 
 public slots:
     void setReplaySpeed(double val) { playbackSpeed = val; qDebug() << "New playback speed: " << playbackSpeed; }
@@ -54,10 +57,41 @@ protected:
     double playbackSpeed;
 
 private:
-    QList<qint32> timestampBuffer;
-    QList<qint32> timestampPos;
-    quint32 timestampBufferIdx;
-    qint32 lastTimeStampPos;
+    /**
+     * Log files are a sequence of records made of a 32 bit timestamp in ms,
+     * a 64 bit data size and the UAVTalk packet. Indexed files end with an
+     * empty record, which makes readers without index support stop there,
+     * and one more record holding the index, so that replay does not need
+     * to scan the file. Files without it are indexed by a scan when opened.
+     */
+    static const quint32 LOG_FORMAT_VERSION = 2;
+    static const quint32 INDEX_MAGIC = 0x58494C54; // "TLIX"
+    static const qint64 RECORD_HEADER_LENGTH = sizeof(quint32) + sizeof(qint64);
+    static const qint64 INDEX_TRAILER_LENGTH = sizeof(qint64) + 2 * sizeof(quint32);
+
+    //! Last record of an object instance within one second of the log
+    struct ObjectIndexEntry {
+        quint32 second;
+        qint64 pos;
+    };
+
+    void indexRecord(qint64 pos, quint32 timeStamp, const char *data, qint64 dataSize);
+    void writeIndex();
+    bool loadIndex();
+    void buildIndex();
+    quint64 indexKey(const char *data, qint64 dataSize);
+    bool readRecordHeader(qint64 &pos, quint32 &timeStamp, qint64 &dataSize);
+
+    //! Position of the first record of every second of the log
+    QVector<qint64> secondIndex;
+    //! Last record of every second in which an object instance was logged,
+    //! by object ID in the upper and instance ID in the lower 16 bits
+    QHash<quint64, QVector<ObjectIndexEntry> > objectIndex;
+    UAVObjectManager *objMngr;
+    qint64 dataStart;
+    qint64 dataEnd;
+    qint64 lastTimeStampPos;
+    qint64 lastDataSize;
 };
 
 #endif // LOGFILE_H
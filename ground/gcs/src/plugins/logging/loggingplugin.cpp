@@ -440,6 +440,22 @@ void LoggingPlugin::replayStopped()
     emit stateChanged("IDLE");
 }
 
+/**
+  * Moves the replay in progress to the given time
+  * @param[in] seconds Time from the beginning of the log
+  * @return true if a replay is running and its position was changed
+  */
+bool LoggingPlugin::seekReplay(double seconds)
+{
+    if (state != REPLAY)
+        return false;
+
+    if (seconds < 0)
+        seconds = 0;
+
+    return getLogfile()->seekReplay(seconds * 1000);
+}
+
 /**
   * Received the replay started signal from the LogFile
   */
@@ -125,6 +125,7 @@ public:
     LoggingConnection* getLogConnection() { return logConnection; };
     LogFile* getLogfile() { return logConnection->getLogfile();}
     void setLogMenuTitle(QString str);
+    bool seekReplay(double seconds);
 
 
 signals:
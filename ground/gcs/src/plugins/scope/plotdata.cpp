@@ -30,6 +30,69 @@
 #include <math.h>
 #include <QDebug>
 
+PlotBuffer::PlotBuffer()
+{
+    m_capacity = 0;
+    m_start = 0;
+    m_size = 0;
+}
+
+/*!
+  \brief Change the capacity of the buffer, keeping the newest samples that fit.
+  */
+void PlotBuffer::setCapacity(int capacity)
+{
+    QVector<double> buffer(2 * capacity);
+    int size = qMin(m_size, capacity);
+    for (int i = 0; i < size; i++) {
+        double value = at(m_size - size + i);
+        buffer[i] = value;
+        buffer[i + capacity] = value;
+    }
+
+    m_buffer = buffer;
+    m_capacity = capacity;
+    m_start = 0;
+    m_size = size;
+}
+
+/*!
+  \brief Append a sample, dropping the oldest one if the buffer is full.
+  */
+void PlotBuffer::append(double value)
+{
+    if (m_capacity == 0)
+        return;
+
+    int pos = m_start + m_size;
+    if (pos >= m_capacity)
+        pos -= m_capacity;
+
+    m_buffer[pos] = value;
+    m_buffer[pos + m_capacity] = value;
+
+    if (m_size < m_capacity)
+        m_size++;
+    else if (++m_start == m_capacity)
+        m_start = 0;
+}
+
+void PlotBuffer::removeFirst()
+{
+    if (m_size == 0)
+        return;
+
+    m_size--;
+    if (++m_start == m_capacity)
+        m_start = 0;
+}
+
+void PlotBuffer::clear()
+{
+    m_start = 0;
+    m_size = 0;
+}
+
 PlotData::PlotData(QString p_uavObject, QString p_uavField)
 {    
     uavObject = p_uavObject;
@@ -47,199 +110,250 @@ PlotData::PlotData(QString p_uavObject, QString p_uavField)
         haveSubField = false;
     }
 
-    xData = new QVector<double>();
-    yData = new QVector<double>();
-    yDataHistory = new QVector<double>();
-
     curve = 0;
     scalePower = 0;
     meanSamples = 1;
-    meanSum = 0.0f;
 //    mathFunction=0;
-    correctionSum = 0.0f;
-    correctionCount = 0;
     yMinimum = 0;
     yMaximum = 0;
 
     m_xWindowSize = 0;
+    m_plotColumns = 0;
+
+    m_object = 0;
+    m_field = 0;
+    m_elementIndex = 0;
+    m_scale = 1;
+    m_mathFunction = MathNone;
+
+    m_mean = 0;
+    m_m2 = 0;
+    m_correctionMean = 0;
+    m_correctionM2 = 0;
+    m_correctionCount = 0;
 }
 
-double PlotData::valueAsDouble(UAVObject* obj, UAVObjectField* field)
+PlotData::~PlotData()
 {
-    Q_UNUSED(obj);
-    QVariant value;
+}
+
+/*!
+  \brief Check whether an updated object feeds this curve. The field, element
+  index, scaling, math function and buffers are set up the first time the
+  object is seen and cached for all following updates.
+  */
+bool PlotData::resolveField(UAVObject* obj)
+{
+    if (obj == m_object)
+        return m_field != 0;
+
+    if (m_object != 0 || uavObject != obj->getName())
+        return false;
+
+    m_object = obj;
+    m_field = obj->getField(uavField);
+    if (m_field && haveSubField)
+        m_elementIndex = m_field->getElementNames().indexOf(uavSubField);
+
+    m_scale = pow(10, scalePower);
 
-    if(haveSubField){
-        int indexOfSubField = field->getElementNames().indexOf(QRegExp(uavSubField, Qt::CaseSensitive, QRegExp::FixedString));
-        value = field->getValue(indexOfSubField);
-    }else
-        value = field->getValue();
+    if (mathFunction == "Boxcar average")
+        m_mathFunction = MathBoxcarAverage;
+    else if (mathFunction == "Standard deviation")
+        m_mathFunction = MathStandardDeviation;
+    else
+        m_mathFunction = MathNone;
 
-    // qDebug() << "Data  (" << value.typeName() << ") " <<  value.toString();
+    setupBuffers();
 
-    return value.toDouble();
+    return m_field != 0;
 }
 
-PlotData::~PlotData()
+/*!
+  \brief Size the sample buffers once the plot parameters are known.
+  */
+void PlotData::setupBuffers()
 {
-    delete xData;
-    delete yData;
-    delete yDataHistory;
+    yDataHistory.setCapacity(qMax(meanSamples, 1));
+    updatePlotCurveData();
 }
 
+/*!
+  \brief Read the current, scaled value of the cached field element.
+  */
+double PlotData::readValue()
+{
+    return m_field->getDouble(m_elementIndex) * m_scale;
+}
 
-bool SequentialPlotData::append(UAVObject* obj)
+/*!
+  \brief Apply the curve's math function to a new sample. The boxcar mean and
+  variance are updated incrementally with Welford's method, so the cost per
+  sample does not depend on the averaging window.
+  */
+double PlotData::applyMath(double value)
 {
-    if (uavObject == obj->getName()) {
-
-        //Get the field of interest
-        UAVObjectField* field =  obj->getField(uavField);
-
-        if (field) {
-
-            double currentValue = valueAsDouble(obj, field) * pow(10, scalePower);
-
-            //Perform scope math, if necessary
-            if (mathFunction  == "Boxcar average" || mathFunction  == "Standard deviation"){
-                //Put the new value at the front
-                yDataHistory->append( currentValue );
-
-                // calculate average value
-                meanSum += currentValue;
-                if(yDataHistory->size() > meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
-
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum+=currentValue;
-                if (++correctionCount >= meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
-
-                double boxcarAvg=meanSum/yDataHistory->size();
-
-                if ( mathFunction  == "Standard deviation" ){
-                    //Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum=0;
-                    for (int i=0; i < yDataHistory->size(); i++){
-                        stdSum+= pow(yDataHistory->at(i)- boxcarAvg,2)/(meanSamples-1);
-                    }
-                    yData->append(sqrt(stdSum));
-                }
-                else  {
-                    yData->append(boxcarAvg);
-                }
-            }
-            else{
-                yData->append( currentValue );
-            }
-
-            if (yData->size() > m_xWindowSize) { //If new data overflows the window, remove old data...
-                yData->pop_front();
-            } else //...otherwise, add a new y point at position xData
-                xData->insert(xData->size(), xData->size());
-
-            //notify the gui of changes in the data
-            //dataChanged();
-            return true;
-        }
+    if (m_mathFunction == MathNone)
+        return value;
+
+    if (yDataHistory.isFull()) {
+        // The new sample replaces the oldest one in the window
+        double oldest = yDataHistory.first();
+        double oldMean = m_mean;
+        m_mean += (value - oldest) / yDataHistory.size();
+        m_m2 += (value - oldest) * (value - m_mean + oldest - oldMean);
+    } else {
+        double delta = value - m_mean;
+        m_mean += delta / (yDataHistory.size() + 1);
+        m_m2 += delta * (value - m_mean);
+    }
+    yDataHistory.append(value);
+
+    // Once the restarted statistics span the whole window they describe exactly
+    // the same samples, so switch over to them to drop accumulated rounding errors
+    double delta = value - m_correctionMean;
+    m_correctionCount++;
+    m_correctionMean += delta / m_correctionCount;
+    m_correctionM2 += delta * (value - m_correctionMean);
+    if (m_correctionCount >= meanSamples) {
+        m_mean = m_correctionMean;
+        m_m2 = m_correctionM2;
+        m_correctionMean = 0;
+        m_correctionM2 = 0;
+        m_correctionCount = 0;
     }
 
-    return false;
+    if (m_mathFunction == MathStandardDeviation) {
+        //Sample standard deviation, with Bessel's correction
+        return sqrt(qMax(m_m2, 0.0) / (meanSamples - 1));
+    }
+
+    return m_mean;
 }
 
-bool ChronoPlotData::append(UAVObject* obj)
+/*!
+  \brief Set the number of pixel columns the whole x window is drawn on,
+  or 0 to always draw every sample.
+  */
+void PlotData::setPlotColumns(int columns)
 {
-    if (uavObject == obj->getName()) {
-        //Get the field of interest
-        UAVObjectField* field =  obj->getField(uavField);
-        //qDebug() << "uavObject: " << uavObject << ", uavField: " << uavField;
-
-        if (field) {
-            QDateTime NOW = QDateTime::currentDateTime(); //THINK ABOUT REIMPLEMENTING THIS TO SHOW UAVO TIME, NOT SYSTEM TIME
-            double currentValue = valueAsDouble(obj, field) * pow(10, scalePower);
-
-            //Perform scope math, if necessary
-            if (mathFunction  == "Boxcar average" || mathFunction  == "Standard deviation"){
-                //Put the new value at the back
-                yDataHistory->append( currentValue );
-
-                // calculate average value
-                meanSum += currentValue;
-                if(yDataHistory->size() > meanSamples) {
-                    meanSum -= yDataHistory->first();
-                    yDataHistory->pop_front();
-                }
-                // make sure to correct the sum every meanSamples steps to prevent it
-                // from running away due to floating point rounding errors
-                correctionSum+=currentValue;
-                if (++correctionCount >= meanSamples) {
-                    meanSum = correctionSum;
-                    correctionSum = 0.0f;
-                    correctionCount = 0;
-                }
-
-                double boxcarAvg=meanSum/yDataHistory->size();
-//qDebug()<<mathFunction;
-                if ( mathFunction  == "Standard deviation" ){
-                    //Calculate square of sample standard deviation, with Bessel's correction
-                    double stdSum=0;
-                    for (int i=0; i < yDataHistory->size(); i++){
-                        stdSum+= pow(yDataHistory->at(i)- boxcarAvg,2)/(meanSamples-1);
-                    }
-                    yData->append(sqrt(stdSum));
-                }
-                else  {
-                    yData->append(boxcarAvg);
-                }
-            }
-            else{
-                yData->append( currentValue );
-            }
-
-            double valueX = NOW.toTime_t() + NOW.time().msec() / 1000.0;
-            xData->append(valueX);
-
-            //qDebug() << "Data  " << uavObject << "." << field->getName() << " X,Y:" << valueX << "," <<  valueY;
-
-            //Remove stale data
-            removeStaleData();
-
-            //notify the gui of chages in the data
-            //dataChanged();
-            return true;
-        }
+    m_plotColumns = columns;
+}
+
+/*!
+  \brief Point the plot curve at the current contents of the sample buffers.
+  When there are many more samples than pixel columns only the min/max
+  envelope is drawn. The curve references the buffers directly, so this only
+  needs to be called after new samples arrived or the buffers were reallocated.
+  */
+void PlotData::updatePlotCurveData()
+{
+    if (!curve)
+        return;
+
+    if (m_plotColumns > 0 && yData.size() > 4 * m_plotColumns &&
+            decimator.envelope(m_xWindowSize / m_plotColumns, xOffset(), m_envelopeX, m_envelopeY)) {
+        curve->setRawSamples(m_envelopeX.constData(), m_envelopeY.constData(), m_envelopeX.size());
+        return;
     }
 
-    return false;
+    curve->setRawSamples(xData.data(), yData.data(), yData.size());
 }
 
-void ChronoPlotData::removeStaleData()
+void SequentialPlotData::setupBuffers()
+{
+    int windowSize = qMax((int)m_xWindowSize, 1);
+
+    // The horizontal axis is just the sample index
+    xData.setCapacity(windowSize);
+    for (int i = 0; i < windowSize; i++)
+        xData.append(i);
+    yData.setCapacity(windowSize);
+
+    // Samples are bucketed by their running sample number
+    decimator.setResolution(qMax(windowSize / MAX_PLOT_COLUMNS, 1), windowSize);
+
+    PlotData::setupBuffers();
+}
+
+double SequentialPlotData::xOffset()
+{
+    // Running sample number of the oldest sample in the window
+    return m_sampleCount - yData.size();
+}
+
+bool SequentialPlotData::append(UAVObject* obj)
+{
+    if (!resolveField(obj))
+        return false;
+
+    //Perform scope math, if necessary. If new data overflows the window, the old data is dropped
+    double valueY = applyMath(readValue());
+    yData.append(valueY);
+
+    decimator.append(m_sampleCount++, valueY);
+    decimator.removeBefore(xOffset());
+
+    //notify the gui of changes in the data
+    //dataChanged();
+    return true;
+}
+
+void ChronoPlotData::setupBuffers()
+{
+    xData.setCapacity(INITIAL_CAPACITY);
+    yData.setCapacity(INITIAL_CAPACITY);
+
+    decimator.setResolution(m_xWindowSize / MAX_PLOT_COLUMNS, m_xWindowSize);
+
+    PlotData::setupBuffers();
+}
+
+bool ChronoPlotData::append(UAVObject* obj)
 {
-    double newestValue;
-    double oldestValue;
+    if (!resolveField(obj))
+        return false;
 
-    while (1) {
-        if (xData->size() == 0)
-            break;
+    QDateTime NOW = QDateTime::currentDateTime(); //THINK ABOUT REIMPLEMENTING THIS TO SHOW UAVO TIME, NOT SYSTEM TIME
+    double valueY = applyMath(readValue());
+    double valueX = NOW.toTime_t() + NOW.time().msec() / 1000.0;
 
-        newestValue = xData->last();
-        oldestValue = xData->first();
+    //Remove the data that falls out of the window once this sample is added
+    removeDataBefore(valueX - m_xWindowSize);
 
-        if (newestValue - oldestValue > m_xWindowSize) {
-            yData->pop_front();
-            xData->pop_front();
-        } else
-            break;
+    // The time window holds a variable number of samples, grow the buffers when full
+    if (xData.isFull()) {
+        xData.setCapacity(xData.capacity() * 2);
+        yData.setCapacity(yData.capacity() * 2);
+        updatePlotCurveData();
     }
 
+    xData.append(valueX);
+    yData.append(valueY);
+    decimator.append(valueX, valueY);
+
+    //notify the gui of chages in the data
+    //dataChanged();
+    return true;
+}
+
+void ChronoPlotData::removeStaleData()
+{
+    if (!xData.isEmpty())
+        removeDataBefore(xData.last() - m_xWindowSize);
+
     //qDebug() << "removeStaleData ";
 }
 
+void ChronoPlotData::removeDataBefore(double oldestValue)
+{
+    while (!xData.isEmpty() && xData.first() < oldestValue) {
+        yData.removeFirst();
+        xData.removeFirst();
+    }
+    decimator.removeBefore(oldestValue);
+}
+
 void ChronoPlotData::removeStaleDataTimeout()
 {
     removeStaleData();
@@ -29,6 +29,8 @@
 #define PLOTDATA_H
 
 #include "uavobject.h"
+#include "uavobjectfield.h"
+#include "plotdecimator.h"
 
 #include "qwt/src/qwt.h"
 #include "qwt/src/qwt_plot.h"
@@ -51,6 +53,47 @@ enum PlotType {
     NPlotTypes
 };
 
+/*!
+\brief Defines the math function applied to the samples of a curve.
+  */
+enum MathFunctionType {
+    MathNone,
+    MathBoxcarAverage,
+    MathStandardDeviation
+};
+
+/*!
+  \brief Fixed capacity circular buffer of samples. Every sample is stored twice,
+  capacity() entries apart, so the buffered samples always form one contiguous
+  span, oldest first, which can be handed to Qwt without copying.
+  */
+class PlotBuffer
+{
+public:
+    PlotBuffer();
+
+    void setCapacity(int capacity);
+    int capacity() const { return m_capacity; }
+    int size() const { return m_size; }
+    bool isEmpty() const { return m_size == 0; }
+    bool isFull() const { return m_size == m_capacity; }
+
+    void append(double value);
+    void removeFirst();
+    void clear();
+
+    double at(int i) const { return m_buffer[m_start + i]; }
+    double first() const { return at(0); }
+    double last() const { return at(m_size - 1); }
+    const double* data() const { return m_buffer.constData() + m_start; }
+
+private:
+    QVector<double> m_buffer;
+    int m_capacity;
+    int m_start;
+    int m_size;
+};
+
 /*!
   \brief Base class that keeps the data for each curve in the plot.
   */
@@ -68,26 +111,50 @@ public:
     bool haveSubField;
     int scalePower; //This is the power to which each value must be raised
     int meanSamples;
-    double meanSum;
     QString mathFunction;
-    double correctionSum;
-    int correctionCount;
     double yMinimum;
     double yMaximum;
     double m_xWindowSize;
     QwtPlotCurve* curve;
-    QVector<double>* xData;
-    QVector<double>* yData;
-    QVector<double>* yDataHistory;
+    PlotBuffer xData;
+    PlotBuffer yData;
+    PlotBuffer yDataHistory;
 
     virtual bool append(UAVObject* obj) = 0;
     virtual PlotType plotType() = 0;
     virtual void removeStaleData() = 0;
 
+    void setPlotColumns(int columns);
     void updatePlotCurveData();
 
 protected:
-    double valueAsDouble(UAVObject* obj, UAVObjectField* field);
+    // Widest plot, in pixels, for which the decimation keeps full detail
+    static const int MAX_PLOT_COLUMNS = 4096;
+
+    PlotDecimator decimator;
+    QVector<double> m_envelopeX;
+    QVector<double> m_envelopeY;
+    int m_plotColumns;
+
+    UAVObject* m_object;
+    UAVObjectField* m_field;
+    quint32 m_elementIndex;
+    double m_scale;
+    MathFunctionType m_mathFunction;
+
+    // Running mean and sum of squared deviations of the samples in yDataHistory
+    double m_mean;
+    double m_m2;
+    // Same statistics restarted every meanSamples samples to bound rounding errors
+    double m_correctionMean;
+    double m_correctionM2;
+    int m_correctionCount;
+
+    bool resolveField(UAVObject* obj);
+    virtual void setupBuffers();
+    virtual double xOffset() { return 0; }
+    double readValue();
+    double applyMath(double value);
 
 signals:
     void dataChanged();
@@ -102,7 +169,7 @@ class SequentialPlotData : public PlotData
     Q_OBJECT
 public:
     SequentialPlotData(QString uavObject, QString uavField)
-            : PlotData(uavObject, uavField) {}
+            : PlotData(uavObject, uavField), m_sampleCount(0) {}
     ~SequentialPlotData() {}
 
     /*!
@@ -121,6 +188,13 @@ public:
       \brief Removes the old data from the buffer
       */
     virtual void removeStaleData(){}
+
+protected:
+    void setupBuffers();
+    double xOffset();
+
+private:
+    qint64 m_sampleCount;
 };
 
 /*!
@@ -145,7 +219,13 @@ public:
 
     virtual void removeStaleData();
 
+protected:
+    void setupBuffers();
+
 private:
+    static const int INITIAL_CAPACITY = 1024;
+
+    void removeDataBefore(double oldestValue);
 
 private slots:
     void removeStaleDataTimeout();
@@ -0,0 +1,169 @@
+/**
+ ******************************************************************************
+ *
+ * @file       plotdecimator.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Min/max level of detail reduction of the scope curves
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "plotdecimator.h"
+#include <math.h>
+
+PlotDecimator::PlotDecimator()
+{
+}
+
+/*!
+  \brief Set the width of the finest buckets and the span of data that is kept,
+  which determines how many levels are needed. Clears all data.
+  */
+void PlotDecimator::setResolution(double baseWidth, double span)
+{
+    m_levels.clear();
+    if (baseWidth <= 0)
+        return;
+
+    double width = baseWidth;
+    do {
+        Level level;
+        level.width = width;
+        level.start = 0;
+        m_levels.append(level);
+        width *= 2;
+    } while (width < span);
+}
+
+/*!
+  \brief Add a sample to the bucket it falls in on every level. Samples are
+  expected in increasing x order.
+  */
+void PlotDecimator::append(double x, double y)
+{
+    for (int i = 0; i < m_levels.size(); i++) {
+        Level &level = m_levels[i];
+        qint64 index = (qint64)floor(x / level.width);
+
+        if (level.start < level.buckets.size() && level.buckets.last().index == index) {
+            Bucket &bucket = level.buckets.last();
+            bucket.lastX = x;
+            bucket.lastY = y;
+            if (y < bucket.minY) {
+                bucket.minX = x;
+                bucket.minY = y;
+            }
+            if (y > bucket.maxY) {
+                bucket.maxX = x;
+                bucket.maxY = y;
+            }
+        } else {
+            Bucket bucket;
+            bucket.index = index;
+            bucket.firstX = bucket.lastX = bucket.minX = bucket.maxX = x;
+            bucket.firstY = bucket.lastY = bucket.minY = bucket.maxY = y;
+            level.buckets.append(bucket);
+        }
+    }
+}
+
+/*!
+  \brief Drop the buckets which only hold samples older than x.
+  */
+void PlotDecimator::removeBefore(double x)
+{
+    for (int i = 0; i < m_levels.size(); i++) {
+        Level &level = m_levels[i];
+        while (level.start < level.buckets.size() && level.buckets[level.start].lastX < x)
+            level.start++;
+
+        // Only compact once the dropped buckets dominate, so this stays O(1) amortized
+        if (level.start > level.buckets.size() / 2) {
+            level.buckets.remove(0, level.start);
+            level.start = 0;
+        }
+    }
+}
+
+void PlotDecimator::clear()
+{
+    for (int i = 0; i < m_levels.size(); i++) {
+        m_levels[i].buckets.clear();
+        m_levels[i].start = 0;
+    }
+}
+
+/*!
+  \brief Build the envelope of the curve for pixel columns of the given width.
+  The coarsest level whose buckets are not wider than a column is used and every
+  bucket contributes its first, extreme and last samples in order.
+  \param columnWidth Width of one pixel column in plot coordinates
+  \param xOffset Value subtracted from the x coordinates of the output
+  \return False if the columns are finer than the base resolution, in which case
+  the raw samples should be drawn instead
+  */
+bool PlotDecimator::envelope(double columnWidth, double xOffset, QVector<double>& xOut, QVector<double>& yOut) const
+{
+    int levelIndex = -1;
+    for (int i = 0; i < m_levels.size() && m_levels[i].width <= columnWidth; i++)
+        levelIndex = i;
+
+    if (levelIndex < 0)
+        return false;
+
+    const Level &level = m_levels[levelIndex];
+
+    xOut.resize(0);
+    yOut.resize(0);
+    xOut.reserve(4 * (level.buckets.size() - level.start));
+    yOut.reserve(4 * (level.buckets.size() - level.start));
+
+    for (int i = level.start; i < level.buckets.size(); i++) {
+        const Bucket &bucket = level.buckets[i];
+
+        double x[4];
+        double y[4];
+        x[0] = bucket.firstX;
+        y[0] = bucket.firstY;
+        if (bucket.minX <= bucket.maxX) {
+            x[1] = bucket.minX;
+            y[1] = bucket.minY;
+            x[2] = bucket.maxX;
+            y[2] = bucket.maxY;
+        } else {
+            x[1] = bucket.maxX;
+            y[1] = bucket.maxY;
+            x[2] = bucket.minX;
+            y[2] = bucket.minY;
+        }
+        x[3] = bucket.lastX;
+        y[3] = bucket.lastY;
+
+        for (int j = 0; j < 4; j++) {
+            // Skip samples that are already in the output
+            if (j > 0 && x[j] == x[j - 1] && y[j] == y[j - 1])
+                continue;
+            xOut.append(x[j] - xOffset);
+            yOut.append(y[j]);
+        }
+    }
+
+    return true;
+}
@@ -0,0 +1,73 @@
+/**
+ ******************************************************************************
+ *
+ * @file       plotdecimator.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup ScopePlugin Scope Gadget Plugin
+ * @{
+ * @brief Min/max level of detail reduction of the scope curves
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef PLOTDECIMATOR_H
+#define PLOTDECIMATOR_H
+
+#include <QVector>
+
+/*!
+  \brief Keeps a min/max summary of a curve at several resolutions.
+
+  Samples are grouped in buckets of a fixed width along the horizontal axis.
+  Level 0 uses the base width and every following level doubles it. Each
+  bucket remembers its first, last, minimum and maximum sample, so drawing one
+  bucket per pixel column keeps the exact envelope of the curve, including
+  short spikes. All levels are updated as samples arrive, so changing the
+  plot width only selects another level instead of rescanning the samples.
+  */
+class PlotDecimator
+{
+public:
+    PlotDecimator();
+
+    void setResolution(double baseWidth, double span);
+    void append(double x, double y);
+    void removeBefore(double x);
+    void clear();
+
+    bool envelope(double columnWidth, double xOffset, QVector<double>& xOut, QVector<double>& yOut) const;
+
+private:
+    struct Bucket {
+        qint64 index;
+        double firstX, firstY;
+        double lastX, lastY;
+        double minX, minY;
+        double maxX, maxY;
+    };
+
+    struct Level {
+        double width;
+        int start;
+        QVector<Bucket> buckets;
+    };
+
+    QVector<Level> m_levels;
+};
+
+#endif // PLOTDECIMATOR_H
@@ -5,6 +5,7 @@ include(../../taulabsgcsplugin.pri)
 include (scope_dependencies.pri)
 HEADERS += scopeplugin.h \
     plotdata.h \
+    plotdecimator.h \
     scope_global.h
 HEADERS += scopegadgetoptionspage.h
 HEADERS += scopegadgetconfiguration.h
@@ -12,7 +13,8 @@ HEADERS += scopegadget.h
 HEADERS += scopegadgetwidget.h
 HEADERS += scopegadgetfactory.h
 SOURCES += scopeplugin.cpp \
-    plotdata.cpp
+    plotdata.cpp \
+    plotdecimator.cpp
 SOURCES += scopegadgetoptionspage.cpp
 SOURCES += scopegadgetconfiguration.cpp
 SOURCES += scopegadget.cpp
@@ -41,6 +41,7 @@
 #include "qwt/src/qwt_legend.h"
 #include "qwt/src/qwt_legend_item.h"
 #include "qwt/src/qwt_plot_grid.h"
+#include "qwt/src/qwt_plot_canvas.h"
 
 #include <iostream>
 #include <math.h>
@@ -438,9 +439,9 @@ void ScopeGadgetWidget::addCurvePlot(QString uavObject, QString uavFieldSubField
 
     QwtPlotCurve* plotCurve = new QwtPlotCurve(curveNameScaled);
     plotCurve->setPen(pen);
-    plotCurve->setSamples(*plotData->xData, *plotData->yData);
-    plotCurve->attach(this);
     plotData->curve = plotCurve;
+    plotData->updatePlotCurveData();
+    plotCurve->attach(this);
 
     //Keep the curve details for later
     m_curvesData.insert(curveNameScaled, plotData);
@@ -491,7 +492,8 @@ void ScopeGadgetWidget::replotNewData()
 	foreach(PlotData* plotData, m_curvesData.values())
 	{
         plotData->removeStaleData();
-        plotData->curve->setSamples(*plotData->xData, *plotData->yData);
+        plotData->setPlotColumns(canvas()->width());
+        plotData->updatePlotCurveData();
     }
 
     QDateTime NOW = QDateTime::currentDateTime();
@@ -673,21 +675,21 @@ int ScopeGadgetWidget::csvLoggingAddData()
     foreach(PlotData* plotData2, m_curvesData.values())
     {
         ss  << ", ";
-        if (plotData2->xData->isEmpty ())
+        if (plotData2->yData.isEmpty ())
         {
             ss  << ", ";
-            if (plotData2->xData->isEmpty ())
+            if (plotData2->yData.isEmpty ())
             {
             }
             else
             {
-                ss  << QString().sprintf("%3.10g",plotData2->yData->last());
+                ss  << QString().sprintf("%3.10g",plotData2->yData.last());
                 m_csvLoggingDataValid=1;
             }
         }
         else
         {
-            ss  << QString().sprintf("%3.10g",plotData2->yData->last());
+            ss  << QString().sprintf("%3.10g",plotData2->yData.last());
             m_csvLoggingDataValid=1;
         }
     }
@@ -0,0 +1,185 @@
+/**
+ ******************************************************************************
+ * @file       tst_uavobjectmanagerbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVObjectsPlugin UAVObjects Plugin
+ * @{
+ * @brief Times the indexed lookups of the UAVObjectManager against the
+ * linear walk over all objects that they replaced
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtCore/QObject>
+#include <QtCore/QElapsedTimer>
+#include <QtTest/QtTest>
+#include <stdio.h>
+
+#include "uavobjects/uavobjectmanager.h"
+#include "uavobjects/uavdataobject.h"
+#include "uavobjects/uavobjectsinit.h"
+
+// The fastest of several batches is reported
+static const int BENCH_BATCHES = 10;
+static const int BENCH_ROUNDS = 200;
+// Instances registered for each multi instance object
+static const quint32 NUM_INSTANCES = 8;
+
+class tst_UAVObjectManagerBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void lookups();
+
+private:
+    UAVObject *linearGetObject(const QString *name, quint32 objId, quint32 instId);
+    double lookupNs(int method);
+
+    UAVObjectManager objMngr;
+    QList< QList<UAVObject*> > objects;
+    QList<quint32> objIds;
+    QStringList names;
+    QList<quint32> instIds;
+};
+
+/**
+ * Register all the objects of shared/uavobjectdefinition and extra
+ * instances of the multi instance ones
+ */
+void tst_UAVObjectManagerBenchmark::initTestCase()
+{
+    UAVObjectsInitialize(&objMngr);
+
+    foreach (const QList<UAVDataObject*> &instances, objMngr.getDataObjects()) {
+        UAVDataObject *obj = instances.first();
+        if (obj->isSingleInstance())
+            continue;
+        for (quint32 instId = instances.size(); instId < NUM_INSTANCES; instId++)
+            QVERIFY(objMngr.registerObject(obj->clone(instId)));
+    }
+
+    // Look up the last instance of every object, which is what the walk
+    // spends the most time on
+    objects = objMngr.getObjects();
+    foreach (const QList<UAVObject*> &instances, objects) {
+        objIds.append(instances.last()->getObjID());
+        names.append(instances.last()->getName());
+        instIds.append(instances.last()->getInstID());
+    }
+
+    QVERIFY(objIds.size() > 0);
+}
+
+/**
+ * The lookup of the manager before the indexes, a walk over every type
+ * and then over the instances of the type that matched
+ */
+UAVObject *tst_UAVObjectManagerBenchmark::linearGetObject(const QString *name, quint32 objId, quint32 instId)
+{
+    for (int objidx = 0; objidx < objects.length(); ++objidx) {
+        UAVObject *obj = objects[objidx][0];
+        if ((name != NULL && obj->getName().compare(*name) == 0) ||
+                (name == NULL && obj->getObjID() == objId)) {
+            for (int inidx = 0; inidx < objects[objidx].length(); ++inidx) {
+                obj = objects[objidx][inidx];
+                if (obj->getInstID() == instId)
+                    return obj;
+            }
+            return NULL;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Look up every object once per round
+ * @param[in] method 0 and 1 for the walk by ID and by name, 2 and 3 for the
+ * manager by ID and by name
+ * @return the time of one lookup in ns
+ */
+double tst_UAVObjectManagerBenchmark::lookupNs(int method)
+{
+    int found = 0;
+    QElapsedTimer timer;
+    timer.start();
+
+    for (int round = 0; round < BENCH_ROUNDS; round++) {
+        for (int i = 0; i < objIds.size(); i++) {
+            UAVObject *obj;
+            switch (method) {
+            case 0:
+                obj = linearGetObject(NULL, objIds[i], instIds[i]);
+                break;
+            case 1:
+                obj = linearGetObject(&names[i], 0, instIds[i]);
+                break;
+            case 2:
+                obj = objMngr.getObject(objIds[i], instIds[i]);
+                break;
+            default:
+                obj = objMngr.getObject(names[i], instIds[i]);
+                break;
+            }
+            found += (obj != NULL);
+        }
+    }
+
+    qint64 ns = timer.nsecsElapsed();
+    // Every lookup has to succeed, this also keeps them from being optimized out
+    if (found != BENCH_ROUNDS * objIds.size())
+        return -1;
+
+    return (double)ns / found;
+}
+
+/* Not a functional test apart from every lookup finding its object */
+void tst_UAVObjectManagerBenchmark::lookups()
+{
+    double best[4] = { 1e12, 1e12, 1e12, 1e12 };
+
+    // Both ways find the same objects
+    for (int i = 0; i < objIds.size(); i++) {
+        QCOMPARE(objMngr.getObject(objIds[i], instIds[i]), linearGetObject(NULL, objIds[i], instIds[i]));
+        QCOMPARE(objMngr.getObject(names[i], instIds[i]), linearGetObject(&names[i], 0, instIds[i]));
+    }
+
+    for (int batch = 0; batch < BENCH_BATCHES; batch++) {
+        for (int method = 0; method < 4; method++) {
+            double ns = lookupNs(method);
+            QVERIFY(ns >= 0);
+            if (ns < best[method])
+                best[method] = ns;
+        }
+    }
+
+    printf("%d object types, ns per lookup by ID: linear %.0f, indexed %.0f\n",
+        objIds.size(), best[0], best[2]);
+    printf("%d object types, ns per lookup by name: linear %.0f, indexed %.0f\n",
+        objIds.size(), best[1], best[3]);
+}
+
+QTEST_MAIN(tst_UAVObjectManagerBenchmark)
+
+#include "tst_uavobjectmanagerbenchmark.moc"
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,13 @@
+# Times the object and instance lookups of the UAVObjectManager
+CONFIG += qtestlib
+TEMPLATE = app
+CONFIG -= app_bundle
+TARGET = uavobjectmanagerbenchmark
+
+include(../../../../gcs.pri)
+
+INCLUDEPATH += $$GCS_SOURCE_TREE/src/plugins
+LIBS += -L$$GCS_PLUGIN_PATH/TauLabs
+include(../uavobjects.pri)
+
+SOURCES += tst_uavobjectmanagerbenchmark.cpp
@@ -264,11 +264,14 @@ UAVObjectField* UAVObject::getField(const QString& name)
 qint32 UAVObject::pack(quint8* dataOut)
 {
     QMutexLocker locker(mutex);
-    qint32 offset = 0;
-    for (int n = 0; n < fields.length(); ++n)
+    if (!packFast(dataOut))
     {
-        fields[n]->pack(&dataOut[offset]);
-        offset += fields[n]->getNumBytes();
+        qint32 offset = 0;
+        for (int n = 0; n < fields.length(); ++n)
+        {
+            fields[n]->pack(&dataOut[offset]);
+            offset += fields[n]->getNumBytes();
+        }
     }
     return numBytes;
 }
@@ -280,11 +283,14 @@ qint32 UAVObject::pack(quint8* dataOut)
 qint32 UAVObject::unpack(const quint8* dataIn)
 {
     QMutexLocker locker(mutex);
-    qint32 offset = 0;
-    for (int n = 0; n < fields.length(); ++n)
+    if (!unpackFast(dataIn))
     {
-        fields[n]->unpack(&dataIn[offset]);
-        offset += fields[n]->getNumBytes();
+        qint32 offset = 0;
+        for (int n = 0; n < fields.length(); ++n)
+        {
+            fields[n]->unpack(&dataIn[offset]);
+            offset += fields[n]->getNumBytes();
+        }
     }
     emit objectUnpacked(this); // trigger object updated event
     emit objectUpdated(this);
@@ -292,6 +298,28 @@ qint32 UAVObject::unpack(const quint8* dataIn)
     return numBytes;
 }
 
+/**
+ * Pack the whole object in one go when the in-memory layout matches the
+ * wire format. Objects with a known fixed layout override this, the
+ * default falls back to packing field by field.
+ * @returns True if the data was packed, false to use the per-field path
+ */
+bool UAVObject::packFast(quint8* dataOut)
+{
+    Q_UNUSED(dataOut);
+    return false;
+}
+
+/**
+ * Unpack the whole object in one go, see packFast().
+ * @returns True if the data was unpacked, false to use the per-field path
+ */
+bool UAVObject::unpackFast(const quint8* dataIn)
+{
+    Q_UNUSED(dataIn);
+    return false;
+}
+
 /**
  * Save the object data to the file.
  * The file will be created in the current directory
@@ -175,6 +175,8 @@ protected:
     void initializeFields(QList<UAVObjectField*>& fields, quint8* data, quint32 numBytes);
     void setDescription(const QString& description);
     void setCategory(const QString& category);
+    virtual bool packFast(quint8* dataOut);
+    virtual bool unpackFast(const quint8* dataIn);
 };
 
 #endif // UAVOBJECT_H
@@ -1043,9 +1043,63 @@ void UAVObjectField::setValue(const QVariant& value, quint32 index)
     }
 }
 
+/**
+ * Get a field element as a double. Numeric types are read directly
+ * from the object data, avoiding the QVariant round trip of getValue().
+ */
 double UAVObjectField::getDouble(quint32 index)
 {
-    return getValue(index).toDouble();
+    QMutexLocker locker(obj->getMutex());
+    // Check that index is not out of bounds
+    if ( index >= numElements )
+    {
+        return 0;
+    }
+    const quint8* element = &data[offset + numBytesPerElement*index];
+    switch (type)
+    {
+    case INT8:
+    {
+        qint8 tmpint8;
+        memcpy(&tmpint8, element, sizeof(tmpint8));
+        return tmpint8;
+    }
+    case INT16:
+    {
+        qint16 tmpint16;
+        memcpy(&tmpint16, element, sizeof(tmpint16));
+        return tmpint16;
+    }
+    case INT32:
+    {
+        qint32 tmpint32;
+        memcpy(&tmpint32, element, sizeof(tmpint32));
+        return tmpint32;
+    }
+    case UINT8:
+        return *element;
+    case UINT16:
+    {
+        quint16 tmpuint16;
+        memcpy(&tmpuint16, element, sizeof(tmpuint16));
+        return tmpuint16;
+    }
+    case UINT32:
+    {
+        quint32 tmpuint32;
+        memcpy(&tmpuint32, element, sizeof(tmpuint32));
+        return tmpuint32;
+    }
+    case FLOAT32:
+    {
+        float tmpfloat;
+        memcpy(&tmpfloat, element, sizeof(tmpfloat));
+        return tmpfloat;
+    }
+    default:
+        // Enums, bitfields and strings keep their QVariant conversion
+        return getValue(index).toDouble();
+    }
 }
 
 void UAVObjectField::setDouble(double value, quint32 index)
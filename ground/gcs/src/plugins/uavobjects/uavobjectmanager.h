@@ -33,6 +33,7 @@
 #include "uavdataobject.h"
 #include "uavmetaobject.h"
 #include <QList>
+#include <QHash>
 #include <QMutex>
 #include <QMutexLocker>
 
@@ -63,9 +64,12 @@ private:
     static const quint32 MAX_INSTANCES = 1000;
 
     QList< QList<UAVObject*> > objects;
+    QHash<quint32, int> objIdIndex;
+    QHash<QString, int> nameIndex;
     QMutex* mutex;
 
     void addObject(UAVObject* obj);
+    int getObjectIndex(const QString* name, quint32 objId);
     UAVObject* getObject(const QString* name, quint32 objId, quint32 instId);
     QList<UAVObject*> getObjectInstances(const QString* name, quint32 objId);
     qint32 getNumInstances(const QString* name, quint32 objId);
@@ -32,6 +32,7 @@
  */
 #include "$(NAMELC).h"
 #include "uavobjectfield.h"
+#include <string.h>
 
 const QString $(NAME)::NAME = QString("$(NAME)");
 const QString $(NAME)::DESCRIPTION = QString("$(DESCRIPTION)");
@@ -114,6 +115,36 @@ void $(NAME)::setData(const DataFields& data)
     }
 }
 
+/**
+ * Pack the object data. The DataFields structure is packed in the same
+ * order as the fields on the wire, so on little endian hosts this is a
+ * single copy. Big endian hosts use the generic per-field path.
+ */
+bool $(NAME)::packFast(quint8* dataOut)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    memcpy(dataOut, &data, NUMBYTES);
+    return true;
+#else
+    Q_UNUSED(dataOut);
+    return false;
+#endif
+}
+
+/**
+ * Unpack the object data, see packFast()
+ */
+bool $(NAME)::unpackFast(const quint8* dataIn)
+{
+#if Q_BYTE_ORDER == Q_LITTLE_ENDIAN
+    memcpy(&data, dataIn, NUMBYTES);
+    return true;
+#else
+    Q_UNUSED(dataIn);
+    return false;
+#endif
+}
+
 void $(NAME)::emitNotifications()
 {
     $(NOTIFY_PROPERTIES_CHANGED)
@@ -78,6 +78,10 @@ $(PROPERTY_SETTERS)
 signals:
 $(PROPERTY_NOTIFICATIONS)
 
+protected:
+    bool packFast(quint8* dataOut);
+    bool unpackFast(const quint8* dataIn);
+
 private slots:
     void emitNotifications();
 	
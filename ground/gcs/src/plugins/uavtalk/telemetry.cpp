@@ -427,24 +427,57 @@ void Telemetry::processObjectUpdates(UAVObject* obj, EventMask event, bool allIn
     processObjectQueue();
 }
 
+/**
+ * Check whether processing the event starts a transaction that waits for
+ * an ack or an object update from the remote end.
+ */
+bool Telemetry::needsTransaction(const ObjectQueueInfo &objInfo)
+{
+    if ( objInfo.event == EV_UPDATE_REQ )
+        return true;
+    if ( objInfo.event == EV_UNPACKED )
+        return false;
+
+    UAVObject::Metadata metadata = objInfo.obj->getMetadata();
+    if ( objInfo.event == EV_UPDATED_PERIODIC && UAVObject::GetGcsTelemetryUpdateMode(metadata) == UAVObject::UPDATEMODE_THROTTLED )
+        return false;
+    return UAVObject::GetGcsTelemetryAcked(metadata);
+}
+
+/**
+ * Take the next event from a queue. While the window of outstanding transactions
+ * is full, only the events that do not start a transaction are taken, the others
+ * stay queued until a transaction completes.
+ */
+bool Telemetry::takeFromQueue(QQueue<ObjectQueueInfo> &queue, bool windowFull, ObjectQueueInfo &objInfo)
+{
+    for (int n = 0; n < queue.length(); ++n)
+    {
+        if ( !windowFull || !needsTransaction(queue[n]) )
+        {
+            objInfo = queue.takeAt(n);
+            return true;
+        }
+    }
+    return false;
+}
+
 /**
  * Process events from the object queue.
+ *
+ * Up to MAX_PENDING_TRANSACTIONS acked updates and object requests are sent
+ * without waiting for the previous ones to complete, so sending many objects
+ * is limited by the link bandwidth instead of its round trip time. Every
+ * transaction has its own timer and only the ones that time out are sent again.
  */
 void Telemetry::processObjectQueue()
 {
-    if (objQueue.length() > 1)
-        qDebug() << "[telemetry.cpp] **************** Object Queue above 1 in backlog ****************";
+    if (objQueue.length() > MAX_PENDING_TRANSACTIONS)
+        qDebug() << "[telemetry.cpp] **************** Object Queue above" << MAX_PENDING_TRANSACTIONS << "in backlog ****************";
     // Get object information from queue (first the priority and then the regular queue)
     ObjectQueueInfo objInfo;
-    if ( !objPriorityQueue.isEmpty() )
-    {
-        objInfo = objPriorityQueue.dequeue();
-    }
-    else if ( !objQueue.isEmpty() )
-    {
-        objInfo = objQueue.dequeue();
-    }
-    else
+    bool windowFull = transMap.size() >= MAX_PENDING_TRANSACTIONS;
+    if ( !takeFromQueue(objPriorityQueue, windowFull, objInfo) && !takeFromQueue(objQueue, windowFull, objInfo) )
     {
         return;
     }
@@ -519,6 +552,11 @@ void Telemetry::processObjectQueue()
             processObjectQueue();
         }
     }
+    else if ( transMap.size() < MAX_PENDING_TRANSACTIONS )
+    {
+        // Keep filling the window of outstanding transactions
+        processObjectQueue();
+    }
 }
 
 /**
@@ -611,6 +649,12 @@ void Telemetry::resetStats()
     txRetries = 0;
 }
 
+void Telemetry::resetDeltaState()
+{
+    QMutexLocker locker(mutex);
+    utalk->resetDeltaState();
+}
+
 void Telemetry::objectUpdatedAuto(UAVObject* obj)
 {
     QMutexLocker locker(mutex);
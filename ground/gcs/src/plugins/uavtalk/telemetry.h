@@ -79,6 +79,7 @@ public:
     ~Telemetry();
     TelemetryStats getStats();
     void resetStats();
+    void resetDeltaState();
     void transactionTimeout(ObjectTransactionInfo *info);
 
 signals:
@@ -89,7 +90,8 @@ private:
     static const int MAX_RETRIES = 2;
     static const int MAX_UPDATE_PERIOD_MS = 1000;
     static const int MIN_UPDATE_PERIOD_MS = 1;
-    static const int MAX_QUEUE_SIZE = 20;
+    static const int MAX_QUEUE_SIZE = 100;
+    static const int MAX_PENDING_TRANSACTIONS = 8;
 
     // Types
     /**
@@ -140,6 +142,8 @@ private:
     void processObjectUpdates(UAVObject* obj, EventMask event, bool allInstances, bool priority);
     void processObjectTransaction(ObjectTransactionInfo *transInfo);
     void processObjectQueue();
+    bool takeFromQueue(QQueue<ObjectQueueInfo> &queue, bool windowFull, ObjectQueueInfo &objInfo);
+    bool needsTransaction(const ObjectQueueInfo &objInfo);
     bool updateTransactionMap(UAVObject* obj, bool request);
 
 
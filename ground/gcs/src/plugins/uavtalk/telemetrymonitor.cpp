@@ -251,6 +251,14 @@ void TelemetryMonitor::processStatsUpdates()
         gcsStatsObj->updated();
     }
 
+    // Keyframes from an earlier link are stale, wait for new ones
+    if (gcsStats.Status != oldStatus &&
+        (gcsStats.Status == GCSTelemetryStats::STATUS_CONNECTED ||
+         gcsStats.Status == GCSTelemetryStats::STATUS_DISCONNECTED))
+    {
+        tel->resetDeltaState();
+    }
+
     // Act on new connections or disconnections
     if (gcsStats.Status == GCSTelemetryStats::STATUS_CONNECTED && gcsStats.Status != oldStatus)
     {
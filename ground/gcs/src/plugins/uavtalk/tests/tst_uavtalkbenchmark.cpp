@@ -0,0 +1,188 @@
+/**
+ ******************************************************************************
+ * @file       tst_uavtalkbenchmark.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @addtogroup GCSPlugins GCS Plugins
+ * @{
+ * @addtogroup UAVTalkPlugin UAVTalk Plugin
+ * @{
+ * @brief Replays a telemetry stream through the byte-wise receive state
+ * machine and through the block receive path and reports packets/s
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtCore/QObject>
+#include <QtCore/QBuffer>
+#include <QtCore/QElapsedTimer>
+#include <QtCore/QFile>
+#include <QtTest/QtTest>
+#include <stdio.h>
+
+#include "uavtalk/uavtalk.h"
+#include "uavobjects/uavobjectsinit.h"
+
+// Copies of the stream replayed by each method, the fastest run is reported
+static const int BENCH_BATCHES = 5;
+// Full speed USB HID reports
+static const int HID_REPORT_SIZE = 64;
+
+/**
+ * Exposes the receive paths of UAVTalk and counts the packets they decode
+ */
+class ReplayTalk : public UAVTalk
+{
+public:
+    ReplayTalk(QIODevice *iodev, UAVObjectManager *objMngr) :
+        UAVTalk(iodev, objMngr), packets(0) {}
+
+    //! The receive path before the block reads, one read per byte
+    void replayBytewise(QIODevice *stream)
+    {
+        char byte;
+        while (stream->getChar(&byte))
+            processInputByte((quint8)byte);
+    }
+
+    //! The block receive path, with the stream arriving in reads of blockSize bytes
+    void replayBlocks(QByteArray &stream, int blockSize)
+    {
+        for (int pos = 0; pos < stream.size(); pos += blockSize)
+            processInputBuffer((quint8 *)stream.data() + pos, qMin(blockSize, stream.size() - pos));
+    }
+
+    quint32 packets;
+
+protected:
+    bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8 *data, qint32 length)
+    {
+        packets++;
+        return UAVTalk::receiveObject(type, objId, instId, data, length);
+    }
+};
+
+class tst_UAVTalkBenchmark : public QObject
+{
+    Q_OBJECT
+
+private slots:
+    void initTestCase();
+    void replay();
+
+private:
+    double replayRate(int method, quint32 &packets);
+
+    UAVObjectManager objMngr;
+    QByteArray stream;
+};
+
+/**
+ * Load the stream to replay. UAVTALK_CAPTURE names a raw capture of a
+ * telemetry link, otherwise every object is sent a number of times by the
+ * transmit path of UAVTalk, as with a full rate telemetry link.
+ */
+void tst_UAVTalkBenchmark::initTestCase()
+{
+    UAVObjectsInitialize(&objMngr);
+
+    QString capture = QString::fromLocal8Bit(qgetenv("UAVTALK_CAPTURE"));
+    if (!capture.isEmpty()) {
+        QFile file(capture);
+        QVERIFY2(file.open(QIODevice::ReadOnly), qPrintable(file.errorString()));
+        stream = file.readAll();
+    } else {
+        QBuffer sink(&stream);
+        sink.open(QIODevice::WriteOnly);
+        UAVTalk talk(&sink, &objMngr);
+        QList< QList<UAVObject*> > objects = objMngr.getObjects();
+        for (int round = 0; round < 100; round++)
+            foreach (const QList<UAVObject*> &instances, objects)
+                foreach (UAVObject *obj, instances)
+                    talk.sendObject(obj, false, false);
+    }
+
+    QVERIFY(!stream.isEmpty());
+}
+
+/**
+ * Decode the whole stream with one method
+ * @param[in] method 0 for the byte-wise path, 1 for USB HID sized reads,
+ * 2 for the whole stream in one read
+ * @param[out] packets The number of packets decoded
+ * @return the packets per second
+ */
+double tst_UAVTalkBenchmark::replayRate(int method, quint32 &packets)
+{
+    QByteArray copy = stream;
+    QBuffer source(&copy);
+    QBuffer sink;
+    source.open(QIODevice::ReadOnly);
+    sink.open(QIODevice::WriteOnly);
+
+    ReplayTalk talk(&sink, &objMngr);
+    QElapsedTimer timer;
+    timer.start();
+
+    switch (method) {
+    case 0:
+        talk.replayBytewise(&source);
+        break;
+    case 1:
+        talk.replayBlocks(copy, HID_REPORT_SIZE);
+        break;
+    default:
+        talk.replayBlocks(copy, copy.size());
+        break;
+    }
+
+    qint64 ns = timer.nsecsElapsed();
+    packets = talk.packets;
+
+    return ns > 0 ? packets * 1e9 / ns : 0;
+}
+
+/* Not a functional test apart from both paths decoding the same packets */
+void tst_UAVTalkBenchmark::replay()
+{
+    static const char *names[] = { "byte-wise", "64 byte reads", "single read" };
+    double best[3] = { 0, 0, 0 };
+    quint32 packets[3];
+
+    for (int batch = 0; batch < BENCH_BATCHES; batch++) {
+        for (int method = 0; method < 3; method++) {
+            double rate = replayRate(method, packets[method]);
+            if (rate > best[method])
+                best[method] = rate;
+        }
+    }
+
+    QVERIFY(packets[0] > 0);
+    QCOMPARE(packets[1], packets[0]);
+    QCOMPARE(packets[2], packets[0]);
+
+    printf("%u packets, %d bytes\n", packets[0], stream.size());
+    for (int method = 0; method < 3; method++)
+        printf("packets/s %s: %.0f\n", names[method], best[method]);
+}
+
+QTEST_MAIN(tst_UAVTalkBenchmark)
+
+#include "tst_uavtalkbenchmark.moc"
+
+/**
+ * @}
+ * @}
+ */
@@ -0,0 +1,14 @@
+# Replays a UAVTalk stream through the byte-wise and the block receive paths
+CONFIG += qtestlib
+TEMPLATE = app
+CONFIG -= app_bundle
+QT += network
+TARGET = uavtalkbenchmark
+
+include(../../../../gcs.pri)
+
+INCLUDEPATH += $$GCS_SOURCE_TREE/src/plugins
+LIBS += -L$$GCS_PLUGIN_PATH/TauLabs
+include(../uavtalk.pri)
+
+SOURCES += tst_uavtalkbenchmark.cpp
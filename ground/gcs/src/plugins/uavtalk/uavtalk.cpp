@@ -78,8 +78,9 @@ UAVTalk::UAVTalk(QIODevice* iodev, UAVObjectManager* objMngr)
 
     connect(io, SIGNAL(readyRead()), this, SLOT(processInputStream()));
     ExtensionSystem::PluginManager *pm = ExtensionSystem::PluginManager::instance();
-    Core::Internal::GeneralSettings * settings=pm->getObject<Core::Internal::GeneralSettings>();
-    useUDPMirror=settings->useUDPMirror();
+    // Without the core plugin (e.g. in the benchmarks) there is no mirror
+    Core::Internal::GeneralSettings * settings = pm ? pm->getObject<Core::Internal::GeneralSettings>() : NULL;
+    useUDPMirror = settings != NULL && settings->useUDPMirror();
     qDebug()<<"[uavtalk.cpp] Use UDP: "<<useUDPMirror;
     if(useUDPMirror)
     {
@@ -109,6 +110,16 @@ void UAVTalk::resetStats()
     memset(&stats, 0, sizeof(ComStats));
 }
 
+/**
+ * Forget the keyframes of the objects received as deltas, called when
+ * the link is reset so deltas against a stale keyframe are dropped
+ */
+void UAVTalk::resetDeltaState()
+{
+    QMutexLocker locker(mutex);
+    deltaKeyframes.clear();
+}
+
 /**
  * Get the statistics counters
  */
@@ -123,17 +134,148 @@ UAVTalk::ComStats UAVTalk::getStats()
  */
 void UAVTalk::processInputStream()
 {
-    quint8 tmp;
-
     if (io && io->isReadable()) {
         while (io->bytesAvailable() > 0)
         {
-            io->read((char*)&tmp, 1);
-            processInputByte(tmp);
+            // Drain everything that is pending in one read into a buffer
+            // which is reused across calls
+            qint64 available = io->bytesAvailable();
+            if (rxStreamBuffer.size() < available)
+                rxStreamBuffer.resize(available);
+
+            qint64 bytesRead = io->read(rxStreamBuffer.data(), available);
+            if (bytesRead <= 0)
+                break;
+
+            processInputBuffer((quint8*)rxStreamBuffer.data(), bytesRead);
+        }
+    }
+}
+
+/**
+ * Process a block of bytes from the telemetry stream. Complete packets
+ * are framed directly from the buffer, only packets which are split
+ * across reads go through the byte-wise state machine.
+ * \param[in] data Received bytes
+ * \param[in] length Number of bytes in data
+ */
+void UAVTalk::processInputBuffer(quint8* data, qint32 length)
+{
+    qint32 pos = 0;
+
+    while (pos < length)
+    {
+        // Finish any packet left over from the previous read
+        if (rxState != STATE_SYNC)
+        {
+            processInputByte(data[pos++]);
+            continue;
         }
+
+        // Skip ahead to the next sync byte
+        quint8* sync = (quint8*)memchr(&data[pos], SYNC_VAL, length - pos);
+        if (sync == NULL)
+        {
+            stats.rxBytes += length - pos;
+            return;
+        }
+        qint32 skipped = sync - &data[pos];
+        stats.rxBytes += skipped;
+        pos += skipped;
+
+        qint32 consumed = processInputPacket(&data[pos], length - pos);
+        if (consumed == 0)
+        {
+            // Not enough data for the whole packet, hand the rest to the
+            // state machine so it can carry over into the next read
+            while (pos < length)
+                processInputByte(data[pos++]);
+            return;
+        }
+
+        stats.rxBytes += consumed;
+        pos += consumed;
     }
 }
 
+/**
+ * Frame and process a packet starting at a sync byte from a contiguous buffer.
+ * On a framing error the same number of bytes is dropped as the byte-wise
+ * state machine would have dropped, so both paths resynchronize identically.
+ * \param[in] data Buffer starting with the sync byte
+ * \param[in] length Number of bytes available in data
+ * \return Number of bytes consumed, or 0 if the packet is not complete
+ */
+qint32 UAVTalk::processInputPacket(quint8* data, qint32 length)
+{
+    // Need at least the header with the object ID to make any decision
+    if (length < MIN_HEADER_LENGTH)
+        return 0;
+
+    quint8 type = data[1];
+    if ((type & TYPE_MASK) != TYPE_VER)
+        return 2;
+
+    qint32 size = qFromLittleEndian<quint16>(&data[2]);
+    if (size < MIN_HEADER_LENGTH || size > MAX_HEADER_LENGTH + MAX_PAYLOAD_LENGTH)
+        return 4;
+
+    quint32 objId = qFromLittleEndian<quint32>(&data[4]);
+    UAVObject *obj = objMngr->getObject(objId);
+    if (obj == NULL && type != TYPE_OBJ_REQ)
+    {
+        stats.rxErrors++;
+        return MIN_HEADER_LENGTH;
+    }
+
+    quint16 dataLength = 0;
+    qint32 instanceLength = 0;
+    if (type == TYPE_OBJ_MULTI || type == TYPE_OBJ_DELTA)
+    {
+        // The records after the first object ID are decoded by receiveMultiObject()
+        // and deltas, including their instance ID, by receiveDeltaObject()
+        dataLength = size - MIN_HEADER_LENGTH;
+    }
+    else
+    {
+        if (type != TYPE_OBJ_REQ && type != TYPE_ACK && type != TYPE_NACK)
+            dataLength = obj->getNumBytes();
+        instanceLength = (obj == NULL || obj->isSingleInstance()) ? 0 : 2;
+    }
+
+    if (dataLength >= MAX_PAYLOAD_LENGTH || (MIN_HEADER_LENGTH + instanceLength + dataLength) != size)
+    {
+        stats.rxErrors++;
+        return MIN_HEADER_LENGTH;
+    }
+
+    // Wait for the rest of the packet
+    if (length < size + CHECKSUM_LENGTH)
+        return 0;
+
+    if (updateCRC(0, data, size) != data[size])
+    {
+        stats.rxErrors++;
+        return size + CHECKSUM_LENGTH;
+    }
+
+    quint16 instId = 0;
+    if (instanceLength > 0)
+        instId = qFromLittleEndian<quint16>(&data[MIN_HEADER_LENGTH]);
+
+    mutex->lock();
+        receiveObject(type, objId, instId, &data[MIN_HEADER_LENGTH + instanceLength], dataLength);
+        if(useUDPMirror)
+        {
+            udpSocketTx->writeDatagram((const char*)data, size + CHECKSUM_LENGTH, QHostAddress::LocalHost, udpSocketRx->localPort());
+        }
+        stats.rxObjectBytes += dataLength;
+        stats.rxObjects++;
+    mutex->unlock();
+
+    return size + CHECKSUM_LENGTH;
+}
+
 void UAVTalk::dummyUDPRead()
 {
     QUdpSocket *socket=qobject_cast<QUdpSocket*>(sender());
@@ -313,7 +455,13 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
                 }
 
                 // Determine data length
-                if (rxType == TYPE_OBJ_REQ || rxType == TYPE_ACK || rxType == TYPE_NACK)
+                if (rxType == TYPE_OBJ_MULTI || rxType == TYPE_OBJ_DELTA)
+                {
+                    // The records after the first object ID are decoded by receiveMultiObject()
+                    // and deltas, including their instance ID, by receiveDeltaObject()
+                    rxLength = packetSize - rxPacketLength;
+                }
+                else if (rxType == TYPE_OBJ_REQ || rxType == TYPE_ACK || rxType == TYPE_NACK)
                 {
                     rxLength = 0;
                 }
@@ -321,7 +469,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
                 {
                     rxLength = rxObj->getNumBytes();
                 }
-                rxInstanceLength = (rxObj->isSingleInstance() ? 0 : 2);
+                rxInstanceLength = ((rxObj == NULL || rxObj->isSingleInstance() || rxType == TYPE_OBJ_MULTI || rxType == TYPE_OBJ_DELTA) ? 0 : 2);
 
                 // Check length and determine next state
                 if (rxLength >= MAX_PAYLOAD_LENGTH)
@@ -351,7 +499,7 @@ bool UAVTalk::processInputByte(quint8 rxbyte)
                    rxInstId = 0;
                    rxCount = 0;
                 }
-                else if (rxObj->isSingleInstance())
+                else if (rxObj->isSingleInstance() || rxType == TYPE_OBJ_MULTI || rxType == TYPE_OBJ_DELTA)
                 {
                     // If there is a payload get it, otherwise receive checksum
                     if (rxLength > 0)
@@ -500,6 +648,12 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8*
             error = true;
         }
         break;
+    case TYPE_OBJ_MULTI: // We have received several objects in one frame
+        error = !receiveMultiObject(objId, data, length);
+        break;
+    case TYPE_OBJ_DELTA: // We have received the fields of an object that changed
+        error = !receiveDeltaObject(objId, data, length);
+        break;
     case TYPE_OBJ_ACK: // We have received an object and are asked for an ACK
         // All instances, not allowed for OBJ_ACK messages
         if (!allInstances)
@@ -588,6 +742,124 @@ bool UAVTalk::receiveObject(quint8 type, quint32 objId, quint16 instId, quint8*
     return !error;
 }
 
+/**
+ * Unpack the objects of a multi-object frame. The frame holds one record per object,
+ * made of its object ID, its instance ID for multi instance objects and its data.
+ * The ID of the first object is in the packet header, so the data starts with the
+ * instance ID or data of the first object.
+ * Records can only be told apart with the object definitions, so decoding stops
+ * at the first unknown object.
+ * \param[in] objId ID of the first object
+ * \param[in] data Frame contents after the first object ID
+ * \param[in] length Length of data
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::receiveMultiObject(quint32 objId, quint8* data, qint32 length)
+{
+    qint32 pos = 0;
+    while (true)
+    {
+        UAVObject* obj = objMngr->getObject(objId);
+        if (obj == NULL)
+            return false;
+
+        qint32 instanceLength = obj->isSingleInstance() ? 0 : 2;
+        qint32 dataLength = obj->getNumBytes();
+        if (pos + instanceLength + dataLength > length)
+            return false;
+
+        quint16 instId = 0;
+        if (instanceLength > 0)
+            instId = qFromLittleEndian<quint16>(&data[pos]);
+        pos += instanceLength;
+
+        if (updateObject(objId, instId, &data[pos]) == NULL)
+            return false;
+        pos += dataLength;
+
+        if (pos == length)
+            return true;
+
+        // Next record
+        if (pos + 4 > length)
+            return false;
+        objId = qFromLittleEndian<quint32>(&data[pos]);
+        pos += 4;
+        stats.rxObjects++;
+    }
+}
+
+/**
+ * Apply a delta update of an object. The data starts with the instance ID for multi
+ * instance objects, followed by the checksum of the keyframe the delta is based on,
+ * a mask with one bit per field and the data of the fields set in the mask.
+ * A delta with every field set is a keyframe and replaces the stored one. Deltas
+ * against another keyframe than the stored one are dropped, the next keyframe
+ * brings the object back in sync.
+ * \param[in] objId ID of the object
+ * \param[in] data Packet contents after the object ID
+ * \param[in] length Length of data
+ * \return Success (true), Failure (false)
+ */
+bool UAVTalk::receiveDeltaObject(quint32 objId, quint8* data, qint32 length)
+{
+    UAVObject* obj = objMngr->getObject(objId);
+    if (obj == NULL)
+        return false;
+
+    QList<UAVObjectField*> fields = obj->getFields();
+    qint32 instanceLength = obj->isSingleInstance() ? 0 : 2;
+    qint32 maskLength = (fields.length() + 7) / 8;
+    if (instanceLength + 1 + maskLength > length)
+        return false;
+
+    quint16 instId = 0;
+    if (instanceLength > 0)
+        instId = qFromLittleEndian<quint16>(data);
+    quint8 baseCrc = data[instanceLength];
+    const quint8* mask = &data[instanceLength + 1];
+    qint32 pos = instanceLength + 1 + maskLength;
+
+    bool keyframe = true;
+    for (int n = 0; n < fields.length(); ++n)
+        keyframe = keyframe && (mask[n / 8] & (1 << (n % 8)));
+
+    quint64 key = ((quint64)objId << 16) | instId;
+    QByteArray state;
+    if (keyframe)
+    {
+        state.fill(0, obj->getNumBytes());
+    }
+    else
+    {
+        state = deltaKeyframes.value(key);
+        if (state.size() != (int)obj->getNumBytes() || updateCRC(0, (const quint8*)state.constData(), state.size()) != baseCrc)
+            return false;
+    }
+
+    // Fields are packed in order, as in UAVObject::pack()
+    qint32 offset = 0;
+    for (int n = 0; n < fields.length(); ++n)
+    {
+        qint32 numBytes = fields[n]->getNumBytes();
+        if (mask[n / 8] & (1 << (n % 8)))
+        {
+            if (pos + numBytes > length)
+                return false;
+            memcpy(state.data() + offset, &data[pos], numBytes);
+            pos += numBytes;
+        }
+        offset += numBytes;
+    }
+    if (pos != length)
+        return false;
+
+    if (keyframe)
+        deltaKeyframes.insert(key, state);
+
+    return updateObject(objId, instId, (quint8*)state.data()) != NULL;
+}
+
 /**
  * Update the data of an object from a byte array (unpack).
  * If the object instance could not be found in the list, then a
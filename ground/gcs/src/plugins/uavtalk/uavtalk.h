@@ -60,6 +60,7 @@ public:
     bool sendObjectRequest(UAVObject* obj, bool allInstances);
     ComStats getStats();
     void resetStats();
+    void resetDeltaState();
 
 signals:
     // The only signals we send to the upper level are when we
@@ -81,6 +82,8 @@ protected:
     static const int TYPE_OBJ_ACK = (TYPE_VER | 0x02);
     static const int TYPE_ACK = (TYPE_VER | 0x03);
     static const int TYPE_NACK = (TYPE_VER | 0x04);
+    static const int TYPE_OBJ_MULTI = (TYPE_VER | 0x05);
+    static const int TYPE_OBJ_DELTA = (TYPE_VER | 0x06);
 
     static const int MIN_HEADER_LENGTH = 8; // sync(1), type (1), size(2), object ID(4)
     static const int MAX_HEADER_LENGTH = 10; // sync(1), type (1), size(2), object ID (4), instance ID(2, not used in single objects)
@@ -125,11 +128,18 @@ protected:
     QUdpSocket * udpSocketTx;
     QUdpSocket * udpSocketRx;
     QByteArray rxDataArray;
+    QByteArray rxStreamBuffer;
+    //! Last keyframe received for the objects sent as deltas, by object and instance ID
+    QHash<quint64, QByteArray> deltaKeyframes;
 
     // Methods
     bool objectTransaction(UAVObject* obj, quint8 type, bool allInstances);
     bool processInputByte(quint8 rxbyte);
+    void processInputBuffer(quint8* data, qint32 length);
+    qint32 processInputPacket(quint8* data, qint32 length);
     virtual bool receiveObject(quint8 type, quint32 objId, quint16 instId, quint8* data, qint32 length);
+    bool receiveMultiObject(quint32 objId, quint8* data, qint32 length);
+    bool receiveDeltaObject(quint32 objId, quint8* data, qint32 length);
     UAVObject* updateObject(quint32 objId, quint16 instId, quint8* data);
     bool transmitNack(quint32 objId);
     bool transmitObject(UAVObject* obj, quint8 type, bool allInstances);
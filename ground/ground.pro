@@ -34,11 +34,15 @@ TEMPLATE  = subdirs
 SUBDIRS = \
         sub_gcs \
         sub_uavobjects \
-        sub_uavobjgenerator
+        sub_uavobjgenerator \
+        sub_logdecoder
 
 # uavobjgenerator
 sub_uavobjgenerator.subdir = uavobjgenerator
 
+# logdecoder
+sub_logdecoder.subdir = logdecoder
+
 # uavobjects
 sub_uavobjects.subdir  = uavobjects
 sub_uavobjects.depends = sub_uavobjgenerator
@@ -0,0 +1,492 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logdecoder.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Decodes GCS log files without replaying them through the GCS.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include "logdecoder.h"
+#include <QtEndian>
+#include <string.h>
+
+
+const quint8 LogDecoder::crc_table[256] = {
+    0x00, 0x07, 0x0e, 0x09, 0x1c, 0x1b, 0x12, 0x15, 0x38, 0x3f, 0x36, 0x31, 0x24, 0x23, 0x2a, 0x2d,
+    0x70, 0x77, 0x7e, 0x79, 0x6c, 0x6b, 0x62, 0x65, 0x48, 0x4f, 0x46, 0x41, 0x54, 0x53, 0x5a, 0x5d,
+    0xe0, 0xe7, 0xee, 0xe9, 0xfc, 0xfb, 0xf2, 0xf5, 0xd8, 0xdf, 0xd6, 0xd1, 0xc4, 0xc3, 0xca, 0xcd,
+    0x90, 0x97, 0x9e, 0x99, 0x8c, 0x8b, 0x82, 0x85, 0xa8, 0xaf, 0xa6, 0xa1, 0xb4, 0xb3, 0xba, 0xbd,
+    0xc7, 0xc0, 0xc9, 0xce, 0xdb, 0xdc, 0xd5, 0xd2, 0xff, 0xf8, 0xf1, 0xf6, 0xe3, 0xe4, 0xed, 0xea,
+    0xb7, 0xb0, 0xb9, 0xbe, 0xab, 0xac, 0xa5, 0xa2, 0x8f, 0x88, 0x81, 0x86, 0x93, 0x94, 0x9d, 0x9a,
+    0x27, 0x20, 0x29, 0x2e, 0x3b, 0x3c, 0x35, 0x32, 0x1f, 0x18, 0x11, 0x16, 0x03, 0x04, 0x0d, 0x0a,
+    0x57, 0x50, 0x59, 0x5e, 0x4b, 0x4c, 0x45, 0x42, 0x6f, 0x68, 0x61, 0x66, 0x73, 0x74, 0x7d, 0x7a,
+    0x89, 0x8e, 0x87, 0x80, 0x95, 0x92, 0x9b, 0x9c, 0xb1, 0xb6, 0xbf, 0xb8, 0xad, 0xaa, 0xa3, 0xa4,
+    0xf9, 0xfe, 0xf7, 0xf0, 0xe5, 0xe2, 0xeb, 0xec, 0xc1, 0xc6, 0xcf, 0xc8, 0xdd, 0xda, 0xd3, 0xd4,
+    0x69, 0x6e, 0x67, 0x60, 0x75, 0x72, 0x7b, 0x7c, 0x51, 0x56, 0x5f, 0x58, 0x4d, 0x4a, 0x43, 0x44,
+    0x19, 0x1e, 0x17, 0x10, 0x05, 0x02, 0x0b, 0x0c, 0x21, 0x26, 0x2f, 0x28, 0x3d, 0x3a, 0x33, 0x34,
+    0x4e, 0x49, 0x40, 0x47, 0x52, 0x55, 0x5c, 0x5b, 0x76, 0x71, 0x78, 0x7f, 0x6a, 0x6d, 0x64, 0x63,
+    0x3e, 0x39, 0x30, 0x37, 0x22, 0x25, 0x2c, 0x2b, 0x06, 0x01, 0x08, 0x0f, 0x1a, 0x1d, 0x14, 0x13,
+    0xae, 0xa9, 0xa0, 0xa7, 0xb2, 0xb5, 0xbc, 0xbb, 0x96, 0x91, 0x98, 0x9f, 0x8a, 0x8d, 0x84, 0x83,
+    0xde, 0xd9, 0xd0, 0xd7, 0xc2, 0xc5, 0xcc, 0xcb, 0xe6, 0xe1, 0xe8, 0xef, 0xfa, 0xfd, 0xf4, 0xf3
+};
+
+LogDecoder::LogDecoder() :
+    format(FORMAT_CSV),
+    logData(NULL),
+    dataStart(0),
+    dataEnd(0),
+    indexed(false)
+{
+}
+
+LogDecoder::~LogDecoder()
+{
+    close();
+}
+
+/**
+ * Build the data layouts of all objects known to the parser. The fields
+ * are already in the order used by the generated code, which packs them
+ * without padding.
+ * @returns false if no objects were found
+ */
+bool LogDecoder::loadDefinitions(UAVObjectParser *parser)
+{
+    layouts.clear();
+
+    for (int objidx = 0; objidx < parser->getNumObjects(); ++objidx) {
+        ObjectInfo *info = parser->getObjectByIndex(objidx);
+
+        ObjectLayout layout;
+        layout.name = info->name;
+        layout.id = info->id;
+        layout.isSingleInst = info->isSingleInst;
+        layout.numBytes = info->numBytes;
+
+        int offset = 0;
+        foreach (FieldInfo *field, info->fields) {
+            for (int n = 0; n < field->numElements; ++n) {
+                ColumnInfo column;
+                if (field->numElements == 1)
+                    column.name = field->name;
+                else
+                    column.name = field->name + "_" + field->elementNames[n];
+                column.type = field->type;
+                column.offset = offset;
+                column.numBytes = field->numBytes;
+                column.options = field->options;
+                layout.columns.append(column);
+                offset += field->numBytes;
+            }
+        }
+
+        layouts.insert(layout.id, layout);
+    }
+
+    return !layouts.isEmpty();
+}
+
+const ObjectLayout *LogDecoder::getLayout(quint32 objId) const
+{
+    QHash<quint32, ObjectLayout>::const_iterator it = layouts.constFind(objId);
+    if (it == layouts.constEnd())
+        return NULL;
+    return &it.value();
+}
+
+/**
+ * Map the log file into memory and split it in time chunks
+ * @param fileName The log file
+ * @param error Set to a description of the problem on failure
+ */
+bool LogDecoder::open(const QString &fileName, QString *error)
+{
+    close();
+
+    file.setFileName(fileName);
+    if (!file.open(QIODevice::ReadOnly)) {
+        *error = QString("Unable to open %1").arg(fileName);
+        return false;
+    }
+
+    if (file.size() == 0) {
+        *error = QString("Empty log file %1").arg(fileName);
+        file.close();
+        return false;
+    }
+
+    logData = file.map(0, file.size());
+    if (logData == NULL) {
+        *error = QString("Unable to map %1").arg(fileName);
+        file.close();
+        return false;
+    }
+
+    dataStart = 0;
+    dataEnd = file.size();
+    if (!parseHeader())
+        dataStart = 0;
+
+    indexed = loadIndex();
+    if (!indexed)
+        buildChunks();
+
+    return true;
+}
+
+void LogDecoder::close()
+{
+    if (logData != NULL) {
+        file.unmap(const_cast<uchar *>(logData));
+        logData = NULL;
+    }
+    if (file.isOpen())
+        file.close();
+
+    chunkStart.clear();
+    gitHash.clear();
+    uavoHash.clear();
+    indexed = false;
+}
+
+/**
+ * Skip the text header with the git and UAVO hashes. Logs without the
+ * header are decoded from the start, like the GCS does.
+ */
+bool LogDecoder::parseHeader()
+{
+    const char *text = (const char *)logData;
+    qint64 length = qMin(dataEnd, (qint64)1024);
+
+    QList<QByteArray> lines;
+    qint64 pos = 0;
+    while (pos < length && lines.size() < 14) {
+        const char *end = (const char *)memchr(text + pos, '\n', length - pos);
+        if (end == NULL)
+            return false;
+        QByteArray line(text + pos, end - (text + pos));
+        pos = end - text + 1;
+
+        if (line == "##") {
+            if (lines.size() >= 3) {
+                gitHash = QString::fromLatin1(lines[1].trimmed());
+                uavoHash = QString::fromLatin1(lines[2].trimmed());
+            }
+            dataStart = pos;
+            return true;
+        }
+        lines.append(line);
+    }
+    return false;
+}
+
+/**
+ * Use the index at the end of the log to find the chunks without reading
+ * the records. The index starts with the position of the first record of
+ * every second.
+ */
+bool LogDecoder::loadIndex()
+{
+    if (dataEnd - dataStart < RECORD_HEADER_LENGTH + INDEX_TRAILER_LENGTH)
+        return false;
+
+    const uchar *trailer = logData + dataEnd - INDEX_TRAILER_LENGTH;
+    qint64 indexPos = qFromLittleEndian<qint64>(trailer);
+    quint32 version = qFromLittleEndian<quint32>(trailer + 8);
+    quint32 magic = qFromLittleEndian<quint32>(trailer + 12);
+
+    if (magic != INDEX_MAGIC || version != LOG_FORMAT_VERSION ||
+            indexPos < dataStart || indexPos > dataEnd - RECORD_HEADER_LENGTH - INDEX_TRAILER_LENGTH)
+        return false;
+
+    qint64 indexSize = qFromLittleEndian<qint64>(logData + indexPos + 4);
+    if (indexSize != dataEnd - indexPos - RECORD_HEADER_LENGTH)
+        return false;
+
+    const uchar *index = logData + indexPos + RECORD_HEADER_LENGTH;
+    quint32 numSeconds = qFromLittleEndian<quint32>(index);
+    if (4 + (qint64)numSeconds * 8 > indexSize)
+        return false;
+
+    chunkStart.clear();
+    for (quint32 second = 0; second < numSeconds; second += CHUNK_SECONDS) {
+        qint64 pos = qFromLittleEndian<qint64>(index + 4 + second * 8);
+        if (pos < dataStart || pos > indexPos) {
+            chunkStart.clear();
+            return false;
+        }
+        // Seconds without data share the position of the next record
+        if (chunkStart.isEmpty() || pos > chunkStart.last())
+            chunkStart.append(pos);
+    }
+
+    dataEnd = indexPos;
+    return true;
+}
+
+/**
+ * Find the chunks by walking the record headers, for logs without index
+ */
+void LogDecoder::buildChunks()
+{
+    chunkStart.clear();
+
+    qint64 pos = dataStart;
+    quint32 timeStamp;
+    qint64 dataSize;
+    quint32 lastChunk = 0;
+
+    while (nextRecord(pos, dataEnd, timeStamp, dataSize)) {
+        quint32 chunk = timeStamp / 1000 / CHUNK_SECONDS;
+        if (chunkStart.isEmpty() || chunk != lastChunk) {
+            chunkStart.append(pos);
+            lastChunk = chunk;
+        }
+        pos += RECORD_HEADER_LENGTH + dataSize;
+    }
+}
+
+/**
+ * Read the header of the record at pos. Like the GCS replay, bytes are
+ * skipped until the upper bytes of the size are zero.
+ * @param pos Position of the record, moved forward past skipped bytes
+ * @param end End of the data to read
+ * @returns false if there are no more complete records
+ */
+bool LogDecoder::nextRecord(qint64 &pos, qint64 end, quint32 &timeStamp, qint64 &dataSize) const
+{
+    while (pos + RECORD_HEADER_LENGTH <= end) {
+        timeStamp = qFromLittleEndian<quint32>(logData + pos);
+        dataSize = qFromLittleEndian<qint64>(logData + pos + 4);
+
+        if ((dataSize & Q_INT64_C(0xFFFFFFFFFFFF0000)) == 0)
+            return pos + RECORD_HEADER_LENGTH + dataSize <= dataEnd;
+
+        pos++;
+    }
+    return false;
+}
+
+/**
+ * Decode all records of one chunk. Chunks do not share any state, so they
+ * can be decoded in parallel.
+ */
+DecodedChunk LogDecoder::decodeChunk(int chunk) const
+{
+    DecodedChunk decoded;
+    decoded.packets = 0;
+    decoded.errors = 0;
+
+    qint64 pos = chunkStart[chunk];
+    qint64 end = (chunk + 1 < chunkStart.size()) ? chunkStart[chunk + 1] : dataEnd;
+    quint32 timeStamp;
+    qint64 dataSize;
+
+    while (pos < end && nextRecord(pos, end, timeStamp, dataSize)) {
+        decodeRecord(timeStamp, logData + pos + RECORD_HEADER_LENGTH, dataSize, decoded);
+        pos += RECORD_HEADER_LENGTH + dataSize;
+    }
+
+    return decoded;
+}
+
+/**
+ * Frame the UAVTalk packets of one record. Each record normally holds
+ * exactly one packet, anything that does not check out is skipped up to
+ * the next sync byte.
+ */
+void LogDecoder::decodeRecord(quint32 timeStamp, const uchar *data, qint64 length, DecodedChunk &chunk) const
+{
+    qint64 pos = 0;
+
+    while (pos + MIN_HEADER_LENGTH + CHECKSUM_LENGTH <= length) {
+        if (data[pos] != SYNC_VAL) {
+            const uchar *sync = (const uchar *)memchr(data + pos, SYNC_VAL, length - pos);
+            if (sync == NULL)
+                return;
+            pos = sync - data;
+            continue;
+        }
+
+        const uchar *packet = data + pos;
+        quint8 type = packet[1];
+        qint32 size = qFromLittleEndian<quint16>(packet + 2);
+        if ((type & TYPE_MASK) != TYPE_VER || size < MIN_HEADER_LENGTH ||
+                size > MAX_HEADER_LENGTH + MAX_PAYLOAD_LENGTH ||
+                pos + size + CHECKSUM_LENGTH > length ||
+                updateCRC(0, packet, size) != packet[size]) {
+            chunk.errors++;
+            pos++;
+            continue;
+        }
+        pos += size + CHECKSUM_LENGTH;
+
+        if (type == TYPE_OBJ_MULTI) {
+            decodeMultiObject(timeStamp, packet, size, chunk);
+            continue;
+        }
+
+        // Requests, acks and metadata carry no object data
+        if (type != TYPE_OBJ && type != TYPE_OBJ_ACK)
+            continue;
+
+        const ObjectLayout *layout = getLayout(qFromLittleEndian<quint32>(packet + 4));
+        if (layout == NULL)
+            continue;
+
+        int instanceLength = layout->isSingleInst ? 0 : 2;
+        if (MIN_HEADER_LENGTH + instanceLength + layout->numBytes != size) {
+            chunk.errors++;
+            continue;
+        }
+
+        quint16 instId = 0;
+        if (instanceLength > 0)
+            instId = qFromLittleEndian<quint16>(packet + MIN_HEADER_LENGTH);
+
+        appendObject(layout, timeStamp, instId, packet + MIN_HEADER_LENGTH + instanceLength, chunk);
+    }
+}
+
+/**
+ * Decode the records of a multi-object frame, each made of the object ID,
+ * the instance ID for multi instance objects and the object data. Records
+ * can only be told apart with the object definitions, so decoding stops at
+ * the first unknown object.
+ */
+void LogDecoder::decodeMultiObject(quint32 timeStamp, const uchar *packet, qint32 size, DecodedChunk &chunk) const
+{
+    qint32 pos = 4;
+
+    while (pos + 4 <= size) {
+        const ObjectLayout *layout = getLayout(qFromLittleEndian<quint32>(packet + pos));
+        int instanceLength = (layout == NULL || layout->isSingleInst) ? 0 : 2;
+        if (layout == NULL || pos + 4 + instanceLength + layout->numBytes > size) {
+            chunk.errors++;
+            return;
+        }
+        pos += 4;
+
+        quint16 instId = 0;
+        if (instanceLength > 0)
+            instId = qFromLittleEndian<quint16>(packet + pos);
+        pos += instanceLength;
+
+        appendObject(layout, timeStamp, instId, packet + pos, chunk);
+        pos += layout->numBytes;
+    }
+}
+
+/**
+ * Add the data of one object to the streams of the chunk
+ */
+void LogDecoder::appendObject(const ObjectLayout *layout, quint32 timeStamp, quint16 instId, const uchar *data, DecodedChunk &chunk) const
+{
+    QVector<QByteArray> &streams = chunk.streams[layout->id];
+    if (format == FORMAT_CSV) {
+        if (streams.isEmpty())
+            streams.resize(1);
+        appendCSV(layout, timeStamp, instId, data, streams[0]);
+    } else {
+        if (streams.isEmpty())
+            streams.resize(1 + (layout->isSingleInst ? 0 : 1) + layout->columns.size());
+        appendColumns(layout, timeStamp, instId, data, streams);
+    }
+    chunk.packets++;
+}
+
+/**
+ * Append one CSV line with the timestamp, instance and all columns
+ */
+void LogDecoder::appendCSV(const ObjectLayout *layout, quint32 timeStamp, quint16 instId, const uchar *data, QByteArray &out) const
+{
+    out.append(QByteArray::number(timeStamp));
+    if (!layout->isSingleInst) {
+        out.append(',');
+        out.append(QByteArray::number(instId));
+    }
+
+    foreach (const ColumnInfo &column, layout->columns) {
+        const uchar *value = data + column.offset;
+        out.append(',');
+        switch (column.type) {
+        case FIELDTYPE_INT8:
+            out.append(QByteArray::number((qint8)value[0]));
+            break;
+        case FIELDTYPE_INT16:
+            out.append(QByteArray::number(qFromLittleEndian<qint16>(value)));
+            break;
+        case FIELDTYPE_INT32:
+            out.append(QByteArray::number(qFromLittleEndian<qint32>(value)));
+            break;
+        case FIELDTYPE_UINT8:
+            out.append(QByteArray::number(value[0]));
+            break;
+        case FIELDTYPE_UINT16:
+            out.append(QByteArray::number(qFromLittleEndian<quint16>(value)));
+            break;
+        case FIELDTYPE_UINT32:
+            out.append(QByteArray::number(qFromLittleEndian<quint32>(value)));
+            break;
+        case FIELDTYPE_FLOAT32:
+        {
+            quint32 bits = qFromLittleEndian<quint32>(value);
+            float f;
+            memcpy(&f, &bits, sizeof(f));
+            out.append(QByteArray::number(f, 'g', 9));
+            break;
+        }
+        case FIELDTYPE_ENUM:
+            if (value[0] < column.options.size())
+                out.append(column.options[value[0]].toLatin1());
+            else
+                out.append(QByteArray::number(value[0]));
+            break;
+        }
+    }
+    out.append('\n');
+}
+
+/**
+ * Append the raw little endian values to the column streams
+ */
+void LogDecoder::appendColumns(const ObjectLayout *layout, quint32 timeStamp, quint16 instId, const uchar *data, QVector<QByteArray> &out) const
+{
+    int stream = 0;
+    uchar buf[4];
+
+    qToLittleEndian<quint32>(timeStamp, buf);
+    out[stream++].append((const char *)buf, 4);
+    if (!layout->isSingleInst) {
+        qToLittleEndian<quint16>(instId, buf);
+        out[stream++].append((const char *)buf, 2);
+    }
+
+    foreach (const ColumnInfo &column, layout->columns)
+        out[stream++].append((const char *)data + column.offset, column.numBytes);
+}
+
+quint8 LogDecoder::updateCRC(quint8 crc, const uchar *data, qint32 length) const
+{
+    while (length--)
+        crc = crc_table[crc ^ *data++];
+    return crc;
+}
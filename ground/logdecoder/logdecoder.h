@@ -0,0 +1,148 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logdecoder.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Decodes GCS log files without replaying them through the GCS.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#ifndef LOGDECODER_H
+#define LOGDECODER_H
+
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+#include <QStringList>
+#include <QVector>
+#include <QByteArray>
+
+#include "../uavobjgenerator/uavobjectparser.h"
+
+/**
+ * One output column, which is a single element of a field
+ */
+typedef struct {
+    QString name;
+    FieldType type;
+    int offset; /** Position in the object data **/
+    int numBytes;
+    QStringList options; /** Enum option names **/
+} ColumnInfo;
+
+/**
+ * Data layout of an object, as generated from its definition
+ */
+typedef struct {
+    QString name;
+    quint32 id;
+    bool isSingleInst;
+    int numBytes;
+    QList<ColumnInfo> columns;
+} ObjectLayout;
+
+/**
+ * Decoded output of a part of the log, with one list of streams for every
+ * object ID that was found. CSV output has a single stream per object, the
+ * column store has one stream per column.
+ */
+typedef struct {
+    QHash<quint32, QVector<QByteArray> > streams;
+    quint32 packets;
+    quint32 errors;
+} DecodedChunk;
+
+class LogDecoder
+{
+public:
+    typedef enum {
+        FORMAT_CSV = 0,
+        FORMAT_COLUMNS
+    } OutputFormat;
+
+    LogDecoder();
+    ~LogDecoder();
+
+    bool loadDefinitions(UAVObjectParser *parser);
+    void setFormat(OutputFormat format) { this->format = format; }
+    OutputFormat getFormat() const { return format; }
+
+    bool open(const QString &fileName, QString *error);
+    void close();
+    QString getGitHash() const { return gitHash; }
+    QString getUAVOHash() const { return uavoHash; }
+    bool hasIndex() const { return indexed; }
+
+    int getNumChunks() const { return chunkStart.size(); }
+    DecodedChunk decodeChunk(int chunk) const;
+
+    const ObjectLayout *getLayout(quint32 objId) const;
+
+private:
+    // Log records are a 32 bit timestamp in ms, a 64 bit data size and
+    // the UAVTalk packet, as written by the GCS logging plugin (LogFile)
+    static const qint64 RECORD_HEADER_LENGTH = 12;
+    static const qint64 INDEX_TRAILER_LENGTH = 16;
+    static const quint32 LOG_FORMAT_VERSION = 2;
+    static const quint32 INDEX_MAGIC = 0x58494C54; // "TLIX"
+
+    // Length of the time chunks the log is split in for decoding
+    static const quint32 CHUNK_SECONDS = 10;
+
+    static const quint8 SYNC_VAL = 0x3C;
+    static const quint8 TYPE_MASK = 0xF8;
+    static const quint8 TYPE_VER = 0x20;
+    static const quint8 TYPE_OBJ = (TYPE_VER | 0x00);
+    static const quint8 TYPE_OBJ_ACK = (TYPE_VER | 0x02);
+    static const quint8 TYPE_OBJ_MULTI = (TYPE_VER | 0x05);
+    static const int MIN_HEADER_LENGTH = 8; // sync(1), type (1), size(2), object ID(4)
+    static const int MAX_HEADER_LENGTH = 10; // sync(1), type (1), size(2), object ID (4), instance ID(2, not used in single objects)
+    static const int MAX_PAYLOAD_LENGTH = 256;
+    static const int CHECKSUM_LENGTH = 1;
+    static const quint8 crc_table[256];
+
+    bool parseHeader();
+    bool loadIndex();
+    void buildChunks();
+    bool nextRecord(qint64 &pos, qint64 end, quint32 &timeStamp, qint64 &dataSize) const;
+    void decodeRecord(quint32 timeStamp, const uchar *data, qint64 length, DecodedChunk &chunk) const;
+    void decodeMultiObject(quint32 timeStamp, const uchar *packet, qint32 size, DecodedChunk &chunk) const;
+    void appendObject(const ObjectLayout *layout, quint32 timeStamp, quint16 instId, const uchar *data, DecodedChunk &chunk) const;
+    void appendCSV(const ObjectLayout *layout, quint32 timeStamp, quint16 instId, const uchar *data, QByteArray &out) const;
+    void appendColumns(const ObjectLayout *layout, quint32 timeStamp, quint16 instId, const uchar *data, QVector<QByteArray> &out) const;
+    quint8 updateCRC(quint8 crc, const uchar *data, qint32 length) const;
+
+    QHash<quint32, ObjectLayout> layouts;
+    OutputFormat format;
+
+    QFile file;
+    const uchar *logData;
+    qint64 dataStart;
+    qint64 dataEnd;
+    bool indexed;
+    QString gitHash;
+    QString uavoHash;
+
+    //! Position of the first record of each time chunk
+    QVector<qint64> chunkStart;
+};
+
+#endif // LOGDECODER_H
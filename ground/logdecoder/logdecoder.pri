@@ -0,0 +1,12 @@
+# Headless decoder for GCS log files. The object layouts come from the
+# UAVObject definitions, parsed with the same code as uavobjgenerator.
+QT += xml
+
+INCLUDEPATH += $$PWD
+
+SOURCES += $$PWD/logdecoder.cpp \
+    $$PWD/logwriter.cpp \
+    $$PWD/../uavobjgenerator/uavobjectparser.cpp
+HEADERS += $$PWD/logdecoder.h \
+    $$PWD/logwriter.h \
+    $$PWD/../uavobjgenerator/uavobjectparser.h
@@ -0,0 +1,17 @@
+QT -= gui
+
+macx {
+    QMAKE_CFLAGS_X86_64 += -mmacosx-version-min=10.7
+    QMAKE_CXXFLAGS_X86_64 = $$QMAKE_CFLAGS_X86_64
+}
+
+TARGET = logdecoder
+CONFIG += console
+CONFIG -= app_bundle
+TEMPLATE = app
+
+include(logdecoder.pri)
+
+SOURCES += main.cpp \
+    ../uavobjgenerator/generators/generator_io.cpp
+HEADERS += ../uavobjgenerator/generators/generator_io.h
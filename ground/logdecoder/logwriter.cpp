@@ -0,0 +1,151 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logwriter.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Writes decoded logs as CSV files or as a column store.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#include "logwriter.h"
+
+LogWriter::LogWriter(const LogDecoder *decoder, const QString &outputPath) :
+    decoder(decoder),
+    outputDir(outputPath)
+{
+}
+
+LogWriter::~LogWriter()
+{
+    close();
+}
+
+/**
+ * Append a chunk to the output files, creating them for objects that
+ * were not seen before
+ * @returns false on a write error, see getError()
+ */
+bool LogWriter::write(const DecodedChunk &chunk)
+{
+    QHash<quint32, QVector<QByteArray> >::const_iterator it;
+    for (it = chunk.streams.constBegin(); it != chunk.streams.constEnd(); ++it) {
+        const ObjectLayout *layout = decoder->getLayout(it.key());
+        if (layout == NULL)
+            continue;
+
+        QList<QFile *> *objectFiles = openFiles(layout);
+        if (objectFiles == NULL)
+            return false;
+
+        const QVector<QByteArray> &streams = it.value();
+        for (int n = 0; n < streams.size() && n < objectFiles->size(); ++n) {
+            if (objectFiles->at(n)->write(streams[n]) != streams[n].size()) {
+                error = QString("Unable to write %1").arg(objectFiles->at(n)->fileName());
+                return false;
+            }
+        }
+    }
+
+    return true;
+}
+
+void LogWriter::close()
+{
+    foreach (QList<QFile *> *objectFiles, files) {
+        qDeleteAll(*objectFiles);
+        delete objectFiles;
+    }
+    files.clear();
+}
+
+/**
+ * Get the output files of an object, in the order of the decoded streams
+ */
+QList<QFile *> *LogWriter::openFiles(const ObjectLayout *layout)
+{
+    QList<QFile *> *objectFiles = files.value(layout->id, NULL);
+    if (objectFiles != NULL)
+        return objectFiles;
+
+    QStringList fileNames;
+    QByteArray csvHeader;
+    if (decoder->getFormat() == LogDecoder::FORMAT_CSV) {
+        fileNames.append(outputDir.filePath(layout->name + ".csv"));
+
+        csvHeader.append("timestamp");
+        if (!layout->isSingleInst)
+            csvHeader.append(",instance");
+        foreach (const ColumnInfo &column, layout->columns)
+            csvHeader.append(',').append(column.name.toLatin1());
+        csvHeader.append('\n');
+    } else {
+        QDir objectDir(outputDir.filePath(layout->name));
+        if (!outputDir.mkpath(layout->name)) {
+            error = QString("Unable to create %1").arg(objectDir.path());
+            return NULL;
+        }
+
+        fileNames.append(objectDir.filePath("timestamp.u32"));
+        if (!layout->isSingleInst)
+            fileNames.append(objectDir.filePath("instance.u16"));
+        foreach (const ColumnInfo &column, layout->columns)
+            fileNames.append(objectDir.filePath(column.name + "." + typeSuffix(column.type)));
+    }
+
+    objectFiles = new QList<QFile *>();
+    files.insert(layout->id, objectFiles);
+
+    foreach (const QString &fileName, fileNames) {
+        QFile *file = new QFile(fileName);
+        objectFiles->append(file);
+        if (!file->open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+            error = QString("Unable to open %1").arg(fileName);
+            return NULL;
+        }
+    }
+
+    if (!csvHeader.isEmpty())
+        objectFiles->first()->write(csvHeader);
+
+    return objectFiles;
+}
+
+QString LogWriter::typeSuffix(FieldType type) const
+{
+    switch (type) {
+    case FIELDTYPE_INT8:
+        return "i8";
+    case FIELDTYPE_INT16:
+        return "i16";
+    case FIELDTYPE_INT32:
+        return "i32";
+    case FIELDTYPE_UINT8:
+    case FIELDTYPE_ENUM:
+        return "u8";
+    case FIELDTYPE_UINT16:
+        return "u16";
+    case FIELDTYPE_UINT32:
+        return "u32";
+    case FIELDTYPE_FLOAT32:
+        return "f32";
+    }
+    return "bin";
+}
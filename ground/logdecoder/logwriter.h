@@ -0,0 +1,66 @@
+/**
+ ******************************************************************************
+ *
+ * @file       logwriter.h
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Writes decoded logs as CSV files or as a column store.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QList>
+#include <QString>
+
+#include "logdecoder.h"
+
+/**
+ * Writes the decoded chunks of a log, in order. CSV output is one file per
+ * object, the column store is one directory per object with a file of raw
+ * little endian values per column. The column files are named after the
+ * column and their type (for example Roll.f32), so they can be read back
+ * directly as arrays.
+ */
+class LogWriter
+{
+public:
+    LogWriter(const LogDecoder *decoder, const QString &outputPath);
+    ~LogWriter();
+
+    bool write(const DecodedChunk &chunk);
+    void close();
+    QString getError() const { return error; }
+
+private:
+    QList<QFile *> *openFiles(const ObjectLayout *layout);
+    QString typeSuffix(FieldType type) const;
+
+    const LogDecoder *decoder;
+    QDir outputDir;
+    QHash<quint32, QList<QFile *> *> files;
+    QString error;
+};
+
+#endif // LOGWRITER_H
@@ -0,0 +1,220 @@
+/**
+ ******************************************************************************
+ *
+ * @file       main.cpp
+ * @author     Tau Labs, http://taulabs.org, Copyright (C) 2013
+ * @brief      Converts GCS log files to CSV files or a column store.
+ *
+ * @see        The GNU Public License (GPL) Version 3
+ *
+ *****************************************************************************/
+/*
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 3 of the License, or
+ * (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+ * or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+ * for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with this program; if not, write to the Free Software Foundation, Inc.,
+ * 59 Temple Place, Suite 330, Boston, MA 02111-1307 USA
+ */
+
+#include <QtCore/QCoreApplication>
+#include <QtConcurrentMap>
+#include <QThreadPool>
+#include <QFileInfo>
+#include <QDir>
+#include <QTime>
+#include <iostream>
+
+#include "../uavobjgenerator/generators/generator_io.h"
+#include "logdecoder.h"
+#include "logwriter.h"
+
+#define RETURN_ERR_USAGE 1
+#define RETURN_ERR_XML 2
+#define RETURN_ERR_LOG 3
+#define RETURN_OK 0
+
+using namespace std;
+
+/**
+ * print usage info
+ */
+void usage() {
+    cout << "Usage: logdecoder [-csv] [-columns] [-jN] [-v] xml_path output_path log1.tll [... logN.tll]" << endl;
+    cout << "Formats: "<< endl;
+    cout << "\t-csv           one CSV file per object (default)" << endl;
+    cout << "\t-columns       one directory per object with a binary file per column" << endl;
+    cout << "Misc: "<< endl;
+    cout << "\t-jN            decode with N threads, default is one per core" << endl;
+    cout << "\t-h             this help" << endl;
+    cout << "\t-v             verbose" << endl;
+    cout << "\txml_path       path to the UAVObject definition (.xml) files the logs were made with." << endl;
+    cout << "\toutput_path    the output of each log goes to a directory named after the log in here." << endl;
+}
+
+/**
+ * inform user of invalid usage
+ */
+int usage_err() {
+    cout << "Invalid usage!" << endl;
+    usage();
+    return RETURN_ERR_USAGE;
+}
+
+/**
+ * Adapter to decode chunks with QtConcurrent
+ */
+struct ChunkDecoder {
+    typedef DecodedChunk result_type;
+
+    ChunkDecoder(const LogDecoder *decoder) : decoder(decoder) {}
+    DecodedChunk operator()(int chunk) const { return decoder->decodeChunk(chunk); }
+
+    const LogDecoder *decoder;
+};
+
+/**
+ * Decode one log. Chunks are decoded in parallel in batches of a few per
+ * thread and written in order, so the memory used does not grow with the
+ * length of the log.
+ */
+int decodeLog(LogDecoder *decoder, const QString &logPath, const QString &outputPath, bool verbose)
+{
+    QString error;
+    QTime time;
+    time.start();
+
+    if (!decoder->open(logPath, &error)) {
+        cout << "Error: " << error.toStdString() << endl;
+        return RETURN_ERR_LOG;
+    }
+
+    if (verbose) {
+        cout << "Decoding " << logPath.toStdString() << " (git hash " << decoder->getGitHash().toStdString()
+             << ", UAVO hash " << decoder->getUAVOHash().toStdString() << ", "
+             << decoder->getNumChunks() << " chunks, " << (decoder->hasIndex() ? "indexed" : "not indexed") << ")" << endl;
+    }
+
+    QDir outputDir(outputPath);
+    QString logName = QFileInfo(logPath).completeBaseName();
+    if (!outputDir.mkpath(logName)) {
+        cout << "Error: Unable to create " << outputDir.filePath(logName).toStdString() << endl;
+        return RETURN_ERR_LOG;
+    }
+
+    LogWriter writer(decoder, outputDir.filePath(logName));
+    quint64 packets = 0;
+    quint64 errors = 0;
+    int batchSize = 4 * QThreadPool::globalInstance()->maxThreadCount();
+
+    for (int first = 0; first < decoder->getNumChunks(); first += batchSize) {
+        QList<int> batch;
+        for (int chunk = first; chunk < first + batchSize && chunk < decoder->getNumChunks(); ++chunk)
+            batch.append(chunk);
+
+        QList<DecodedChunk> decoded = QtConcurrent::blockingMapped<QList<DecodedChunk> >(batch, ChunkDecoder(decoder));
+
+        foreach (const DecodedChunk &chunk, decoded) {
+            if (!writer.write(chunk)) {
+                cout << "Error: " << writer.getError().toStdString() << endl;
+                return RETURN_ERR_LOG;
+            }
+            packets += chunk.packets;
+            errors += chunk.errors;
+        }
+    }
+
+    writer.close();
+    decoder->close();
+
+    cout << "Done: " << logPath.toStdString() << ", " << packets << " objects decoded, "
+         << errors << " bad packets, " << time.elapsed() << " ms" << endl;
+    return RETURN_OK;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    cout << "- Tau Labs Log Decoder -" << endl;
+
+    QStringList arguments_stringlist;
+
+    // process arguments
+    for (int argi=1;argi<argc;argi++)
+        arguments_stringlist << argv[argi];
+
+    if (arguments_stringlist.removeAll("-h")>0) {
+      usage();
+      return RETURN_OK;
+    }
+
+    bool verbose=(arguments_stringlist.removeAll("-v")>0);
+    bool do_csv=(arguments_stringlist.removeAll("-csv")>0);
+    bool do_columns=(arguments_stringlist.removeAll("-columns")>0);
+
+    if (do_csv && do_columns)
+        return usage_err();
+
+    for (int argi=arguments_stringlist.length()-1;argi>=0;argi--) {
+        QString arg = arguments_stringlist.at(argi);
+        if (arg.startsWith("-j")) {
+            bool ok;
+            int threads = arg.mid(2).toInt(&ok);
+            if (!ok || threads < 1)
+                return usage_err();
+            QThreadPool::globalInstance()->setMaxThreadCount(threads);
+            arguments_stringlist.removeAt(argi);
+        }
+    }
+
+    if (arguments_stringlist.length() < 3)
+        return usage_err();
+
+    QString inputpath = arguments_stringlist.at(0);
+    QString outputpath = arguments_stringlist.at(1);
+
+    // Parse the object definitions the logs were made with
+    QDir xmlPath = QDir(inputpath);
+    UAVObjectParser* parser = new UAVObjectParser();
+
+    xmlPath.setNameFilters(QStringList("*.xml"));
+    QFileInfoList xmlList = xmlPath.entryInfoList();
+
+    for (int n = 0; n < xmlList.length(); ++n) {
+        QFileInfo fileinfo = xmlList[n];
+        if (verbose)
+          cout << "Parsing XML file: " << fileinfo.fileName().toStdString() << endl;
+        QString filename = fileinfo.fileName();
+        QString xmlstr = readFile(fileinfo.absoluteFilePath());
+
+        QString res = parser->parseXML(xmlstr, filename);
+
+        if (!res.isNull()) {
+            cout << "Error parsing " << fileinfo.fileName().toStdString() << ": " << res.toStdString() << endl;
+            return RETURN_ERR_XML;
+        }
+    }
+
+    LogDecoder decoder;
+    decoder.setFormat(do_columns ? LogDecoder::FORMAT_COLUMNS : LogDecoder::FORMAT_CSV);
+    if (!decoder.loadDefinitions(parser)) {
+        cout << "Error: No UAVObject definitions found in " << inputpath.toStdString() << endl;
+        return RETURN_ERR_XML;
+    }
+
+    int result = RETURN_OK;
+    for (int argi=2;argi<arguments_stringlist.length();argi++) {
+        if (decodeLog(&decoder, arguments_stringlist.at(argi), outputpath, verbose) != RETURN_OK)
+            result = RETURN_ERR_LOG;
+    }
+
+    return result;
+}
@@ -25,6 +25,7 @@
  */
 
 #include "uavobjectgeneratorflight.h"
+#include <QMap>
 
 using namespace std;
 
@@ -33,7 +34,9 @@ bool UAVObjectGeneratorFlight::generate(UAVObjectParser* parser,QString template
     fieldTypeStrC << "int8_t" << "int16_t" << "int32_t" <<"uint8_t"
             <<"uint16_t" << "uint32_t" << "float" << "uint8_t";
 
-    QString flightObjInit,objInc,objFileNames,objNames;
+    QString flightObjInit,objInc,objFileNames,objNames,objIds,objFieldsIndex,objFieldOffsets;
+    QList<quint32> ids;
+    QMap<quint32, ObjectInfo*> objectsById;
     qint32 sizeCalc;
     flightCodePath = QDir( templatepath + QString("flight/targets/UAVObjects"));
     flightOutputPath = QDir( outputpath + QString("flight") );
@@ -63,8 +66,32 @@ bool UAVObjectGeneratorFlight::generate(UAVObjectParser* parser,QString template
 	if (parser->getNumBytes(objidx)>sizeCalc) {
 		sizeCalc = parser->getNumBytes(objidx);
 	}
+	ids.append(info->id);
+	objectsById.insert(info->id, info);
     }
 
+    // The object manager finds objects by a binary search in the sorted IDs,
+    // the field offsets are listed in the same order
+    qSort(ids);
+    int numFields = 0;
+    for (int n = 0; n < ids.length(); ++n) {
+        objIds.append("    0x" + QString().setNum(ids[n], 16).toUpper() + ", \\\r\n");
+
+        ObjectInfo* info = objectsById[ids[n]];
+        objFieldsIndex.append("    " + QString().setNum(numFields) + ", \\\r\n");
+        if (info->fields.length() > 0) {
+            int offset = 0;
+            objFieldOffsets.append("   ");
+            for (int f = 0; f < info->fields.length(); ++f) {
+                objFieldOffsets.append(" " + QString().setNum(offset) + ",");
+                offset += info->fields[f]->numBytes * info->fields[f]->numElements;
+            }
+            objFieldOffsets.append(" \\\r\n");
+        }
+        numFields += info->fields.length();
+    }
+    objFieldsIndex.append("    " + QString().setNum(numFields) + ", \\\r\n");
+
     // Write the flight object inialization files
     flightInitTemplate.replace( QString("$(OBJINC)"), objInc);
     flightInitTemplate.replace( QString("$(OBJINIT)"), flightObjInit);
@@ -77,6 +104,10 @@ bool UAVObjectGeneratorFlight::generate(UAVObjectParser* parser,QString template
 
     // Write the flight object initialization header
     flightInitIncludeTemplate.replace( QString("$(SIZECALCULATION)"), QString().setNum(sizeCalc));
+    flightInitIncludeTemplate.replace( QString("$(OBJCOUNT)"), QString().setNum(ids.length()));
+    flightInitIncludeTemplate.replace( QString("$(OBJIDS)"), objIds);
+    flightInitIncludeTemplate.replace( QString("$(OBJFIELDSINDEX)"), objFieldsIndex);
+    flightInitIncludeTemplate.replace( QString("$(OBJFIELDOFFSETS)"), objFieldOffsets);
     res = writeFileIfDiffrent( flightOutputPath.absolutePath() + "/uavobjectsinit.h",
                      flightInitIncludeTemplate );
     if (!res) {